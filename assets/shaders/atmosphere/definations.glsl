@@ -39,6 +39,21 @@ struct AtmosphereParameters {
     vec3 ground_albedo;
 };
 
+// std140 packing of AtmosphereParameters for uniform buffers, filled by PackAtmosphereParameters on the cpu
+struct AtmosphereUbData {
+    vec4 radii; // bottom_radius, top_radius, mie_g, sun_angular_radius
+    vec4 solar_irradiance; // w is mu_s_min
+    vec4 rayleigh_scattering;
+    vec4 mie_scattering;
+    vec4 mie_extinction;
+    vec4 absorption_extinction;
+    vec4 ground_albedo;
+    // width, exp_term, exp_scale, linear_term of the rayleigh, mie and absorption layers
+    vec4 density_layers[6];
+    // constant_term of the same six layers
+    vec4 density_constant_terms[2];
+};
+
 #define COMBINED_SCATTERING_TEXTURES
 
 #define Length float
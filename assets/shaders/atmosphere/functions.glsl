@@ -1,37 +1,31 @@
 #include "definations.glsl"
 
-AtmosphereParameters GetAtmosphereParameters()
+DensityProfileLayer UnpackDensityProfileLayer(AtmosphereUbData data, int i)
+{
+    vec4 layer = data.density_layers[i];
+    return DensityProfileLayer(layer.x, layer.y, layer.z, layer.w, data.density_constant_terms[i / 4][i % 4]);
+}
+
+AtmosphereParameters UnpackAtmosphereParameters(AtmosphereUbData data)
 {
     AtmosphereParameters atmosphere;
-    atmosphere.bottom_radius = 6360.0f;
-    atmosphere.top_radius = 6460.0f;
-    // TODO: light is not a part of sky model
-    atmosphere.solar_irradiance = vec3(1.0f);
-    atmosphere.sun_angular_radius = 0.004675f;
-
-    float rayleigh_scale_height = 8.0f;
-    float mie_scale_height = 1.2f;
-
-    // Raleigh scattering
-    atmosphere.rayleigh_density.layers[0] = DensityProfileLayer(0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
-    atmosphere.rayleigh_density.layers[1] = DensityProfileLayer(0.0f, 1.0f, -1.0f / rayleigh_scale_height, 0.0f, 0.0f);
-    atmosphere.rayleigh_scattering = vec3(0.005802f, 0.013558f, 0.033100f); // 1/km
-
-    // Mie scattering
-    atmosphere.mie_density.layers[0] = DensityProfileLayer(0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
-    atmosphere.mie_density.layers[1] = DensityProfileLayer(0.0f, 1.0f, -1.0f / mie_scale_height, 0.0f, 0.0f);
-    atmosphere.mie_scattering = vec3(0.003996f, 0.003996f, 0.003996f); // 1/km
-    atmosphere.mie_extinction = vec3(0.004440f, 0.004440f, 0.004440f); // 1/km
-    atmosphere.mie_g = 0.8;
-
-    // Ozone absorption
-    atmosphere.absorption_density.layers[0] = DensityProfileLayer(25.0f, 0.0f, 0.0f, 1.0f / 15.0f, -2.0f / 3.0f);
-    atmosphere.absorption_density.layers[1] = DensityProfileLayer(0.0f, 0.0f, 0.0f, -1.0f / 15.0f, 8.0f / 3.0f);
-    atmosphere.absorption_extinction = vec3(0.000650f, 0.001881f, 0.000085f); // 1/km
-    atmosphere.ground_albedo = vec3(0.0, 0.0, 0.0);
-
-    const float max_sun_zenith_angle = 120.0 / 180.0 * PI;
-    atmosphere.mu_s_min = cos(max_sun_zenith_angle);
+    atmosphere.bottom_radius = data.radii.x;
+    atmosphere.top_radius = data.radii.y;
+    atmosphere.mie_g = data.radii.z;
+    atmosphere.sun_angular_radius = data.radii.w;
+    atmosphere.solar_irradiance = data.solar_irradiance.xyz;
+    atmosphere.mu_s_min = data.solar_irradiance.w;
+    atmosphere.rayleigh_scattering = data.rayleigh_scattering.xyz;
+    atmosphere.mie_scattering = data.mie_scattering.xyz;
+    atmosphere.mie_extinction = data.mie_extinction.xyz;
+    atmosphere.absorption_extinction = data.absorption_extinction.xyz;
+    atmosphere.ground_albedo = data.ground_albedo.xyz;
+    atmosphere.rayleigh_density.layers[0] = UnpackDensityProfileLayer(data, 0);
+    atmosphere.rayleigh_density.layers[1] = UnpackDensityProfileLayer(data, 1);
+    atmosphere.mie_density.layers[0] = UnpackDensityProfileLayer(data, 2);
+    atmosphere.mie_density.layers[1] = UnpackDensityProfileLayer(data, 3);
+    atmosphere.absorption_density.layers[0] = UnpackDensityProfileLayer(data, 4);
+    atmosphere.absorption_density.layers[1] = UnpackDensityProfileLayer(data, 5);
     return atmosphere;
 }
 
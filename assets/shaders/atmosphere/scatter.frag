@@ -4,12 +4,16 @@
 
 layout(location = 0) out vec4 out_color;
 
+#include "functions.glsl"
+
 layout(set = 0, binding = 0) uniform ScatteringUb {
     mat4 inv_view_projection_matrix;
     vec2 resolution;
     vec2 pad0;
     vec3 camera_position;
     float pad1;
+    // parameters the sampled luts were computed with
+    AtmosphereUbData atmosphere_data;
 } scattering_ub;
 
 layout(set = 0, binding = 1) uniform sampler2D transmittance_lut;
@@ -17,10 +21,8 @@ layout(set = 0, binding = 2) uniform sampler3D scattering_lut;
 layout(set = 0, binding = 3) uniform sampler2D geometry_color;
 layout(set = 0, binding = 4) uniform sampler2D scene_depth;
 
-#include "functions.glsl"
-
 void main() {
-    AtmosphereParameters atmosphere = GetAtmosphereParameters();
+    AtmosphereParameters atmosphere = UnpackAtmosphereParameters(scattering_ub.atmosphere_data);
 	vec2 frag_coord = gl_FragCoord.xy / vec2(scattering_ub.resolution);
     vec3 x_clip = vec3(frag_coord * vec2(2.0, -2.0) - vec2(1.0, -1.0), 0.5); 
     vec4 _x_world = scattering_ub.inv_view_projection_matrix * vec4(x_clip, 1.0); 
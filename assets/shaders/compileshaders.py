@@ -15,6 +15,11 @@ def main():
     glslc("postprocess.frag")
     glslc("geometry.vert")
     glslc("geometry.frag")
+    glslc("geometry_bindless.vert")
+    glslc("geometry_bindless.frag")
+    glslc("geometry_indirect.vert")
+    glslc("cull.comp")
+    glslc("light_cull.comp")
     glslc("present.frag")
     glslc("simplevs.vert")
     glslc("shading.frag")
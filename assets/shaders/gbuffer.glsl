@@ -0,0 +1,30 @@
+// packed g-buffer layout, matches the attachments created in Geometry.cpp
+// gbuffer0, rgb10a2: octahedral encoded normal, roughness
+// gbuffer1, rgba8: albedo, metallic
+// world position is reconstructed from the depth buffer
+
+vec2 OctWrap(vec2 v) {
+    return (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// unit vector to [0, 1]^2
+vec2 EncodeNormal(vec3 n) {
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    n.xy = n.z >= 0.0 ? n.xy : OctWrap(n.xy);
+    return n.xy * 0.5 + 0.5;
+}
+
+vec3 DecodeNormal(vec2 f) {
+    f = f * 2.0 - 1.0;
+    vec3 n = vec3(f.x, f.y, 1.0 - abs(f.x) - abs(f.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+// uv in [0, 1] with the flipped viewport of the graphics pipelines, depth as stored in the depth buffer
+vec3 ReconstructWorldPosition(vec2 uv, float depth, mat4 inv_view_projection) {
+    vec4 world_pos = inv_view_projection * vec4(uv * vec2(2.0, -2.0) - vec2(1.0, -1.0), depth, 1.0);
+    return world_pos.xyz / world_pos.w;
+}
@@ -0,0 +1,54 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(location = 1) in vec3 world_normal;
+layout(location = 2) in vec2 frag_tex_coord;
+layout(location = 3) flat in uint material_index;
+
+layout(location = 0) out vec4 normal_roughness;
+layout(location = 1) out vec4 albedo_metallic;
+
+#include "gbuffer.glsl"
+
+// set 0: scene
+layout(set = 0, binding = 0) uniform SceneUb {
+    mat4 view, proj;
+    vec2 near_far;
+} scene_ub;
+
+// set 1: bindless material table, matches MaterialData in MaterialTable.h
+
+#define MATERIAL_HAS_BASE_COLOR 1u
+#define MATERIAL_HAS_NORMAL 2u
+#define MATERIAL_HAS_METALLIC_ROUGHNESS 4u
+
+struct MaterialData {
+    uint base_color_texture;
+    uint normal_texture;
+    uint metallic_roughness_texture;
+    uint flags;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer Materials {
+    MaterialData materials[];
+};
+
+layout(set = 1, binding = 1) uniform sampler2D textures[];
+
+// -------------------------------------------------------
+
+void main() {
+    MaterialData material = materials[material_index];
+
+    vec3 albedo = (material.flags & MATERIAL_HAS_BASE_COLOR) != 0u ?
+        texture(textures[nonuniformEXT(material.base_color_texture)], frag_tex_coord).xyz : vec3(1.0);
+    vec3 normal = (material.flags & MATERIAL_HAS_NORMAL) != 0u ?
+        texture(textures[nonuniformEXT(material.normal_texture)], frag_tex_coord).xyz : vec3(0.0);
+    vec2 metallic_roughness = (material.flags & MATERIAL_HAS_METALLIC_ROUGHNESS) != 0u ?
+        texture(textures[nonuniformEXT(material.metallic_roughness_texture)], frag_tex_coord).xy : vec2(0.0, 1.0);
+    float metallic = metallic_roughness.x;
+    float roughness = metallic_roughness.y;
+
+    normal_roughness = vec4(EncodeNormal(normalize(world_normal)), roughness, 0.0);
+    albedo_metallic = vec4(albedo, metallic);
+}
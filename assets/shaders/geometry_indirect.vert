@@ -0,0 +1,49 @@
+#version 450
+
+layout(location = 0) in vec3 in_position;
+layout(location = 1) in vec3 in_normal;
+layout(location = 2) in vec2 in_tex_coord;
+
+layout(location = 0) out vec3 world_pos;
+layout(location = 1) out vec3 world_normal;
+layout(location = 2) out vec2 frag_tex_coord;
+layout(location = 3) flat out uint material_index;
+
+// set 0: scene
+
+layout(set = 0, binding = 0) uniform SceneUb {
+    mat4 view, proj;
+    vec2 near_far;
+} scene_ub;
+
+// set 1: bindless material table, read by geometry_bindless.frag
+
+// set 2: draw instances written by the cpu and culled by cull.comp, matches DrawInstance in IndirectDrawList.h
+
+struct DrawInstance {
+    mat4 model;
+    vec4 bounds_center;
+    vec4 bounds_extent;
+    uint first_index;
+    uint index_count;
+    uint material_index;
+    uint batch;
+    uint batch_first;
+    uint padding0, padding1, padding2;
+};
+
+layout(std430, set = 2, binding = 0) readonly buffer Instances {
+    DrawInstance instances[];
+};
+
+
+void main() {
+    // the draw command's first_instance is the instance index
+    DrawInstance instance = instances[gl_InstanceIndex];
+    mat4 model = instance.model;
+    world_pos = (model * vec4(in_position, 1.0)).xyz;
+    world_normal = (model * vec4(in_normal, 0.0)).xyz;
+    frag_tex_coord = in_tex_coord;
+    material_index = instance.material_index;
+    gl_Position = scene_ub.proj * scene_ub.view * model * vec4(in_position, 1.0);
+}
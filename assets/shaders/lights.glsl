@@ -0,0 +1,10 @@
+// matches LightParams in Light.h
+struct LightParams {
+    vec4 color_intensity; // r, g, b, intensity
+    vec4 position_type; // x, y, z, type
+    vec4 direction;
+    vec4 radius_inner_outer; // radius, innerradius, outerradius
+};
+
+// index slots of a cluster, matches ClusteredLights.cpp
+#define MAX_LIGHTS_PER_CLUSTER 128
@@ -1,6 +1,5 @@
 #version 450
 
-#define MAX_LIGHT_COUNT 512
 #define PI 3.14159265359
 #define eps 1e-6
 
@@ -8,28 +7,38 @@ layout(location = 0) out vec3 outColor;
 
 // set 0: scene
 
-struct LightParams{
-    vec4 colorIntensity; // r, g, b, intensity
-    vec4 positionType; // x, y, z, type
-    vec4 direction;
-    vec4 radiusInnerOuter; // radius, innerradius, outerradius
-};
+#include "lights.glsl"
 
-layout(set = 0, binding = 0) uniform LightCountUb {
-    uint lightCount;
-}m_light_count_ub;
+// matches ClusterUbData in ClusteredLights.h
+layout(set = 0, binding = 0) uniform ClusterUb {
+    uvec4 grid; // x, y, z, directional light count
+    vec4 params; // near, far, tile size in pixels, depth slices per log unit of depth
+}m_cluster_ub;
 
-layout(set = 0, binding = 1) uniform LightUb {
-    LightParams lights[MAX_LIGHT_COUNT];
-}m_light_ub;
+// directional lights first, then the clustered point and spot lights
+layout(std430, set = 0, binding = 1) readonly buffer LightBuffer {
+    LightParams lights[];
+}m_light_buffer;
 
 layout(set = 0, binding = 2) uniform CameraUb {
     vec3 eyePos;
+    vec3 forward_dir;
+    mat4 inv_view_projection;
 }m_camera_ub;
 
-layout(set = 0, binding = 3) uniform sampler2D position_depth;
-layout(set = 0, binding = 4) uniform sampler2D normal_roughness;
-layout(set = 0, binding = 5) uniform sampler2D albedo_metallic;
+layout(set = 0, binding = 3) uniform sampler2D normal_roughness;
+layout(set = 0, binding = 4) uniform sampler2D albedo_metallic;
+layout(set = 0, binding = 5) uniform sampler2D scene_depth;
+
+layout(std430, set = 0, binding = 6) readonly buffer ClusterLightCounts {
+    uint cluster_light_counts[];
+};
+
+layout(std430, set = 0, binding = 7) readonly buffer ClusterLightIndices {
+    uint cluster_light_indices[];
+};
+
+#include "gbuffer.glsl"
 
 float saturate(float x) {
     return clamp(x, 0.0f , 1.0f);
@@ -94,31 +103,31 @@ vec3 radiance(LightParams light, vec3 N, vec3 V, vec3 world_pos, vec3 albedo, fl
     vec3 L;
 
     // direct light
-    if(light.positionType.w == 0.0f) {
+    if(light.position_type.w == 0.0f) {
         L = - normalize(light.direction.xyz);
         float lightAttenuation = 1.0f;
-        lightRadiance = lightAttenuation * light.colorIntensity.xyz * light.colorIntensity.w;
+        lightRadiance = lightAttenuation * light.color_intensity.xyz * light.color_intensity.w;
     }
     // point light
-    else if(light.positionType.w == 1.0f) {
-        L = light.positionType.xyz - world_pos;
+    else if(light.position_type.w == 1.0f) {
+        L = light.position_type.xyz - world_pos;
         float dist = length(L);
         L = normalize(L);
 
-        float lightAttenuation = distanceFalloff(dist, light.radiusInnerOuter.x, L);
+        float lightAttenuation = distanceFalloff(dist, light.radius_inner_outer.x, L);
 
-        lightRadiance = lightAttenuation * light.colorIntensity.xyz * light.colorIntensity.w;
+        lightRadiance = lightAttenuation * light.color_intensity.xyz * light.color_intensity.w;
     }
     // spot light
-    else if (light.positionType.w == 2.0f) {
+    else if (light.position_type.w == 2.0f) {
 
-        L = light.positionType.xyz - world_pos;
+        L = light.position_type.xyz - world_pos;
         float dist = length(L);
         L = normalize(L);
 
-        float lightAttenuation = distanceFalloff(dist, light.radiusInnerOuter.x, L) * angleFalloff(light.radiusInnerOuter.y, light.radiusInnerOuter.z, light.direction.xyz, L);
+        float lightAttenuation = distanceFalloff(dist, light.radius_inner_outer.x, L) * angleFalloff(light.radius_inner_outer.y, light.radius_inner_outer.z, light.direction.xyz, L);
 
-        lightRadiance = lightAttenuation * light.colorIntensity.xyz * light.colorIntensity.w;
+        lightRadiance = lightAttenuation * light.color_intensity.xyz * light.color_intensity.w;
 
     }
 
@@ -140,24 +149,36 @@ vec3 radiance(LightParams light, vec3 N, vec3 V, vec3 world_pos, vec3 albedo, fl
 
 void main() {
 
-    vec2 frag_coord = gl_FragCoord.xy/vec2(1920.0f,1080.0f);
-    vec4 position_depth_color = texture(position_depth, frag_coord);
-    vec4 albedo_metallic_color = texture(albedo_metallic, frag_coord);
-    vec4 normal_roughness_color = texture(normal_roughness, frag_coord);
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    vec2 frag_coord = gl_FragCoord.xy / vec2(textureSize(scene_depth, 0));
+    vec4 albedo_metallic_color = texelFetch(albedo_metallic, pixel, 0);
+    vec4 normal_roughness_color = texelFetch(normal_roughness, pixel, 0);
+    float depth = texelFetch(scene_depth, pixel, 0).r;
 
-    vec3 world_pos = position_depth_color.rgb;
+    vec3 world_pos = ReconstructWorldPosition(frag_coord, depth, m_camera_ub.inv_view_projection);
     vec3 albedo = albedo_metallic_color.rgb;
     float metallic = albedo_metallic_color.a;
-    float roughness = normal_roughness_color.a;
-    vec3 world_normal = normal_roughness_color.rgb;
+    float roughness = normal_roughness_color.b;
 
     vec3 V = - normalize(world_pos - m_camera_ub.eyePos);
-    vec3 N = normalize(world_normal);
+    vec3 N = DecodeNormal(normal_roughness_color.rg);
 
     vec3 color = vec3(0.0f);
-    
-    for(uint i = 0; i < m_light_count_ub.lightCount; i++) {
-        color += radiance(m_light_ub.lights[i], N, V, world_pos ,albedo, metallic, roughness);
+
+    for(uint i = 0; i < m_cluster_ub.grid.w; i++) {
+        color += radiance(m_light_buffer.lights[i], N, V, world_pos ,albedo, metallic, roughness);
+    }
+
+    // only the point and spot lights binned into this pixel's cluster
+    float view_depth = dot(world_pos - m_camera_ub.eyePos, m_camera_ub.forward_dir);
+    uvec2 tile = uvec2(gl_FragCoord.xy / m_cluster_ub.params.z);
+    float slice = clamp(log(view_depth / m_cluster_ub.params.x) * m_cluster_ub.params.w, 0.0,
+                        float(m_cluster_ub.grid.z - 1));
+    uint cluster = tile.x + m_cluster_ub.grid.x * (tile.y + m_cluster_ub.grid.y * uint(slice));
+    uint count = cluster_light_counts[cluster];
+    for(uint i = 0; i < count; i++) {
+        uint light = cluster_light_indices[cluster * MAX_LIGHTS_PER_CLUSTER + i];
+        color += radiance(m_light_buffer.lights[light], N, V, world_pos ,albedo, metallic, roughness);
     }
     outColor = color;
     
@@ -0,0 +1,2 @@
+#define ASSET_DIR "/root/repo/assets"
+#define CACHE_DIR "/tmp/swbuild/cache"
@@ -1,27 +1,187 @@
 #include "Atmosphere.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <memory>
+#include <string>
+#include <vector>
+
+#include <runtime/core/profile/Profiler.h>
 
 using namespace Horizon;
 
-App::App(u32 _width, u32 _height) noexcept : m_width(_width), mHeight(_height) {}
+App::App(u32 _width, u32 _height, const AppOptions &_options) noexcept
+    : m_width(_width), mHeight(_height), m_options(_options) {}
 
 void App::Run() noexcept {
 
-    m_window = std::make_shared<Window>("horizon", m_width, mHeight);
-    m_renderer = std::make_unique<Renderer>(m_window->getWidth(), m_window->getHeight(), m_window);
-    m_input_manager = std::make_unique<InputManager>(m_window, m_renderer->GetMainCamera());
+    if (m_options.headless_frames > 0) {
+        m_renderer = std::make_unique<Renderer>(m_width, mHeight, nullptr);
+    } else {
+        m_window = std::make_shared<Window>("horizon", m_width, mHeight);
+        m_renderer = std::make_unique<Renderer>(m_window->getWidth(), m_window->getHeight(), m_window);
+        m_input_manager = std::make_unique<InputManager>(m_window, m_renderer->GetMainCamera());
+    }
+    SetupScene();
+
+    if (m_options.headless_frames > 0) {
+        RunHeadless();
+    } else {
+        while (m_window->ShouldClose() == 0) {
+            m_input_manager->ProcessInput();
+            m_renderer->Update();
+            m_renderer->Render();
+        }
+    }
+    m_renderer->Wait();
+
+    auto gpu_profiler = m_renderer->GetGpuProfiler();
+    if (gpu_profiler && !m_options.gpu_profile_path.empty()) {
+        gpu_profiler->WriteChromeTrace(m_options.gpu_profile_path + ".json");
+        gpu_profiler->WriteCsv(m_options.gpu_profile_path + ".csv");
+    }
+    if (!m_options.gpu_profile_path.empty()) {
+        PROFILE_WRITE_CHROME_TRACE(m_options.gpu_profile_path + ".cpu.json");
+    }
+}
+
+void App::SetupScene() noexcept {
+    m_renderer->GetScene()->SetRecordingThreadCount(m_options.recording_thread_count);
+    auto gpu_profiler = m_renderer->GetGpuProfiler();
+    if (gpu_profiler) {
+        gpu_profiler->SetPipelineStatistics(m_options.pipeline_statistics);
+    }
 
-    while (m_window->ShouldClose() == 0) {
-        m_input_manager->ProcessInput();
+    if (m_options.instance_count > 1) {
+        // square grid around the original, part of it falls outside the view and is culled
+        u32 side = static_cast<u32>(std::ceil(std::sqrt(static_cast<f32>(m_options.instance_count))));
+        f32 spacing = 15.0f;
+        std::vector<Math::mat4> instances;
+        for (u32 i = 0; i < m_options.instance_count; i++) {
+            Math::vec3 offset((static_cast<f32>(i % side) - 0.5f * (side - 1)) * spacing, 0.0f,
+                              (static_cast<f32>(i / side) - 0.5f * (side - 1)) * spacing);
+            instances.push_back(Math::translate(Math::mat4(1.0f), offset));
+        }
+        m_renderer->GetScene()->GetModel("flighthelmet")->SetInstances(instances);
+    }
+
+    if (m_options.light_count > 0) {
+        // sunflower spiral on the ground around the model, the disc grows with the light count so the lights per
+        // cluster stay about the same
+        constexpr f32 golden_angle = 2.39996323f;
+        f32 spacing = 4.0f;
+        for (u32 i = 0; i < m_options.light_count; i++) {
+            f32 r = spacing * std::sqrt(static_cast<f32>(i) + 0.5f);
+            f32 theta = golden_angle * static_cast<f32>(i);
+            Math::vec3 position(r * std::cos(theta), 6370.0f + 2.0f * static_cast<f32>(i % 3), r * std::sin(theta));
+            Math::vec3 color(0.5f + 0.5f * std::cos(theta), 0.5f + 0.5f * std::cos(theta + 2.1f),
+                             0.5f + 0.5f * std::cos(theta + 4.2f));
+            m_renderer->GetScene()->AddPointLight(color, 100.0f, position, 6.0f);
+        }
+    }
+}
+
+void App::RunHeadless() noexcept {
+    u32 frame_count = m_options.headless_frames;
+    std::vector<f64> cpu_ms(frame_count, 0.0);
+    std::vector<FrameTiming> timings;
+
+    // one orbit around the model over the run, every run sees the same views
+    auto camera = m_renderer->GetMainCamera();
+    Math::vec3 center(0.0f, 6370.0f, 0.0f);
+    for (u32 i = 0; i < frame_count; i++) {
+        f32 angle = Math::two_pi<f32>() * static_cast<f32>(i) / static_cast<f32>(frame_count);
+        camera->SetLookAt(center + Math::vec3(10.0f * std::sin(angle), 2.0f, 10.0f * std::cos(angle)), center);
+
+        auto begin = std::chrono::steady_clock::now();
         m_renderer->Update();
         m_renderer->Render();
+        cpu_ms[i] = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+        auto retired = m_renderer->CollectFrameTimings();
+        timings.insert(timings.end(), retired.begin(), retired.end());
     }
     m_renderer->Wait();
+    auto retired = m_renderer->CollectFrameTimings();
+    timings.insert(timings.end(), retired.begin(), retired.end());
+
+    // the first frame waits for pipelines and the atmosphere precompute, it is left out of the averages
+    f64 cpu_sum = 0.0, gpu_sum = 0.0, cpu_max = 0.0, gpu_max = 0.0;
+    u32 count = 0;
+    for (auto &timing : timings) {
+        if (timing.frame == 0 || timing.frame >= frame_count) {
+            continue;
+        }
+        cpu_sum += cpu_ms[timing.frame];
+        gpu_sum += timing.gpu_ms;
+        cpu_max = std::max(cpu_max, cpu_ms[timing.frame]);
+        gpu_max = std::max(gpu_max, timing.gpu_ms);
+        count++;
+    }
+    if (count > 0) {
+        LOG_INFO("headless: {} frames, cpu {:.2f} ms (max {:.2f}), gpu {:.2f} ms (max {:.2f})", frame_count,
+                 cpu_sum / count, cpu_max, gpu_sum / count, gpu_max);
+    }
+
+    if (!m_options.frame_timings_path.empty()) {
+        std::ofstream file(m_options.frame_timings_path, std::ios::trunc);
+        file << "frame,cpu_ms,wait_ms,record_ms,gpu_ms\n";
+        for (auto &timing : timings) {
+            if (timing.frame < frame_count) {
+                file << fmt::format("{},{:.4f},{:.4f},{:.4f},{:.4f}\n", timing.frame, cpu_ms[timing.frame],
+                                   timing.wait_ms, timing.record_ms, timing.gpu_ms);
+            }
+        }
+        if (!file.good()) {
+            LOG_WARN("failed to write {}", m_options.frame_timings_path);
+        }
+    }
+    if (!m_options.image_path.empty()) {
+        m_renderer->SaveImage(m_options.image_path);
+    }
 }
 
 int main(int argc, char *argv[]) {
+    // --instances <n>: draw n copies of the model, the geometry pass logs its cost every 240 frames
+    // --lights <n>: add n point lights around the model, the light culling logs its cost every 240 frames
+    // --record-threads <n>: record the geometry pass on n threads, 0 picks a count from the instances. together with
+    // --instances this compares the recording cost by thread count
+    // --gpu-profile <path>: on exit write the gpu time of every pass over the last frames to <path>.json as a chrome
+    // trace and to <path>.csv as a summary. runtimes built with HORIZON_ENABLE_PROFILER also write their cpu scopes to
+    // <path>.cpu.json
+    // --pipeline-statistics: also count primitives and shader invocations per pass
+    // --headless <n>: render n frames into offscreen images without a window while the camera orbits the model, then
+    // exit. runs on software drivers such as lavapipe
+    // --frame-timings <path>: write the cpu and gpu time of every headless frame to <path> as csv
+    // --image <path>: write the last headless frame to <path> as png
+    AppOptions options;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--pipeline-statistics") == 0) {
+            options.pipeline_statistics = true;
+        }
+    }
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--instances") == 0) {
+            options.instance_count = std::max(1, atoi(argv[i + 1]));
+        } else if (strcmp(argv[i], "--lights") == 0) {
+            options.light_count = std::max(0, atoi(argv[i + 1]));
+        } else if (strcmp(argv[i], "--record-threads") == 0) {
+            options.recording_thread_count = std::max(0, atoi(argv[i + 1]));
+        } else if (strcmp(argv[i], "--gpu-profile") == 0) {
+            options.gpu_profile_path = argv[i + 1];
+        } else if (strcmp(argv[i], "--headless") == 0) {
+            options.headless_frames = std::max(0, atoi(argv[i + 1]));
+        } else if (strcmp(argv[i], "--frame-timings") == 0) {
+            options.frame_timings_path = argv[i + 1];
+        } else if (strcmp(argv[i], "--image") == 0) {
+            options.image_path = argv[i + 1];
+        }
+    }
 
-    std::unique_ptr<App> app = std::make_unique<App>(1920, 1080);
+    std::unique_ptr<App> app = std::make_unique<App>(1920, 1080, options);
     app->Run();
 
     return 0;
@@ -1,15 +1,35 @@
 #pragma once
 
 #include <memory>
+#include <string>
 
 #include <runtime/function/input/InputManager.h>
 #include <runtime/function/rhi/RenderContext.h>
 #include <runtime/function/window/Window.h>
 #include <runtime/scene/render/Renderer.h>
 
+// command line options, see main
+struct AppOptions {
+    // copies of the model laid out on a grid, scales the scene for draw benchmarks
+    Horizon::u32 instance_count = 1;
+    // point lights scattered around the model for light culling benchmarks
+    Horizon::u32 light_count = 0;
+    // threads recording the geometry pass, 0 lets the scene decide
+    Horizon::u32 recording_thread_count = 0;
+    // gpu pass timings are exported here on exit, nothing is written when empty
+    std::string gpu_profile_path;
+    bool pipeline_statistics = false;
+    // frames rendered without a window along a scripted camera path, 0 opens a window and runs until it is closed
+    Horizon::u32 headless_frames = 0;
+    // per frame cpu and gpu timings of a headless run, csv
+    std::string frame_timings_path;
+    // last frame of a headless run, png
+    std::string image_path;
+};
+
 class App {
   public:
-    App(Horizon::u32 _width, Horizon::u32 _height) noexcept;
+    App(Horizon::u32 _width, Horizon::u32 _height, const AppOptions &_options = {}) noexcept;
     ~App() noexcept = default;
     App(const App &) = delete;
     App(App &&) = delete;
@@ -18,9 +38,15 @@ class App {
 
     void Run() noexcept;
 
+  private:
+    void SetupScene() noexcept;
+
+    void RunHeadless() noexcept;
+
   private:
     Horizon::u32 m_width;
     Horizon::u32 mHeight;
+    AppOptions m_options;
     std::shared_ptr<Horizon::Window> m_window = nullptr;
     std::unique_ptr<Horizon::Renderer> m_renderer = nullptr;
     std::unique_ptr<Horizon::InputManager> m_input_manager;
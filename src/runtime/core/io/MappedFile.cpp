@@ -0,0 +1,106 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Horizon {
+
+MappedFile::~MappedFile() noexcept { Close(); }
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string &path) noexcept {
+    Close();
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        CloseHandle(file);
+        return false;
+    }
+    void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!data) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    m_file_handle = file;
+    m_mapping_handle = mapping;
+    m_data = static_cast<const u8 *>(data);
+    m_size = static_cast<u64>(size.QuadPart);
+    return true;
+}
+
+void MappedFile::Close() noexcept {
+    if (m_data) {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mapping_handle) {
+        CloseHandle(m_mapping_handle);
+    }
+    if (m_file_handle) {
+        CloseHandle(m_file_handle);
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_file_handle = nullptr;
+    m_mapping_handle = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const std::string &path) noexcept {
+    Close();
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st {};
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    void *data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+    // the whole file is consumed front to back right after mapping
+    madvise(data, static_cast<size_t>(st.st_size), MADV_WILLNEED);
+    m_fd = fd;
+    m_data = static_cast<const u8 *>(data);
+    m_size = static_cast<u64>(st.st_size);
+    return true;
+}
+
+void MappedFile::Close() noexcept {
+    if (m_data) {
+        munmap(const_cast<u8 *>(m_data), static_cast<size_t>(m_size));
+    }
+    if (m_fd >= 0) {
+        close(m_fd);
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_fd = -1;
+}
+
+#endif
+
+} // namespace Horizon
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+
+#include <runtime/core/math/Math.h>
+
+namespace Horizon {
+
+// read only view of a whole file mapped into memory
+class MappedFile {
+  public:
+    MappedFile() noexcept = default;
+    ~MappedFile() noexcept;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool Open(const std::string &path) noexcept;
+    void Close() noexcept;
+
+    inline const u8 *Data() const noexcept { return m_data; }
+    inline u64 Size() const noexcept { return m_size; }
+    inline bool IsOpen() const noexcept { return m_data != nullptr; }
+
+  private:
+    const u8 *m_data = nullptr;
+    u64 m_size = 0;
+#ifdef _WIN32
+    void *m_file_handle = nullptr;
+    void *m_mapping_handle = nullptr;
+#else
+    int m_fd = -1;
+#endif
+};
+
+} // namespace Horizon
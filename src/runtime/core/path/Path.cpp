@@ -16,4 +16,11 @@ std::string GetShaderPath(const std::string &_path) noexcept {
 std::string GetTexturePath(const std::string &_path) noexcept {
     return GetAssetsPath().append("/textures/").append(_path);
 }
+
+std::string GetCachePath(const std::string &_path) noexcept {
+    // created on first use, a failure shows up when the cache is written
+    std::error_code ec;
+    std::filesystem::create_directories(CACHE_DIR, ec);
+    return std::string(CACHE_DIR).append("/").append(_path);
+}
 } // namespace Horizon::Path
\ No newline at end of file
@@ -10,4 +10,6 @@ static std::string GetAssetsPath() noexcept;
 std::string GetModelPath(const std::string &_path) noexcept;
 std::string GetTexturePath(const std::string &_path) noexcept;
 std::string GetShaderPath(const std::string &_path) noexcept;
+// files the renderer regenerates, like baked luts and caches. they live in the build tree, never next to the assets
+std::string GetCachePath(const std::string &_path) noexcept;
 } // namespace Horizon::Path
@@ -0,0 +1,153 @@
+#include "Profiler.h"
+
+#ifdef HORIZON_ENABLE_PROFILER
+
+#include <fstream>
+
+#include <runtime/core/log/Log.h>
+
+namespace Horizon {
+
+namespace {
+
+// drain before a busy thread can fill its ring
+constexpr u64 FLUSH_INTERVAL = 16;
+// 1M events, about 32 MB
+constexpr u64 MAX_TRACE_EVENTS = 1 << 20;
+constexpr u32 OVERHEAD_SCOPES = 1 << 16;
+
+thread_local ProfileEventRing *t_ring = nullptr;
+
+std::string EscapeJson(const char *text) noexcept {
+    std::string result;
+    for (; *text; text++) {
+        if (*text == '"' || *text == '\\') {
+            result += '\\';
+        }
+        result += *text;
+    }
+    return result;
+}
+
+} // namespace
+
+Profiler::Profiler() noexcept : m_start(std::chrono::steady_clock::now()) {
+    m_scope_overhead_ns = MeasureScopeOverhead();
+    LOG_INFO("cpu profiler enabled, {:.1f} ns per scope", m_scope_overhead_ns);
+}
+
+ProfileEventRing &Profiler::GetThreadRing() noexcept {
+    if (!t_ring) {
+        // once per thread, the rings outlive their threads until the profiler is destroyed
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_rings.push_back(std::make_unique<ProfileEventRing>(static_cast<u32>(m_rings.size())));
+        t_ring = m_rings.back().get();
+    }
+    return *t_ring;
+}
+
+void Profiler::Push(ProfileEventType type, const char *name, f64 value) noexcept {
+    u64 time_ns = static_cast<u64>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count());
+    GetThreadRing().Push(ProfileEvent{name, time_ns, value, type});
+}
+
+void Profiler::Frame() noexcept {
+    Push(ProfileEventType::FRAME, "frame", 0.0);
+    if (++m_frame % FLUSH_INTERVAL == 0) {
+        Flush();
+    }
+}
+
+void Profiler::Flush() noexcept {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto &ring : m_rings) {
+        u32 thread_index = ring->GetThreadIndex();
+        ring->Drain([this, thread_index](const ProfileEvent &event) {
+            if (m_trace.size() < MAX_TRACE_EVENTS) {
+                m_trace.push_back({event, thread_index});
+            } else {
+                m_trace_dropped++;
+            }
+        });
+    }
+}
+
+bool Profiler::WriteChromeTrace(const std::string &path) noexcept {
+    Flush();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open()) {
+        LOG_WARN("failed to open {}", path);
+        return false;
+    }
+
+    file << "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"scope_overhead_ns\":"
+         << fmt::format("{:.1f}", m_scope_overhead_ns) << "},\"traceEvents\":[";
+    u64 ring_dropped = 0;
+    for (u32 i = 0; i < m_rings.size(); i++) {
+        file << (i ? ",\n" : "\n")
+             << fmt::format("{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":{},"
+                            "\"args\":{{\"name\":\"thread {}\"}}}}",
+                            i, i);
+        ring_dropped += m_rings[i]->GetDropped();
+    }
+    for (auto &[event, thread_index] : m_trace) {
+        f64 ts = static_cast<f64>(event.time_ns) * 1e-3;
+        file << ",\n";
+        switch (event.type) {
+        case ProfileEventType::BEGIN:
+            file << fmt::format("{{\"name\":\"{}\",\"ph\":\"B\",\"pid\":0,\"tid\":{},\"ts\":{:.3f}}}",
+                                EscapeJson(event.name), thread_index, ts);
+            break;
+        case ProfileEventType::END:
+            file << fmt::format("{{\"ph\":\"E\",\"pid\":0,\"tid\":{},\"ts\":{:.3f}}}", thread_index, ts);
+            break;
+        case ProfileEventType::COUNTER:
+            file << fmt::format("{{\"name\":\"{}\",\"ph\":\"C\",\"pid\":0,\"tid\":{},\"ts\":{:.3f},"
+                                "\"args\":{{\"value\":{}}}}}",
+                                EscapeJson(event.name), thread_index, ts, event.value);
+            break;
+        case ProfileEventType::FRAME:
+            file << fmt::format("{{\"name\":\"frame\",\"ph\":\"i\",\"s\":\"g\",\"pid\":0,\"tid\":{},\"ts\":{:.3f}}}",
+                                thread_index, ts);
+            break;
+        }
+    }
+    file << "\n]}\n";
+    if (!file.good()) {
+        LOG_WARN("failed to write {}", path);
+        return false;
+    }
+    LOG_INFO("cpu trace of {} events on {} threads written to {}, {} events dropped by full rings, {} by the trace "
+             "limit",
+             m_trace.size(), m_rings.size(), path, ring_dropped, m_trace_dropped);
+    return true;
+}
+
+f64 Profiler::MeasureScopeOverhead() noexcept {
+    // a private ring so the measurement doesn't show up in the trace, drained between batches so nothing is dropped
+    auto scratch = std::make_unique<ProfileEventRing>(0);
+    ProfileEventRing *ring = t_ring;
+    t_ring = scratch.get();
+
+    // calls this instance directly, the constructor measures before GetInstance returns
+    constexpr u32 batch = static_cast<u32>(ProfileEventRing::CAPACITY / 2);
+    f64 elapsed_ns = 0.0;
+    for (u32 done = 0; done < OVERHEAD_SCOPES; done += batch) {
+        auto begin = std::chrono::steady_clock::now();
+        for (u32 i = 0; i < batch; i++) {
+            Begin("overhead");
+            End("overhead");
+        }
+        elapsed_ns += std::chrono::duration<f64, std::nano>(std::chrono::steady_clock::now() - begin).count();
+        scratch->Drain([](const ProfileEvent &) {});
+    }
+
+    t_ring = ring;
+    return elapsed_ns / OVERHEAD_SCOPES;
+}
+
+} // namespace Horizon
+
+#endif
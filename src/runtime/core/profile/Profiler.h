@@ -0,0 +1,147 @@
+#pragma once
+
+// cpu profiling scopes, counters and frame markers, flushed to the chrome trace event format. everything below
+// compiles to nothing unless HORIZON_ENABLE_PROFILER is defined. names must be string literals, only their pointers
+// are recorded.
+//
+//     PROFILE_SCOPE("Scene::Prepare");
+//     PROFILE_COUNTER("geometry draws", draw_count);
+//     PROFILE_FRAME();
+//     PROFILE_WRITE_CHROME_TRACE("cpu.json");
+
+#ifdef HORIZON_ENABLE_PROFILER
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <runtime/core/math/Math.h>
+#include <runtime/core/singleton/public_singleton.h>
+
+namespace Horizon {
+
+enum class ProfileEventType : u32 { BEGIN, END, COUNTER, FRAME };
+
+struct ProfileEvent {
+    const char *name = nullptr;
+    u64 time_ns = 0; // since the profiler was created
+    f64 value = 0.0; // counters only
+    ProfileEventType type = ProfileEventType::BEGIN;
+};
+
+// single producer single consumer ring. its thread pushes without locks, the flushing thread drains it. events
+// pushed while the ring is full are dropped and counted.
+class ProfileEventRing {
+  public:
+    static constexpr u64 CAPACITY = 1 << 15; // power of two
+
+    explicit ProfileEventRing(u32 thread_index) noexcept : m_thread_index(thread_index) {}
+
+    void Push(const ProfileEvent &event) noexcept {
+        u64 head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) == CAPACITY) {
+            m_dropped.store(m_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return;
+        }
+        m_events[head & (CAPACITY - 1)] = event;
+        m_head.store(head + 1, std::memory_order_release);
+    }
+
+    // consumer side, one thread at a time
+    template <typename F> void Drain(F &&func) noexcept {
+        u64 tail = m_tail.load(std::memory_order_relaxed);
+        u64 head = m_head.load(std::memory_order_acquire);
+        for (; tail != head; tail++) {
+            func(m_events[tail & (CAPACITY - 1)]);
+        }
+        m_tail.store(tail, std::memory_order_release);
+    }
+
+    u32 GetThreadIndex() const noexcept { return m_thread_index; }
+    u64 GetDropped() const noexcept { return m_dropped.load(std::memory_order_relaxed); }
+
+  private:
+    std::array<ProfileEvent, CAPACITY> m_events{};
+    u32 m_thread_index;
+    // producer and consumer indices on their own cache lines
+    alignas(64) std::atomic<u64> m_head{0};
+    alignas(64) std::atomic<u64> m_tail{0};
+    std::atomic<u64> m_dropped{0};
+};
+
+class Profiler : public PublicSingleton<Profiler> {
+  public:
+    Profiler() noexcept;
+    ~Profiler() noexcept override = default;
+    Profiler(const Profiler &) = delete;
+    Profiler(Profiler &&) = delete;
+    Profiler &operator=(const Profiler &) = delete;
+    Profiler &operator=(Profiler &&) = delete;
+
+    void Begin(const char *name) noexcept { Push(ProfileEventType::BEGIN, name, 0.0); }
+    void End(const char *name) noexcept { Push(ProfileEventType::END, name, 0.0); }
+    void Counter(const char *name, f64 value) noexcept { Push(ProfileEventType::COUNTER, name, value); }
+    // marks the end of a frame, the rings are drained every few frames
+    void Frame() noexcept;
+
+    // moves the events of every ring into the trace
+    void Flush() noexcept;
+    bool WriteChromeTrace(const std::string &path) noexcept;
+
+    // nanoseconds per scope, a begin and end pair, on the calling thread. events go to a scratch ring
+    f64 MeasureScopeOverhead() noexcept;
+
+  private:
+    void Push(ProfileEventType type, const char *name, f64 value) noexcept;
+    ProfileEventRing &GetThreadRing() noexcept;
+
+  private:
+    struct TraceEvent {
+        ProfileEvent event;
+        u32 thread_index;
+    };
+
+    std::chrono::steady_clock::time_point m_start;
+    // ring registration, draining and the trace
+    std::mutex m_mutex;
+    std::vector<std::unique_ptr<ProfileEventRing>> m_rings;
+    std::vector<TraceEvent> m_trace;
+    u64 m_trace_dropped = 0;
+    u64 m_frame = 0;
+    f64 m_scope_overhead_ns = 0.0;
+};
+
+class ProfileScope {
+  public:
+    explicit ProfileScope(const char *name) noexcept : m_name(name) { Profiler::GetInstance().Begin(name); }
+    ~ProfileScope() noexcept { Profiler::GetInstance().End(m_name); }
+    ProfileScope(const ProfileScope &) = delete;
+    ProfileScope(ProfileScope &&) = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
+    ProfileScope &operator=(ProfileScope &&) = delete;
+
+  private:
+    const char *m_name;
+};
+
+} // namespace Horizon
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+#define PROFILE_SCOPE(name) ::Horizon::ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(name)
+#define PROFILE_COUNTER(name, value) ::Horizon::Profiler::GetInstance().Counter(name, static_cast<f64>(value))
+#define PROFILE_FRAME() ::Horizon::Profiler::GetInstance().Frame()
+#define PROFILE_WRITE_CHROME_TRACE(path) ::Horizon::Profiler::GetInstance().WriteChromeTrace(path)
+
+#else
+
+#define PROFILE_SCOPE(name)
+#define PROFILE_COUNTER(name, value)
+#define PROFILE_FRAME()
+#define PROFILE_WRITE_CHROME_TRACE(path)
+
+#endif
@@ -0,0 +1,94 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace Horizon {
+
+ThreadPool::ThreadPool() noexcept {
+    u32 worker_count = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    m_workers.reserve(worker_count);
+    for (u32 i = 0; i < worker_count; i++) {
+        m_workers.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() noexcept {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_condition.notify_all();
+    for (auto &worker : m_workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::Enqueue(std::function<void()> task) noexcept {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.push(std::move(task));
+    }
+    m_condition.notify_one();
+}
+
+void ThreadPool::WorkerLoop() noexcept {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+            if (m_stop && m_tasks.empty()) {
+                return;
+            }
+            task = std::move(m_tasks.front());
+            m_tasks.pop();
+        }
+        task();
+    }
+}
+
+void ThreadPool::ParallelFor(u64 count, u64 grain, const std::function<void(u64 begin, u64 end)> &func) noexcept {
+    if (count == 0) {
+        return;
+    }
+    grain = std::max<u64>(grain, 1);
+    u64 chunk_size = std::max<u64>(grain, count / ((GetWorkerCount() + 1) * 4));
+    u64 chunk_count = (count + chunk_size - 1) / chunk_size;
+    if (chunk_count == 1 || m_workers.empty()) {
+        func(0, count);
+        return;
+    }
+
+    // helpers only steal chunks and never block on each other, so nested calls cannot deadlock
+    struct State {
+        std::atomic<u64> next_chunk{0};
+        std::atomic<u64> done_chunks{0};
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+    auto state = std::make_shared<State>();
+
+    auto run_chunks = [state, &func, count, chunk_size, chunk_count]() {
+        u64 chunk;
+        while ((chunk = state->next_chunk.fetch_add(1)) < chunk_count) {
+            u64 begin = chunk * chunk_size;
+            func(begin, std::min(begin + chunk_size, count));
+            if (state->done_chunks.fetch_add(1) + 1 == chunk_count) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->finished.notify_all();
+            }
+        }
+    };
+
+    u64 helper_count = std::min<u64>(GetWorkerCount(), chunk_count - 1);
+    for (u64 i = 0; i < helper_count; i++) {
+        Enqueue(run_chunks);
+    }
+    run_chunks();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&state, chunk_count]() { return state->done_chunks.load() == chunk_count; });
+}
+
+} // namespace Horizon
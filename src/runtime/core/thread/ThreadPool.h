@@ -0,0 +1,54 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <runtime/core/math/Math.h>
+#include <runtime/core/singleton/public_singleton.h>
+
+namespace Horizon {
+
+// fixed size worker pool shared by the whole runtime, one worker per hardware thread minus the main thread
+class ThreadPool : public PublicSingleton<ThreadPool> {
+  public:
+    ThreadPool() noexcept;
+    ~ThreadPool() noexcept override;
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool(ThreadPool &&) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+    ThreadPool &operator=(ThreadPool &&) = delete;
+
+    template <typename F> auto Submit(F &&func) noexcept -> std::future<std::invoke_result_t<F>> {
+        using R = std::invoke_result_t<F>;
+        auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(func));
+        std::future<R> result = task->get_future();
+        Enqueue([task]() { (*task)(); });
+        return result;
+    }
+
+    // run func(begin, end) over [0, count) split into chunks of at least grain elements, the calling thread
+    // takes part and the call returns once every chunk is done. safe to call from inside a worker.
+    void ParallelFor(u64 count, u64 grain, const std::function<void(u64 begin, u64 end)> &func) noexcept;
+
+    u32 GetWorkerCount() const noexcept { return static_cast<u32>(m_workers.size()); }
+
+  private:
+    void Enqueue(std::function<void()> task) noexcept;
+    void WorkerLoop() noexcept;
+
+  private:
+    std::vector<std::thread> m_workers;
+    std::queue<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_stop = false;
+};
+
+} // namespace Horizon
@@ -5,6 +5,9 @@
 
 namespace Horizon {
 
+// frames the cpu may record ahead of the gpu, per frame resources are ring buffered by this count
+constexpr u32 MAX_FRAMES_IN_FLIGHT = 2;
+
 struct RenderContext {
     u32 width;
     u32 height;
@@ -183,6 +186,8 @@ enum class TextureFormat {
 
     TEXTURE_FORMAT_D32_SFLOAT,
 
+    // packed
+    TEXTURE_FORMAT_RGB10A2_UNORM,
 };
 
 enum TextureUsage { TEXTURE_USAGE_R, TEXTURE_USAGE_RW };
@@ -190,7 +195,8 @@ enum TextureUsage { TEXTURE_USAGE_R, TEXTURE_USAGE_RW };
 inline VkDescriptorType ToVkDescriptorType(DescriptorType type) noexcept {
     switch (type) {
     case DescriptorType::DESCRIPTOR_TYPE_UNIFORM_BUFFER:
-        return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        // uniform buffers are slices of the per frame ring, selected with a dynamic offset at bind time
+        return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     case DescriptorType::DESCRIPTOR_TYPE_RW_BUFFER:
         return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
         //case DescriptorType::DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
@@ -327,6 +333,8 @@ inline VkFormat ToVkImageFormat(TextureFormat format) {
         return VK_FORMAT_R32G32B32A32_SFLOAT;
     case Horizon::TextureFormat::TEXTURE_FORMAT_D32_SFLOAT:
         return VK_FORMAT_D32_SFLOAT;
+    case Horizon::TextureFormat::TEXTURE_FORMAT_RGB10A2_UNORM:
+        return VK_FORMAT_A2B10G10R10_UNORM_PACK32;
     default:
         LOG_ERROR("invalid format");
         return VK_FORMAT_MAX_ENUM;
@@ -341,6 +349,9 @@ inline VkImageUsageFlags ToVkImageUsage(u32 usage) {
     if ((usage & TextureUsage::TEXTURE_USAGE_RW) != 0u) {
         flags |= VK_IMAGE_USAGE_STORAGE_BIT;
         flags |= VK_IMAGE_USAGE_SAMPLED_BIT;
+        // compute results can be read back or restored with copies
+        flags |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        flags |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
     }
     if (flags == 0) {
         LOG_ERROR("invalid image usage: ", usage);
@@ -38,17 +38,8 @@ Attachment::Attachment(std::shared_ptr<Device> device, const AttachmentCreateInf
     image_create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
     image_create_info.usage = usage | VK_IMAGE_USAGE_SAMPLED_BIT;
 
-    VkMemoryAllocateInfo memAlloc{};
-    VkMemoryRequirements memReqs{};
-
-    CHECK_VK_RESULT(vkCreateImage(device->Get(), &image_create_info, nullptr, &m_image));
-    vkGetImageMemoryRequirements(device->Get(), m_image, &memReqs);
-    memAlloc.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    memAlloc.allocationSize = memReqs.size;
-    memAlloc.memoryTypeIndex =
-        FindMemoryType(device->getPhysicalDevice(), memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    CHECK_VK_RESULT(vkAllocateMemory(device->Get(), &memAlloc, nullptr, &m_image_memory));
-    CHECK_VK_RESULT(vkBindImageMemory(device->Get(), m_image, m_image_memory, 0));
+    CHECK_VK_RESULT(device->GetMemoryAllocator()->CreateImage(image_create_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                              m_image, m_image_memory));
 
     VkImageViewCreateInfo imageView{};
     imageView.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
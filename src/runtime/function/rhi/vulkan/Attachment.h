@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <string>
 #include <vector>
 
 #include <vulkan/vulkan.hpp>
@@ -10,7 +11,14 @@
 #include <runtime/function/rhi/vulkan/VulkanEnums.h>
 
 namespace Horizon {
-enum AttachmentUsageFlags { NONE = 0, COLOR_ATTACHMENT = 1, DEPTH_STENCIL_ATTACHMENT = 2, PRESENT_SRC = 4 };
+// TRANSFER_SRC leaves a color attachment ready to be copied from, e.g. headless images that are never sampled
+enum AttachmentUsageFlags {
+    NONE = 0,
+    COLOR_ATTACHMENT = 1,
+    DEPTH_STENCIL_ATTACHMENT = 2,
+    PRESENT_SRC = 4,
+    TRANSFER_SRC = 8
+};
 using AttachmentUsage = u32;
 
 struct AttachmentCreateInfo {
@@ -19,6 +27,8 @@ struct AttachmentCreateInfo {
     AttachmentUsage usage = AttachmentUsageFlags::NONE;
     TextureType texture_type = TextureType::TEXTURE_TYPE_INVALID;
     u32 width = 0, height = 0, depth = 1;
+    // named attachments come from the render target pool, the name is the render graph resource they hold
+    std::string name;
 };
 
 class Attachment {
@@ -26,7 +36,7 @@ class Attachment {
     Attachment(std::shared_ptr<Device> device, const AttachmentCreateInfo create_info);
 
     VkImage m_image;
-    VkDeviceMemory m_image_memory;
+    MemoryAllocation m_image_memory;
     VkImageView m_image_view;
     VkFormat m_format;
 };
@@ -1,61 +1,132 @@
 #include "CommandBuffer.h"
 
+#include <algorithm>
 #include <memory>
 #include <runtime/core/log/Log.h>
+#include <runtime/core/profile/Profiler.h>
+#include <runtime/core/thread/ThreadPool.h>
 #include <runtime/function/rhi/vulkan/Texture.h>
 
 namespace Horizon {
 
+namespace {
+
+// frames averaged into one timing report
+constexpr u32 FRAME_STATS_INTERVAL = 240;
+// retired frame timings kept until they are collected
+constexpr u32 FRAME_TIMING_BACKLOG = 4096;
+
+} // namespace
+
 CommandBuffer::CommandBuffer(RenderContext &render_context, std::shared_ptr<Device> device)
     : m_render_context(render_context), m_device(device) {
     createCommandPool();
+    createSecondaryPools();
     allocateCommandBuffers();
     createSyncObjects();
+    createTimestampQueries();
+    m_upload_manager = std::make_shared<UploadManager>(m_device);
 }
 
 CommandBuffer::~CommandBuffer() {
+    m_upload_manager = nullptr;
+    m_gpu_profiler = nullptr;
     for (u32 i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
         vkDestroySemaphore(m_device->Get(), m_render_finished_semaphores[i], nullptr);
         vkDestroySemaphore(m_device->Get(), m_image_available_semaphores[i], nullptr);
         vkDestroyFence(m_device->Get(), m_in_flight_fences[i], nullptr);
     }
+    if (m_timestamp_query_pool) {
+        vkDestroyQueryPool(m_device->Get(), m_timestamp_query_pool, nullptr);
+    }
+    // secondary command buffers are freed with their pools
+    for (auto &pools : m_secondary_pools) {
+        for (auto &pool : pools) {
+            vkDestroyCommandPool(m_device->Get(), pool.pool, nullptr);
+        }
+    }
     vkDestroyCommandPool(m_device->Get(), m_command_pool, nullptr);
 }
 
 VkCommandBuffer CommandBuffer::Get(u32 i) const noexcept { return m_command_buffers[i]; }
 
-void CommandBuffer::submit(std::shared_ptr<SwapChain> swap_chain) {
+void CommandBuffer::BeginFrame(std::shared_ptr<SwapChain> swap_chain) noexcept {
+    auto wait_begin = std::chrono::steady_clock::now();
+
     vkWaitForFences(m_device->Get(), 1, &m_in_flight_fences[m_current_frame], VK_TRUE, UINT64_MAX);
+    RetireFrame(m_current_frame);
+
+    if (swap_chain->IsHeadless()) {
+        m_image_index = static_cast<u32>(m_submitted_frames % m_images_in_flight.size());
+    } else {
+        vkAcquireNextImageKHR(m_device->Get(), swap_chain->Get(), UINT64_MAX,
+                              m_image_available_semaphores[m_current_frame], VK_NULL_HANDLE, &m_image_index);
+    }
 
-    uint32_t imageIndex;
-    vkAcquireNextImageKHR(m_device->Get(), swap_chain->Get(), UINT64_MAX, m_image_available_semaphores[m_current_frame],
-                          VK_NULL_HANDLE, &imageIndex);
+    // the image may still be presented by a frame that used another slot
+    if (m_images_in_flight[m_image_index] != VK_NULL_HANDLE) {
+        vkWaitForFences(m_device->Get(), 1, &m_images_in_flight[m_image_index], VK_TRUE, UINT64_MAX);
+    }
+    m_images_in_flight[m_image_index] = m_in_flight_fences[m_current_frame];
+
+    for (auto &pool : m_secondary_pools[m_current_frame]) {
+        if (pool.used > 0) {
+            CHECK_VK_RESULT(vkResetCommandPool(m_device->Get(), pool.pool, 0));
+            pool.used = 0;
+        }
+    }
+
+    m_device->GetUniformAllocator()->BeginFrame(m_current_frame);
+    m_device->GetDescriptorAllocator()->BeginFrame();
 
-    if (m_images_in_flight[imageIndex] != VK_NULL_HANDLE) {
-        vkWaitForFences(m_device->Get(), 1, &m_images_in_flight[imageIndex], VK_TRUE, UINT64_MAX);
+    auto now = std::chrono::steady_clock::now();
+    m_in_flight_timings[m_current_frame] = FrameTiming{};
+    m_in_flight_timings[m_current_frame].wait_ms = std::chrono::duration<f64, std::milli>(now - wait_begin).count();
+    if (m_frame_begin != std::chrono::steady_clock::time_point{}) {
+        AccumulateFrameStats(std::chrono::duration<f64, std::milli>(wait_begin - m_frame_begin).count(),
+                             m_in_flight_timings[m_current_frame].wait_ms);
     }
-    m_images_in_flight[imageIndex] = m_in_flight_fences[m_current_frame];
+    m_frame_begin = wait_begin;
+    m_record_begin = now;
+}
+
+void CommandBuffer::submit(std::shared_ptr<SwapChain> swap_chain) {
+    PROFILE_SCOPE("CommandBuffer::submit");
+    f64 record_ms = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - m_record_begin).count();
+    m_frame_stats_sum.record_ms += record_ms;
+    m_in_flight_timings[m_current_frame].frame = m_submitted_frames++;
+    m_in_flight_timings[m_current_frame].record_ms = record_ms;
+    m_in_flight[m_current_frame] = true;
+    bool headless = swap_chain->IsHeadless();
+
+    // pending uploads must reach the queue before the frame that samples them
+    m_upload_manager->Flush();
 
     VkSubmitInfo submitInfo{};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
     VkSemaphore waitSemaphores[] = {m_image_available_semaphores[m_current_frame]};
     VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-    submitInfo.waitSemaphoreCount = 1;
+    submitInfo.waitSemaphoreCount = headless ? 0 : 1;
     submitInfo.pWaitSemaphores = waitSemaphores;
     submitInfo.pWaitDstStageMask = waitStages;
 
     submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &m_command_buffers[imageIndex];
+    submitInfo.pCommandBuffers = &m_command_buffers[m_current_frame];
 
     VkSemaphore signalSemaphores[] = {m_render_finished_semaphores[m_current_frame]};
-    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.signalSemaphoreCount = headless ? 0 : 1;
     submitInfo.pSignalSemaphores = signalSemaphores;
 
     vkResetFences(m_device->Get(), 1, &m_in_flight_fences[m_current_frame]);
 
     CHECK_VK_RESULT(vkQueueSubmit(m_device->getGraphicQueue(), 1, &submitInfo, m_in_flight_fences[m_current_frame]));
 
+    if (headless) {
+        m_current_frame = (m_current_frame + 1) % MAX_FRAMES_IN_FLIGHT;
+        return;
+    }
+
     VkPresentInfoKHR presentInfo{};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
@@ -66,12 +137,81 @@ void CommandBuffer::submit(std::shared_ptr<SwapChain> swap_chain) {
     presentInfo.swapchainCount = 1;
     presentInfo.pSwapchains = swapChains;
 
-    presentInfo.pImageIndices = &imageIndex;
+    presentInfo.pImageIndices = &m_image_index;
 
     vkQueuePresentKHR(m_device->getPresnetQueue(), &presentInfo);
 
+    // no wait here, the next use of this slot waits on its fence in BeginFrame
     m_current_frame = (m_current_frame + 1) % MAX_FRAMES_IN_FLIGHT;
-    vkQueueWaitIdle(m_device->getGraphicQueue());
+}
+
+void CommandBuffer::WaitIdle() noexcept {
+    vkDeviceWaitIdle(m_device->Get());
+    // oldest first, the slot recorded next holds the oldest frame
+    for (u32 i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        RetireFrame((m_current_frame + i) % MAX_FRAMES_IN_FLIGHT);
+    }
+}
+
+std::vector<FrameTiming> CommandBuffer::CollectFrameTimings() noexcept {
+    std::vector<FrameTiming> timings(m_retired_timings.begin(), m_retired_timings.end());
+    m_retired_timings.clear();
+    return timings;
+}
+
+void CommandBuffer::RetireFrame(u32 frame) noexcept {
+    ReadTimestamps(frame);
+    if (m_gpu_profiler) {
+        m_gpu_profiler->ReadResults(frame);
+    }
+    if (!m_in_flight[frame]) {
+        return;
+    }
+    m_in_flight[frame] = false;
+    m_retired_timings.push_back(m_in_flight_timings[frame]);
+    if (m_retired_timings.size() > FRAME_TIMING_BACKLOG) {
+        m_retired_timings.pop_front();
+    }
+}
+
+void CommandBuffer::ReadTimestamps(u32 frame) noexcept {
+    if (!m_timestamp_query_pool || !m_timestamps_written[frame]) {
+        return;
+    }
+    // the frame's fence has signaled, results are available without waiting
+    u64 timestamps[2]{};
+    if (vkGetQueryPoolResults(m_device->Get(), m_timestamp_query_pool, frame * 2, 2, sizeof(timestamps), timestamps,
+                              sizeof(u64), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+        u64 ticks = ((timestamps[1] & m_timestamp_mask) - (timestamps[0] & m_timestamp_mask)) & m_timestamp_mask;
+        m_last_gpu_ms = static_cast<f64>(ticks) * m_timestamp_period * 1e-6;
+        m_in_flight_timings[frame].gpu_ms = m_last_gpu_ms;
+    }
+    m_timestamps_written[frame] = false;
+}
+
+void CommandBuffer::AccumulateFrameStats(f64 frame_ms, f64 wait_ms) noexcept {
+    m_frame_stats_sum.frame_ms += frame_ms;
+    m_frame_stats_sum.wait_ms += wait_ms;
+    m_frame_stats_sum.gpu_ms += m_last_gpu_ms;
+    m_frame_stats_sum.overlap_ms += std::max(m_last_gpu_ms - wait_ms, 0.0);
+    if (++m_frame_stats_count < FRAME_STATS_INTERVAL) {
+        return;
+    }
+
+    f64 inv_count = 1.0 / m_frame_stats_count;
+    m_frame_stats.frame_ms = m_frame_stats_sum.frame_ms * inv_count;
+    m_frame_stats.wait_ms = m_frame_stats_sum.wait_ms * inv_count;
+    m_frame_stats.record_ms = m_frame_stats_sum.record_ms * inv_count;
+    m_frame_stats.gpu_ms = m_frame_stats_sum.gpu_ms * inv_count;
+    m_frame_stats.overlap_ms = m_frame_stats_sum.overlap_ms * inv_count;
+    m_frame_stats_sum = FrameStats{};
+    m_frame_stats_count = 0;
+
+    LOG_INFO("frame {:.2f} ms, cpu record {:.2f} ms, cpu wait {:.2f} ms, gpu {:.2f} ms, overlap {:.2f} ms ({:.0f}%)",
+             m_frame_stats.frame_ms, m_frame_stats.record_ms, m_frame_stats.wait_ms, m_frame_stats.gpu_ms,
+             m_frame_stats.overlap_ms,
+             m_frame_stats.gpu_ms > 0.0 ? 100.0 * m_frame_stats.overlap_ms / m_frame_stats.gpu_ms : 0.0);
+    m_device->GetDescriptorAllocator()->LogStats();
 }
 
 VkCommandPool CommandBuffer::getCommandpool() const noexcept { return m_command_pool; }
@@ -90,14 +230,28 @@ void CommandBuffer::createCommandPool() {
     CHECK_VK_RESULT(vkCreateCommandPool(m_device->Get(), &command_pool_create_info, nullptr, &m_command_pool));
 }
 
+void CommandBuffer::createSecondaryPools() {
+    // the main thread records alongside the workers
+    m_recording_slot_count = ThreadPool::GetInstance().GetWorkerCount() + 1;
+
+    VkCommandPoolCreateInfo command_pool_create_info{};
+    command_pool_create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    command_pool_create_info.queueFamilyIndex = m_device->getQueueFamilyIndices().getGraphics();
+    command_pool_create_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    for (auto &pools : m_secondary_pools) {
+        pools.resize(m_recording_slot_count);
+        for (auto &pool : pools) {
+            CHECK_VK_RESULT(vkCreateCommandPool(m_device->Get(), &command_pool_create_info, nullptr, &pool.pool));
+        }
+    }
+}
+
 void CommandBuffer::allocateCommandBuffers() {
-    // We can now start allocating command buffers and recording drawing commands in them.
-    // Because one of the drawing commands involves binding the right VkFramebuffer,
-    // we'll actually have to record a command buffer for every image in the swap chain
-    // once again. To that end, create a list of VkCommandBuffer objects as a class member.
+    // one command buffer per frame in flight, re-recorded every time its slot comes around. the present pass
+    // picks the framebuffer of the acquired image at record time.
     // Command buffers will be automatically freed when their command pool is destroyed,
     // so we don't need an explicit cleanup.
-    m_command_buffers.resize(m_render_context.swap_chain_image_count);
+    m_command_buffers.resize(MAX_FRAMES_IN_FLIGHT);
 
     VkCommandBufferAllocateInfo commandBufferAllocateInfo{};
     commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -108,13 +262,14 @@ void CommandBuffer::allocateCommandBuffers() {
     CHECK_VK_RESULT(vkAllocateCommandBuffers(m_device->Get(), &commandBufferAllocateInfo, m_command_buffers.data()));
 }
 
-void CommandBuffer::beginRenderPass(u32 index, std::shared_ptr<Pipeline> pipeline, bool is_present) const noexcept {
+void CommandBuffer::beginRenderPass(u32 index, std::shared_ptr<Pipeline> pipeline, bool is_present,
+                                    bool secondary_contents) const noexcept {
     std::shared_ptr<GraphicsPipeline> _pipeline = std::static_pointer_cast<GraphicsPipeline>(pipeline);
     VkRenderPassBeginInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
     renderPassInfo.renderPass = _pipeline->getRenderPass();
     if (is_present) {
-        renderPassInfo.framebuffer = _pipeline->getFrameBuffer(index);
+        renderPassInfo.framebuffer = _pipeline->getFrameBuffer(m_image_index);
     } else {
         renderPassInfo.framebuffer = _pipeline->getFrameBuffer();
     }
@@ -125,6 +280,11 @@ void CommandBuffer::beginRenderPass(u32 index, std::shared_ptr<Pipeline> pipelin
     auto clearValues = _pipeline->getClearValues();
     renderPassInfo.clearValueCount = static_cast<u32>(clearValues.size());
     renderPassInfo.pClearValues = clearValues.data();
+    if (secondary_contents) {
+        // dynamic state is not inherited, the secondary command buffers set the viewport themselves
+        vkCmdBeginRenderPass(m_command_buffers[index], &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+        return;
+    }
     auto viewport = _pipeline->getViewport();
     vkCmdBeginRenderPass(m_command_buffers[index], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
     vkCmdSetViewport(m_command_buffers[index], 0, 1, &viewport);
@@ -132,6 +292,47 @@ void CommandBuffer::beginRenderPass(u32 index, std::shared_ptr<Pipeline> pipelin
 
 void CommandBuffer::endRenderPass(u32 index) const noexcept { vkCmdEndRenderPass(m_command_buffers[index]); }
 
+VkCommandBuffer CommandBuffer::BeginSecondary(u32 frame, u32 slot, std::shared_ptr<Pipeline> pipeline) noexcept {
+    SecondaryPool &pool = m_secondary_pools[frame][slot];
+    if (pool.used == pool.command_buffers.size()) {
+        VkCommandBufferAllocateInfo allocate_info{};
+        allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocate_info.commandPool = pool.pool;
+        allocate_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocate_info.commandBufferCount = 1;
+        VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+        CHECK_VK_RESULT(vkAllocateCommandBuffers(m_device->Get(), &allocate_info, &command_buffer));
+        pool.command_buffers.push_back(command_buffer);
+    }
+    VkCommandBuffer command_buffer = pool.command_buffers[pool.used++];
+
+    // the primary has begun the render pass, its framebuffer exists and is only read here
+    std::shared_ptr<GraphicsPipeline> _pipeline = std::static_pointer_cast<GraphicsPipeline>(pipeline);
+    VkCommandBufferInheritanceInfo inheritance_info{};
+    inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritance_info.renderPass = _pipeline->getRenderPass();
+    inheritance_info.subpass = 0;
+    inheritance_info.framebuffer = _pipeline->getFrameBuffer();
+    // the primary's pass scope may have a pipeline statistics query active
+    if (m_gpu_profiler) {
+        inheritance_info.pipelineStatistics = m_gpu_profiler->GetInheritedStatistics(frame);
+    }
+
+    VkCommandBufferBeginInfo begin_info{};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    begin_info.pInheritanceInfo = &inheritance_info;
+    CHECK_VK_RESULT(vkBeginCommandBuffer(command_buffer, &begin_info));
+
+    auto viewport = _pipeline->getViewport();
+    vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+    return command_buffer;
+}
+
+void CommandBuffer::EndSecondary(VkCommandBuffer command_buffer) const noexcept {
+    CHECK_VK_RESULT(vkEndCommandBuffer(command_buffer));
+}
+
 void CommandBuffer::createSyncObjects() {
     createSemaphores();
     createFences();
@@ -152,7 +353,6 @@ void CommandBuffer::createSemaphores() {
 }
 
 void CommandBuffer::createFences() {
-
     m_in_flight_fences.resize(MAX_FRAMES_IN_FLIGHT);
     m_images_in_flight.resize(m_render_context.swap_chain_image_count, VK_NULL_HANDLE);
 
@@ -165,6 +365,32 @@ void CommandBuffer::createFences() {
     }
 }
 
+void CommandBuffer::createTimestampQueries() {
+    u32 queue_family_count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(m_device->getPhysicalDevice(), &queue_family_count, nullptr);
+    std::vector<VkQueueFamilyProperties> queue_families(queue_family_count);
+    vkGetPhysicalDeviceQueueFamilyProperties(m_device->getPhysicalDevice(), &queue_family_count,
+                                             queue_families.data());
+    u32 valid_bits = queue_families[m_device->getQueueFamilyIndices().getGraphics()].timestampValidBits;
+    if (valid_bits == 0) {
+        LOG_WARN("graphics queue does not support timestamps, gpu frame time is not reported");
+        return;
+    }
+    m_timestamp_mask = valid_bits >= 64 ? ~0ull : (1ull << valid_bits) - 1;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(m_device->getPhysicalDevice(), &properties);
+    m_timestamp_period = properties.limits.timestampPeriod;
+
+    VkQueryPoolCreateInfo query_pool_create_info{};
+    query_pool_create_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    query_pool_create_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    query_pool_create_info.queryCount = MAX_FRAMES_IN_FLIGHT * 2;
+    CHECK_VK_RESULT(vkCreateQueryPool(m_device->Get(), &query_pool_create_info, nullptr, &m_timestamp_query_pool));
+
+    m_gpu_profiler = std::make_shared<GpuProfiler>(m_device, m_timestamp_period, m_timestamp_mask);
+}
+
 VkCommandBuffer CommandBuffer::beginSingleTimeCommands() {
     VkCommandBufferAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -203,11 +429,26 @@ u32 CommandBuffer::present() { return 1; }
 void CommandBuffer::beginCommandRecording(u32 i) {
     VkCommandBufferBeginInfo commandBufferBeginInfo{};
     commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
     // begin command buffer recording
     CHECK_VK_RESULT(vkBeginCommandBuffer(m_command_buffers[i], &commandBufferBeginInfo));
+    if (m_timestamp_query_pool) {
+        vkCmdResetQueryPool(m_command_buffers[i], m_timestamp_query_pool, i * 2, 2);
+        vkCmdWriteTimestamp(m_command_buffers[i], VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_timestamp_query_pool, i * 2);
+    }
+    if (m_gpu_profiler) {
+        m_gpu_profiler->Reset(i, m_command_buffers[i]);
+    }
 }
 
-void CommandBuffer::endCommandRecording(u32 i) { CHECK_VK_RESULT(vkEndCommandBuffer(m_command_buffers[i])); }
+void CommandBuffer::endCommandRecording(u32 i) {
+    if (m_timestamp_query_pool) {
+        vkCmdWriteTimestamp(m_command_buffers[i], VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_timestamp_query_pool,
+                            i * 2 + 1);
+        m_timestamps_written[i] = true;
+    }
+    CHECK_VK_RESULT(vkEndCommandBuffer(m_command_buffers[i]));
+}
 
 void CommandBuffer::Dispatch(u32 i, std::shared_ptr<Pipeline> pipeline,
                              const std::vector<std::shared_ptr<DescriptorSet>> _descriptor_sets) noexcept {
@@ -215,6 +456,18 @@ void CommandBuffer::Dispatch(u32 i, std::shared_ptr<Pipeline> pipeline,
         LOG_ERROR("incorrect pipeline type");
         return;
     }
+    std::shared_ptr<ComputePipeline> _pipeline = std::static_pointer_cast<ComputePipeline>(pipeline);
+    Dispatch(i, pipeline, _descriptor_sets, _pipeline->GroupCountX(), _pipeline->GroupCountY(),
+             _pipeline->GroupCountZ());
+}
+
+void CommandBuffer::Dispatch(u32 i, std::shared_ptr<Pipeline> pipeline,
+                             const std::vector<std::shared_ptr<DescriptorSet>> _descriptor_sets, u32 group_count_x,
+                             u32 group_count_y, u32 group_count_z) noexcept {
+    if (pipeline->GetType() != PipelineType::COMPUTE) {
+        LOG_ERROR("incorrect pipeline type");
+        return;
+    }
 
     if (pipeline->hasPushConstants()) {
         for (auto &pc : pipeline->m_push_constants->ranges) {
@@ -226,13 +479,16 @@ void CommandBuffer::Dispatch(u32 i, std::shared_ptr<Pipeline> pipeline,
     std::shared_ptr<ComputePipeline> _pipeline = std::static_pointer_cast<ComputePipeline>(pipeline);
     if (!_descriptor_sets.empty()) {
         std::vector<VkDescriptorSet> descriptor_sets(_descriptor_sets.size());
-        for (u32 i = 0; i < _descriptor_sets.size(); i++) {
-            descriptor_sets[i] = _descriptor_sets[i]->Get();
+        std::vector<u32> dynamic_offsets;
+        for (u32 set = 0; set < _descriptor_sets.size(); set++) {
+            descriptor_sets[set] = _descriptor_sets[set]->Get();
+            _descriptor_sets[set]->GetDynamicOffsets(dynamic_offsets);
         }
         vkCmdBindDescriptorSets(m_command_buffers[i], VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline->GetLayout(), 0,
-                                descriptor_sets.size(), descriptor_sets.data(), 0, 0);
+                                descriptor_sets.size(), descriptor_sets.data(), dynamic_offsets.size(),
+                                dynamic_offsets.data());
     }
     vkCmdBindPipeline(m_command_buffers[i], VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline->Get());
-    vkCmdDispatch(m_command_buffers[i], _pipeline->GroupCountX(), _pipeline->GroupCountY(), _pipeline->GroupCountZ());
+    vkCmdDispatch(m_command_buffers[i], group_count_x, group_count_y, group_count_z);
 }
 } // namespace Horizon
\ No newline at end of file
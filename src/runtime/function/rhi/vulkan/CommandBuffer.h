@@ -1,25 +1,68 @@
 #pragma once
 
+#include <array>
+#include <chrono>
+#include <deque>
 #include <vector>
 #include <vulkan/vulkan.hpp>
 
 #include "Device.h"
+#include "GpuProfiler.h"
 #include "Pipeline.h"
 #include "SwapChain.h"
+#include "UploadManager.h"
 #include <runtime/core/singleton/public_singleton.h>
 #include <runtime/function/rhi/RenderContext.h>
 
 namespace Horizon {
 
+// averaged over the last report interval
+struct FrameStats {
+    f64 frame_ms = 0.0;   // between two BeginFrame calls
+    f64 wait_ms = 0.0;    // cpu blocked on the frame fence and image acquire
+    f64 record_ms = 0.0;  // cpu work from BeginFrame to submit, uniform updates included
+    f64 gpu_ms = 0.0;     // timestamps around the frame's command buffer
+    f64 overlap_ms = 0.0; // gpu time that ran while the cpu was not waiting on it
+};
+
+// one retired frame
+struct FrameTiming {
+    u64 frame = 0;        // submission order, from 0
+    f64 wait_ms = 0.0;    // cpu blocked on the frame fence and image acquire
+    f64 record_ms = 0.0;  // cpu work from BeginFrame to submit
+    f64 gpu_ms = 0.0;     // timestamps around the frame's command buffer, 0 without timestamp support
+};
+
+// one command buffer per frame in flight. BeginFrame waits for the slot's previous frame, acquires the swap chain
+// image and rewinds per frame resources, only that slot's command buffer is recorded and submitted. a headless swap
+// chain's images are taken in turn, nothing waits on acquire or presents.
 class CommandBuffer {
   public:
     CommandBuffer(RenderContext &render_context, std::shared_ptr<Device> device);
     ~CommandBuffer();
     VkCommandBuffer Get(u32 i) const noexcept;
+    // wait until the frame slot is retired, acquire the next image and rewind the slot's uniform region, call
+    // before any uniform or descriptor update of the frame
+    void BeginFrame(std::shared_ptr<SwapChain> swap_chain) noexcept;
     void submit(std::shared_ptr<SwapChain> swap_chain);
+    // waits for the device and retires every frame in flight, their timings and gpu profiles become available
+    void WaitIdle() noexcept;
+    // swap chain image of the last submitted frame
+    u32 GetImageIndex() const noexcept { return m_image_index; }
+    // timings of the frames retired since the last call, oldest first. only the latest FRAME_TIMING_BACKLOG are
+    // kept when nobody collects them
+    std::vector<FrameTiming> CollectFrameTimings() noexcept;
     VkCommandPool getCommandpool() const noexcept;
-    void beginRenderPass(u32 index, std::shared_ptr<Pipeline> pipeline, bool is_present = false) const noexcept;
+    // with secondary_contents the pass may only execute secondary command buffers begun with BeginSecondary
+    void beginRenderPass(u32 index, std::shared_ptr<Pipeline> pipeline, bool is_present = false,
+                         bool secondary_contents = false) const noexcept;
     void endRenderPass(u32 index) const noexcept;
+    // one command pool per recording slot and frame in flight, any thread may record a slot as long as no other
+    // thread records the same slot at the same time. the slots are rewound in BeginFrame
+    u32 GetRecordingSlotCount() const noexcept { return m_recording_slot_count; }
+    // secondary command buffer continuing the pipeline's render pass, the viewport is already set
+    VkCommandBuffer BeginSecondary(u32 frame, u32 slot, std::shared_ptr<Pipeline> pipeline) noexcept;
+    void EndSecondary(VkCommandBuffer command_buffer) const noexcept;
     VkCommandBuffer beginSingleTimeCommands();
     void endSingleTimeCommands(VkCommandBuffer command_buffer);
     u32 commandBufferCount() const noexcept { return m_command_buffers.size(); }
@@ -28,13 +71,32 @@ class CommandBuffer {
     void endCommandRecording(u32 index);
     void Dispatch(u32 i, std::shared_ptr<Pipeline> pipeline,
                   const std::vector<std::shared_ptr<DescriptorSet>> _descriptor_sets) noexcept;
+    // dispatch part of the pipeline's grid, the shader offsets its invocation ids itself
+    void Dispatch(u32 i, std::shared_ptr<Pipeline> pipeline,
+                  const std::vector<std::shared_ptr<DescriptorSet>> _descriptor_sets, u32 group_count_x,
+                  u32 group_count_y, u32 group_count_z) noexcept;
+    std::shared_ptr<UploadManager> GetUploadManager() const noexcept { return m_upload_manager; }
+    // index of the command buffer to record this frame
+    u32 GetCurrentFrame() const noexcept { return m_current_frame; }
+    const FrameStats &GetFrameStats() const noexcept { return m_frame_stats; }
+    // nanoseconds per timestamp tick and the valid timestamp bits, the mask is 0 without timestamp support
+    f64 GetTimestampPeriod() const noexcept { return m_timestamp_period; }
+    u64 GetTimestampMask() const noexcept { return m_timestamp_mask; }
+    // per pass gpu timings, nullptr without timestamp support
+    std::shared_ptr<GpuProfiler> GetGpuProfiler() const noexcept { return m_gpu_profiler; }
 
   private:
     void createCommandPool();
+    void createSecondaryPools();
     void allocateCommandBuffers();
     void createSyncObjects();
     void createSemaphores();
     void createFences();
+    void createTimestampQueries();
+    // reads the slot's timestamps and gpu profile, call once its fence has signaled
+    void RetireFrame(u32 frame) noexcept;
+    void ReadTimestamps(u32 frame) noexcept;
+    void AccumulateFrameStats(f64 frame_ms, f64 wait_ms) noexcept;
 
   private:
     RenderContext &m_render_context;
@@ -43,6 +105,17 @@ class CommandBuffer {
     VkCommandPool m_command_pool = nullptr;
     std::vector<VkCommandBuffer> m_command_buffers;
 
+    // secondary command buffers of a recording slot, reused once the slot's frame has retired
+    struct SecondaryPool {
+        VkCommandPool pool = VK_NULL_HANDLE;
+        std::vector<VkCommandBuffer> command_buffers;
+        u32 used = 0;
+    };
+    u32 m_recording_slot_count = 0;
+    std::array<std::vector<SecondaryPool>, MAX_FRAMES_IN_FLIGHT> m_secondary_pools;
+
+    std::shared_ptr<UploadManager> m_upload_manager = nullptr;
+
     // We'll need one semaphore to signal that an image has been acquired and is ready for rendering,
     // and another one to signal that rendering has finished and presentation can happen. Create two
     // class members to store these semaphore objects:
@@ -50,8 +123,27 @@ class CommandBuffer {
     std::vector<VkSemaphore> m_render_finished_semaphores;
     std::vector<VkFence> m_in_flight_fences;
     std::vector<VkFence> m_images_in_flight;
-    const int MAX_FRAMES_IN_FLIGHT = 2;
     u32 m_current_frame = 0;
+    u32 m_image_index = 0;
+
+    // two timestamps per frame in flight, disabled if the graphics queue has no timestamp support
+    VkQueryPool m_timestamp_query_pool = VK_NULL_HANDLE;
+    f64 m_timestamp_period = 0.0;
+    u64 m_timestamp_mask = 0;
+    std::array<bool, MAX_FRAMES_IN_FLIGHT> m_timestamps_written{};
+    std::shared_ptr<GpuProfiler> m_gpu_profiler = nullptr;
+
+    std::chrono::steady_clock::time_point m_frame_begin{};
+    std::chrono::steady_clock::time_point m_record_begin{};
+    f64 m_last_gpu_ms = 0.0;
+    u64 m_submitted_frames = 0;
+    // timings of the frames in flight, completed when their slot retires
+    std::array<FrameTiming, MAX_FRAMES_IN_FLIGHT> m_in_flight_timings{};
+    std::array<bool, MAX_FRAMES_IN_FLIGHT> m_in_flight{};
+    std::deque<FrameTiming> m_retired_timings;
+    FrameStats m_frame_stats_sum;
+    FrameStats m_frame_stats;
+    u32 m_frame_stats_count = 0;
 };
 
 } // namespace Horizon
\ No newline at end of file
@@ -0,0 +1,258 @@
+#include "DescriptorAllocator.h"
+
+#include <algorithm>
+#include <array>
+
+#include <runtime/core/log/Log.h>
+#include <runtime/function/rhi/RenderContext.h>
+
+namespace Horizon {
+
+namespace {
+
+constexpr u32 MIN_POOL_SETS = 64;
+constexpr u32 MAX_POOL_SETS = 4096;
+// released sets are freed after this many frames without a request, which also keeps them out of any frame in flight
+constexpr u64 EVICT_AFTER_FRAMES = 64;
+static_assert(EVICT_AFTER_FRAMES > MAX_FRAMES_IN_FLIGHT);
+
+// descriptors of each type reserved per set in a pool, pools are shared so only the totals matter
+constexpr std::array<std::pair<VkDescriptorType, u32>, 4> POOL_RATIOS{{
+    {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 2},
+    {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1},
+    {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4},
+    {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 4},
+}};
+
+} // namespace
+
+DescriptorAllocator::DescriptorAllocator(VkDevice device) noexcept
+    : m_device(device), m_next_pool_size(MIN_POOL_SETS) {}
+
+DescriptorAllocator::~DescriptorAllocator() noexcept {
+    // sets are freed with their pools
+    for (auto pool : m_pools) {
+        vkDestroyDescriptorPool(m_device, pool, nullptr);
+    }
+}
+
+DescriptorAllocator::Key DescriptorAllocator::MakeKey(VkDescriptorSetLayout layout,
+                                                      const std::vector<VkWriteDescriptorSet> &writes,
+                                                      std::vector<u32> *handles) noexcept {
+    Key key;
+    key.data.reserve(1 + writes.size() * 4);
+    key.data.push_back(HandleToU64(layout));
+    auto push_handle = [&key, handles](u64 handle) {
+        if (handles) {
+            handles->push_back(static_cast<u32>(key.data.size()));
+        }
+        key.data.push_back(handle);
+    };
+    for (auto &write : writes) {
+        key.data.push_back((static_cast<u64>(write.dstBinding) << 32) | static_cast<u64>(write.descriptorType));
+        if (write.pImageInfo) {
+            push_handle(HandleToU64(write.pImageInfo->sampler));
+            push_handle(HandleToU64(write.pImageInfo->imageView));
+            key.data.push_back(static_cast<u64>(write.pImageInfo->imageLayout));
+        } else if (write.pBufferInfo) {
+            // dynamic uniform buffers always point at the start of the ring, their offset is supplied at bind time
+            push_handle(HandleToU64(write.pBufferInfo->buffer));
+            key.data.push_back(write.pBufferInfo->offset);
+            key.data.push_back(write.pBufferInfo->range);
+        }
+    }
+    // fnv-1a over the words
+    u64 hash = 14695981039346656037ull;
+    for (u64 word : key.data) {
+        hash = (hash ^ word) * 1099511628211ull;
+    }
+    key.hash = hash;
+    return key;
+}
+
+VkDescriptorSet DescriptorAllocator::Acquire(VkDescriptorSetLayout layout, std::vector<VkWriteDescriptorSet> &writes,
+                                             VkDescriptorSet previous) noexcept {
+    Key key = MakeKey(layout, writes);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_cache.find(key);
+    if (it != m_cache.end()) {
+        m_stats.cache_hits++;
+        Entry &entry = it->second;
+        entry.last_used_frame = m_frame;
+        if (entry.set != previous) {
+            entry.refs++;
+            ReleaseLocked(previous);
+        }
+        return entry.set;
+    }
+
+    m_stats.cache_misses++;
+    Entry entry;
+    if (!Allocate(layout, entry)) {
+        return previous;
+    }
+    // only cached sets need the handle positions, hits skip collecting them
+    MakeKey(layout, writes, &entry.handles);
+    for (auto &write : writes) {
+        write.dstSet = entry.set;
+    }
+    vkUpdateDescriptorSets(m_device, static_cast<u32>(writes.size()), writes.data(), 0, nullptr);
+
+    entry.refs = 1;
+    entry.last_used_frame = m_frame;
+    auto inserted = m_cache.emplace(std::move(key), entry).first;
+    m_set_keys[entry.set] = &inserted->first;
+    ReleaseLocked(previous);
+    return entry.set;
+}
+
+void DescriptorAllocator::Release(VkDescriptorSet set) noexcept {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ReleaseLocked(set);
+}
+
+void DescriptorAllocator::ReleaseLocked(VkDescriptorSet set) noexcept {
+    if (set == VK_NULL_HANDLE) {
+        return;
+    }
+    auto it = m_set_keys.find(set);
+    if (it == m_set_keys.end()) {
+        return;
+    }
+    Entry &entry = m_cache.at(*it->second);
+    if (entry.refs > 0) {
+        entry.refs--;
+    }
+    // the set may still be bound by a frame in flight, it is freed by the sweep in BeginFrame
+    entry.last_used_frame = m_frame;
+}
+
+void DescriptorAllocator::InvalidateHandle(u64 handle) noexcept {
+    if (handle == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto it = m_cache.begin(); it != m_cache.end();) {
+        const Key &key = it->first;
+        Entry &entry = it->second;
+        bool referenced = std::any_of(entry.handles.begin(), entry.handles.end(),
+                                      [&key, handle](u32 offset) { return key.data[offset] == handle; });
+        if (!referenced) {
+            ++it;
+            continue;
+        }
+        // holders keep the set until they update or go away, releasing it is then a no-op
+        m_set_keys.erase(entry.set);
+        entry.last_used_frame = m_frame;
+        m_invalidated.push_back(std::move(entry));
+        it = m_cache.erase(it);
+        m_stats.invalidations++;
+    }
+}
+
+void DescriptorAllocator::BeginFrame() noexcept {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_frame++;
+    // sweeping is cheap but not free, a released set only has to be gone eventually
+    if (m_frame % EVICT_AFTER_FRAMES != 0) {
+        return;
+    }
+    for (auto it = m_cache.begin(); it != m_cache.end();) {
+        Entry &entry = it->second;
+        if (entry.refs == 0 && m_frame - entry.last_used_frame > EVICT_AFTER_FRAMES) {
+            vkFreeDescriptorSets(m_device, entry.pool, 1, &entry.set);
+            m_set_keys.erase(entry.set);
+            it = m_cache.erase(it);
+            m_stats.evictions++;
+        } else {
+            ++it;
+        }
+    }
+    auto retired = std::partition(m_invalidated.begin(), m_invalidated.end(), [this](const Entry &entry) {
+        return m_frame - entry.last_used_frame <= EVICT_AFTER_FRAMES;
+    });
+    for (auto it = retired; it != m_invalidated.end(); ++it) {
+        vkFreeDescriptorSets(m_device, it->pool, 1, &it->set);
+    }
+    m_invalidated.erase(retired, m_invalidated.end());
+}
+
+bool DescriptorAllocator::Allocate(VkDescriptorSetLayout layout, Entry &entry) noexcept {
+    VkDescriptorSetAllocateInfo alloc_info{};
+    alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    alloc_info.descriptorSetCount = 1;
+    alloc_info.pSetLayouts = &layout;
+
+    // newest pools have the most room, older ones may have holes left by evicted sets
+    for (auto it = m_pools.rbegin(); it != m_pools.rend(); ++it) {
+        alloc_info.descriptorPool = *it;
+        m_stats.allocations++;
+        VkResult result = vkAllocateDescriptorSets(m_device, &alloc_info, &entry.set);
+        if (result == VK_SUCCESS) {
+            entry.pool = *it;
+            return true;
+        }
+        if (result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL) {
+            CHECK_VK_RESULT(result);
+            return false;
+        }
+    }
+
+    VkDescriptorPool pool = CreatePool(m_next_pool_size);
+    if (pool == VK_NULL_HANDLE) {
+        return false;
+    }
+    m_next_pool_size = std::min(m_next_pool_size * 2, MAX_POOL_SETS);
+    alloc_info.descriptorPool = pool;
+    m_stats.allocations++;
+    VkResult result = vkAllocateDescriptorSets(m_device, &alloc_info, &entry.set);
+    if (result != VK_SUCCESS) {
+        LOG_ERROR("failed to allocate descriptorset from a new pool, the layout exceeds the pool ratios");
+        return false;
+    }
+    entry.pool = pool;
+    return true;
+}
+
+VkDescriptorPool DescriptorAllocator::CreatePool(u32 max_sets) noexcept {
+    std::array<VkDescriptorPoolSize, POOL_RATIOS.size()> pool_sizes;
+    for (u32 i = 0; i < POOL_RATIOS.size(); i++) {
+        pool_sizes[i] = VkDescriptorPoolSize{POOL_RATIOS[i].first, POOL_RATIOS[i].second * max_sets};
+    }
+
+    VkDescriptorPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    // evicted sets go back to their pool
+    pool_info.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+    pool_info.maxSets = max_sets;
+    pool_info.poolSizeCount = static_cast<u32>(pool_sizes.size());
+    pool_info.pPoolSizes = pool_sizes.data();
+
+    VkDescriptorPool pool = VK_NULL_HANDLE;
+    CHECK_VK_RESULT(vkCreateDescriptorPool(m_device, &pool_info, nullptr, &pool));
+    if (pool) {
+        m_pools.push_back(pool);
+    }
+    return pool;
+}
+
+DescriptorStats DescriptorAllocator::GetStats() const noexcept {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    DescriptorStats stats = m_stats;
+    stats.pool_count = static_cast<u32>(m_pools.size());
+    stats.cached_sets = static_cast<u32>(m_cache.size());
+    return stats;
+}
+
+void DescriptorAllocator::LogStats() const noexcept {
+    DescriptorStats stats = GetStats();
+    u64 requests = stats.cache_hits + stats.cache_misses;
+    LOG_INFO("descriptor sets: {} cached in {} pools, {} requests, {} hits ({:.1f}%), {} allocations, {} evictions, "
+             "{} invalidations",
+             stats.cached_sets, stats.pool_count, requests, stats.cache_hits,
+             requests ? 100.0 * stats.cache_hits / requests : 0.0, stats.allocations, stats.evictions,
+             stats.invalidations);
+}
+
+} // namespace Horizon
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include <runtime/core/math/Math.h>
+
+namespace Horizon {
+
+struct DescriptorStats {
+    u32 pool_count = 0;
+    u32 cached_sets = 0;
+    u64 allocations = 0; // vkAllocateDescriptorSets calls
+    u64 cache_hits = 0;
+    u64 cache_misses = 0;
+    u64 evictions = 0;
+    u64 invalidations = 0; // sets dropped because a resource they reference was destroyed
+};
+
+// hands out descriptor sets from shared pools which grow on demand. sets are cached by layout and bound resources,
+// a set is written once when it is created and never changes, so identical updates return the same set and it can
+// be bound by several frames in flight. sets nobody holds any more are freed once they have not been requested for
+// a while. resources must invalidate their handles before they are destroyed, a new resource can get the same handle
+// and would otherwise hit a set written for the old one. thread safe.
+class DescriptorAllocator {
+  public:
+    explicit DescriptorAllocator(VkDevice device) noexcept;
+    ~DescriptorAllocator() noexcept;
+    DescriptorAllocator(const DescriptorAllocator &) = delete;
+    DescriptorAllocator &operator=(const DescriptorAllocator &) = delete;
+
+    // returns a set holding exactly these writes and releases previous, dstSet of the writes is filled on a miss
+    VkDescriptorSet Acquire(VkDescriptorSetLayout layout, std::vector<VkWriteDescriptorSet> &writes,
+                            VkDescriptorSet previous = VK_NULL_HANDLE) noexcept;
+    void Release(VkDescriptorSet set) noexcept;
+
+    // drop the cached sets referencing a buffer, image view or sampler about to be destroyed, later requests allocate
+    // new sets. the dropped sets are freed once they can no longer be in flight
+    template <typename T> void Invalidate(T handle) noexcept { InvalidateHandle(HandleToU64(handle)); }
+
+    // advance the frame counter and free released sets that are no longer in flight
+    void BeginFrame() noexcept;
+
+    DescriptorStats GetStats() const noexcept;
+    void LogStats() const noexcept;
+
+  private:
+    // non-dispatchable handles are pointers on 64 bit targets and integers elsewhere
+    template <typename T> static u64 HandleToU64(T handle) noexcept {
+        if constexpr (std::is_pointer_v<T>) {
+            return static_cast<u64>(reinterpret_cast<uintptr_t>(handle));
+        } else {
+            return static_cast<u64>(handle);
+        }
+    }
+
+    struct Key {
+        std::vector<u64> data;
+        u64 hash = 0;
+        bool operator==(const Key &other) const noexcept { return hash == other.hash && data == other.data; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key &key) const noexcept { return static_cast<size_t>(key.hash); }
+    };
+    struct Entry {
+        VkDescriptorSet set = VK_NULL_HANDLE;
+        VkDescriptorPool pool = VK_NULL_HANDLE;
+        u32 refs = 0;
+        u64 last_used_frame = 0;
+        // offsets of the handle words in the key
+        std::vector<u32> handles;
+    };
+
+    static Key MakeKey(VkDescriptorSetLayout layout, const std::vector<VkWriteDescriptorSet> &writes,
+                       std::vector<u32> *handles = nullptr) noexcept;
+    void InvalidateHandle(u64 handle) noexcept;
+    bool Allocate(VkDescriptorSetLayout layout, Entry &entry) noexcept;
+    VkDescriptorPool CreatePool(u32 max_sets) noexcept;
+    void ReleaseLocked(VkDescriptorSet set) noexcept;
+
+  private:
+    VkDevice m_device = VK_NULL_HANDLE;
+    mutable std::mutex m_mutex;
+    std::vector<VkDescriptorPool> m_pools;
+    u32 m_next_pool_size = 0;
+    std::unordered_map<Key, Entry, KeyHash> m_cache;
+    // key of every live set, pointing into m_cache whose nodes are stable
+    std::unordered_map<VkDescriptorSet, const Key *> m_set_keys;
+    // sets of invalidated entries, freed by the sweep once no frame in flight can bind them
+    std::vector<Entry> m_invalidated;
+    u64 m_frame = 0;
+    DescriptorStats m_stats;
+};
+
+} // namespace Horizon
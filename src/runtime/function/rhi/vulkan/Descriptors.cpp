@@ -1,7 +1,5 @@
 #include "Descriptors.h"
 
-#include <unordered_map>
-
 #include <runtime/core/log/Log.h>
 
 #include "UniformBuffer.h"
@@ -11,11 +9,10 @@ namespace Horizon {
 DescriptorSet::DescriptorSet(std::shared_ptr<Device> device, std::shared_ptr<DescriptorSetInfo> setInfo)
     : m_device(device), mDescriptorSetInfo(setInfo) {
     CreateDescriptorSetLayout();
-    CreateDescriptorPool();
 }
 
 DescriptorSet::~DescriptorSet() {
-    vkDestroyDescriptorPool(m_device->Get(), mDescriptorPool, nullptr);
+    m_device->GetDescriptorAllocator()->Release(mSet);
     vkDestroyDescriptorSetLayout(m_device->Get(), mSetLayout, nullptr);
 }
 
@@ -37,13 +34,12 @@ void DescriptorSet::CreateDescriptorSetLayout() {
 }
 
 void DescriptorSet::UpdateDescriptorSet(const DescriptorSetUpdateDesc &desc) {
-    AllocateDescriptorSet();
+    m_dynamic_buffers.clear();
     // update descriptor set
     std::vector<VkWriteDescriptorSet> descriptorWrites(mDescriptorSetInfo->bindingCount);
     for (u32 binding = 0; binding < mDescriptorSetInfo->bindingCount; binding++) {
         descriptorWrites[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
         descriptorWrites[binding].pNext = nullptr;
-        descriptorWrites[binding].dstSet = mSet;
         descriptorWrites[binding].dstBinding = binding;
         descriptorWrites[binding].dstArrayElement = 0;
         descriptorWrites[binding].descriptorCount = 1;
@@ -60,58 +56,26 @@ void DescriptorSet::UpdateDescriptorSet(const DescriptorSetUpdateDesc &desc) {
         case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
             descriptorWrites[binding].pBufferInfo = &desc.descriptorMap.at(binding).get()->bufferDescriptrInfo;
             break;
+        case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+            descriptorWrites[binding].pBufferInfo = &desc.descriptorMap.at(binding).get()->bufferDescriptrInfo;
+            m_dynamic_buffers.push_back(desc.descriptorMap.at(binding));
+            break;
         default:
             break;
         }
     }
-    vkUpdateDescriptorSets(m_device->Get(), descriptorWrites.size(), descriptorWrites.data(), 0, nullptr);
+    mSet = m_device->GetDescriptorAllocator()->Acquire(mSetLayout, descriptorWrites, mSet);
 }
 
-VkDescriptorSetLayout DescriptorSet::GetLayout() { return mSetLayout; }
-
-VkDescriptorSet DescriptorSet::Get() { return mSet; }
-
-void DescriptorSet::AllocateDescriptorSet() {
-    if (mSet != VK_NULL_HANDLE) {
-        CHECK_VK_RESULT(vkFreeDescriptorSets(m_device->Get(), mDescriptorPool, 1, &mSet));
-    }
-    VkDescriptorSetAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = mDescriptorPool;
-    allocInfo.descriptorSetCount = 1;
-    allocInfo.pSetLayouts = &mSetLayout;
-    CHECK_VK_RESULT(vkAllocateDescriptorSets(m_device->Get(), &allocInfo, &mSet));
-    if (!mSet) {
-        LOG_ERROR("failed to allocate descriptorset");
+void DescriptorSet::GetDynamicOffsets(std::vector<u32> &offsets) const noexcept {
+    for (auto &buffer : m_dynamic_buffers) {
+        offsets.push_back(buffer->dynamicOffset);
     }
 }
 
-void DescriptorSet::CreateDescriptorPool() {
-
-    std::unordered_map<VkDescriptorType, u32> descriptorTypeMap;
-
-    for (u32 binding = 0; binding < mDescriptorSetInfo->bindingCount; binding++) {
-        descriptorTypeMap[ToVkDescriptorType(mDescriptorSetInfo->types[binding])]++;
-    }
-
-    std::vector<VkDescriptorPoolSize> poolSizes(descriptorTypeMap.size());
-
-    u32 i = 0;
-    for (auto &type : descriptorTypeMap) {
-        poolSizes[i++] = VkDescriptorPoolSize{type.first, type.second};
-    }
-
-    VkDescriptorPoolCreateInfo poolInfo{};
+VkDescriptorSetLayout DescriptorSet::GetLayout() { return mSetLayout; }
 
-    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    poolInfo.pNext = nullptr;
-    poolInfo.flags = 0;
-    poolInfo.maxSets = 1;
-    poolInfo.poolSizeCount = static_cast<u32>(poolSizes.size());
-    poolInfo.pPoolSizes = poolSizes.data();
-    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
-    CHECK_VK_RESULT(vkCreateDescriptorPool(m_device->Get(), &poolInfo, nullptr, &mDescriptorPool));
-}
+VkDescriptorSet DescriptorSet::Get() { return mSet; }
 
 void DescriptorSetInfo::AddBinding(DescriptorType type, u32 stage) {
     bindingCount++;
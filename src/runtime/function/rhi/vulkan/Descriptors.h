@@ -34,19 +34,21 @@ class DescriptorSet {
     ~DescriptorSet();
     VkDescriptorSetLayout GetLayout();
     VkDescriptorSet Get();
-    void AllocateDescriptorSet();
+    // looks the bindings up in the device's descriptor set cache, only a new combination allocates and writes a set.
+    // the previous set stays valid for frames in flight
     void UpdateDescriptorSet(const DescriptorSetUpdateDesc &desc);
+    // append the current offsets of the dynamic uniform buffers in binding order, read at bind time
+    void GetDynamicOffsets(std::vector<u32> &offsets) const noexcept;
 
   private:
     void CreateDescriptorSetLayout();
-    void CreateDescriptorPool();
 
   private:
     std::shared_ptr<Device> m_device = nullptr;
     std::shared_ptr<DescriptorSetInfo> mDescriptorSetInfo;
     VkDescriptorSetLayout mSetLayout = VK_NULL_HANDLE;
     VkDescriptorSet mSet = VK_NULL_HANDLE;
-    VkDescriptorPool mDescriptorPool = VK_NULL_HANDLE;
+    std::vector<std::shared_ptr<DescriptorBase>> m_dynamic_buffers;
 };
 
 } // namespace Horizon
\ No newline at end of file
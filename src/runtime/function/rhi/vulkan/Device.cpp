@@ -1,5 +1,7 @@
 #include "Device.h"
 
+#include <algorithm>
+#include <cstring>
 #include <set>
 #include <vector>
 
@@ -11,6 +13,9 @@
 namespace Horizon {
 Device::Device(std::shared_ptr<Instance> instance, std::shared_ptr<Surface> surface)
     : m_instance(instance), m_surface(surface) {
+    if (m_surface) {
+        m_device_extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    }
     // enumerate vk devices
     vkEnumeratePhysicalDevices(m_instance->Get(), &device_count, nullptr);
     if (device_count == 0) {
@@ -19,9 +24,17 @@ Device::Device(std::shared_ptr<Instance> instance, std::shared_ptr<Surface> surf
     vkEnumeratePhysicalDevices(m_instance->Get(), &device_count, m_physical_devices.data());
     pickPhysicalDevice(m_instance->Get());
     createDevice(m_instance->getValidationLayer());
+    m_memory_allocator = std::make_unique<MemoryAllocator>(m_device, getPhysicalDevice());
+    m_uniform_allocator = std::make_unique<UniformAllocator>(getPhysicalDevice(), m_memory_allocator.get());
+    m_descriptor_allocator = std::make_unique<DescriptorAllocator>(m_device);
 }
 
-Device::~Device() { vkDestroyDevice(m_device, nullptr); }
+Device::~Device() {
+    m_descriptor_allocator.reset();
+    m_uniform_allocator.reset();
+    m_memory_allocator.reset();
+    vkDestroyDevice(m_device, nullptr);
+}
 
 VkPhysicalDevice Device::getPhysicalDevice() const noexcept { return m_physical_devices[m_physical_device_index]; }
 
@@ -32,9 +45,10 @@ VkQueue Device::getGraphicQueue() const noexcept { return m_graphics_queue; }
 VkQueue Device::getPresnetQueue() const noexcept { return m_present_queue; }
 
 bool Device::isDeviceSuitable(VkPhysicalDevice device) {
-    QueueFamilyIndices indices(device, m_surface->Get());
-    SurfaceSupportDetails details(device, m_surface->Get());
-    if (indices.completed() && details.suitable() && checkDeviceExtensionSupport(device)) {
+    VkSurfaceKHR surface = m_surface ? m_surface->Get() : VK_NULL_HANDLE;
+    QueueFamilyIndices indices(device, surface);
+    bool surface_suitable = !m_surface || SurfaceSupportDetails(device, surface).suitable();
+    if (indices.completed() && surface_suitable && checkDeviceExtensionSupport(device)) {
         VkPhysicalDeviceProperties device_properties;
         vkGetPhysicalDeviceProperties(device, &device_properties);
         LOG_INFO("using device:{}", device_properties.deviceName);
@@ -85,19 +99,67 @@ void Device::createDevice(const ValidationLayer &validation_layers) {
 
     VkPhysicalDeviceFeatures deviceFeatures{};
 
+    // gpu driven drawing, optional
+    VkPhysicalDeviceFeatures supported_features{};
+    vkGetPhysicalDeviceFeatures(m_physical_devices[m_physical_device_index], &supported_features);
+    m_multi_draw_indirect_supported =
+        supported_features.multiDrawIndirect && supported_features.drawIndirectFirstInstance;
+    if (m_multi_draw_indirect_supported) {
+        deviceFeatures.multiDrawIndirect = VK_TRUE;
+        deviceFeatures.drawIndirectFirstInstance = VK_TRUE;
+    }
+    // gpu profiler, optional
+    m_pipeline_statistics_query_supported = supported_features.pipelineStatisticsQuery;
+    deviceFeatures.pipelineStatisticsQuery = supported_features.pipelineStatisticsQuery;
+    m_inherited_queries_supported = supported_features.pipelineStatisticsQuery && supported_features.inheritedQueries;
+    deviceFeatures.inheritedQueries = m_inherited_queries_supported;
+
+    std::vector<const char *> device_extensions = m_device_extensions;
+
+    bool draw_indirect_count_supported =
+        checkExtensionSupport(m_physical_devices[m_physical_device_index], VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+    if (draw_indirect_count_supported) {
+        device_extensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+    }
+
+    // pipeline cache statistics, optional
+    m_pipeline_creation_feedback_supported = checkExtensionSupport(m_physical_devices[m_physical_device_index],
+                                                                   VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME);
+    if (m_pipeline_creation_feedback_supported) {
+        device_extensions.push_back(VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME);
+    }
+
+    // bindless material textures, optional
+    VkPhysicalDeviceDescriptorIndexingFeatures descriptor_indexing_features{};
+    descriptor_indexing_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+    m_bindless_supported = checkBindlessSupport(m_physical_devices[m_physical_device_index]);
+    if (m_bindless_supported) {
+        device_extensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+        descriptor_indexing_features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+        descriptor_indexing_features.descriptorBindingPartiallyBound = VK_TRUE;
+        descriptor_indexing_features.runtimeDescriptorArray = VK_TRUE;
+    }
+
     VkDeviceCreateInfo device_create_info{};
     device_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    device_create_info.pNext = m_bindless_supported ? &descriptor_indexing_features : nullptr;
     device_create_info.pQueueCreateInfos = device_queue_create_info.data();
     device_create_info.queueCreateInfoCount = static_cast<u32>(device_queue_create_info.size());
     device_create_info.pEnabledFeatures = &deviceFeatures;
-    device_create_info.enabledExtensionCount = static_cast<u32>(m_device_extensions.size());
-    device_create_info.ppEnabledExtensionNames = m_device_extensions.data();
+    device_create_info.enabledExtensionCount = static_cast<u32>(device_extensions.size());
+    device_create_info.ppEnabledExtensionNames = device_extensions.data();
 
     CHECK_VK_RESULT(
         vkCreateDevice(m_physical_devices[m_physical_device_index], &device_create_info, nullptr, &m_device));
 
     vkGetDeviceQueue(m_device, m_queue_family_indices.getGraphics(), 0, &m_graphics_queue);
     vkGetDeviceQueue(m_device, m_queue_family_indices.getPresent(), 0, &m_present_queue);
+
+    // the instance targets 1.1, so the count draw comes from the extension rather than core 1.2
+    if (draw_indirect_count_supported) {
+        m_draw_indexed_indirect_count = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCount>(
+            vkGetDeviceProcAddr(m_device, "vkCmdDrawIndexedIndirectCountKHR"));
+    }
 }
 
 bool Device::checkDeviceExtensionSupport(VkPhysicalDevice device) {
@@ -116,6 +178,54 @@ bool Device::checkDeviceExtensionSupport(VkPhysicalDevice device) {
     return required_extensions.empty();
 }
 
+bool Device::checkExtensionSupport(VkPhysicalDevice device, const char *extension_name) {
+    u32 extension_count;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extension_count, nullptr);
+
+    std::vector<VkExtensionProperties> available_extensions(extension_count);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extension_count, available_extensions.data());
+
+    return std::any_of(available_extensions.begin(), available_extensions.end(),
+                       [&](auto &extension) { return strcmp(extension.extensionName, extension_name) == 0; });
+}
+
+bool Device::checkBindlessSupport(VkPhysicalDevice device) {
+    if (!checkExtensionSupport(device, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME)) {
+        return false;
+    }
+
+    VkPhysicalDeviceDescriptorIndexingFeatures descriptor_indexing_features{};
+    descriptor_indexing_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &descriptor_indexing_features;
+    vkGetPhysicalDeviceFeatures2(device, &features);
+
+    return descriptor_indexing_features.shaderSampledImageArrayNonUniformIndexing &&
+           descriptor_indexing_features.descriptorBindingPartiallyBound &&
+           descriptor_indexing_features.runtimeDescriptorArray;
+}
+
 QueueFamilyIndices Device::getQueueFamilyIndices() const noexcept { return m_queue_family_indices; }
 
+MemoryAllocator *Device::GetMemoryAllocator() const noexcept { return m_memory_allocator.get(); }
+
+UniformAllocator *Device::GetUniformAllocator() const noexcept { return m_uniform_allocator.get(); }
+
+DescriptorAllocator *Device::GetDescriptorAllocator() const noexcept { return m_descriptor_allocator.get(); }
+
+bool Device::IsBindlessSupported() const noexcept { return m_bindless_supported; }
+
+bool Device::IsMultiDrawIndirectSupported() const noexcept { return m_multi_draw_indirect_supported; }
+
+PFN_vkCmdDrawIndexedIndirectCount Device::GetDrawIndexedIndirectCount() const noexcept {
+    return m_draw_indexed_indirect_count;
+}
+
+bool Device::IsPipelineCreationFeedbackSupported() const noexcept { return m_pipeline_creation_feedback_supported; }
+
+bool Device::IsPipelineStatisticsQuerySupported() const noexcept { return m_pipeline_statistics_query_supported; }
+
+bool Device::IsInheritedQueriesSupported() const noexcept { return m_inherited_queries_supported; }
+
 } // namespace Horizon
\ No newline at end of file
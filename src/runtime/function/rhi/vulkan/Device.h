@@ -2,9 +2,12 @@
 
 #include <vulkan/vulkan.hpp>
 
+#include "DescriptorAllocator.h"
 #include "Instance.h"
+#include "MemoryAllocator.h"
 #include "QueueFamilyIndices.h"
 #include "Surface.h"
+#include "UniformAllocator.h"
 #include "ValidationLayer.h"
 #include <runtime/function/rhi/RenderContext.h>
 
@@ -12,6 +15,7 @@ namespace Horizon {
 
 class Device {
   public:
+    // surface is nullptr for headless rendering, the swap chain extension is not required then
     Device(std::shared_ptr<Instance> instance, std::shared_ptr<Surface> surface);
     ~Device();
     VkPhysicalDevice getPhysicalDevice() const noexcept;
@@ -19,6 +23,24 @@ class Device {
     VkQueue getGraphicQueue() const noexcept;
     VkQueue getPresnetQueue() const noexcept;
     QueueFamilyIndices getQueueFamilyIndices() const noexcept;
+    // every buffer and image allocates its memory here
+    MemoryAllocator *GetMemoryAllocator() const noexcept;
+    // per frame ring every UniformBuffer writes into
+    UniformAllocator *GetUniformAllocator() const noexcept;
+    // shared descriptor pools and the descriptor set cache
+    DescriptorAllocator *GetDescriptorAllocator() const noexcept;
+    // descriptor indexing with partially bound, non-uniformly indexed sampler arrays is enabled
+    bool IsBindlessSupported() const noexcept;
+    // multi draw indirect with a non zero first instance, needed for gpu driven drawing
+    bool IsMultiDrawIndirectSupported() const noexcept;
+    // VK_KHR_draw_indirect_count entry point, nullptr if the extension is not available
+    PFN_vkCmdDrawIndexedIndirectCount GetDrawIndexedIndirectCount() const noexcept;
+    // VK_EXT_pipeline_creation_feedback is enabled, pipelines can report pipeline cache hits
+    bool IsPipelineCreationFeedbackSupported() const noexcept;
+    // pipeline statistics queries are enabled, used by the gpu profiler
+    bool IsPipelineStatisticsQuerySupported() const noexcept;
+    // secondary command buffers can run inside an active pipeline statistics query
+    bool IsInheritedQueriesSupported() const noexcept;
 
   private:
     bool isDeviceSuitable(VkPhysicalDevice device);
@@ -30,6 +52,8 @@ class Device {
     void createDevice(const ValidationLayer &validation_layers);
 
     bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+    bool checkBindlessSupport(VkPhysicalDevice device);
+    bool checkExtensionSupport(VkPhysicalDevice device, const char *extension_name);
 
   private:
     u32 device_count;
@@ -40,8 +64,16 @@ class Device {
     QueueFamilyIndices m_queue_family_indices;
     std::shared_ptr<Instance> m_instance = nullptr;
     std::shared_ptr<Surface> m_surface = nullptr;
-    const std::vector<const char *> m_device_extensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME,
-                                                           VK_KHR_MAINTENANCE1_EXTENSION_NAME};
+    std::unique_ptr<MemoryAllocator> m_memory_allocator = nullptr;
+    std::unique_ptr<UniformAllocator> m_uniform_allocator = nullptr;
+    std::unique_ptr<DescriptorAllocator> m_descriptor_allocator = nullptr;
+    bool m_bindless_supported = false;
+    bool m_multi_draw_indirect_supported = false;
+    PFN_vkCmdDrawIndexedIndirectCount m_draw_indexed_indirect_count = nullptr;
+    bool m_pipeline_creation_feedback_supported = false;
+    bool m_pipeline_statistics_query_supported = false;
+    bool m_inherited_queries_supported = false;
+    std::vector<const char *> m_device_extensions = {VK_KHR_MAINTENANCE1_EXTENSION_NAME};
 };
 
 } // namespace Horizon
\ No newline at end of file
@@ -1,45 +1,76 @@
 #include "Framebuffer.h"
 
+#include <algorithm>
+
 #include <runtime/core/log/Log.h>
 
 namespace Horizon {
 
 Framebuffer::Framebuffer(std::shared_ptr<Device> device,
                          const std::vector<AttachmentCreateInfo> &attachment_create_info, RenderContext &render_context,
-                         std::shared_ptr<SwapChain> swap_chain)
+                         std::shared_ptr<SwapChain> swap_chain, std::shared_ptr<RenderTargetPool> render_target_pool)
     : m_render_context(render_context), m_device(device) {
-    createAttachmentsResources(attachment_create_info);
+    bool pooled = render_target_pool && !swap_chain &&
+                  std::all_of(attachment_create_info.begin(), attachment_create_info.end(),
+                              [](const AttachmentCreateInfo &create_info) { return !create_info.name.empty(); });
+    if (pooled) {
+        for (auto &create_info : attachment_create_info) {
+            m_render_targets.push_back(render_target_pool->Request(create_info));
+        }
+        m_render_target_pool = render_target_pool;
+    }
+    createAttachmentsResources(pooled ? std::vector<AttachmentCreateInfo>{} : attachment_create_info);
     m_render_pass = std::make_shared<RenderPass>(m_device, attachment_create_info);
     if (swap_chain) {
         createFrameBuffer(m_render_context.width, m_render_context.height, m_render_context.swap_chain_image_count,
                           swap_chain);
-    } else {
+    } else if (!pooled) {
         createFrameBuffer(m_render_context.width, m_render_context.height, 1);
+    } else {
+        // pool targets have no memory until the pool is built, the pool creates the framebuffer in Build
+        render_target_pool->AddFramebuffer(this);
     }
 }
 
 Framebuffer::~Framebuffer() {
+    if (m_render_target_pool) {
+        m_render_target_pool->RemoveFramebuffer(this);
+    }
+    m_device->GetDescriptorAllocator()->Invalidate(m_sampler);
     vkDestroySampler(m_device->Get(), m_sampler, nullptr);
     for (auto &attachment : m_frame_buffer_attachments) {
-        vkDestroyImage(m_device->Get(), attachment.m_image, nullptr);
+        m_device->GetDescriptorAllocator()->Invalidate(attachment.m_image_view);
         vkDestroyImageView(m_device->Get(), attachment.m_image_view, nullptr);
-        vkFreeMemory(m_device->Get(), attachment.m_image_memory, nullptr);
+        m_device->GetMemoryAllocator()->DestroyImage(attachment.m_image, attachment.m_image_memory);
     }
     for (auto &framebuffer : m_framebuffer) {
         vkDestroyFramebuffer(m_device->Get(), framebuffer, nullptr);
     }
 }
 
-VkFramebuffer Framebuffer::Get() const noexcept { return m_framebuffer[0]; }
+VkFramebuffer Framebuffer::Get() const noexcept { return Get(0); }
 
-VkFramebuffer Framebuffer::Get(u32 index) const noexcept { return m_framebuffer[index]; }
+VkFramebuffer Framebuffer::Get(u32 index) const noexcept {
+    if (index >= m_framebuffer.size()) {
+        LOG_ERROR("framebuffer {} requested before its render targets were built", index);
+        return VK_NULL_HANDLE;
+    }
+    return m_framebuffer[index];
+}
+
+void Framebuffer::CreateForRenderTargets() noexcept {
+    if (m_framebuffer.empty()) {
+        createFrameBuffer(m_render_context.width, m_render_context.height, 1);
+    }
+}
 
 VkRenderPass Framebuffer::getRenderPass() const noexcept { return m_render_pass->Get(); }
 
 std::shared_ptr<AttachmentDescriptor> Framebuffer::getDescriptorImageInfo(u32 attachment_index) {
     std::shared_ptr<AttachmentDescriptor> attachmentDescriptor = std::make_shared<AttachmentDescriptor>();
-    attachmentDescriptor->imageDescriptorInfo = {m_sampler, m_frame_buffer_attachments[attachment_index].m_image_view,
-                                                 VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    VkImageView image_view = m_render_targets.empty() ? m_frame_buffer_attachments[attachment_index].m_image_view
+                                                      : m_render_targets[attachment_index]->image_view;
+    attachmentDescriptor->imageDescriptorInfo = {m_sampler, image_view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
     return attachmentDescriptor;
 }
 
@@ -84,6 +115,9 @@ void Framebuffer::createFrameBuffer(u32 width, u32 height, u32 imag_count, std::
             for (u32 j = 0; j < m_frame_buffer_attachments.size(); j++) {
                 attachmentsImageViews[j] = m_frame_buffer_attachments[j].m_image_view;
             }
+            for (auto &render_target : m_render_targets) {
+                attachmentsImageViews.push_back(render_target->image_view);
+            }
         }
         VkFramebufferCreateInfo frameBufferCreateInfo{};
         frameBufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
@@ -6,13 +6,17 @@
 
 #include "Device.h"
 #include "RenderPass.h"
+#include "RenderTargetPool.h"
 #include "SwapChain.h"
 
 namespace Horizon {
+// with a render target pool and every attachment named, the attachments are pool targets and the VkFramebuffer is
+// created by the pool's Build. otherwise the framebuffer owns its attachments.
 class Framebuffer {
   public:
     Framebuffer(std::shared_ptr<Device> device, const std::vector<AttachmentCreateInfo> &attachment_create_info,
-                RenderContext &render_context, std::shared_ptr<SwapChain> swap_chain = nullptr);
+                RenderContext &render_context, std::shared_ptr<SwapChain> swap_chain = nullptr,
+                std::shared_ptr<RenderTargetPool> render_target_pool = nullptr);
     ~Framebuffer();
     VkFramebuffer Get() const noexcept;
     VkFramebuffer Get(u32 index) const noexcept;
@@ -21,6 +25,8 @@ class Framebuffer {
     std::vector<VkImage> getPresentImages();
     u32 getColorAttachmentCount();
     std::vector<VkClearValue> getClearValues();
+    // called by the render target pool once its targets have memory and views
+    void CreateForRenderTargets() noexcept;
 
   private:
     void createFrameBuffer(u32 width, u32 height, u32 imag_count, std::shared_ptr<SwapChain> swap_chain = nullptr);
@@ -35,5 +41,7 @@ class Framebuffer {
     // Shared sampler used for all color attachments
     VkSampler m_sampler;
     std::vector<Attachment> m_frame_buffer_attachments;
+    std::vector<std::shared_ptr<RenderTarget>> m_render_targets;
+    std::shared_ptr<RenderTargetPool> m_render_target_pool = nullptr;
 };
 } // namespace Horizon
@@ -0,0 +1,308 @@
+#include "GpuProfiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+
+#include <runtime/core/log/Log.h>
+
+namespace Horizon {
+
+namespace {
+
+constexpr u32 MAX_SCOPES_PER_FRAME = 32;
+// frames kept for the exports
+constexpr u32 PROFILE_HISTORY = 240;
+// frames averaged into one log line
+constexpr u32 PROFILE_STATS_INTERVAL = 240;
+
+// results come in bit order, matching GpuProfiler::PipelineStatistic
+constexpr VkQueryPipelineStatisticFlags PIPELINE_STATISTICS =
+    VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT | VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+
+const char *PIPELINE_STATISTIC_NAMES[GpuProfiler::PIPELINE_STATISTIC_COUNT] = {
+    "primitives", "vertex_invocations", "clipped_primitives", "fragment_invocations", "compute_invocations"};
+
+// scope names are pass names, only quotes and backslashes need escaping
+std::string EscapeJson(const std::string &text) noexcept {
+    std::string result;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            result += '\\';
+        }
+        result += c;
+    }
+    return result;
+}
+
+} // namespace
+
+GpuProfiler::GpuProfiler(std::shared_ptr<Device> device, f64 timestamp_period, u64 timestamp_mask) noexcept
+    : m_device(device), m_timestamp_period(timestamp_period), m_timestamp_mask(timestamp_mask) {
+    VkQueryPoolCreateInfo query_pool_create_info{};
+    query_pool_create_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    query_pool_create_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    query_pool_create_info.queryCount = MAX_FRAMES_IN_FLIGHT * MAX_SCOPES_PER_FRAME * 2;
+    CHECK_VK_RESULT(vkCreateQueryPool(m_device->Get(), &query_pool_create_info, nullptr, &m_timestamp_pool));
+
+    if (m_device->IsPipelineStatisticsQuerySupported()) {
+        query_pool_create_info.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+        query_pool_create_info.queryCount = MAX_FRAMES_IN_FLIGHT * MAX_SCOPES_PER_FRAME;
+        query_pool_create_info.pipelineStatistics = PIPELINE_STATISTICS;
+        CHECK_VK_RESULT(vkCreateQueryPool(m_device->Get(), &query_pool_create_info, nullptr, &m_statistics_pool));
+    }
+}
+
+GpuProfiler::~GpuProfiler() noexcept {
+    vkDestroyQueryPool(m_device->Get(), m_timestamp_pool, nullptr);
+    if (m_statistics_pool) {
+        vkDestroyQueryPool(m_device->Get(), m_statistics_pool, nullptr);
+    }
+}
+
+void GpuProfiler::SetPipelineStatistics(bool enabled) noexcept {
+    if (enabled && !m_statistics_pool) {
+        LOG_WARN("pipeline statistics queries are not supported, only gpu times are profiled");
+    }
+    m_statistics_enabled = enabled && m_statistics_pool;
+}
+
+void GpuProfiler::Reset(u32 frame, VkCommandBuffer command_buffer) noexcept {
+    FrameScopes &scopes = m_frames[frame];
+    scopes.names.clear();
+    scopes.scope_statistics.clear();
+    scopes.frame_index = m_frame_index++;
+    scopes.statistics = m_statistics_enabled;
+    scopes.open = false;
+    scopes.recorded = true;
+    vkCmdResetQueryPool(command_buffer, m_timestamp_pool, frame * MAX_SCOPES_PER_FRAME * 2, MAX_SCOPES_PER_FRAME * 2);
+    if (scopes.statistics) {
+        vkCmdResetQueryPool(command_buffer, m_statistics_pool, frame * MAX_SCOPES_PER_FRAME, MAX_SCOPES_PER_FRAME);
+    }
+}
+
+void GpuProfiler::BeginScope(u32 frame, VkCommandBuffer command_buffer, const std::string &name,
+                             bool secondary_command_buffers) noexcept {
+    FrameScopes &scopes = m_frames[frame];
+    if (scopes.names.size() == MAX_SCOPES_PER_FRAME) {
+        if (!m_overflow_reported) {
+            LOG_WARN("more than {} gpu profiler scopes in a frame, the rest are not profiled", MAX_SCOPES_PER_FRAME);
+            m_overflow_reported = true;
+        }
+        return;
+    }
+    u32 scope = static_cast<u32>(scopes.names.size());
+    scopes.names.push_back(name);
+    scopes.open = true;
+    vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_timestamp_pool,
+                        (frame * MAX_SCOPES_PER_FRAME + scope) * 2);
+    bool statistics = scopes.statistics && (!secondary_command_buffers || m_device->IsInheritedQueriesSupported());
+    scopes.scope_statistics.push_back(statistics);
+    if (scopes.statistics) {
+        vkCmdBeginQuery(command_buffer, m_statistics_pool, frame * MAX_SCOPES_PER_FRAME + scope, 0);
+        if (!statistics) {
+            // secondaries must not run inside the query, an empty one keeps the slot's results available
+            vkCmdEndQuery(command_buffer, m_statistics_pool, frame * MAX_SCOPES_PER_FRAME + scope);
+        }
+    }
+}
+
+void GpuProfiler::EndScope(u32 frame, VkCommandBuffer command_buffer) noexcept {
+    FrameScopes &scopes = m_frames[frame];
+    if (!scopes.open) {
+        return;
+    }
+    scopes.open = false;
+    u32 scope = static_cast<u32>(scopes.names.size()) - 1;
+    if (scopes.scope_statistics[scope]) {
+        vkCmdEndQuery(command_buffer, m_statistics_pool, frame * MAX_SCOPES_PER_FRAME + scope);
+    }
+    vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_timestamp_pool,
+                        (frame * MAX_SCOPES_PER_FRAME + scope) * 2 + 1);
+}
+
+VkQueryPipelineStatisticFlags GpuProfiler::GetInheritedStatistics(u32 frame) const noexcept {
+    const FrameScopes &scopes = m_frames[frame];
+    return scopes.open && scopes.scope_statistics.back() ? PIPELINE_STATISTICS : 0;
+}
+
+void GpuProfiler::ReadResults(u32 frame) noexcept {
+    FrameScopes &scopes = m_frames[frame];
+    if (!scopes.recorded) {
+        return;
+    }
+    scopes.recorded = false;
+    u32 scope_count = static_cast<u32>(scopes.names.size());
+    if (scope_count == 0) {
+        return;
+    }
+
+    // the slot's fence has signaled, the results are available without waiting
+    std::array<u64, MAX_SCOPES_PER_FRAME * 2> timestamps{};
+    if (vkGetQueryPoolResults(m_device->Get(), m_timestamp_pool, frame * MAX_SCOPES_PER_FRAME * 2, scope_count * 2,
+                              sizeof(timestamps), timestamps.data(), sizeof(u64),
+                              VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+        return;
+    }
+    std::array<u64, MAX_SCOPES_PER_FRAME * PIPELINE_STATISTIC_COUNT> statistics{};
+    bool has_statistics =
+        scopes.statistics &&
+        vkGetQueryPoolResults(m_device->Get(), m_statistics_pool, frame * MAX_SCOPES_PER_FRAME, scope_count,
+                              sizeof(statistics), statistics.data(), PIPELINE_STATISTIC_COUNT * sizeof(u64),
+                              VK_QUERY_RESULT_64_BIT) == VK_SUCCESS;
+
+    FrameResult result;
+    result.frame_index = scopes.frame_index;
+    for (u32 i = 0; i < scope_count; i++) {
+        u64 begin = timestamps[i * 2] & m_timestamp_mask;
+        u64 ticks = ((timestamps[i * 2 + 1] & m_timestamp_mask) - begin) & m_timestamp_mask;
+        ScopeResult &scope = result.scopes.emplace_back();
+        scope.name = scopes.names[i];
+        scope.begin_us = static_cast<f64>(begin) * m_timestamp_period * 1e-3;
+        scope.duration_ms = static_cast<f64>(ticks) * m_timestamp_period * 1e-6;
+        scope.has_statistics = has_statistics && scopes.scope_statistics[i];
+        if (scope.has_statistics) {
+            std::copy_n(statistics.begin() + i * PIPELINE_STATISTIC_COUNT, PIPELINE_STATISTIC_COUNT,
+                        scope.statistics.begin());
+        }
+    }
+    m_history.push_back(std::move(result));
+    if (m_history.size() > PROFILE_HISTORY) {
+        m_history.pop_front();
+    }
+    if (m_history.back().frame_index % PROFILE_STATS_INTERVAL == PROFILE_STATS_INTERVAL - 1) {
+        LogStats();
+    }
+}
+
+void GpuProfiler::LogStats() noexcept {
+    // mean of every scope over the last interval, in the order of the latest frame
+    u32 frames = static_cast<u32>(std::min<u64>(m_history.size(), PROFILE_STATS_INTERVAL));
+    std::map<std::string, f64> total_ms;
+    for (u32 f = static_cast<u32>(m_history.size()) - frames; f < m_history.size(); f++) {
+        for (auto &scope : m_history[f].scopes) {
+            total_ms[scope.name] += scope.duration_ms;
+        }
+    }
+    std::string passes;
+    f64 frame_ms = 0.0;
+    for (auto &scope : m_history.back().scopes) {
+        f64 mean_ms = total_ms[scope.name] / frames;
+        frame_ms += mean_ms;
+        passes += (passes.empty() ? "" : ", ") + scope.name + " " + fmt::format("{:.3f}", mean_ms);
+    }
+    LOG_INFO("gpu passes (ms): {}, sum {:.3f}", passes, frame_ms);
+}
+
+bool GpuProfiler::WriteChromeTrace(const std::string &path) const noexcept {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open()) {
+        LOG_WARN("failed to open {}", path);
+        return false;
+    }
+    // timestamps relative to the oldest scope, the gpu clock is shared by every frame
+    f64 origin_us = 0.0;
+    bool first = true;
+    for (auto &frame : m_history) {
+        for (auto &scope : frame.scopes) {
+            origin_us = first ? scope.begin_us : std::min(origin_us, scope.begin_us);
+            first = false;
+        }
+    }
+
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    first = true;
+    for (auto &frame : m_history) {
+        for (auto &scope : frame.scopes) {
+            file << (first ? "\n" : ",\n")
+                 << fmt::format("{{\"name\":\"{}\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":{:.3f},"
+                                "\"dur\":{:.3f},\"args\":{{\"frame\":{}",
+                                EscapeJson(scope.name), scope.begin_us - origin_us, scope.duration_ms * 1e3,
+                                frame.frame_index);
+            if (scope.has_statistics) {
+                for (u32 s = 0; s < PIPELINE_STATISTIC_COUNT; s++) {
+                    file << ",\"" << PIPELINE_STATISTIC_NAMES[s] << "\":" << scope.statistics[s];
+                }
+            }
+            file << "}}";
+            first = false;
+        }
+    }
+    file << "\n]}\n";
+    if (!file.good()) {
+        LOG_WARN("failed to write {}", path);
+        return false;
+    }
+    LOG_INFO("gpu trace of {} frames written to {}", m_history.size(), path);
+    return true;
+}
+
+bool GpuProfiler::WriteCsv(const std::string &path) const noexcept {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open()) {
+        LOG_WARN("failed to open {}", path);
+        return false;
+    }
+
+    struct Summary {
+        std::vector<f64> durations_ms;
+        std::array<f64, PIPELINE_STATISTIC_COUNT> statistics{};
+        u32 statistic_samples = 0;
+    };
+    // scopes in the order they first appear
+    std::vector<std::string> names;
+    std::map<std::string, Summary> summaries;
+    for (auto &frame : m_history) {
+        for (auto &scope : frame.scopes) {
+            auto [it, inserted] = summaries.try_emplace(scope.name);
+            if (inserted) {
+                names.push_back(scope.name);
+            }
+            it->second.durations_ms.push_back(scope.duration_ms);
+            if (scope.has_statistics) {
+                for (u32 s = 0; s < PIPELINE_STATISTIC_COUNT; s++) {
+                    it->second.statistics[s] += static_cast<f64>(scope.statistics[s]);
+                }
+                it->second.statistic_samples++;
+            }
+        }
+    }
+
+    file << "pass,samples,mean_ms,min_ms,max_ms,p95_ms";
+    for (const char *statistic : PIPELINE_STATISTIC_NAMES) {
+        file << "," << statistic;
+    }
+    file << "\n";
+    for (auto &name : names) {
+        Summary &summary = summaries[name];
+        std::vector<f64> &durations = summary.durations_ms;
+        std::sort(durations.begin(), durations.end());
+        f64 total_ms = 0.0;
+        for (f64 duration : durations) {
+            total_ms += duration;
+        }
+        size_t p95 = std::min(durations.size() - 1, durations.size() * 95 / 100);
+        file << name << "," << durations.size()
+             << fmt::format(",{:.4f},{:.4f},{:.4f},{:.4f}", total_ms / durations.size(), durations.front(),
+                            durations.back(), durations[p95]);
+        for (u32 s = 0; s < PIPELINE_STATISTIC_COUNT; s++) {
+            if (summary.statistic_samples) {
+                file << fmt::format(",{:.0f}", summary.statistics[s] / summary.statistic_samples);
+            } else {
+                file << ",";
+            }
+        }
+        file << "\n";
+    }
+    if (!file.good()) {
+        LOG_WARN("failed to write {}", path);
+        return false;
+    }
+    LOG_INFO("gpu pass summary of {} frames written to {}", m_history.size(), path);
+    return true;
+}
+
+} // namespace Horizon
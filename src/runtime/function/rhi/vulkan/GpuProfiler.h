@@ -0,0 +1,103 @@
+#pragma once
+
+#include <array>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "Device.h"
+#include <runtime/function/rhi/RenderContext.h>
+
+namespace Horizon {
+
+// gpu time and optionally pipeline statistics of named scopes, usually one per render graph pass. every frame slot
+// owns a range of the query pools, its results are read once the slot's fence has signaled MAX_FRAMES_IN_FLIGHT
+// frames later, so reading never waits on the gpu. scopes don't nest and must begin and end on the same side of a
+// render pass boundary. a scope that executes secondary command buffers only gets statistics with the inheritedQueries
+// feature, the secondaries inherit the query through GetInheritedStatistics.
+class GpuProfiler {
+  public:
+    // counters of the pipeline statistics query, in query result order
+    enum PipelineStatistic {
+        INPUT_ASSEMBLY_PRIMITIVES = 0,
+        VERTEX_SHADER_INVOCATIONS,
+        CLIPPING_PRIMITIVES,
+        FRAGMENT_SHADER_INVOCATIONS,
+        COMPUTE_SHADER_INVOCATIONS,
+        PIPELINE_STATISTIC_COUNT
+    };
+
+    // the timestamp period and valid bits of the graphics queue
+    GpuProfiler(std::shared_ptr<Device> device, f64 timestamp_period, u64 timestamp_mask) noexcept;
+    ~GpuProfiler() noexcept;
+    GpuProfiler(const GpuProfiler &) = delete;
+    GpuProfiler(GpuProfiler &&) = delete;
+    GpuProfiler &operator=(const GpuProfiler &) = delete;
+    GpuProfiler &operator=(GpuProfiler &&) = delete;
+
+    // takes effect with the next frame, ignored without the pipelineStatisticsQuery feature
+    void SetPipelineStatistics(bool enabled) noexcept;
+
+    // reads the scopes of the slot's last frame, call once the slot's fence has signaled
+    void ReadResults(u32 frame) noexcept;
+    // resets the slot's queries, call first in the slot's command buffer
+    void Reset(u32 frame, VkCommandBuffer command_buffer) noexcept;
+    // secondary_command_buffers: the scope executes secondary command buffers
+    void BeginScope(u32 frame, VkCommandBuffer command_buffer, const std::string &name,
+                    bool secondary_command_buffers = false) noexcept;
+    void EndScope(u32 frame, VkCommandBuffer command_buffer) noexcept;
+    // pipeline statistics of the query active in the slot's open scope, for the inheritance info of secondaries
+    VkQueryPipelineStatisticFlags GetInheritedStatistics(u32 frame) const noexcept;
+
+    // every scope of the last PROFILE_HISTORY frames as complete events of the chrome trace event format, open in
+    // chrome://tracing or perfetto
+    bool WriteChromeTrace(const std::string &path) const noexcept;
+    // per scope summary of the same frames: samples, mean, min, max and 95th percentile in ms, mean statistics
+    bool WriteCsv(const std::string &path) const noexcept;
+
+  private:
+    struct ScopeResult {
+        std::string name;
+        f64 begin_us = 0.0; // gpu clock
+        f64 duration_ms = 0.0;
+        bool has_statistics = false;
+        std::array<u64, PIPELINE_STATISTIC_COUNT> statistics{};
+    };
+
+    struct FrameResult {
+        u64 frame_index = 0;
+        std::vector<ScopeResult> scopes;
+    };
+
+    // scopes recorded into the slot's command buffer
+    struct FrameScopes {
+        std::vector<std::string> names;
+        std::vector<bool> scope_statistics; // per scope, false when its query was left empty
+        u64 frame_index = 0;
+        bool statistics = false;
+        bool open = false;
+        bool recorded = false;
+    };
+
+    void LogStats() noexcept;
+
+  private:
+    std::shared_ptr<Device> m_device;
+    f64 m_timestamp_period = 0.0; // nanoseconds per tick
+    u64 m_timestamp_mask = 0;
+    VkQueryPool m_timestamp_pool = VK_NULL_HANDLE;
+    VkQueryPool m_statistics_pool = VK_NULL_HANDLE;
+    bool m_statistics_enabled = false;
+
+    std::array<FrameScopes, MAX_FRAMES_IN_FLIGHT> m_frames;
+    u64 m_frame_index = 0;
+    bool m_overflow_reported = false;
+
+    // rolling window of read back frames, oldest first
+    std::deque<FrameResult> m_history;
+};
+
+} // namespace Horizon
@@ -4,26 +4,26 @@
 namespace Horizon {
 IndexBuffer::IndexBuffer(std::shared_ptr<Device> device, std::shared_ptr<CommandBuffer> command_buffer,
                          const std::vector<Index> &indices)
+    : IndexBuffer(device, command_buffer, indices.data(), indices.size()) {}
+
+IndexBuffer::IndexBuffer(std::shared_ptr<Device> device, std::shared_ptr<CommandBuffer> command_buffer,
+                         const Index *indices, u64 indices_count)
     : m_device(device) {
-    m_indices_count = indices.size();
+    m_indices_count = indices_count;
     VkDeviceSize buffer_size = sizeof(Index) * m_indices_count;
 
     // create stage buffer
     VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    vk_createBuffer(device->Get(), device->getPhysicalDevice(), buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+    MemoryAllocation stagingBufferMemory;
+    vk_createBuffer(device, buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer,
-                    stagingBufferMemory);
+                    stagingBufferMemory, true);
 
-    // upload cpu data
-    void *data;
-    vkMapMemory(m_device->Get(), stagingBufferMemory, 0, buffer_size, 0, &data);
-    memcpy(data, indices.data(), buffer_size);
-    vkUnmapMemory(m_device->Get(), stagingBufferMemory);
+    // upload cpu data, staging memory stays mapped
+    memcpy(stagingBufferMemory.mapped, indices, buffer_size);
 
     // create gpu buffer
-    vk_createBuffer(device->Get(), device->getPhysicalDevice(), buffer_size,
-                    VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+    vk_createBuffer(device, buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_index_buffer, m_index_buffer_memory);
 
     vk_copyBuffer(device, command_buffer, stagingBuffer, m_index_buffer, buffer_size);
@@ -40,8 +40,7 @@ IndexBuffer::IndexBuffer(std::shared_ptr<Device> device, std::shared_ptr<Command
                          &bufferMemoryBarrier, 0, nullptr);
     command_buffer->endSingleTimeCommands(cmdbuf);
 
-    vkDestroyBuffer(device->Get(), stagingBuffer, nullptr);
-    vkFreeMemory(device->Get(), stagingBufferMemory, nullptr);
+    vk_destroyBuffer(device, stagingBuffer, stagingBufferMemory);
 }
 
 //VertexBuffer::VertexBuffer(const VertexBuffer&& rhs)
@@ -58,8 +57,7 @@ IndexBuffer::IndexBuffer(std::shared_ptr<Device> device, std::shared_ptr<Command
 //}
 
 IndexBuffer::~IndexBuffer() {
-    vkDestroyBuffer(m_device->Get(), m_index_buffer, nullptr);
-    vkFreeMemory(m_device->Get(), m_index_buffer_memory, nullptr);
+    vk_destroyBuffer(m_device, m_index_buffer, m_index_buffer_memory);
 }
 
 VkBuffer IndexBuffer::Get() const noexcept { return m_index_buffer; }
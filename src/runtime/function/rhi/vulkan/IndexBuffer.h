@@ -15,13 +15,15 @@ class IndexBuffer {
     IndexBuffer() = default;
     IndexBuffer(std::shared_ptr<Device> device, std::shared_ptr<CommandBuffer> command_buffer,
                 const std::vector<Index> &vertices);
+    IndexBuffer(std::shared_ptr<Device> device, std::shared_ptr<CommandBuffer> command_buffer, const Index *indices,
+                u64 indices_count);
     ~IndexBuffer();
     VkBuffer Get() const noexcept;
     u64 getIndicesCount() const noexcept;
 
   private:
     VkBuffer m_index_buffer;
-    VkDeviceMemory m_index_buffer_memory;
+    MemoryAllocation m_index_buffer_memory;
     std::shared_ptr<Device> m_device = nullptr;
     u64 m_indices_count;
 };
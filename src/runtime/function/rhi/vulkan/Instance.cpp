@@ -3,7 +3,7 @@
 #include <runtime/core/log/Log.h>
 
 namespace Horizon {
-Instance::Instance() { createInstance(); }
+Instance::Instance(bool headless) : m_headless(headless) { createInstance(); }
 
 Instance::~Instance() {
     if (enableValidationLayers) {
@@ -34,7 +34,7 @@ void Instance::createInstance() {
     instance_create_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
     instance_create_info.pApplicationInfo = &appInfo;
     instance_create_info.flags = 0;
-    auto extensions = m_validation_layer.getRequiredExtensions();
+    auto extensions = m_validation_layer.getRequiredExtensions(m_headless);
     instance_create_info.enabledExtensionCount = static_cast<u32>(extensions.size());
     instance_create_info.ppEnabledExtensionNames = extensions.data();
 
@@ -11,7 +11,8 @@ namespace Horizon {
 
 class Instance {
   public:
-    Instance();
+    // a headless instance needs no window system, glfw is not initialized
+    explicit Instance(bool headless = false);
     ~Instance();
     VkInstance Get() const noexcept;
     const ValidationLayer &getValidationLayer() const noexcept;
@@ -21,6 +22,7 @@ class Instance {
 
   private:
     VkInstance m_instance;
+    bool m_headless = false;
     u32 m_extension_count = 0;
     std::vector<VkExtensionProperties> m_extensions;
     ValidationLayer m_validation_layer;
@@ -0,0 +1,639 @@
+#include "MemoryAllocator.h"
+
+#include <algorithm>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include <runtime/core/log/Log.h>
+
+namespace Horizon {
+
+namespace {
+
+constexpr u64 MAX_BLOCK_SIZE = 256ull * 1024 * 1024;
+constexpr u64 MIN_BLOCK_SIZE = 16ull * 1024 * 1024;
+constexpr u64 TRANSIENT_ARENA_SIZE = 32ull * 1024 * 1024;
+
+u64 AlignUp(u64 value, u64 alignment) noexcept { return (value + alignment - 1) & ~(alignment - 1); }
+
+u32 FindFirstSet(u32 value) noexcept {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, value);
+    return static_cast<u32>(index);
+#else
+    return static_cast<u32>(__builtin_ctz(value));
+#endif
+}
+
+u32 FloorLog2(u64 value) noexcept {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return static_cast<u32>(index);
+#else
+    return 63 - static_cast<u32>(__builtin_clzll(value));
+#endif
+}
+
+// two level segregated fit over a single range, offsets and sizes are multiples of GRANULARITY.
+// O(1) allocate and free, adjacent free ranges are merged immediately.
+class Tlsf {
+  public:
+    static constexpr u32 INVALID = ~0u;
+    static constexpr u64 GRANULARITY = 64;
+
+    explicit Tlsf(u64 size) noexcept : m_size(size) {
+        std::fill(std::begin(m_sl_bitmap), std::end(m_sl_bitmap), 0u);
+        for (auto &heads : m_heads) {
+            std::fill(std::begin(heads), std::end(heads), INVALID);
+        }
+        // node 0 always starts at offset 0, it is never merged away and heads the physical list
+        u32 node = NewNode();
+        m_nodes[node] = {0, size, INVALID, INVALID, INVALID, INVALID, true};
+        InsertFree(node);
+    }
+
+    bool Allocate(u64 size, u64 alignment, u32 &out_node, u64 &out_offset) noexcept {
+        size = AlignUp(std::max<u64>(size, 1), GRANULARITY);
+        alignment = std::max(alignment, GRANULARITY);
+        // every free range starts on GRANULARITY, so alignment costs at most alignment - GRANULARITY
+        u32 fl, sl;
+        MappingSearch(size + alignment - GRANULARITY, fl, sl);
+        u32 node = FindSuitable(fl, sl);
+        if (node == INVALID) {
+            return false;
+        }
+        RemoveFree(node);
+
+        u64 padding = AlignUp(m_nodes[node].offset, alignment) - m_nodes[node].offset;
+        if (padding > 0) {
+            u32 front = NewNode();
+            Node &block = m_nodes[node];
+            m_nodes[front] = {block.offset, padding, block.prev_phys, node, INVALID, INVALID, true};
+            if (block.prev_phys != INVALID) {
+                m_nodes[block.prev_phys].next_phys = front;
+            }
+            block.prev_phys = front;
+            block.offset += padding;
+            block.size -= padding;
+            InsertFree(front);
+        }
+        if (m_nodes[node].size - size >= GRANULARITY) {
+            u32 back = NewNode();
+            Node &block = m_nodes[node];
+            m_nodes[back] = {block.offset + size, block.size - size, node, block.next_phys, INVALID, INVALID, true};
+            if (block.next_phys != INVALID) {
+                m_nodes[block.next_phys].prev_phys = back;
+            }
+            block.next_phys = back;
+            block.size = size;
+            InsertFree(back);
+        }
+
+        Node &block = m_nodes[node];
+        block.free = false;
+        m_used += block.size;
+        m_allocation_count++;
+        out_node = node;
+        out_offset = block.offset;
+        return true;
+    }
+
+    void Free(u32 node) noexcept {
+        m_nodes[node].free = true;
+        m_used -= m_nodes[node].size;
+        m_allocation_count--;
+
+        u32 prev = m_nodes[node].prev_phys;
+        if (prev != INVALID && m_nodes[prev].free) {
+            RemoveFree(prev);
+            m_nodes[prev].size += m_nodes[node].size;
+            Unlink(node);
+            node = prev;
+        }
+        u32 next = m_nodes[node].next_phys;
+        if (next != INVALID && m_nodes[next].free) {
+            RemoveFree(next);
+            m_nodes[node].size += m_nodes[next].size;
+            Unlink(next);
+        }
+        InsertFree(node);
+    }
+
+    u64 GetSize() const noexcept { return m_size; }
+    u64 GetUsed() const noexcept { return m_used; }
+    u32 GetAllocationCount() const noexcept { return m_allocation_count; }
+
+    void AccumulateFreeRegions(u32 &region_count, u64 &largest_region) const noexcept {
+        for (u32 node = 0; node != INVALID; node = m_nodes[node].next_phys) {
+            if (m_nodes[node].free) {
+                region_count++;
+                largest_region = std::max(largest_region, m_nodes[node].size);
+            }
+        }
+    }
+
+  private:
+    static constexpr u32 SL_LOG2 = 5;
+    static constexpr u32 SL_COUNT = 1 << SL_LOG2;
+    // sizes below SMALL_SIZE map linearly into the first level, one second level slot per GRANULARITY
+    static constexpr u32 SMALL_LOG2 = SL_LOG2 + 6;
+    static constexpr u64 SMALL_SIZE = 1ull << SMALL_LOG2;
+    static constexpr u32 FL_COUNT = 32;
+
+    struct Node {
+        u64 offset;
+        u64 size;
+        u32 prev_phys;
+        u32 next_phys;
+        u32 prev_free;
+        u32 next_free;
+        bool free;
+    };
+
+    static void Mapping(u64 size, u32 &fl, u32 &sl) noexcept {
+        if (size < SMALL_SIZE) {
+            fl = 0;
+            sl = static_cast<u32>(size / GRANULARITY);
+        } else {
+            u32 log2 = FloorLog2(size);
+            fl = log2 - SMALL_LOG2 + 1;
+            sl = static_cast<u32>(size >> (log2 - SL_LOG2)) ^ SL_COUNT;
+        }
+    }
+
+    // round up to the next slot so that any range found there is large enough
+    static void MappingSearch(u64 size, u32 &fl, u32 &sl) noexcept {
+        if (size >= SMALL_SIZE) {
+            size += (1ull << (FloorLog2(size) - SL_LOG2)) - 1;
+        }
+        Mapping(size, fl, sl);
+    }
+
+    u32 FindSuitable(u32 fl, u32 sl) const noexcept {
+        if (fl >= FL_COUNT) {
+            return INVALID;
+        }
+        u32 sl_map = m_sl_bitmap[fl] & (~0u << sl);
+        if (!sl_map) {
+            u32 fl_map = fl + 1 < FL_COUNT ? m_fl_bitmap & (~0u << (fl + 1)) : 0;
+            if (!fl_map) {
+                return INVALID;
+            }
+            fl = FindFirstSet(fl_map);
+            sl_map = m_sl_bitmap[fl];
+        }
+        return m_heads[fl][FindFirstSet(sl_map)];
+    }
+
+    void InsertFree(u32 node) noexcept {
+        u32 fl, sl;
+        Mapping(m_nodes[node].size, fl, sl);
+        u32 head = m_heads[fl][sl];
+        m_nodes[node].prev_free = INVALID;
+        m_nodes[node].next_free = head;
+        if (head != INVALID) {
+            m_nodes[head].prev_free = node;
+        }
+        m_heads[fl][sl] = node;
+        m_fl_bitmap |= 1u << fl;
+        m_sl_bitmap[fl] |= 1u << sl;
+    }
+
+    void RemoveFree(u32 node) noexcept {
+        u32 fl, sl;
+        Mapping(m_nodes[node].size, fl, sl);
+        Node &block = m_nodes[node];
+        if (block.prev_free != INVALID) {
+            m_nodes[block.prev_free].next_free = block.next_free;
+        }
+        if (block.next_free != INVALID) {
+            m_nodes[block.next_free].prev_free = block.prev_free;
+        }
+        if (m_heads[fl][sl] == node) {
+            m_heads[fl][sl] = block.next_free;
+            if (block.next_free == INVALID) {
+                m_sl_bitmap[fl] &= ~(1u << sl);
+                if (!m_sl_bitmap[fl]) {
+                    m_fl_bitmap &= ~(1u << fl);
+                }
+            }
+        }
+        block.prev_free = block.next_free = INVALID;
+    }
+
+    // remove a node from the physical list, its range has been merged into a neighbour
+    void Unlink(u32 node) noexcept {
+        Node &block = m_nodes[node];
+        if (block.prev_phys != INVALID) {
+            m_nodes[block.prev_phys].next_phys = block.next_phys;
+        }
+        if (block.next_phys != INVALID) {
+            m_nodes[block.next_phys].prev_phys = block.prev_phys;
+        }
+        m_unused_nodes.push_back(node);
+    }
+
+    u32 NewNode() noexcept {
+        if (!m_unused_nodes.empty()) {
+            u32 node = m_unused_nodes.back();
+            m_unused_nodes.pop_back();
+            return node;
+        }
+        m_nodes.emplace_back();
+        return static_cast<u32>(m_nodes.size() - 1);
+    }
+
+  private:
+    u64 m_size = 0;
+    u64 m_used = 0;
+    u32 m_allocation_count = 0;
+    std::vector<Node> m_nodes;
+    std::vector<u32> m_unused_nodes;
+    u32 m_fl_bitmap = 0;
+    u32 m_sl_bitmap[FL_COUNT];
+    u32 m_heads[FL_COUNT][SL_COUNT];
+};
+
+} // namespace
+
+struct MemoryAllocator::MemoryBlock {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    u8 *mapped = nullptr;
+    Tlsf tlsf;
+
+    MemoryBlock(u64 size) noexcept : tlsf(size) {}
+};
+
+struct MemoryAllocator::MemoryPool {
+    u32 memory_type = 0;
+    bool linear = false;
+    u64 block_size = 0;
+    // freed slots stay nullptr so block indices in live allocations remain valid
+    std::vector<std::unique_ptr<MemoryBlock>> blocks;
+
+    u32 dedicated_count = 0;
+    u64 dedicated_bytes = 0;
+
+    // linear arena for transient allocations
+    VkDeviceMemory transient_memory = VK_NULL_HANDLE;
+    u8 *transient_mapped = nullptr;
+    u64 transient_size = 0;
+    u64 transient_head = 0;
+    u32 transient_count = 0;
+};
+
+MemoryAllocator::MemoryAllocator(VkDevice device, VkPhysicalDevice physical_device) noexcept : m_device(device) {
+    vkGetPhysicalDeviceMemoryProperties(physical_device, &m_memory_properties);
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physical_device, &properties);
+    m_max_allocation_count = properties.limits.maxMemoryAllocationCount;
+    m_pools.resize(m_memory_properties.memoryTypeCount * 2);
+}
+
+MemoryAllocator::~MemoryAllocator() noexcept {
+    MemoryStats stats = GetStats();
+    if (stats.allocation_count > 0) {
+        LOG_WARN("{} device memory allocations ({} KB) still alive at shutdown", stats.allocation_count,
+                 stats.used_bytes / 1024);
+    }
+    for (auto &pool : m_pools) {
+        if (!pool) {
+            continue;
+        }
+        for (auto &block : pool->blocks) {
+            if (block) {
+                FreeDeviceMemory(block->memory, block->mapped != nullptr);
+            }
+        }
+        if (pool->transient_memory) {
+            FreeDeviceMemory(pool->transient_memory, pool->transient_mapped != nullptr);
+        }
+    }
+}
+
+MemoryAllocator::MemoryPool &MemoryAllocator::GetPool(u32 memory_type, bool linear) noexcept {
+    std::unique_ptr<MemoryPool> &pool = m_pools[memory_type * 2 + (linear ? 1 : 0)];
+    if (!pool) {
+        pool = std::make_unique<MemoryPool>();
+        pool->memory_type = memory_type;
+        pool->linear = linear;
+        // an eighth of the heap keeps small heaps (e.g. the host visible vram window) from being exhausted by one
+        // block
+        u64 heap_size = m_memory_properties.memoryHeaps[m_memory_properties.memoryTypes[memory_type].heapIndex].size;
+        pool->block_size = std::clamp(heap_size / 8, MIN_BLOCK_SIZE, MAX_BLOCK_SIZE);
+    }
+    return *pool;
+}
+
+VkDeviceMemory MemoryAllocator::AllocateDeviceMemory(u32 memory_type, u64 size, void **mapped) noexcept {
+    if (m_device_memory_count >= m_max_allocation_count) {
+        LOG_ERROR("maxMemoryAllocationCount ({}) reached", m_max_allocation_count);
+        return VK_NULL_HANDLE;
+    }
+    VkMemoryAllocateInfo allocate_info{};
+    allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocate_info.allocationSize = size;
+    allocate_info.memoryTypeIndex = memory_type;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    if (vkAllocateMemory(m_device, &allocate_info, nullptr, &memory) != VK_SUCCESS) {
+        LOG_ERROR("failed to allocate {} MB of device memory from type {}", size / (1024 * 1024), memory_type);
+        return VK_NULL_HANDLE;
+    }
+    m_device_memory_count++;
+
+    *mapped = nullptr;
+    if (m_memory_properties.memoryTypes[memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        CHECK_VK_RESULT(vkMapMemory(m_device, memory, 0, VK_WHOLE_SIZE, 0, mapped));
+    }
+    return memory;
+}
+
+void MemoryAllocator::FreeDeviceMemory(VkDeviceMemory memory, bool mapped) noexcept {
+    if (mapped) {
+        vkUnmapMemory(m_device, memory);
+    }
+    vkFreeMemory(m_device, memory, nullptr);
+    m_device_memory_count--;
+}
+
+MemoryAllocation MemoryAllocator::Allocate(const VkMemoryRequirements &requirements, VkMemoryPropertyFlags properties,
+                                           bool linear, bool transient) noexcept {
+    MemoryAllocation allocation{};
+    u32 memory_type = ~0u;
+    for (u32 i = 0; i < m_memory_properties.memoryTypeCount; i++) {
+        if ((requirements.memoryTypeBits & (1u << i)) &&
+            (m_memory_properties.memoryTypes[i].propertyFlags & properties) == properties) {
+            memory_type = i;
+            break;
+        }
+    }
+    if (memory_type == ~0u) {
+        LOG_ERROR("failed to find suitable memory type");
+        return allocation;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    MemoryPool &pool = GetPool(memory_type, linear);
+    allocation.pool = memory_type * 2 + (linear ? 1 : 0);
+    if (transient && AllocateTransient(pool, requirements, allocation)) {
+        return allocation;
+    }
+    if (requirements.size > pool.block_size / 2) {
+        AllocateDedicated(pool, requirements, allocation);
+        return allocation;
+    }
+    AllocateFromBlocks(pool, requirements, allocation);
+    return allocation;
+}
+
+bool MemoryAllocator::AllocateTransient(MemoryPool &pool, const VkMemoryRequirements &requirements,
+                                        MemoryAllocation &allocation) noexcept {
+    if (!pool.transient_memory) {
+        pool.transient_size = std::min(TRANSIENT_ARENA_SIZE, pool.block_size);
+        void *mapped;
+        pool.transient_memory = AllocateDeviceMemory(pool.memory_type, pool.transient_size, &mapped);
+        if (!pool.transient_memory) {
+            return false;
+        }
+        pool.transient_mapped = static_cast<u8 *>(mapped);
+    }
+    u64 offset = AlignUp(pool.transient_head, std::max<u64>(requirements.alignment, 1));
+    if (offset + requirements.size > pool.transient_size) {
+        // arena is full, the caller falls back to a regular allocation
+        return false;
+    }
+    pool.transient_head = offset + requirements.size;
+    pool.transient_count++;
+
+    allocation.memory = pool.transient_memory;
+    allocation.offset = offset;
+    allocation.size = requirements.size;
+    allocation.mapped = pool.transient_mapped ? pool.transient_mapped + offset : nullptr;
+    allocation.type = MemoryAllocationType::TRANSIENT;
+    return true;
+}
+
+bool MemoryAllocator::AllocateFromBlocks(MemoryPool &pool, const VkMemoryRequirements &requirements,
+                                         MemoryAllocation &allocation) noexcept {
+    u32 node;
+    u64 offset;
+    u32 free_slot = ~0u;
+    for (u32 i = 0; i < pool.blocks.size(); i++) {
+        MemoryBlock *block = pool.blocks[i].get();
+        if (!block) {
+            free_slot = i;
+            continue;
+        }
+        if (block->tlsf.Allocate(requirements.size, requirements.alignment, node, offset)) {
+            allocation.memory = block->memory;
+            allocation.offset = offset;
+            allocation.size = requirements.size;
+            allocation.mapped = block->mapped ? block->mapped + offset : nullptr;
+            allocation.type = MemoryAllocationType::BLOCK;
+            allocation.block = i;
+            allocation.node = node;
+            return true;
+        }
+    }
+
+    // no block has room, add one
+    auto block = std::make_unique<MemoryBlock>(pool.block_size);
+    void *mapped;
+    block->memory = AllocateDeviceMemory(pool.memory_type, pool.block_size, &mapped);
+    if (!block->memory) {
+        return false;
+    }
+    block->mapped = static_cast<u8 *>(mapped);
+    if (!block->tlsf.Allocate(requirements.size, requirements.alignment, node, offset)) {
+        // the alignment padding does not fit an empty block either
+        FreeDeviceMemory(block->memory, block->mapped != nullptr);
+        return AllocateDedicated(pool, requirements, allocation);
+    }
+    if (free_slot == ~0u) {
+        free_slot = static_cast<u32>(pool.blocks.size());
+        pool.blocks.emplace_back();
+    }
+    allocation.memory = block->memory;
+    allocation.offset = offset;
+    allocation.size = requirements.size;
+    allocation.mapped = block->mapped ? block->mapped + offset : nullptr;
+    allocation.type = MemoryAllocationType::BLOCK;
+    allocation.block = free_slot;
+    allocation.node = node;
+    pool.blocks[free_slot] = std::move(block);
+    return true;
+}
+
+bool MemoryAllocator::AllocateDedicated(MemoryPool &pool, const VkMemoryRequirements &requirements,
+                                        MemoryAllocation &allocation) noexcept {
+    void *mapped;
+    VkDeviceMemory memory = AllocateDeviceMemory(pool.memory_type, requirements.size, &mapped);
+    if (!memory) {
+        return false;
+    }
+    pool.dedicated_count++;
+    pool.dedicated_bytes += requirements.size;
+    allocation.memory = memory;
+    allocation.offset = 0;
+    allocation.size = requirements.size;
+    allocation.mapped = mapped;
+    allocation.type = MemoryAllocationType::DEDICATED;
+    return true;
+}
+
+void MemoryAllocator::Free(MemoryAllocation &allocation) noexcept {
+    if (allocation.type == MemoryAllocationType::NONE) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    MemoryPool &pool = *m_pools[allocation.pool];
+    switch (allocation.type) {
+    case MemoryAllocationType::BLOCK: {
+        std::unique_ptr<MemoryBlock> &block = pool.blocks[allocation.block];
+        block->tlsf.Free(allocation.node);
+        if (block->tlsf.GetAllocationCount() == 0) {
+            // keep one empty block around so alternating create/destroy does not thrash vkAllocateMemory
+            u32 live_blocks = static_cast<u32>(
+                std::count_if(pool.blocks.begin(), pool.blocks.end(), [](const auto &b) { return b != nullptr; }));
+            if (live_blocks > 1) {
+                FreeDeviceMemory(block->memory, block->mapped != nullptr);
+                block.reset();
+            }
+        }
+        break;
+    }
+    case MemoryAllocationType::DEDICATED:
+        pool.dedicated_count--;
+        pool.dedicated_bytes -= allocation.size;
+        FreeDeviceMemory(allocation.memory, allocation.mapped != nullptr);
+        break;
+    case MemoryAllocationType::TRANSIENT:
+        // the arena rewinds once everything in it has been released
+        if (--pool.transient_count == 0) {
+            pool.transient_head = 0;
+        }
+        break;
+    default:
+        break;
+    }
+    allocation = MemoryAllocation{};
+}
+
+VkResult MemoryAllocator::CreateBuffer(const VkBufferCreateInfo &create_info, VkMemoryPropertyFlags properties,
+                                       VkBuffer &buffer, MemoryAllocation &allocation, bool transient) noexcept {
+    VkResult result = vkCreateBuffer(m_device, &create_info, nullptr, &buffer);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(m_device, buffer, &requirements);
+    allocation = Allocate(requirements, properties, true, transient);
+    if (allocation.type == MemoryAllocationType::NONE) {
+        vkDestroyBuffer(m_device, buffer, nullptr);
+        buffer = VK_NULL_HANDLE;
+        return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+    }
+    return vkBindBufferMemory(m_device, buffer, allocation.memory, allocation.offset);
+}
+
+VkResult MemoryAllocator::CreateImage(const VkImageCreateInfo &create_info, VkMemoryPropertyFlags properties,
+                                      VkImage &image, MemoryAllocation &allocation) noexcept {
+    VkResult result = vkCreateImage(m_device, &create_info, nullptr, &image);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(m_device, image, &requirements);
+    allocation = Allocate(requirements, properties, create_info.tiling == VK_IMAGE_TILING_LINEAR);
+    if (allocation.type == MemoryAllocationType::NONE) {
+        vkDestroyImage(m_device, image, nullptr);
+        image = VK_NULL_HANDLE;
+        return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+    }
+    return vkBindImageMemory(m_device, image, allocation.memory, allocation.offset);
+}
+
+void MemoryAllocator::DestroyBuffer(VkBuffer &buffer, MemoryAllocation &allocation) noexcept {
+    if (buffer) {
+        vkDestroyBuffer(m_device, buffer, nullptr);
+        buffer = VK_NULL_HANDLE;
+    }
+    Free(allocation);
+}
+
+void MemoryAllocator::DestroyImage(VkImage &image, MemoryAllocation &allocation) noexcept {
+    if (image) {
+        vkDestroyImage(m_device, image, nullptr);
+        image = VK_NULL_HANDLE;
+    }
+    Free(allocation);
+}
+
+void MemoryAllocator::AccumulateStats(const MemoryPool &pool, MemoryStats &stats) const noexcept {
+    for (auto &block : pool.blocks) {
+        if (!block) {
+            continue;
+        }
+        stats.block_count++;
+        stats.allocation_count += block->tlsf.GetAllocationCount();
+        stats.reserved_bytes += block->tlsf.GetSize();
+        stats.used_bytes += block->tlsf.GetUsed();
+        stats.free_bytes += block->tlsf.GetSize() - block->tlsf.GetUsed();
+        block->tlsf.AccumulateFreeRegions(stats.free_region_count, stats.largest_free_region);
+    }
+    stats.allocation_count += pool.dedicated_count + pool.transient_count;
+    stats.dedicated_count += pool.dedicated_count;
+    stats.transient_count += pool.transient_count;
+    stats.reserved_bytes += pool.dedicated_bytes + pool.transient_size;
+    stats.used_bytes += pool.dedicated_bytes + pool.transient_head;
+}
+
+MemoryStats MemoryAllocator::GetStats() const noexcept {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    MemoryStats stats{};
+    stats.device_memory_count = m_device_memory_count;
+    for (auto &pool : m_pools) {
+        if (pool) {
+            AccumulateStats(*pool, stats);
+        }
+    }
+    if (stats.free_bytes > 0) {
+        stats.fragmentation = 1.0f - static_cast<f32>(stats.largest_free_region) / stats.free_bytes;
+    }
+    return stats;
+}
+
+void MemoryAllocator::LogStats() const noexcept {
+    constexpr f64 MB = 1024.0 * 1024.0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto &pool : m_pools) {
+            if (!pool) {
+                continue;
+            }
+            MemoryStats stats{};
+            AccumulateStats(*pool, stats);
+            if (stats.reserved_bytes == 0) {
+                continue;
+            }
+            f32 fragmentation =
+                stats.free_bytes > 0 ? 1.0f - static_cast<f32>(stats.largest_free_region) / stats.free_bytes : 0.0f;
+            LOG_INFO("memory type {} ({}): {} blocks, {} allocations ({} dedicated, {} transient), {:.1f}/{:.1f} MB "
+                     "used, {} free regions, fragmentation {:.2f}",
+                     pool->memory_type, pool->linear ? "linear" : "optimal", stats.block_count,
+                     stats.allocation_count, stats.dedicated_count, stats.transient_count, stats.used_bytes / MB,
+                     stats.reserved_bytes / MB, stats.free_region_count, fragmentation);
+        }
+    }
+    MemoryStats stats = GetStats();
+    LOG_INFO("device memory: {} allocations in {} vkDeviceMemory objects (limit {}), {:.1f}/{:.1f} MB used, "
+             "fragmentation {:.2f}",
+             stats.allocation_count, stats.device_memory_count, m_max_allocation_count, stats.used_bytes / MB,
+             stats.reserved_bytes / MB, stats.fragmentation);
+}
+
+} // namespace Horizon
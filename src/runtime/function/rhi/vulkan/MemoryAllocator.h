@@ -0,0 +1,96 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include <runtime/core/math/Math.h>
+
+namespace Horizon {
+
+enum class MemoryAllocationType : u8 { NONE = 0, BLOCK, DEDICATED, TRANSIENT };
+
+// a range of device memory owned by the allocator, bind resources at memory + offset
+struct MemoryAllocation {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    u64 offset = 0;
+    u64 size = 0;
+    // persistently mapped pointer to offset, nullptr if the memory type is not host visible
+    void *mapped = nullptr;
+    MemoryAllocationType type = MemoryAllocationType::NONE;
+    u32 pool = 0;
+    u32 block = 0;
+    u32 node = 0;
+};
+
+struct MemoryStats {
+    u32 device_memory_count = 0; // live vkAllocateMemory objects
+    u32 block_count = 0;
+    u32 allocation_count = 0;
+    u32 dedicated_count = 0;
+    u32 transient_count = 0;
+    u64 reserved_bytes = 0; // device memory owned by the allocator
+    u64 used_bytes = 0;     // bytes handed out, including alignment padding
+    u64 free_bytes = 0;     // free bytes inside sub-allocated blocks
+    u32 free_region_count = 0;
+    u64 largest_free_region = 0;
+    // 1 - largest free region / free bytes, 0 means all free space is contiguous
+    f32 fragmentation = 0.0f;
+};
+
+// sub-allocates buffers and images out of large blocks per memory type with a tlsf allocator. buffers and optimal
+// images live in separate blocks so bufferImageGranularity never has to be considered. allocations larger than half
+// a block get their own device memory. transient allocations are bumped out of a linear arena per memory type which
+// rewinds once every transient allocation is freed. host visible blocks stay mapped. thread safe.
+class MemoryAllocator {
+  public:
+    MemoryAllocator(VkDevice device, VkPhysicalDevice physical_device) noexcept;
+    ~MemoryAllocator() noexcept;
+    MemoryAllocator(const MemoryAllocator &) = delete;
+    MemoryAllocator &operator=(const MemoryAllocator &) = delete;
+
+    // linear is true for buffers and linear tiled images
+    MemoryAllocation Allocate(const VkMemoryRequirements &requirements, VkMemoryPropertyFlags properties, bool linear,
+                              bool transient = false) noexcept;
+    // resets the allocation, freeing an empty allocation is a no-op
+    void Free(MemoryAllocation &allocation) noexcept;
+
+    VkResult CreateBuffer(const VkBufferCreateInfo &create_info, VkMemoryPropertyFlags properties, VkBuffer &buffer,
+                          MemoryAllocation &allocation, bool transient = false) noexcept;
+    VkResult CreateImage(const VkImageCreateInfo &create_info, VkMemoryPropertyFlags properties, VkImage &image,
+                         MemoryAllocation &allocation) noexcept;
+    void DestroyBuffer(VkBuffer &buffer, MemoryAllocation &allocation) noexcept;
+    void DestroyImage(VkImage &image, MemoryAllocation &allocation) noexcept;
+
+    MemoryStats GetStats() const noexcept;
+    // per memory type usage and fragmentation
+    void LogStats() const noexcept;
+
+  private:
+    struct MemoryBlock;
+    struct MemoryPool;
+
+    MemoryPool &GetPool(u32 memory_type, bool linear) noexcept;
+    VkDeviceMemory AllocateDeviceMemory(u32 memory_type, u64 size, void **mapped) noexcept;
+    void FreeDeviceMemory(VkDeviceMemory memory, bool mapped) noexcept;
+    bool AllocateTransient(MemoryPool &pool, const VkMemoryRequirements &requirements,
+                           MemoryAllocation &allocation) noexcept;
+    bool AllocateFromBlocks(MemoryPool &pool, const VkMemoryRequirements &requirements,
+                            MemoryAllocation &allocation) noexcept;
+    bool AllocateDedicated(MemoryPool &pool, const VkMemoryRequirements &requirements,
+                           MemoryAllocation &allocation) noexcept;
+    void AccumulateStats(const MemoryPool &pool, MemoryStats &stats) const noexcept;
+
+  private:
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkPhysicalDeviceMemoryProperties m_memory_properties{};
+    u32 m_max_allocation_count = 0;
+    u32 m_device_memory_count = 0;
+    mutable std::mutex m_mutex;
+    // indexed by memory_type * 2 + linear, created on first use
+    std::vector<std::unique_ptr<MemoryPool>> m_pools;
+};
+
+} // namespace Horizon
@@ -1,8 +1,13 @@
 #include "Pipeline.h"
 
+#include <algorithm>
 #include <array>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 
 #include <runtime/core/log/Log.h>
+#include <runtime/core/thread/ThreadPool.h>
 
 #include "Device.h"
 #include "Instance.h"
@@ -12,14 +17,41 @@
 #include "Vertex.h"
 
 namespace Horizon {
-Pipeline::Pipeline(std::shared_ptr<Device> device) noexcept : m_device(device) {}
+
+namespace {
+
+constexpr u32 PIPELINE_CACHE_MAGIC = 0x43504848; // "HHPC"
+constexpr u32 PIPELINE_CACHE_VERSION = 1;
+
+// precedes the driver's cache data, VkPipelineCacheHeaderVersionOne has no driver version
+struct PipelineCacheFileHeader {
+    u32 magic;
+    u32 version;
+    u32 vendor_id;
+    u32 device_id;
+    u32 driver_version;
+    u8 pipeline_cache_uuid[VK_UUID_SIZE];
+    u32 padding;
+    u64 data_size;
+};
+
+} // namespace
+
+Pipeline::Pipeline(std::shared_ptr<Device> device, VkPipelineCache pipeline_cache) noexcept
+    : m_device(device), m_pipeline_cache(pipeline_cache) {}
 
 Pipeline::~Pipeline() noexcept {
+    // the pool thread may still be creating it
+    Wait();
     vkDestroyPipeline(m_device->Get(), m_pipeline, nullptr);
     vkDestroyPipelineLayout(m_device->Get(), m_pipeline_layout, nullptr);
 }
 
-VkPipeline Pipeline::Get() const noexcept { return m_pipeline; }
+VkPipeline Pipeline::Get() const noexcept {
+    // returns at once for a pipeline that is compiled, the first use of an async one blocks until it is
+    Wait();
+    return m_pipeline;
+}
 
 VkPipelineLayout Pipeline::GetLayout() const noexcept { return m_pipeline_layout; }
 
@@ -27,23 +59,52 @@ bool Pipeline::hasPushConstants() const noexcept { return m_push_constants != nu
 
 PipelineType Pipeline::GetType() const noexcept { return m_type; }
 
+f64 Pipeline::GetCreationTime() const noexcept { return m_creation_ms; }
+
+PipelineCacheResult Pipeline::GetCacheResult() const noexcept { return m_cache_result; }
+
+void Pipeline::Wait() const noexcept {
+    if (m_ready.valid()) {
+        m_ready.wait();
+    }
+}
+
+void Pipeline::Compile(std::function<void()> create, bool async) noexcept {
+    if (!async) {
+        create();
+        return;
+    }
+    // shader modules, the layout and the cache are only read, vkCreate*Pipelines may run on any thread
+    m_ready = ThreadPool::GetInstance().Submit(std::move(create)).share();
+}
+
+void Pipeline::RecordCreation(std::chrono::steady_clock::time_point begin,
+                              const VkPipelineCreationFeedback &feedback) noexcept {
+    m_creation_ms = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    if (feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT) {
+        m_cache_result = (feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT)
+                             ? PipelineCacheResult::HIT
+                             : PipelineCacheResult::MISS;
+    }
+}
+
 GraphicsPipeline::GraphicsPipeline(std::shared_ptr<Device> device, const GraphicsPipelineCreateInfo &create_info,
                                    const std::vector<AttachmentCreateInfo> &attachment_create_info,
-                                   const RenderContext render_context, std::shared_ptr<SwapChain> swap_chain) noexcept
-    : Pipeline(device), m_render_context(render_context) {
+                                   const RenderContext render_context, std::shared_ptr<SwapChain> swap_chain,
+                                   VkPipelineCache pipeline_cache, bool async_compile,
+                                   std::shared_ptr<RenderTargetPool> render_target_pool) noexcept
+    : Pipeline(device, pipeline_cache), m_render_context(render_context) {
     m_type = PipelineType::GRAPHICS;
 
-    if (swap_chain) {
-        m_framebuffer = std::make_shared<Framebuffer>(m_device, attachment_create_info, m_render_context, swap_chain);
-    } else {
-        m_framebuffer = std::make_shared<Framebuffer>(m_device, attachment_create_info, m_render_context);
-    }
+    m_framebuffer = std::make_shared<Framebuffer>(m_device, attachment_create_info, m_render_context, swap_chain,
+                                                  render_target_pool);
     CreatePipelineLayout(create_info);
-    CreatePipeline(create_info);
+    Compile([this, create_info]() { CreatePipeline(create_info); }, async_compile);
     m_clear_values = m_framebuffer->getClearValues();
 }
 
-GraphicsPipeline::~GraphicsPipeline() noexcept {}
+// the compile task uses the framebuffer, wait before it goes away
+GraphicsPipeline::~GraphicsPipeline() noexcept { Wait(); }
 
 VkViewport GraphicsPipeline::getViewport() const noexcept { return m_viewport; }
 
@@ -108,6 +169,10 @@ void GraphicsPipeline::CreatePipeline(const GraphicsPipelineCreateInfo &create_i
     pipelineShaderStageCreateInfos[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
     pipelineShaderStageCreateInfos[1].module = create_info.ps->Get();
     pipelineShaderStageCreateInfos[1].pName = "main";
+    if (!pipelineShaderStageCreateInfos[0].module || !pipelineShaderStageCreateInfos[1].module) {
+        LOG_ERROR("pipeline {} is not created, its shaders failed to load", create_info.name);
+        return;
+    }
 
     auto bindingDescription = Vertex::getBindingDescription();
     auto attributeDescriptions = Vertex::getAttributeDescriptions();
@@ -234,10 +299,146 @@ void GraphicsPipeline::CreatePipeline(const GraphicsPipelineCreateInfo &create_i
     pipelineInfo.subpass = 0;
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-    CHECK_VK_RESULT(vkCreateGraphicsPipelines(m_device->Get(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_pipeline));
+    // cache hit statistics, chained only when the extension is enabled
+    VkPipelineCreationFeedback feedback{};
+    VkPipelineCreationFeedbackCreateInfo feedback_create_info{};
+    feedback_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO;
+    feedback_create_info.pPipelineCreationFeedback = &feedback;
+    if (m_device->IsPipelineCreationFeedbackSupported()) {
+        pipelineInfo.pNext = &feedback_create_info;
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    CHECK_VK_RESULT(
+        vkCreateGraphicsPipelines(m_device->Get(), m_pipeline_cache, 1, &pipelineInfo, nullptr, &m_pipeline));
+    RecordCreation(begin, feedback);
+}
+
+PipelineManager::PipelineManager(std::shared_ptr<Device> device, const std::string &cache_path,
+                                 std::shared_ptr<RenderTargetPool> render_target_pool)
+    : m_device(device), m_render_target_pool(render_target_pool), m_cache_path(cache_path) {
+    CreatePipelineCache();
+}
+
+PipelineManager::~PipelineManager() { vkDestroyPipelineCache(m_device->Get(), m_pipeline_cache, nullptr); }
+
+void PipelineManager::CreatePipelineCache() noexcept {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(m_device->getPhysicalDevice(), &properties);
+
+    // a cache from another device or driver is rejected before the driver sees it, some drivers crash on those
+    std::vector<char> data;
+    std::ifstream file(m_cache_path, std::ios::binary);
+    if (!m_cache_path.empty() && file.is_open()) {
+        PipelineCacheFileHeader header{};
+        file.read(reinterpret_cast<char *>(&header), sizeof(header));
+        if (!file.good() || header.magic != PIPELINE_CACHE_MAGIC || header.version != PIPELINE_CACHE_VERSION) {
+            LOG_WARN("{} is not a pipeline cache file of version {}", m_cache_path, PIPELINE_CACHE_VERSION);
+        } else if (header.vendor_id != properties.vendorID || header.device_id != properties.deviceID ||
+                   header.driver_version != properties.driverVersion ||
+                   std::memcmp(header.pipeline_cache_uuid, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+            LOG_INFO("{} was written by another device or driver version", m_cache_path);
+        } else {
+            data.resize(header.data_size);
+            file.read(data.data(), static_cast<std::streamsize>(data.size()));
+            if (!file.good() || data.size() < sizeof(VkPipelineCacheHeaderVersionOne)) {
+                LOG_WARN("{} is truncated", m_cache_path);
+                data.clear();
+            }
+        }
+    }
+
+    VkPipelineCacheCreateInfo pipeline_cache_create_info{};
+    pipeline_cache_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    pipeline_cache_create_info.initialDataSize = data.size();
+    pipeline_cache_create_info.pInitialData = data.empty() ? nullptr : data.data();
+    if (vkCreatePipelineCache(m_device->Get(), &pipeline_cache_create_info, nullptr, &m_pipeline_cache) ==
+        VK_SUCCESS) {
+        m_loaded_cache_size = data.size();
+        return;
+    }
+
+    // the driver may still refuse the data, start empty then
+    LOG_WARN("failed to create the pipeline cache from {}, starting empty", m_cache_path);
+    pipeline_cache_create_info.initialDataSize = 0;
+    pipeline_cache_create_info.pInitialData = nullptr;
+    CHECK_VK_RESULT(vkCreatePipelineCache(m_device->Get(), &pipeline_cache_create_info, nullptr, &m_pipeline_cache));
+    m_loaded_cache_size = 0;
+}
+
+bool PipelineManager::SavePipelineCache() noexcept {
+    if (m_cache_path.empty()) {
+        return false;
+    }
+    size_t data_size = 0;
+    CHECK_VK_RESULT(vkGetPipelineCacheData(m_device->Get(), m_pipeline_cache, &data_size, nullptr));
+    std::vector<char> data(data_size);
+    CHECK_VK_RESULT(vkGetPipelineCacheData(m_device->Get(), m_pipeline_cache, &data_size, data.data()));
+    data.resize(data_size);
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(m_device->getPhysicalDevice(), &properties);
+    PipelineCacheFileHeader header{};
+    header.magic = PIPELINE_CACHE_MAGIC;
+    header.version = PIPELINE_CACHE_VERSION;
+    header.vendor_id = properties.vendorID;
+    header.device_id = properties.deviceID;
+    header.driver_version = properties.driverVersion;
+    std::memcpy(header.pipeline_cache_uuid, properties.pipelineCacheUUID, VK_UUID_SIZE);
+    header.data_size = data.size();
+
+    // write to a temporary file first so a crash never leaves a truncated file behind
+    std::string tmp_path = m_cache_path + ".tmp";
+    {
+        std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            LOG_WARN("failed to open {}", tmp_path);
+            return false;
+        }
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!file.good()) {
+            LOG_WARN("failed to write {}", tmp_path);
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp_path, m_cache_path, ec);
+    if (ec) {
+        LOG_WARN("failed to move {} to {}: {}", tmp_path, m_cache_path, ec.message());
+        std::filesystem::remove(tmp_path, ec);
+        return false;
+    }
+    return true;
 }
 
-PipelineManager::PipelineManager(std::shared_ptr<Device> device) : m_device(device) {}
+void PipelineManager::LogStats() const noexcept {
+    std::vector<std::pair<std::string, std::shared_ptr<Pipeline>>> pipelines;
+    for (auto &[name, val] : m_pipeline_map) {
+        if (val.pipeline) {
+            pipelines.emplace_back(name, val.pipeline);
+        }
+    }
+    std::sort(pipelines.begin(), pipelines.end(), [](const auto &a, const auto &b) {
+        return a.second->GetCreationTime() > b.second->GetCreationTime();
+    });
+
+    const char *results[3] = {"unknown", "hit", "miss"};
+    f64 total_ms = 0.0;
+    u32 counts[3]{};
+    for (auto &[name, pipeline] : pipelines) {
+        u32 result = static_cast<u32>(pipeline->GetCacheResult());
+        LOG_INFO("pipeline {:<24} {:8.2f} ms, cache {}", name, pipeline->GetCreationTime(), results[result]);
+        total_ms += pipeline->GetCreationTime();
+        counts[result]++;
+    }
+    LOG_INFO("{} pipelines created in {:.2f} ms from a {} start ({} bytes of cache data), {} hits, {} misses, {} "
+             "unknown",
+             pipelines.size(), total_ms, m_loaded_cache_size > 0 ? "warm" : "cold", m_loaded_cache_size,
+             counts[static_cast<u32>(PipelineCacheResult::HIT)], counts[static_cast<u32>(PipelineCacheResult::MISS)],
+             counts[static_cast<u32>(PipelineCacheResult::UNKNOWN)]);
+}
 
 std::shared_ptr<Pipeline>
 PipelineManager::CreateGraphicsPipeline(const GraphicsPipelineCreateInfo &create_info,
@@ -247,8 +448,10 @@ PipelineManager::CreateGraphicsPipeline(const GraphicsPipelineCreateInfo &create
     // pipeline key exist
     if (!m_pipeline_map[hashKey].pipeline) {
         auto &pipelineVal = m_pipeline_map[hashKey];
+        BeginCompile();
         pipelineVal.pipeline =
-            std::make_shared<GraphicsPipeline>(m_device, create_info, _attachment_create_info, _render_context);
+            std::make_shared<GraphicsPipeline>(m_device, create_info, _attachment_create_info, _render_context, nullptr,
+                                               m_pipeline_cache, true, m_render_target_pool);
     } else {
         LOG_INFO("pipeline exist");
     }
@@ -260,7 +463,8 @@ std::shared_ptr<Pipeline> PipelineManager::CreateComputePipeline(const ComputePi
     // pipeline key exist
     if (!m_pipeline_map[hashKey].pipeline) {
         auto &pipelineVal = m_pipeline_map[hashKey];
-        pipelineVal.pipeline = std::make_shared<ComputePipeline>(m_device, create_info);
+        BeginCompile();
+        pipelineVal.pipeline = std::make_shared<ComputePipeline>(m_device, create_info, m_pipeline_cache, true);
     } else {
         LOG_INFO("pipeline exist");
     }
@@ -274,9 +478,33 @@ void PipelineManager::createPresentPipeline(const GraphicsPipelineCreateInfo &cr
     // pipeline key exist
     if (!m_pipeline_map[hashKey].pipeline) {
         auto &pipelineVal = m_pipeline_map[hashKey];
+        BeginCompile();
         pipelineVal.pipeline = std::make_shared<GraphicsPipeline>(m_device, create_info, _attachment_create_info,
-                                                                  _render_context, swap_chain);
+                                                                  _render_context, swap_chain, m_pipeline_cache, true);
+    }
+}
+
+void PipelineManager::BeginCompile() noexcept {
+    if (m_pending_compiles++ == 0) {
+        m_compile_begin = std::chrono::steady_clock::now();
+    }
+}
+
+void PipelineManager::WaitForPipelines() noexcept {
+    if (m_pending_compiles == 0) {
+        return;
+    }
+    f64 compile_ms = 0.0;
+    for (auto &[name, val] : m_pipeline_map) {
+        if (val.pipeline) {
+            val.pipeline->Wait();
+            compile_ms += val.pipeline->GetCreationTime();
+        }
     }
+    f64 elapsed = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - m_compile_begin).count();
+    LOG_INFO("{} pipelines compiled on {} threads in {:.2f} ms, {:.2f} ms of compile time", m_pending_compiles,
+             ThreadPool::GetInstance().GetWorkerCount(), elapsed, compile_ms);
+    m_pending_compiles = 0;
 }
 
 std::shared_ptr<Pipeline> PipelineManager::Get(const std::string &name) {
@@ -289,17 +517,18 @@ std::shared_ptr<Pipeline> PipelineManager::Get(const std::string &name) {
     }
 }
 
-ComputePipeline::ComputePipeline(std::shared_ptr<Device> device, const ComputePipelineCreateInfo &create_info) noexcept
-    : Pipeline(device) {
+ComputePipeline::ComputePipeline(std::shared_ptr<Device> device, const ComputePipelineCreateInfo &create_info,
+                                 VkPipelineCache pipeline_cache, bool async_compile) noexcept
+    : Pipeline(device, pipeline_cache) {
     m_group_count_x = create_info.group_count_x;
     m_group_count_y = create_info.group_count_y;
     m_group_count_z = create_info.group_count_z;
     m_type = PipelineType::COMPUTE;
     CreatePipelineLayout(create_info);
-    CreatePipeline(create_info);
+    Compile([this, create_info]() { CreatePipeline(create_info); }, async_compile);
 }
 
-ComputePipeline::~ComputePipeline() noexcept {}
+ComputePipeline::~ComputePipeline() noexcept { Wait(); }
 
 u32 ComputePipeline::GroupCountX() const noexcept { return m_group_count_x; }
 
@@ -348,6 +577,10 @@ void ComputePipeline::CreatePipeline(const ComputePipelineCreateInfo &create_inf
     pipeline_shader_stage_create_info.stage = VK_SHADER_STAGE_COMPUTE_BIT;
     pipeline_shader_stage_create_info.module = create_info.cs->Get();
     pipeline_shader_stage_create_info.pName = "main";
+    if (!pipeline_shader_stage_create_info.module) {
+        LOG_ERROR("pipeline {} is not created, its shader failed to load", create_info.name);
+        return;
+    }
 
     VkComputePipelineCreateInfo compute_pipeline_create_info{};
     compute_pipeline_create_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
@@ -357,8 +590,19 @@ void ComputePipeline::CreatePipeline(const ComputePipelineCreateInfo &create_inf
     compute_pipeline_create_info.basePipelineHandle = nullptr;
     compute_pipeline_create_info.basePipelineIndex = 0;
 
-    CHECK_VK_RESULT(
-        vkCreateComputePipelines(m_device->Get(), nullptr, 1, &compute_pipeline_create_info, nullptr, &m_pipeline));
+    // cache hit statistics, chained only when the extension is enabled
+    VkPipelineCreationFeedback feedback{};
+    VkPipelineCreationFeedbackCreateInfo feedback_create_info{};
+    feedback_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO;
+    feedback_create_info.pPipelineCreationFeedback = &feedback;
+    if (m_device->IsPipelineCreationFeedbackSupported()) {
+        compute_pipeline_create_info.pNext = &feedback_create_info;
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    CHECK_VK_RESULT(vkCreateComputePipelines(m_device->Get(), m_pipeline_cache, 1, &compute_pipeline_create_info,
+                                             nullptr, &m_pipeline));
+    RecordCreation(begin, feedback);
 }
 
 } // namespace Horizon
\ No newline at end of file
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <chrono>
+#include <functional>
+#include <future>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
@@ -10,6 +14,7 @@
 #include "Framebuffer.h"
 #include "Instance.h"
 #include "RenderPass.h"
+#include "RenderTargetPool.h"
 #include "ShaderModule.h"
 #include "Surface.h"
 #include "SwapChain.h"
@@ -33,30 +38,51 @@ struct ComputePipelineCreateInfo {
     u32 group_count_x = 1, group_count_y = 1, group_count_z = 1;
 };
 
+// whether the driver found the pipeline in the pipeline cache, UNKNOWN without VK_EXT_pipeline_creation_feedback
+enum class PipelineCacheResult { UNKNOWN, HIT, MISS };
+
 class Pipeline {
   public:
-    Pipeline(std::shared_ptr<Device> device) noexcept;
+    Pipeline(std::shared_ptr<Device> device, VkPipelineCache pipeline_cache = VK_NULL_HANDLE) noexcept;
     ~Pipeline() noexcept;
+    // waits for an async compile, VK_NULL_HANDLE when a shader failed to load
     VkPipeline Get() const noexcept;
     VkPipelineLayout GetLayout() const noexcept;
     bool hasPushConstants() const noexcept;
     PipelineType GetType() const noexcept;
+    // wall time of vkCreate*Pipelines
+    f64 GetCreationTime() const noexcept;
+    PipelineCacheResult GetCacheResult() const noexcept;
+    // a pipeline compiled on the thread pool is only usable once this returned, Get calls it
+    void Wait() const noexcept;
 
   public:
     std::shared_ptr<PushConstants> m_push_constants = nullptr;
 
+  protected:
+    // runs create inline, or on the thread pool when async
+    void Compile(std::function<void()> create, bool async) noexcept;
+    void RecordCreation(std::chrono::steady_clock::time_point begin,
+                        const VkPipelineCreationFeedback &feedback) noexcept;
+
   protected:
     PipelineType m_type;
     std::shared_ptr<Device> m_device = nullptr;
     VkPipelineLayout m_pipeline_layout = nullptr;
-    VkPipeline m_pipeline;
+    VkPipeline m_pipeline = VK_NULL_HANDLE;
+    VkPipelineCache m_pipeline_cache = VK_NULL_HANDLE;
+    f64 m_creation_ms = 0.0;
+    PipelineCacheResult m_cache_result = PipelineCacheResult::UNKNOWN;
+    std::shared_future<void> m_ready;
 };
 
 class GraphicsPipeline : public Pipeline {
   public:
     GraphicsPipeline(std::shared_ptr<Device> device, const GraphicsPipelineCreateInfo &create_info,
                      const std::vector<AttachmentCreateInfo> &attachment_create_info,
-                     const RenderContext render_context, std::shared_ptr<SwapChain> swap_chain = nullptr) noexcept;
+                     const RenderContext render_context, std::shared_ptr<SwapChain> swap_chain = nullptr,
+                     VkPipelineCache pipeline_cache = VK_NULL_HANDLE, bool async_compile = false,
+                     std::shared_ptr<RenderTargetPool> render_target_pool = nullptr) noexcept;
     ~GraphicsPipeline() noexcept;
 
     VkViewport getViewport() const noexcept;
@@ -80,7 +106,8 @@ class GraphicsPipeline : public Pipeline {
 
 class ComputePipeline : public Pipeline {
   public:
-    ComputePipeline(std::shared_ptr<Device> device, const ComputePipelineCreateInfo &create_info) noexcept;
+    ComputePipeline(std::shared_ptr<Device> device, const ComputePipelineCreateInfo &create_info,
+                    VkPipelineCache pipeline_cache = VK_NULL_HANDLE, bool async_compile = false) noexcept;
     ~ComputePipeline() noexcept;
     u32 GroupCountX() const noexcept;
     u32 GroupCountY() const noexcept;
@@ -98,9 +125,15 @@ class RTpipeline : public Pipeline {
   public:
 };
 
+// owns every pipeline by name. with a cache path the VkPipelineCache is loaded from and saved to that file, a file
+// written by another gpu or driver version is ignored. layouts and framebuffers are created right away, the pipelines
+// themselves compile concurrently on the thread pool until WaitForPipelines. named attachments of graphics pipelines
+// come from the render target pool if there is one.
 class PipelineManager {
   public:
-    PipelineManager(std::shared_ptr<Device> device);
+    PipelineManager(std::shared_ptr<Device> device, const std::string &cache_path = {},
+                    std::shared_ptr<RenderTargetPool> render_target_pool = nullptr);
+    ~PipelineManager();
 
     std::shared_ptr<Pipeline> CreateGraphicsPipeline(const GraphicsPipelineCreateInfo &create_info,
                                                      const std::vector<AttachmentCreateInfo> &_attachment_create_info,
@@ -114,7 +147,21 @@ class PipelineManager {
 
     std::shared_ptr<Pipeline> Get(const std::string &name);
 
+    // blocks until every pipeline created so far has compiled
+    void WaitForPipelines() noexcept;
+
+    // writes the pipeline cache to the cache path, false without a cache path or on io errors
+    bool SavePipelineCache() noexcept;
+
+    // creation time and cache result of every pipeline, slowest first
+    void LogStats() const noexcept;
+
   private:
+    void CreatePipelineCache() noexcept;
+
+    // counts a compile submitted to the thread pool
+    void BeginCompile() noexcept;
+
     // convert pipelinecreateinfo and pipelinename to u32 hash key, https://dev.to/muiz6/string-hashing-in-c-1np3
     inline std::string GetPipelineKey(const GraphicsPipelineCreateInfo &create_info) { return create_info.name; }
 
@@ -126,6 +173,14 @@ class PipelineManager {
     };
     std::shared_ptr<Device> m_device;
     std::shared_ptr<SwapChain> m_swap_chain;
+    std::shared_ptr<RenderTargetPool> m_render_target_pool;
     std::unordered_map<std::string, PipelineVal> m_pipeline_map;
+    std::string m_cache_path;
+    VkPipelineCache m_pipeline_cache = VK_NULL_HANDLE;
+    // bytes of driver cache data the pipeline cache was created from, 0 for a cold start
+    u64 m_loaded_cache_size = 0;
+    // first compile submitted since the last WaitForPipelines
+    std::chrono::steady_clock::time_point m_compile_begin{};
+    u32 m_pending_compiles = 0;
 };
 } // namespace Horizon
\ No newline at end of file
@@ -44,10 +44,14 @@ QueueFamilyIndices::QueueFamilyIndices(VkPhysicalDevice device, VkSurfaceKHR sur
         }
 
         // queue support present operation
-        VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
-        if (queueFamilies[i].queueCount > 0 && presentSupport) {
-            present = i;
+        if (surface == VK_NULL_HANDLE) {
+            present = graphics;
+        } else {
+            VkBool32 presentSupport = false;
+            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+            if (queueFamilies[i].queueCount > 0 && presentSupport) {
+                present = i;
+            }
         }
 
         if (completed()) {
@@ -11,6 +11,7 @@ namespace Horizon {
 class QueueFamilyIndices {
   public:
     QueueFamilyIndices();
+    // without a surface nothing is presented, the present family is the graphics family
     QueueFamilyIndices(VkPhysicalDevice device, VkSurfaceKHR surface);
 
     ~QueueFamilyIndices() = default;
@@ -28,6 +28,8 @@ void RenderPass::CreateRenderPass(const std::vector<AttachmentCreateInfo> &attac
             } else if (attachment_create_info[i].usage & AttachmentUsageFlags::DEPTH_STENCIL_ATTACHMENT) {
                 attachmentsDesc[i].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
             }
+        } else if (attachment_create_info[i].usage & AttachmentUsageFlags::TRANSFER_SRC) {
+            attachmentsDesc[i].finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
         } else if (attachment_create_info[i].usage & AttachmentUsageFlags::COLOR_ATTACHMENT) {
             attachmentsDesc[i].finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
         } else if (attachment_create_info[i].usage & AttachmentUsageFlags::DEPTH_STENCIL_ATTACHMENT) {
@@ -0,0 +1,261 @@
+#include "RenderTargetPool.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <numeric>
+
+#include <runtime/core/log/Log.h>
+#include <runtime/function/rhi/RenderContext.h>
+
+#include "Framebuffer.h"
+
+namespace Horizon {
+
+namespace {
+
+bool SameKey(const AttachmentCreateInfo &a, const AttachmentCreateInfo &b) noexcept {
+    return a.format == b.format && a.usage == b.usage && a.texture_type == b.texture_type && a.width == b.width &&
+           a.height == b.height && a.depth == b.depth;
+}
+
+VkImageAspectFlags GetAspect(const AttachmentCreateInfo &create_info) noexcept {
+    return create_info.usage & AttachmentUsageFlags::DEPTH_STENCIL_ATTACHMENT ? VK_IMAGE_ASPECT_DEPTH_BIT
+                                                                              : VK_IMAGE_ASPECT_COLOR_BIT;
+}
+
+} // namespace
+
+RenderTargetPool::RenderTargetPool(std::shared_ptr<Device> device) noexcept : m_device(device) {}
+
+RenderTargetPool::~RenderTargetPool() noexcept {
+    for (auto &[name, target] : m_targets) {
+        m_device->GetDescriptorAllocator()->Invalidate(target->image_view);
+        vkDestroyImageView(m_device->Get(), target->image_view, nullptr);
+    }
+    for (auto &image : m_images) {
+        vkDestroyImage(m_device->Get(), image.image, nullptr);
+    }
+    for (auto &slot : m_slots) {
+        m_device->GetMemoryAllocator()->Free(slot.allocation);
+    }
+}
+
+std::shared_ptr<RenderTarget> RenderTargetPool::Request(const AttachmentCreateInfo &create_info) noexcept {
+    auto it = m_targets.find(create_info.name);
+    if (it != m_targets.end()) {
+        if (!SameKey(it->second->create_info, create_info)) {
+            LOG_ERROR("render target {} requested with a different format, extent or usage", create_info.name);
+        }
+        return it->second;
+    }
+    if (m_built) {
+        LOG_ERROR("render target {} requested after the pool was built", create_info.name);
+    }
+    auto target = std::make_shared<RenderTarget>();
+    target->create_info = create_info;
+    m_targets.emplace(create_info.name, target);
+    m_target_names.push_back(create_info.name);
+    return target;
+}
+
+std::vector<std::string> RenderTargetPool::GetTargetNames() const noexcept { return m_target_names; }
+
+void RenderTargetPool::SetLifetime(const std::string &name, u32 first_use, u32 last_use) noexcept {
+    auto it = m_targets.find(name);
+    if (it == m_targets.end() || m_built) {
+        return;
+    }
+    it->second->first_use = first_use;
+    it->second->last_use = last_use;
+}
+
+u32 RenderTargetPool::GetMemorySlot(const std::string &name) const noexcept {
+    auto it = m_targets.find(name);
+    return it != m_targets.end() ? it->second->memory_slot : 0;
+}
+
+void RenderTargetPool::AddFramebuffer(Framebuffer *framebuffer) noexcept {
+    m_framebuffers.push_back(framebuffer);
+    if (m_built) {
+        framebuffer->CreateForRenderTargets();
+    }
+}
+
+void RenderTargetPool::RemoveFramebuffer(Framebuffer *framebuffer) noexcept {
+    m_framebuffers.erase(std::remove(m_framebuffers.begin(), m_framebuffers.end(), framebuffer),
+                         m_framebuffers.end());
+}
+
+bool RenderTargetPool::Overlaps(const RenderTarget &a, const RenderTarget &b) noexcept {
+    return a.first_use <= b.last_use && b.first_use <= a.last_use;
+}
+
+bool RenderTargetPool::Overlaps(const PooledImage &a, const PooledImage &b) const noexcept {
+    for (auto &target_a : a.targets) {
+        for (auto &target_b : b.targets) {
+            if (Overlaps(*target_a, *target_b)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void RenderTargetPool::Build() noexcept {
+    if (m_built) {
+        return;
+    }
+    m_built = true;
+
+    // targets of the same key share an image when no two of them are live at once, earliest first
+    std::vector<std::shared_ptr<RenderTarget>> targets;
+    for (auto &name : m_target_names) {
+        targets.push_back(m_targets[name]);
+    }
+    std::stable_sort(targets.begin(), targets.end(),
+                     [](const auto &a, const auto &b) { return a->first_use < b->first_use; });
+    for (auto &target : targets) {
+        auto image = std::find_if(m_images.begin(), m_images.end(), [&target](const PooledImage &image) {
+            return SameKey(image.targets[0]->create_info, target->create_info) &&
+                   std::none_of(image.targets.begin(), image.targets.end(),
+                                [&target](const auto &other) { return Overlaps(*other, *target); });
+        });
+        if (image == m_images.end()) {
+            image = m_images.emplace(m_images.end());
+        }
+        image->targets.push_back(target);
+    }
+    for (auto &image : m_images) {
+        CreateImage(image);
+    }
+
+    // the remaining images share memory when their lifetimes are disjoint, largest first so small images fill the
+    // slots of large ones
+    std::vector<u32> order(m_images.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [this](u32 a, u32 b) {
+        return m_images[a].requirements.size > m_images[b].requirements.size;
+    });
+    for (u32 i : order) {
+        const VkMemoryRequirements &requirements = m_images[i].requirements;
+        auto slot = std::find_if(m_slots.begin(), m_slots.end(), [this, i, &requirements](const MemorySlot &slot) {
+            return (slot.requirements.memoryTypeBits & requirements.memoryTypeBits) != 0 &&
+                   std::none_of(slot.images.begin(), slot.images.end(),
+                                [this, i](u32 other) { return Overlaps(m_images[other], m_images[i]); });
+        });
+        if (slot == m_slots.end()) {
+            slot = m_slots.emplace(m_slots.end());
+            slot->requirements = requirements;
+        } else {
+            slot->requirements.size = std::max(slot->requirements.size, requirements.size);
+            slot->requirements.alignment = std::max(slot->requirements.alignment, requirements.alignment);
+            slot->requirements.memoryTypeBits &= requirements.memoryTypeBits;
+        }
+        slot->images.push_back(i);
+    }
+
+    auto allocator = m_device->GetMemoryAllocator();
+    for (u32 s = 0; s < m_slots.size(); s++) {
+        MemorySlot &slot = m_slots[s];
+        slot.allocation = allocator->Allocate(slot.requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, false);
+        if (slot.allocation.type == MemoryAllocationType::NONE) {
+            // the images of the slot would stay unbound and every pass using them would be invalid
+            LOG_ERROR("failed to allocate {:.1f} MB of render target memory",
+                      slot.requirements.size / (1024.0 * 1024.0));
+            std::abort();
+        }
+        for (u32 i : slot.images) {
+            CHECK_VK_RESULT(vkBindImageMemory(m_device->Get(), m_images[i].image, slot.allocation.memory,
+                                              slot.allocation.offset));
+            for (auto &target : m_images[i].targets) {
+                target->memory_slot = s;
+            }
+            CreateImageViews(m_images[i]);
+        }
+    }
+
+    for (auto framebuffer : m_framebuffers) {
+        framebuffer->CreateForRenderTargets();
+    }
+}
+
+void RenderTargetPool::CreateImage(PooledImage &image) noexcept {
+    const AttachmentCreateInfo &create_info = image.targets[0]->create_info;
+    VkImageCreateInfo image_create_info{};
+    image_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    image_create_info.imageType = ToVkImageType(create_info.texture_type);
+    image_create_info.format = ToVkImageFormat(create_info.format);
+    image_create_info.extent = {create_info.width, create_info.height, create_info.depth};
+    image_create_info.mipLevels = 1;
+    image_create_info.arrayLayers = 1;
+    image_create_info.samples = VK_SAMPLE_COUNT_1_BIT;
+    image_create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    image_create_info.usage = VK_IMAGE_USAGE_SAMPLED_BIT;
+    if (create_info.usage & AttachmentUsageFlags::COLOR_ATTACHMENT) {
+        image_create_info.usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    }
+    if (create_info.usage & AttachmentUsageFlags::DEPTH_STENCIL_ATTACHMENT) {
+        image_create_info.usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    }
+    CHECK_VK_RESULT(vkCreateImage(m_device->Get(), &image_create_info, nullptr, &image.image));
+    vkGetImageMemoryRequirements(m_device->Get(), image.image, &image.requirements);
+}
+
+void RenderTargetPool::CreateImageViews(PooledImage &image) noexcept {
+    for (auto &target : image.targets) {
+        const AttachmentCreateInfo &create_info = target->create_info;
+        VkImageViewCreateInfo view_create_info{};
+        view_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        view_create_info.image = image.image;
+        view_create_info.viewType = create_info.texture_type == TextureType::TEXTURE_TYPE_3D ? VK_IMAGE_VIEW_TYPE_3D
+                                                                                             : VK_IMAGE_VIEW_TYPE_2D;
+        view_create_info.format = ToVkImageFormat(create_info.format);
+        view_create_info.subresourceRange = {GetAspect(create_info), 0, 1, 0, 1};
+        CHECK_VK_RESULT(vkCreateImageView(m_device->Get(), &view_create_info, nullptr, &target->image_view));
+        target->image = image.image;
+    }
+}
+
+void RenderTargetPool::LogStats() const noexcept {
+    constexpr f64 MB = 1024.0 * 1024.0;
+    // without aliasing every target has its own image and memory for the whole frame
+    u64 unaliased_bytes = 0, allocated_bytes = 0;
+    for (auto &image : m_images) {
+        unaliased_bytes += image.requirements.size * image.targets.size();
+    }
+    for (auto &slot : m_slots) {
+        allocated_bytes += slot.allocation.size;
+    }
+    // the bytes live at once peak where some target begins
+    u64 peak_live_bytes = 0;
+    for (auto &image : m_images) {
+        for (auto &begin : image.targets) {
+            u64 live_bytes = 0;
+            for (auto &other : m_images) {
+                for (auto &target : other.targets) {
+                    if (target->first_use <= begin->first_use && begin->first_use <= target->last_use) {
+                        live_bytes += other.requirements.size;
+                    }
+                }
+            }
+            peak_live_bytes = std::max(peak_live_bytes, live_bytes);
+        }
+    }
+    LOG_INFO("render targets: {} targets in {} images and {} memory blocks, {:.1f} MB per frame without aliasing, "
+             "{:.1f} MB allocated with aliasing, {:.1f} MB live at the peak",
+             m_target_names.size(), m_images.size(), m_slots.size(), unaliased_bytes / MB, allocated_bytes / MB,
+             peak_live_bytes / MB);
+    for (u32 s = 0; s < m_slots.size(); s++) {
+        std::string names;
+        for (u32 i : m_slots[s].images) {
+            for (auto &target : m_images[i].targets) {
+                names += (names.empty() ? "" : ", ") + target->create_info.name;
+            }
+        }
+        const MemoryAllocation &allocation = m_slots[s].allocation;
+        LOG_INFO("  memory block {}: {:.1f} MB {}, {}", s, allocation.size / MB,
+                 allocation.type == MemoryAllocationType::DEDICATED ? "dedicated" : "suballocated", names);
+    }
+}
+
+} // namespace Horizon
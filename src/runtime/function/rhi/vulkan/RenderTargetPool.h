@@ -0,0 +1,95 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "Attachment.h"
+#include "Device.h"
+#include "MemoryAllocator.h"
+
+namespace Horizon {
+
+class Framebuffer;
+
+// a named render target handed out by the pool, image and view are valid once the pool is built
+struct RenderTarget {
+    AttachmentCreateInfo create_info;
+    VkImage image = VK_NULL_HANDLE;
+    VkImageView image_view = VK_NULL_HANDLE;
+    // first and last scheduled pass touching the target, the whole frame if never set
+    u32 first_use = 0, last_use = ~0u;
+    u32 memory_slot = 0;
+};
+
+// render targets of the frame keyed by format, extent and usage. targets are requested by name while the pipelines
+// are created and only get memory in Build, once their lifetimes in the frame are known. targets with the same key
+// and disjoint lifetimes share one image, the remaining images share device memory when their lifetimes don't
+// overlap. later users of aliased memory clear or overwrite it, nothing may rely on its contents across owners.
+class RenderTargetPool {
+  public:
+    RenderTargetPool(std::shared_ptr<Device> device) noexcept;
+    ~RenderTargetPool() noexcept;
+    RenderTargetPool(const RenderTargetPool &) = delete;
+    RenderTargetPool(RenderTargetPool &&) = delete;
+    RenderTargetPool &operator=(const RenderTargetPool &) = delete;
+    RenderTargetPool &operator=(RenderTargetPool &&) = delete;
+
+    // the same name returns the same target
+    std::shared_ptr<RenderTarget> Request(const AttachmentCreateInfo &create_info) noexcept;
+
+    std::vector<std::string> GetTargetNames() const noexcept;
+
+    void SetLifetime(const std::string &name, u32 first_use, u32 last_use) noexcept;
+
+    // framebuffers of pool targets, Build creates their VkFramebuffer once the views exist
+    void AddFramebuffer(Framebuffer *framebuffer) noexcept;
+    void RemoveFramebuffer(Framebuffer *framebuffer) noexcept;
+
+    // creates the images, views and framebuffers and binds the images to aliased memory, aborts when the memory
+    // can't be allocated
+    void Build() noexcept;
+
+    bool IsBuilt() const noexcept { return m_built; }
+
+    // targets in the same slot share device memory and must never be live at the same time
+    u32 GetMemorySlot(const std::string &name) const noexcept;
+
+    // render target memory per frame without aliasing, the memory actually allocated for the pool, and the peak of
+    // bytes live at the same time
+    void LogStats() const noexcept;
+
+  private:
+    // an image shared by targets of the same key
+    struct PooledImage {
+        VkImage image = VK_NULL_HANDLE;
+        VkMemoryRequirements requirements{};
+        std::vector<std::shared_ptr<RenderTarget>> targets;
+    };
+
+    // device memory shared by images with disjoint lifetimes
+    struct MemorySlot {
+        MemoryAllocation allocation;
+        VkMemoryRequirements requirements{};
+        std::vector<u32> images;
+    };
+
+    static bool Overlaps(const RenderTarget &a, const RenderTarget &b) noexcept;
+    bool Overlaps(const PooledImage &a, const PooledImage &b) const noexcept;
+    void CreateImage(PooledImage &image) noexcept;
+    void CreateImageViews(PooledImage &image) noexcept;
+
+  private:
+    std::shared_ptr<Device> m_device;
+    std::unordered_map<std::string, std::shared_ptr<RenderTarget>> m_targets;
+    std::vector<std::string> m_target_names; // request order
+    std::vector<PooledImage> m_images;
+    std::vector<MemorySlot> m_slots;
+    std::vector<Framebuffer *> m_framebuffers;
+    bool m_built = false;
+};
+
+} // namespace Horizon
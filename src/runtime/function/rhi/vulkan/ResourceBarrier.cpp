@@ -8,9 +8,16 @@ void InsertBarrier(u32 i, std::shared_ptr<CommandBuffer> command_buffer, const B
     VkPipelineStageFlags src_stage = ToVkPipelineStage(desc.src_stage);
     VkPipelineStageFlags dst_stage = ToVkPipelineStage(desc.dst_stage);
 
+    std::vector<VkMemoryBarrier> memory_barriers(desc.memory_barriers.size());
     std::vector<VkBufferMemoryBarrier> buffer_memory_barriers(desc.buffer_memory_barriers.size());
     std::vector<VkImageMemoryBarrier> image_memory_barriers(desc.image_memory_barriers.size());
 
+    for (u32 i = 0; i < desc.memory_barriers.size(); i++) {
+        memory_barriers[i].sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        memory_barriers[i].srcAccessMask = ToVkMemoryAccessFlags(desc.memory_barriers[i].src_access_mask);
+        memory_barriers[i].dstAccessMask = ToVkMemoryAccessFlags(desc.memory_barriers[i].dst_access_mask);
+    }
+
     for (u32 i = 0; i < desc.buffer_memory_barriers.size(); i++) {
         buffer_memory_barriers[i].sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
         buffer_memory_barriers[i].srcAccessMask = ToVkMemoryAccessFlags(desc.buffer_memory_barriers[i].src_access_mask);
@@ -30,8 +37,8 @@ void InsertBarrier(u32 i, std::shared_ptr<CommandBuffer> command_buffer, const B
         image_memory_barriers[i].subresourceRange = desc.image_memory_barriers[i].texture->GetSubresourceRange();
     }
 
-    vkCmdPipelineBarrier(command_buffer->Get(i), src_stage, dst_stage, 0, 0, nullptr,
-                         desc.buffer_memory_barriers.size(), buffer_memory_barriers.data(),
+    vkCmdPipelineBarrier(command_buffer->Get(i), src_stage, dst_stage, 0, desc.memory_barriers.size(),
+                         memory_barriers.data(), desc.buffer_memory_barriers.size(), buffer_memory_barriers.data(),
                          desc.image_memory_barriers.size(), image_memory_barriers.data());
 }
 
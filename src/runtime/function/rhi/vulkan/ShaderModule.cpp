@@ -7,34 +7,48 @@
 
 namespace Horizon {
 
-Shader::Shader(VkDevice device, const std::string &path) : m_device(device) {
-    std::vector<char> code = readFile(path);
-    if (code.empty()) {
-        LOG_ERROR("shader code in {} is empty", path);
+Shader::Shader(VkDevice device, const std::string &path) : m_device(device), m_path(path) {}
+
+Shader::~Shader() { vkDestroyShaderModule(m_device, m_shader_module, nullptr); }
+
+VkShaderModule Shader::Get() const noexcept {
+    // several pipelines may share a shader and compile at the same time
+    std::call_once(m_created, [this]() { CreateShaderModule(); });
+    return m_shader_module;
+}
+
+bool Shader::CreateShaderModule() const noexcept {
+    // runs on pool threads, a missing shader must not throw
+    std::vector<char> code = readFile(m_path);
+    if (code.empty() || code.size() % sizeof(u32) != 0) {
+        LOG_ERROR("shader code in {} is empty or not spirv", m_path);
+        return false;
     }
     VkShaderModuleCreateInfo shaderModuleCreateInfo{};
     shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
     shaderModuleCreateInfo.codeSize = code.size();
     shaderModuleCreateInfo.pCode = reinterpret_cast<const u32 *>(code.data());
     CHECK_VK_RESULT(vkCreateShaderModule(m_device, &shaderModuleCreateInfo, nullptr, &m_shader_module));
+    return m_shader_module != VK_NULL_HANDLE;
 }
 
-Shader::~Shader() { vkDestroyShaderModule(m_device, m_shader_module, nullptr); }
-
-VkShaderModule Shader::Get() const noexcept { return m_shader_module; }
-
-std::vector<char> Shader::readFile(const std::string &path) {
+std::vector<char> Shader::readFile(const std::string &path) const noexcept {
 
     std::ifstream file(path, std::ios::ate | std::ios::binary);
     if (!file.is_open()) {
         LOG_ERROR("failed to open shader file: {}", path);
+        return {};
+    }
+    std::streamoff fileSize = file.tellg();
+    if (fileSize <= 0) {
+        return {};
     }
-    size_t fileSize = (size_t)file.tellg();
-    std::vector<char> buffer(fileSize);
+    std::vector<char> buffer(static_cast<size_t>(fileSize));
     file.seekg(0);
-    file.read(buffer.data(), fileSize);
-    file.close();
-
+    if (!file.read(buffer.data(), fileSize)) {
+        LOG_ERROR("failed to read shader file: {}", path);
+        return {};
+    }
     return buffer;
 }
 
@@ -1,21 +1,28 @@
 #pragma once
 
 #include <runtime/function/rhi/vulkan/VulkanEnums.h>
+#include <mutex>
 #include <string>
 
 namespace Horizon {
 
+// the spirv is read and the module created on the first Get(), which happens on the thread compiling the pipeline
 class Shader {
   public:
     Shader(VkDevice device, const std::string &path);
     ~Shader();
+    // VK_NULL_HANDLE when the spirv is missing or empty, the error is logged once
     VkShaderModule Get() const noexcept;
 
   private:
-    std::vector<char> readFile(const std::string &path);
+    bool CreateShaderModule() const noexcept;
+    // empty when the file can't be read
+    std::vector<char> readFile(const std::string &path) const noexcept;
 
   private:
-    VkShaderModule m_shader_module;
+    mutable VkShaderModule m_shader_module = VK_NULL_HANDLE;
+    mutable std::once_flag m_created;
     VkDevice m_device;
+    std::string m_path;
 };
 } // namespace Horizon
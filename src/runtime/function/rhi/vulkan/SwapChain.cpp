@@ -10,7 +10,11 @@
 namespace Horizon {
 SwapChain::SwapChain(RenderContext &render_context, std::shared_ptr<Device> device, std::shared_ptr<Surface> surface)
     : m_render_context(render_context), m_device(device), m_surface(surface) {
-    createSwapChain();
+    if (m_surface) {
+        createSwapChain();
+    } else {
+        createOffscreenImages();
+    }
 
     createImageViews();
 }
@@ -28,7 +32,11 @@ VkFormat SwapChain::getImageFormat() const noexcept { return mImageFormat; }
 void SwapChain::recreate(VkExtent2D newExtent) {
     cleanup();
 
-    createSwapChain();
+    if (m_surface) {
+        createSwapChain();
+    } else {
+        createOffscreenImages();
+    }
 
     createImageViews();
 }
@@ -83,6 +91,32 @@ void SwapChain::createSwapChain() {
     vkGetSwapchainImagesKHR(m_device->Get(), m_swap_chain, &imag_count, images.data()); // Get images
 }
 
+void SwapChain::createOffscreenImages() {
+    mImageFormat = PREFERRED_PRESENT_FORMAT.format;
+
+    VkImageCreateInfo image_create_info{};
+    image_create_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    image_create_info.imageType = VK_IMAGE_TYPE_2D;
+    image_create_info.format = mImageFormat;
+    image_create_info.extent = {m_render_context.width, m_render_context.height, 1};
+    image_create_info.mipLevels = 1;
+    image_create_info.arrayLayers = 1;
+    image_create_info.samples = VK_SAMPLE_COUNT_1_BIT;
+    image_create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    // same usage as the swap chain images, transfer source for image dumps
+    image_create_info.usage =
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    image_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    image_create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    images.resize(m_render_context.swap_chain_image_count);
+    m_offscreen_memory.resize(m_render_context.swap_chain_image_count);
+    for (u32 i = 0; i < m_render_context.swap_chain_image_count; i++) {
+        CHECK_VK_RESULT(m_device->GetMemoryAllocator()->CreateImage(
+            image_create_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, images[i], m_offscreen_memory[i]));
+    }
+}
+
 VkSurfaceFormatKHR SwapChain::chooseSurfaceFormat(std::vector<VkSurfaceFormatKHR> availableFormats) const noexcept {
     // force predefined format
     VkSurfaceFormatKHR ret{};
@@ -137,9 +171,18 @@ u32 SwapChain::chooseMinImageCount(VkSurfaceCapabilitiesKHR capabilities) {
 
 void SwapChain::cleanup() {
     for (auto &imageView : imageViews) {
+        m_device->GetDescriptorAllocator()->Invalidate(imageView);
         vkDestroyImageView(m_device->Get(), imageView, nullptr);
     }
-    vkDestroySwapchainKHR(m_device->Get(), m_swap_chain, nullptr);
+    if (m_surface) {
+        vkDestroySwapchainKHR(m_device->Get(), m_swap_chain, nullptr);
+        return;
+    }
+    for (u32 i = 0; i < images.size(); i++) {
+        m_device->GetMemoryAllocator()->DestroyImage(images[i], m_offscreen_memory[i]);
+    }
+    images.clear();
+    m_offscreen_memory.clear();
 }
 
 void SwapChain::createImageViews() {
@@ -12,6 +12,8 @@
 
 namespace Horizon {
 
+// without a surface the swap chain is headless, it owns offscreen images in the present format which are used in
+// turn like acquired images and are never presented
 class SwapChain {
 
   public:
@@ -19,8 +21,13 @@ class SwapChain {
 
     ~SwapChain();
 
+    // VK_NULL_HANDLE when headless
     VkSwapchainKHR Get() const noexcept;
 
+    bool IsHeadless() const noexcept { return !m_surface; }
+
+    VkImage getImage(u32 i) const noexcept { return images[i]; }
+
     std::vector<VkImageView> getImageViews() const noexcept;
 
     VkImageView getImageView(u32 i) const noexcept;
@@ -32,6 +39,8 @@ class SwapChain {
   private:
     void createSwapChain();
 
+    void createOffscreenImages();
+
     VkSurfaceFormatKHR chooseSurfaceFormat(std::vector<VkSurfaceFormatKHR> availableFormats) const noexcept;
 
     VkPresentModeKHR choosePresentMode(std::vector<VkPresentModeKHR> availablePresentModes) const noexcept;
@@ -52,7 +61,9 @@ class SwapChain {
     std::shared_ptr<Device> m_device = nullptr;
     std::shared_ptr<Surface> m_surface = nullptr;
     std::shared_ptr<Window> m_window = nullptr;
-    VkSwapchainKHR m_swap_chain;
+    VkSwapchainKHR m_swap_chain = VK_NULL_HANDLE;
+    // memory of the headless images
+    std::vector<MemoryAllocation> m_offscreen_memory;
     //VkExtent2D mExtent;	// swap extent is the resolution of swap chain images
     VkFormat mImageFormat;
     std::vector<VkImage> images; // handle of swapchain images
@@ -1,5 +1,7 @@
 #include "Texture.h"
 
+#include <cstring>
+
 #include <stb_image.h>
 
 #include <runtime/core/log/Log.h>
@@ -8,49 +10,77 @@
 
 namespace Horizon {
 
+namespace {
+
+size_t BytesPerChannel(const tinygltf::Image &image) noexcept {
+    if (image.bits == 8 && image.pixel_type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE) {
+        return 1;
+    }
+    if (image.bits == 16 && image.pixel_type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT) {
+        return 2;
+    }
+    return 0;
+}
+
+// 1-4 channel 8/16 bit images whose pixel data matches the declared size, images that failed to decode have
+// negative dimensions and no data
+bool IsSupportedImage(const tinygltf::Image &image) noexcept {
+    size_t bytes_per_channel = BytesPerChannel(image);
+    if (bytes_per_channel == 0 || image.component < 1 || image.component > 4 || image.width <= 0 ||
+        image.height <= 0) {
+        return false;
+    }
+    size_t pixel_count = static_cast<size_t>(image.width) * static_cast<size_t>(image.height);
+    return image.image.size() == pixel_count * static_cast<size_t>(image.component) * bytes_per_channel;
+}
+
+// expands a supported image to rgba8, grey is replicated and missing alpha is opaque
+void ConvertToRgba8(const tinygltf::Image &image, unsigned char *rgba) noexcept {
+    size_t bytes_per_channel = BytesPerChannel(image);
+    size_t channels = static_cast<size_t>(image.component);
+    if (channels == 4 && bytes_per_channel == 1) {
+        memcpy(rgba, image.image.data(), image.image.size());
+        return;
+    }
+
+    size_t pixel_count = static_cast<size_t>(image.width) * static_cast<size_t>(image.height);
+    const unsigned char *src = image.image.data();
+    for (size_t i = 0; i < pixel_count; ++i, rgba += 4, src += channels * bytes_per_channel) {
+        unsigned char texel[4] = {0, 0, 0, 255};
+        for (size_t c = 0; c < channels; ++c) {
+            // keep the high byte of little endian 16 bit channels
+            texel[c] = src[c * bytes_per_channel + bytes_per_channel - 1];
+        }
+        if (channels == 1) {
+            texel[1] = texel[2] = texel[0];
+        } else if (channels == 2) {
+            // grey + alpha
+            texel[3] = texel[1];
+            texel[1] = texel[2] = texel[0];
+        }
+        memcpy(rgba, texel, 4);
+    }
+}
+
+} // namespace
+
 Texture::Texture(std::shared_ptr<Device> device, std::shared_ptr<CommandBuffer> command_buffer)
     : m_device(device), m_command_buffer(command_buffer) {}
 
 Texture::Texture(std::shared_ptr<Device> device, std::shared_ptr<CommandBuffer> command_buffer,
                  tinygltf::Image &gltfimage)
     : m_device(device), m_command_buffer(command_buffer) {
-    u8 *buffer = nullptr;
-    VkDeviceSize buffer_size = 0;
-    bool deleteBuffer = false;
-    if (gltfimage.component == 3) {
-        // Most devices don't support RGB only on Vulkan so convert if necessary
-        // TODO(hyl5): Check actual format support and transform only if required
-        buffer_size = gltfimage.width * gltfimage.height * 4;
-        buffer = new unsigned char[buffer_size];
-        unsigned char *rgba = buffer;
-        unsigned char *rgb = &gltfimage.image[0];
-        for (int32_t i = 0; i < gltfimage.width * gltfimage.height; ++i) {
-            for (int32_t j = 0; j < 3; ++j) {
-                rgba[j] = rgb[j];
-            }
-            rgba += 4;
-            rgb += 3;
-        }
-        deleteBuffer = true;
+    bool supported = IsSupportedImage(gltfimage);
+    if (supported) {
+        texWidth = gltfimage.width;
+        texHeight = gltfimage.height;
     } else {
-        buffer = &gltfimage.image[0];
-        buffer_size = gltfimage.image.size();
+        // fall back to a 1x1 opaque white texture so the material is still valid to sample
+        LOG_ERROR("unsupported gltf image {}: {}x{}, {} components, {} bits, {} bytes", gltfimage.uri,
+                  gltfimage.width, gltfimage.height, gltfimage.component, gltfimage.bits, gltfimage.image.size());
+        texWidth = 1;
+        texHeight = 1;
     }
-    texWidth = gltfimage.width;
-    texHeight = gltfimage.height;
-
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    vk_createBuffer(m_device->Get(), m_device->getPhysicalDevice(), buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer,
-                    stagingBufferMemory);
-
-    void *data;
-    vkMapMemory(m_device->Get(), stagingBufferMemory, 0, buffer_size, 0, &data);
-    memcpy(data, buffer, static_cast<size_t>(buffer_size));
-    vkUnmapMemory(m_device->Get(), stagingBufferMemory);
-
-    //stbi_image_free(buffer);
 
     // create image
     VkImageCreateInfo image_create_info{};
@@ -69,27 +99,23 @@ Texture::Texture(std::shared_ptr<Device> device, std::shared_ptr<CommandBuffer>
     image_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     image_create_info.samples = VK_SAMPLE_COUNT_1_BIT;
 
-    CHECK_VK_RESULT(vkCreateImage(m_device->Get(), &image_create_info, nullptr, &m_image));
-
-    VkMemoryRequirements memRequirements;
-    vkGetImageMemoryRequirements(m_device->Get(), m_image, &memRequirements);
-
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = FindMemoryType(m_device->getPhysicalDevice(), memRequirements.memoryTypeBits,
-                                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-    CHECK_VK_RESULT(vkAllocateMemory(m_device->Get(), &allocInfo, nullptr, &m_image_memory));
-
-    vkBindImageMemory(m_device->Get(), m_image, m_image_memory, 0);
-
-    transitionImageLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    copyBufferToImage(stagingBuffer, m_image, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
-    transitionImageLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-    vkDestroyBuffer(m_device->Get(), stagingBuffer, nullptr);
-    vkFreeMemory(m_device->Get(), stagingBufferMemory, nullptr);
+    CHECK_VK_RESULT(m_device->GetMemoryAllocator()->CreateImage(image_create_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                                m_image, m_image_memory));
+
+    // stage straight into the upload ring, the copy is batched with the other textures of the model
+    std::shared_ptr<UploadManager> upload_manager = m_command_buffer->GetUploadManager();
+    VkDeviceSize buffer_size = static_cast<VkDeviceSize>(texWidth) * texHeight * 4;
+    StagingAllocation staging = upload_manager->AllocateStaging(buffer_size);
+    if (staging.data) {
+        unsigned char *rgba = static_cast<unsigned char *>(staging.data);
+        if (supported) {
+            ConvertToRgba8(gltfimage, rgba);
+        } else {
+            memset(rgba, 0xff, static_cast<size_t>(buffer_size));
+        }
+        upload_manager->CopyToImage(staging, m_image, static_cast<uint32_t>(texWidth),
+                                    static_cast<uint32_t>(texHeight), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
 
     createImageView(VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_VIEW_TYPE_2D);
 
@@ -137,20 +163,8 @@ Texture::Texture(std::shared_ptr<Device> device, std::shared_ptr<CommandBuffer>
     image_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     image_create_info.samples = VK_SAMPLE_COUNT_1_BIT;
 
-    CHECK_VK_RESULT(vkCreateImage(m_device->Get(), &image_create_info, nullptr, &m_image));
-
-    VkMemoryRequirements memRequirements;
-    vkGetImageMemoryRequirements(m_device->Get(), m_image, &memRequirements);
-
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = FindMemoryType(m_device->getPhysicalDevice(), memRequirements.memoryTypeBits,
-                                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-    CHECK_VK_RESULT(vkAllocateMemory(m_device->Get(), &allocInfo, nullptr, &m_image_memory));
-
-    vkBindImageMemory(m_device->Get(), m_image, m_image_memory, 0);
+    CHECK_VK_RESULT(m_device->GetMemoryAllocator()->CreateImage(image_create_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                                m_image, m_image_memory));
 
     if (create_info.texture_usage & TextureUsage::TEXTURE_USAGE_RW) {
 
@@ -193,34 +207,25 @@ Texture::Texture(std::shared_ptr<Device> device, std::shared_ptr<CommandBuffer>
 }
 
 Texture::~Texture() {
-    vkDestroyImage(m_device->Get(), m_image, nullptr);
+    m_device->GetDescriptorAllocator()->Invalidate(m_image_view);
+    m_device->GetDescriptorAllocator()->Invalidate(m_sampler);
     vkDestroyImageView(m_device->Get(), m_image_view, nullptr);
     vkDestroySampler(m_device->Get(), m_sampler, nullptr);
-    vkFreeMemory(m_device->Get(), m_image_memory, nullptr);
+    m_device->GetMemoryAllocator()->DestroyImage(m_image, m_image_memory);
 }
 
 void Texture::loadFromFile(const std::string &path, VkImageUsageFlags usage, VkImageLayout layout) {
     buffer = stbi_load(path.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
     texChannels = 4;
-    VkDeviceSize imageSize = texWidth * texHeight * texChannels;
 
+    // a missing image still gets a 1x1 opaque white texture, materials bind its view and sampler unconditionally
+    const u8 white[4] = {0xff, 0xff, 0xff, 0xff};
     if (!buffer) {
         LOG_ERROR("failed to load texture image {}", path);
-        return;
+        texWidth = 1;
+        texHeight = 1;
     }
-
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    vk_createBuffer(m_device->Get(), m_device->getPhysicalDevice(), imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer,
-                    stagingBufferMemory);
-
-    void *data;
-    vkMapMemory(m_device->Get(), stagingBufferMemory, 0, imageSize, 0, &data);
-    memcpy(data, buffer, static_cast<size_t>(imageSize));
-    vkUnmapMemory(m_device->Get(), stagingBufferMemory);
-
-    stbi_image_free(buffer);
+    VkDeviceSize imageSize = static_cast<VkDeviceSize>(texWidth) * texHeight * texChannels;
 
     // create image
     VkImageCreateInfo image_create_info{};
@@ -238,27 +243,16 @@ void Texture::loadFromFile(const std::string &path, VkImageUsageFlags usage, VkI
     image_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     image_create_info.samples = VK_SAMPLE_COUNT_1_BIT;
 
-    CHECK_VK_RESULT(vkCreateImage(m_device->Get(), &image_create_info, nullptr, &m_image));
-
-    VkMemoryRequirements memRequirements;
-    vkGetImageMemoryRequirements(m_device->Get(), m_image, &memRequirements);
+    CHECK_VK_RESULT(m_device->GetMemoryAllocator()->CreateImage(image_create_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                                m_image, m_image_memory));
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = FindMemoryType(m_device->getPhysicalDevice(), memRequirements.memoryTypeBits,
-                                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-    CHECK_VK_RESULT(vkAllocateMemory(m_device->Get(), &allocInfo, nullptr, &m_image_memory));
-
-    vkBindImageMemory(m_device->Get(), m_image, m_image_memory, 0);
-
-    transitionImageLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    copyBufferToImage(stagingBuffer, m_image, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
-    transitionImageLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, layout);
-
-    vkDestroyBuffer(m_device->Get(), stagingBuffer, nullptr);
-    vkFreeMemory(m_device->Get(), stagingBufferMemory, nullptr);
+    m_command_buffer->GetUploadManager()->UploadImage(m_image, buffer ? buffer : white, imageSize,
+                                                      static_cast<uint32_t>(texWidth),
+                                                      static_cast<uint32_t>(texHeight), layout);
+    if (buffer) {
+        stbi_image_free(buffer);
+        buffer = nullptr;
+    }
 
     createImageView(VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_VIEW_TYPE_2D);
     createSampler();
@@ -370,8 +364,9 @@ void Texture::createSampler() {
 }
 
 void Texture::destroy() {
+    m_device->GetDescriptorAllocator()->Invalidate(m_image_view);
     vkDestroyImageView(m_device->Get(), m_image_view, nullptr);
-    vkDestroyImage(m_device->Get(), m_image, nullptr);
-    vkFreeMemory(m_device->Get(), m_image_memory, nullptr);
+    m_image_view = VK_NULL_HANDLE;
+    m_device->GetMemoryAllocator()->DestroyImage(m_image, m_image_memory);
 }
 } // namespace Horizon
@@ -37,10 +37,10 @@ class Texture : public DescriptorBase {
     u8 *buffer = nullptr;
     i32 texWidth, texHeight, texChannels;
     u32 mipLevels;
-    VkImage m_image;
-    VkDeviceMemory m_image_memory;
-    VkImageView m_image_view;
-    VkSampler m_sampler;
+    VkImage m_image = VK_NULL_HANDLE;
+    MemoryAllocation m_image_memory;
+    VkImageView m_image_view = VK_NULL_HANDLE;
+    VkSampler m_sampler = VK_NULL_HANDLE;
     VkImageSubresourceRange subresource_range;
     VkDescriptorImageInfo mDescriptorImageInfo;
 };
@@ -0,0 +1,57 @@
+#include "UniformAllocator.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include <runtime/core/log/Log.h>
+
+namespace Horizon {
+
+namespace {
+
+u64 AlignUp(u64 value, u64 alignment) noexcept { return (value + alignment - 1) & ~(alignment - 1); }
+
+} // namespace
+
+UniformAllocator::UniformAllocator(VkPhysicalDevice physical_device, MemoryAllocator *memory_allocator,
+                                   u64 frame_region_size) noexcept
+    : m_memory_allocator(memory_allocator) {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physical_device, &properties);
+    m_alignment = std::max<u64>(properties.limits.minUniformBufferOffsetAlignment, 16);
+    m_region_size = AlignUp(frame_region_size, m_alignment);
+
+    VkBufferCreateInfo buffer_create_info{};
+    buffer_create_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buffer_create_info.size = m_region_size * MAX_FRAMES_IN_FLIGHT;
+    buffer_create_info.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+    buffer_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    CHECK_VK_RESULT(m_memory_allocator->CreateBuffer(
+        buffer_create_info, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_buffer,
+        m_allocation));
+}
+
+UniformAllocator::~UniformAllocator() noexcept { m_memory_allocator->DestroyBuffer(m_buffer, m_allocation); }
+
+void UniformAllocator::BeginFrame(u32 frame_index) noexcept {
+    m_region_begin = static_cast<u64>(frame_index % MAX_FRAMES_IN_FLIGHT) * m_region_size;
+    m_head.store(m_region_begin);
+}
+
+UniformAllocation UniformAllocator::Allocate(u64 size) noexcept {
+    UniformAllocation allocation{};
+    u64 aligned_size = AlignUp(size, m_alignment);
+    u64 offset = m_head.fetch_add(aligned_size);
+    if (offset + aligned_size > m_region_begin + m_region_size) {
+        // wrapping would overwrite uniforms this frame has already recorded, growing would invalidate the dynamic
+        // descriptors that point at the buffer
+        LOG_ERROR("uniform ring exhausted, {} bytes requested with {} of {} bytes per frame in use", size,
+                  offset - m_region_begin, m_region_size);
+        std::abort();
+    }
+    allocation.data = static_cast<u8 *>(m_allocation.mapped) + offset;
+    allocation.offset = static_cast<u32>(offset);
+    return allocation;
+}
+
+} // namespace Horizon
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+
+#include <vulkan/vulkan.hpp>
+
+#include "MemoryAllocator.h"
+#include <runtime/function/rhi/RenderContext.h>
+
+namespace Horizon {
+
+struct UniformAllocation {
+    void *data = nullptr;
+    u32 offset = 0;
+};
+
+// one persistently mapped uniform buffer split into MAX_FRAMES_IN_FLIGHT regions. every frame bumps allocations out
+// of its own region and hands out dynamic offsets, a region is only rewound once the frame that used it has
+// retired, so the gpu never reads a slice the cpu is writing. Allocate is thread safe. running out of a frame's region
+// aborts, size it with frame_region_size.
+class UniformAllocator {
+  public:
+    UniformAllocator(VkPhysicalDevice physical_device, MemoryAllocator *memory_allocator,
+                     u64 frame_region_size = 4 * 1024 * 1024) noexcept;
+    ~UniformAllocator() noexcept;
+    UniformAllocator(const UniformAllocator &) = delete;
+    UniformAllocator &operator=(const UniformAllocator &) = delete;
+
+    // rewind the region of frame_index, the caller must have waited on that frame's fence
+    void BeginFrame(u32 frame_index) noexcept;
+    UniformAllocation Allocate(u64 size) noexcept;
+
+    VkBuffer GetBuffer() const noexcept { return m_buffer; }
+    // bytes handed out in the current frame
+    u64 GetFrameUsage() const noexcept { return m_head.load() - m_region_begin; }
+
+  private:
+    MemoryAllocator *m_memory_allocator = nullptr;
+    VkBuffer m_buffer = VK_NULL_HANDLE;
+    MemoryAllocation m_allocation;
+    u64 m_alignment = 256;
+    u64 m_region_size = 0;
+    u64 m_region_begin = 0;
+    std::atomic<u64> m_head{0};
+};
+
+} // namespace Horizon
@@ -4,27 +4,19 @@ namespace Horizon {
 
 UniformBuffer::UniformBuffer(std::shared_ptr<Device> device) : m_device(device) {}
 
-UniformBuffer::~UniformBuffer() {
-    vkDestroyBuffer(m_device->Get(), m_uniform_buffer, nullptr);
-    vkFreeMemory(m_device->Get(), m_uniform_buffer_memory, nullptr);
-}
+UniformBuffer::~UniformBuffer() {}
 
 void UniformBuffer::update(void *Ub, u64 buffer_size) {
-    if (!m_uniform_buffer) {
-        vk_createBuffer(m_device->Get(), m_device->getPhysicalDevice(), buffer_size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_uniform_buffer,
-                        m_uniform_buffer_memory);
-        m_size = buffer_size;
-        bufferDescriptrInfo.buffer = m_uniform_buffer;
-        bufferDescriptrInfo.offset = 0;
-        bufferDescriptrInfo.range = buffer_size;
-    }
-    void *data;
-    vkMapMemory(m_device->Get(), m_uniform_buffer_memory, 0, buffer_size, 0, &data);
-    memcpy(data, Ub, buffer_size);
-    vkUnmapMemory(m_device->Get(), m_uniform_buffer_memory);
+    UniformAllocation allocation = m_device->GetUniformAllocator()->Allocate(buffer_size);
+    memcpy(allocation.data, Ub, buffer_size);
+    m_size = buffer_size;
+    // the descriptor always points at the start of the ring, the slice is selected by the dynamic offset
+    bufferDescriptrInfo.buffer = m_device->GetUniformAllocator()->GetBuffer();
+    bufferDescriptrInfo.offset = 0;
+    bufferDescriptrInfo.range = buffer_size;
+    dynamicOffset = allocation.offset;
 }
 
-VkBuffer UniformBuffer::Get() const noexcept { return m_uniform_buffer; }
+VkBuffer UniformBuffer::Get() const noexcept { return m_device->GetUniformAllocator()->GetBuffer(); }
 u64 UniformBuffer::size() const noexcept { return m_size; }
-} // namespace Horizon
\ No newline at end of file
+} // namespace Horizon
@@ -8,6 +8,9 @@
 #include <runtime/function/rhi/RenderContext.h>
 
 namespace Horizon {
+// a slice of the device's per frame uniform ring, bound as a dynamic uniform buffer. every update() writes a fresh
+// slice so frames still in flight keep reading their own copy, which means a uniform buffer has to be updated in
+// every frame it is bound.
 class UniformBuffer : public DescriptorBase {
   public:
     UniformBuffer(std::shared_ptr<Device>);
@@ -18,9 +21,7 @@ class UniformBuffer : public DescriptorBase {
 
   private:
     std::shared_ptr<Device> m_device = nullptr;
-    VkBuffer m_uniform_buffer = VK_NULL_HANDLE;
-    VkDeviceMemory m_uniform_buffer_memory = VK_NULL_HANDLE;
-    u64 m_size;
+    u64 m_size = 0;
 };
 
-} // namespace Horizon
\ No newline at end of file
+} // namespace Horizon
@@ -0,0 +1,248 @@
+#include "UploadManager.h"
+
+#include <cstring>
+
+#include <runtime/core/log/Log.h>
+
+#include "VulkanBuffer.h"
+
+namespace Horizon {
+
+namespace {
+
+constexpr u64 STAGING_ALIGNMENT = 16;
+
+u64 AlignUp(u64 value, u64 alignment) noexcept { return (value + alignment - 1) & ~(alignment - 1); }
+
+} // namespace
+
+UploadManager::UploadManager(std::shared_ptr<Device> device, u64 staging_size) noexcept
+    : m_device(device), m_ring_size(AlignUp(staging_size, STAGING_ALIGNMENT)) {
+    VkCommandPoolCreateInfo command_pool_create_info{};
+    command_pool_create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    command_pool_create_info.queueFamilyIndex = m_device->getQueueFamilyIndices().getGraphics();
+    command_pool_create_info.flags =
+        VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    CHECK_VK_RESULT(vkCreateCommandPool(m_device->Get(), &command_pool_create_info, nullptr, &m_command_pool));
+
+    vk_createBuffer(m_device, m_ring_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_staging_buffer,
+                    m_staging_memory);
+    // persistently mapped by the allocator for the lifetime of the manager
+    m_staging_data = static_cast<u8 *>(m_staging_memory.mapped);
+}
+
+UploadManager::~UploadManager() noexcept {
+    WaitIdle();
+    for (auto &batch : m_free_batches) {
+        vkDestroyFence(m_device->Get(), batch.fence, nullptr);
+    }
+    if (m_current.fence) {
+        vkDestroyFence(m_device->Get(), m_current.fence, nullptr);
+    }
+    vk_destroyBuffer(m_device, m_staging_buffer, m_staging_memory);
+    // command buffers are freed with the pool
+    vkDestroyCommandPool(m_device->Get(), m_command_pool, nullptr);
+}
+
+StagingAllocation UploadManager::AllocateStaging(u64 size) noexcept {
+    StagingAllocation allocation{};
+    m_stats.bytes += size;
+    size = AlignUp(size, STAGING_ALIGNMENT);
+
+    // too large for the ring, give it a buffer of its own which dies with the batch
+    if (size > m_ring_size) {
+        VkBuffer buffer;
+        MemoryAllocation memory;
+        vk_createBuffer(m_device, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, buffer, memory,
+                        true);
+        allocation.data = memory.mapped;
+        GetCommandBuffer();
+        m_current.dedicated_buffers.emplace_back(buffer, memory);
+        allocation.buffer = buffer;
+        allocation.offset = 0;
+        return allocation;
+    }
+
+    RetireCompletedBatches();
+    u64 offset = 0;
+    while (!TryAllocate(size, offset)) {
+        // ring is full, submit what we have and wait for the oldest batch to free its range
+        if (m_pending.empty()) {
+            Flush();
+        }
+        if (m_pending.empty()) {
+            LOG_ERROR("failed to allocate {} bytes of staging memory", size);
+            return allocation;
+        }
+        m_stats.stalls++;
+        RetireBatch();
+    }
+
+    GetCommandBuffer();
+    m_current_allocations++;
+    allocation.data = m_staging_data + offset;
+    allocation.buffer = m_staging_buffer;
+    allocation.offset = offset;
+    return allocation;
+}
+
+bool UploadManager::TryAllocate(u64 size, u64 &offset) noexcept {
+    if (m_ring_empty) {
+        m_head = m_tail = 0;
+    }
+    if (m_head > m_tail || m_ring_empty) {
+        // free space is [head, ring_size) and [0, tail)
+        if (m_head + size <= m_ring_size) {
+            offset = m_head;
+        } else if (size <= m_tail) {
+            offset = 0;
+        } else {
+            return false;
+        }
+    } else {
+        // free space is [head, tail)
+        if (m_head + size <= m_tail) {
+            offset = m_head;
+        } else {
+            return false;
+        }
+    }
+    m_head = offset + size;
+    m_ring_empty = false;
+    return true;
+}
+
+VkCommandBuffer UploadManager::GetCommandBuffer() noexcept {
+    if (m_current_recording) {
+        return m_current.command_buffer;
+    }
+    if (!m_current.command_buffer) {
+        if (!m_free_batches.empty()) {
+            m_current = std::move(m_free_batches.back());
+            m_free_batches.pop_back();
+        } else {
+            VkCommandBufferAllocateInfo alloc_info{};
+            alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            alloc_info.commandPool = m_command_pool;
+            alloc_info.commandBufferCount = 1;
+            CHECK_VK_RESULT(vkAllocateCommandBuffers(m_device->Get(), &alloc_info, &m_current.command_buffer));
+
+            VkFenceCreateInfo fence_info{};
+            fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+            CHECK_VK_RESULT(vkCreateFence(m_device->Get(), &fence_info, nullptr, &m_current.fence));
+        }
+    }
+
+    VkCommandBufferBeginInfo begin_info{};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    CHECK_VK_RESULT(vkBeginCommandBuffer(m_current.command_buffer, &begin_info));
+    m_current_recording = true;
+    return m_current.command_buffer;
+}
+
+void UploadManager::CopyToImage(const StagingAllocation &staging, VkImage image, u32 width, u32 height,
+                                VkImageLayout final_layout, u32 depth) noexcept {
+    VkCommandBuffer cmdbuf = GetCommandBuffer();
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmdbuf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+                         nullptr, 1, &barrier);
+
+    VkBufferImageCopy region{};
+    region.bufferOffset = staging.offset;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.imageOffset = {0, 0, 0};
+    region.imageExtent = {width, height, depth};
+    vkCmdCopyBufferToImage(cmdbuf, staging.buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = final_layout;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(cmdbuf, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr,
+                         0, nullptr, 1, &barrier);
+
+    m_stats.images++;
+}
+
+void UploadManager::UploadImage(VkImage image, const void *data, u64 size, u32 width, u32 height,
+                                VkImageLayout final_layout, u32 depth) noexcept {
+    StagingAllocation staging = AllocateStaging(size);
+    if (!staging.data) {
+        return;
+    }
+    memcpy(staging.data, data, static_cast<size_t>(size));
+    CopyToImage(staging, image, width, height, final_layout, depth);
+}
+
+void UploadManager::Flush() noexcept {
+    if (!m_current_recording) {
+        return;
+    }
+    CHECK_VK_RESULT(vkEndCommandBuffer(m_current.command_buffer));
+
+    VkSubmitInfo submit_info{};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &m_current.command_buffer;
+    CHECK_VK_RESULT(vkQueueSubmit(m_device->getGraphicQueue(), 1, &submit_info, m_current.fence));
+    m_stats.submits++;
+
+    m_current.ring_end = m_head;
+    m_pending.push_back(std::move(m_current));
+    m_current = Batch{};
+    m_current_recording = false;
+    m_current_allocations = 0;
+}
+
+void UploadManager::WaitIdle() noexcept {
+    Flush();
+    while (!m_pending.empty()) {
+        RetireBatch();
+    }
+}
+
+void UploadManager::RetireBatch() noexcept {
+    Batch batch = std::move(m_pending.front());
+    m_pending.pop_front();
+
+    vkWaitForFences(m_device->Get(), 1, &batch.fence, VK_TRUE, UINT64_MAX);
+    vkResetFences(m_device->Get(), 1, &batch.fence);
+    vkResetCommandBuffer(batch.command_buffer, 0);
+
+    for (auto &[buffer, memory] : batch.dedicated_buffers) {
+        vk_destroyBuffer(m_device, buffer, memory);
+    }
+    batch.dedicated_buffers.clear();
+
+    // batches retire in submission order, so everything before its end is free again
+    m_tail = batch.ring_end;
+    if (m_pending.empty() && m_current_allocations == 0) {
+        m_ring_empty = true;
+    }
+    m_free_batches.push_back(std::move(batch));
+}
+
+void UploadManager::RetireCompletedBatches() noexcept {
+    while (!m_pending.empty() && vkGetFenceStatus(m_device->Get(), m_pending.front().fence) == VK_SUCCESS) {
+        RetireBatch();
+    }
+}
+
+} // namespace Horizon
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "Device.h"
+#include <runtime/function/rhi/RenderContext.h>
+
+namespace Horizon {
+
+struct StagingAllocation {
+    void *data = nullptr;
+    VkBuffer buffer = VK_NULL_HANDLE;
+    u64 offset = 0;
+};
+
+struct UploadStats {
+    u64 images = 0;
+    u64 bytes = 0;
+    u64 submits = 0;
+    u64 stalls = 0;
+};
+
+// batches texture uploads through a persistently mapped staging ring, copies are recorded into one command buffer
+// and submitted together with a fence, ring space is reclaimed once that fence signals. uploads land on the
+// graphics queue so any frame submitted after Flush() sees the data. not thread safe.
+class UploadManager {
+  public:
+    UploadManager(std::shared_ptr<Device> device, u64 staging_size = 64 * 1024 * 1024) noexcept;
+    ~UploadManager() noexcept;
+    UploadManager(const UploadManager &) = delete;
+    UploadManager &operator=(const UploadManager &) = delete;
+
+    // reserve staging memory for the current batch, larger than the ring falls back to a dedicated buffer
+    StagingAllocation AllocateStaging(u64 size) noexcept;
+    // transition to transfer dst, copy from staging and transition to final_layout, depth is for 3d images
+    void CopyToImage(const StagingAllocation &staging, VkImage image, u32 width, u32 height, VkImageLayout final_layout,
+                     u32 depth = 1) noexcept;
+    void UploadImage(VkImage image, const void *data, u64 size, u32 width, u32 height, VkImageLayout final_layout,
+                     u32 depth = 1) noexcept;
+
+    // submit the recorded batch, does not wait
+    void Flush() noexcept;
+    // flush and wait for every batch to finish
+    void WaitIdle() noexcept;
+
+    const UploadStats &GetStats() const noexcept { return m_stats; }
+
+  private:
+    struct Batch {
+        VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        u64 ring_end = 0;
+        std::vector<std::pair<VkBuffer, MemoryAllocation>> dedicated_buffers;
+    };
+
+    bool TryAllocate(u64 size, u64 &offset) noexcept;
+    VkCommandBuffer GetCommandBuffer() noexcept;
+    void RetireBatch() noexcept;
+    void RetireCompletedBatches() noexcept;
+
+  private:
+    std::shared_ptr<Device> m_device = nullptr;
+    VkCommandPool m_command_pool = VK_NULL_HANDLE;
+
+    VkBuffer m_staging_buffer = VK_NULL_HANDLE;
+    MemoryAllocation m_staging_memory;
+    u8 *m_staging_data = nullptr;
+    u64 m_ring_size = 0;
+    u64 m_head = 0;
+    u64 m_tail = 0;
+    bool m_ring_empty = true;
+
+    Batch m_current{};
+    bool m_current_recording = false;
+    u32 m_current_allocations = 0;
+    std::deque<Batch> m_pending;
+    std::vector<Batch> m_free_batches;
+
+    UploadStats m_stats{};
+};
+
+} // namespace Horizon
@@ -73,12 +73,14 @@ void ValidationLayer::setupDebugMessenger(VkInstance instance) {
 
     CHECK_VK_RESULT(CreateDebugUtilsMessengerEXT(instance, &debugUtilsMessengerCreateInfo, nullptr, &debugMessenger));
 }
-std::vector<const char *> ValidationLayer::getRequiredExtensions() {
-    u32 glfwExtensionCount{0};
-    const char **glfwExtensions{};
-    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-    std::vector<const char *> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+std::vector<const char *> ValidationLayer::getRequiredExtensions(bool headless) {
+    std::vector<const char *> extensions;
+    if (!headless) {
+        u32 glfwExtensionCount{0};
+        const char **glfwExtensions{};
+        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+        extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    }
 
     if (enableValidationLayers) {
         extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -39,7 +39,8 @@ class ValidationLayer {
 
     void setupDebugMessenger(VkInstance instance);
 
-    std::vector<const char *> getRequiredExtensions();
+    // the window system's surface extensions are left out when headless
+    std::vector<const char *> getRequiredExtensions(bool headless = false);
     //private:
 
     VkDebugUtilsMessengerEXT debugMessenger{};
@@ -6,6 +6,9 @@
 
 namespace Horizon {
 struct Vertex {
+    // bump whenever the vertex layout changes, cooked mesh caches are keyed on it
+    static constexpr u32 LAYOUT_VERSION = 1;
+
     Math::vec3 pos;
     Math::vec3 normal;
     Math::vec2 uv0;
@@ -4,26 +4,26 @@
 namespace Horizon {
 VertexBuffer::VertexBuffer(std::shared_ptr<Device> device, std::shared_ptr<CommandBuffer> command_buffer,
                            const std::vector<Vertex> &vertices)
+    : VertexBuffer(device, command_buffer, vertices.data(), vertices.size()) {}
+
+VertexBuffer::VertexBuffer(std::shared_ptr<Device> device, std::shared_ptr<CommandBuffer> command_buffer,
+                           const Vertex *vertices, u64 vertices_count)
     : m_device(device) {
-    m_vertices_count = vertices.size();
-    VkDeviceSize buffer_size = sizeof(vertices[0]) * m_vertices_count;
+    m_vertices_count = vertices_count;
+    VkDeviceSize buffer_size = sizeof(Vertex) * m_vertices_count;
 
     // create stage buffer
     VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    vk_createBuffer(device->Get(), device->getPhysicalDevice(), buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+    MemoryAllocation stagingBufferMemory;
+    vk_createBuffer(device, buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer,
-                    stagingBufferMemory);
+                    stagingBufferMemory, true);
 
-    // upload cpu data
-    void *data;
-    vkMapMemory(m_device->Get(), stagingBufferMemory, 0, buffer_size, 0, &data);
-    memcpy(data, vertices.data(), buffer_size);
-    vkUnmapMemory(m_device->Get(), stagingBufferMemory);
+    // upload cpu data, staging memory stays mapped
+    memcpy(stagingBufferMemory.mapped, vertices, buffer_size);
 
     // create actual vertex buffer
-    vk_createBuffer(device->Get(), device->getPhysicalDevice(), buffer_size,
-                    VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+    vk_createBuffer(device, buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_vertex_buffer, m_vertex_buffer_memory);
 
     vk_copyBuffer(device, command_buffer, stagingBuffer, m_vertex_buffer, buffer_size);
@@ -40,8 +40,7 @@ VertexBuffer::VertexBuffer(std::shared_ptr<Device> device, std::shared_ptr<Comma
                          &bufferMemoryBarrier, 0, nullptr);
     command_buffer->endSingleTimeCommands(cmdbuf);
 
-    vkDestroyBuffer(device->Get(), stagingBuffer, nullptr);
-    vkFreeMemory(device->Get(), stagingBufferMemory, nullptr);
+    vk_destroyBuffer(device, stagingBuffer, stagingBufferMemory);
 }
 
 //VertexBuffer::VertexBuffer(const VertexBuffer&& rhs)
@@ -58,8 +57,7 @@ VertexBuffer::VertexBuffer(std::shared_ptr<Device> device, std::shared_ptr<Comma
 //}
 
 VertexBuffer::~VertexBuffer() {
-    vkDestroyBuffer(m_device->Get(), m_vertex_buffer, nullptr);
-    vkFreeMemory(m_device->Get(), m_vertex_buffer_memory, nullptr);
+    vk_destroyBuffer(m_device, m_vertex_buffer, m_vertex_buffer_memory);
 }
 
 VkBuffer VertexBuffer::Get() const noexcept { return m_vertex_buffer; }
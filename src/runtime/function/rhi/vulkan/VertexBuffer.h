@@ -12,6 +12,8 @@ class VertexBuffer {
     VertexBuffer() = default;
     VertexBuffer(std::shared_ptr<Device> device, std::shared_ptr<CommandBuffer> command_buffer,
                  const std::vector<Vertex> &vertices);
+    VertexBuffer(std::shared_ptr<Device> device, std::shared_ptr<CommandBuffer> command_buffer, const Vertex *vertices,
+                 u64 vertices_count);
     //VertexBuffer(const VertexBuffer&& rhs);
     //VertexBuffer& operator=(VertexBuffer&& rhs);
     ~VertexBuffer();
@@ -21,7 +23,7 @@ class VertexBuffer {
   private:
     std::shared_ptr<Device> m_device = nullptr;
     VkBuffer m_vertex_buffer;
-    VkDeviceMemory m_vertex_buffer_memory;
+    MemoryAllocation m_vertex_buffer_memory;
     u64 m_vertices_count;
 };
 } // namespace Horizon
\ No newline at end of file
@@ -3,29 +3,24 @@
 namespace Horizon {
 
 // vkcreatebuffer, allocate memory and bindbuffermemory
-void vk_createBuffer(VkDevice device, VkPhysicalDevice gpu, VkDeviceSize size, VkBufferUsageFlags usage,
-                     VkMemoryPropertyFlags properties, VkBuffer &buffer, VkDeviceMemory &buffer_memory) {
+void vk_createBuffer(std::shared_ptr<Device> device, VkDeviceSize size, VkBufferUsageFlags usage,
+                     VkMemoryPropertyFlags properties, VkBuffer &buffer, MemoryAllocation &allocation,
+                     bool transient) {
     VkBufferCreateInfo bufferInfo{};
     bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     bufferInfo.size = size;
     bufferInfo.usage = usage;
     bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-    if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+    if (device->GetMemoryAllocator()->CreateBuffer(bufferInfo, properties, buffer, allocation, transient) !=
+        VK_SUCCESS) {
         throw std::runtime_error("failed to create buffer!");
     }
+}
 
-    VkMemoryRequirements memRequirements;
-    vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
-
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = FindMemoryType(gpu, memRequirements.memoryTypeBits, properties);
-
-    CHECK_VK_RESULT(vkAllocateMemory(device, &allocInfo, nullptr, &buffer_memory));
-
-    vkBindBufferMemory(device, buffer, buffer_memory, 0);
+void vk_destroyBuffer(std::shared_ptr<Device> device, VkBuffer &buffer, MemoryAllocation &allocation) {
+    device->GetDescriptorAllocator()->Invalidate(buffer);
+    device->GetMemoryAllocator()->DestroyBuffer(buffer, allocation);
 }
 
 void vk_copyBuffer(std::shared_ptr<Device> device, std::shared_ptr<CommandBuffer> command_buffer, VkBuffer srcBuffer,
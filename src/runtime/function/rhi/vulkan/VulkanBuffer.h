@@ -1,3 +1,5 @@
+#pragma once
+
 #include <vulkan/vulkan.hpp>
 
 #include "CommandBuffer.h"
@@ -6,8 +8,12 @@
 
 namespace Horizon {
 
-void vk_createBuffer(VkDevice device, VkPhysicalDevice gpu, VkDeviceSize size, VkBufferUsageFlags usage,
-                     VkMemoryPropertyFlags properties, VkBuffer &buffer, VkDeviceMemory &buffer_memory);
+// memory comes from the device allocator, transient buffers are bumped out of its linear arena
+void vk_createBuffer(std::shared_ptr<Device> device, VkDeviceSize size, VkBufferUsageFlags usage,
+                     VkMemoryPropertyFlags properties, VkBuffer &buffer, MemoryAllocation &allocation,
+                     bool transient = false);
+
+void vk_destroyBuffer(std::shared_ptr<Device> device, VkBuffer &buffer, MemoryAllocation &allocation);
 
 void vk_copyBuffer(std::shared_ptr<Device> device, std::shared_ptr<CommandBuffer> command_buffer, VkBuffer srcBuffer,
                    VkBuffer dstBuffer, VkDeviceSize size);
@@ -25,6 +25,8 @@ struct DescriptorBase {
     //DescriptorType type;
     VkDescriptorImageInfo imageDescriptorInfo{};
     VkDescriptorBufferInfo bufferDescriptrInfo{};
+    // offset into the uniform ring for dynamic uniform buffers
+    u32 dynamicOffset = 0;
 };
 
 } // namespace Horizon
\ No newline at end of file
@@ -1,5 +1,8 @@
 #include "Camera.h"
 
+#include <algorithm>
+#include <cmath>
+
 namespace Horizon {
 Camera::Camera(Math::vec3 eye, Math::vec3 at, Math::vec3 up) noexcept : m_eye(eye), m_at(at), m_up(up) {
     m_forward = normalize(m_at - m_eye);
@@ -63,6 +66,14 @@ void Camera::Rotate(f32 xoffset, f32 yoffset) noexcept {
         m_pitch = -89.0f;
     }
 }
+void Camera::SetLookAt(Math::vec3 eye, Math::vec3 at) noexcept {
+    Math::vec3 forward = Math::normalize(at - eye);
+    m_eye = eye;
+    m_yaw = Math::degrees(std::atan2(forward.z, forward.x));
+    m_pitch = std::clamp(Math::degrees(std::asin(forward.y)), -89.0f, 89.0f);
+    UpdateViewMatrix();
+}
+
 void Camera::UpdateViewMatrix() noexcept {
     // calculate the new Front std::vector
     Math::vec3 front;
@@ -14,7 +14,9 @@ class Camera {
 
     Math::mat4 GetProjectionMatrix() const noexcept;
 
-    //void setLookAt(vec3 position, vec3 at, vec3 up = vec3(0.0f, 1.0f, 0.0f));
+    // moves the camera to eye and turns it towards at, the view matrix is updated
+    void SetLookAt(Math::vec3 eye, Math::vec3 at) noexcept;
+
     Math::mat4 GetViewMatrix() const noexcept;
 
     Math::vec3 GetPosition() const noexcept;
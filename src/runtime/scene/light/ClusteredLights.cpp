@@ -0,0 +1,320 @@
+#include "ClusteredLights.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+
+#include <runtime/core/log/Log.h>
+#include <runtime/core/path/Path.h>
+#include <runtime/function/rhi/vulkan/ResourceBarrier.h>
+#include <runtime/function/rhi/vulkan/ShaderModule.h>
+#include <runtime/function/rhi/vulkan/VulkanBuffer.h>
+
+namespace Horizon {
+
+namespace {
+
+constexpr u32 CULL_GROUP_SIZE = 64; // local_size_x of light_cull.comp
+constexpr u32 TILE_SIZE = 64;       // pixels
+constexpr u32 DEPTH_SLICES = 24;
+constexpr u32 MAX_LIGHTS_PER_CLUSTER = 128; // matches lights.glsl
+constexpr u32 MIN_LIGHT_CAPACITY = 256;
+// frames averaged into one report
+constexpr u32 STATS_INTERVAL = 240;
+
+// push constant of light_cull.comp
+struct LightCullParams {
+    Math::mat4 view;
+    Math::vec4 ndc_to_view; // 1 / projection[0][0], 1 / projection[1][1], near, far
+    Math::vec4 tile_ndc;
+    u32 grid[3];
+    u32 first_light;
+    u32 light_count;
+};
+
+} // namespace
+
+ClusteredLights::ClusteredLights(std::shared_ptr<Device> device, std::shared_ptr<CommandBuffer> command_buffer,
+                                 u32 width, u32 height) noexcept
+    : m_device(device), m_command_buffer(command_buffer), m_width(width), m_height(height) {
+    m_cluster_ubdata.grid_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+    m_cluster_ubdata.grid_y = (height + TILE_SIZE - 1) / TILE_SIZE;
+    m_cluster_ubdata.grid_z = DEPTH_SLICES;
+    m_cluster_ubdata.tile_size = static_cast<f32>(TILE_SIZE);
+    m_cluster_ub = std::make_shared<UniformBuffer>(device);
+
+    CreateLayout();
+    CreatePool();
+    CreatePipeline();
+    for (auto &frame : m_frames) {
+        CreateClusterBuffers(frame);
+        ReserveLights(frame, 0);
+    }
+}
+
+ClusteredLights::~ClusteredLights() noexcept {
+    for (auto &frame : m_frames) {
+        Destroy(frame);
+        vk_destroyBuffer(m_device, frame.count_buffer, frame.count_memory);
+        vk_destroyBuffer(m_device, frame.index_buffer, frame.index_memory);
+        vk_destroyBuffer(m_device, frame.stats_buffer, frame.stats_memory);
+    }
+    // sets are freed with the pool
+    vkDestroyDescriptorPool(m_device->Get(), m_pool, nullptr);
+    vkDestroyDescriptorSetLayout(m_device->Get(), m_layout, nullptr);
+}
+
+u32 ClusteredLights::GetClusterCount() const noexcept {
+    return m_cluster_ubdata.grid_x * m_cluster_ubdata.grid_y * m_cluster_ubdata.grid_z;
+}
+
+void ClusteredLights::CreateLayout() noexcept {
+    // lights, cluster light counts, cluster light indices, statistics
+    std::array<VkDescriptorSetLayoutBinding, 4> bindings{};
+    for (u32 i = 0; i < bindings.size(); i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layout_create_info{};
+    layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layout_create_info.bindingCount = static_cast<u32>(bindings.size());
+    layout_create_info.pBindings = bindings.data();
+    CHECK_VK_RESULT(vkCreateDescriptorSetLayout(m_device->Get(), &layout_create_info, nullptr, &m_layout));
+}
+
+void ClusteredLights::CreatePool() noexcept {
+    VkDescriptorPoolSize pool_size{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4 * MAX_FRAMES_IN_FLIGHT};
+
+    VkDescriptorPoolCreateInfo pool_create_info{};
+    pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_create_info.maxSets = MAX_FRAMES_IN_FLIGHT;
+    pool_create_info.poolSizeCount = 1;
+    pool_create_info.pPoolSizes = &pool_size;
+    CHECK_VK_RESULT(vkCreateDescriptorPool(m_device->Get(), &pool_create_info, nullptr, &m_pool));
+
+    std::array<VkDescriptorSetLayout, MAX_FRAMES_IN_FLIGHT> layouts;
+    layouts.fill(m_layout);
+    std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT> sets{};
+    VkDescriptorSetAllocateInfo alloc_info{};
+    alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    alloc_info.descriptorPool = m_pool;
+    alloc_info.descriptorSetCount = MAX_FRAMES_IN_FLIGHT;
+    alloc_info.pSetLayouts = layouts.data();
+    CHECK_VK_RESULT(vkAllocateDescriptorSets(m_device->Get(), &alloc_info, sets.data()));
+    for (u32 i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        m_frames[i].set = sets[i];
+    }
+}
+
+void ClusteredLights::CreatePipeline() noexcept {
+    if (!std::filesystem::exists(Path::GetShaderPath("light_cull.comp.spv"))) {
+        LOG_WARN("light culling shader is not compiled, every pixel shades every light");
+        return;
+    }
+    ComputePipelineCreateInfo create_info;
+    create_info.name = "light_cull";
+    create_info.cs = std::make_shared<Shader>(m_device->Get(), Path::GetShaderPath("light_cull.comp.spv"));
+    create_info.descriptor_layouts = std::make_shared<DescriptorSetLayouts>();
+    create_info.descriptor_layouts->layouts = {m_layout};
+    create_info.push_constants = std::make_shared<PushConstants>();
+    create_info.push_constants->ranges = {{SHADER_STAGE_COMPUTE_SHADER, 0, sizeof(LightCullParams)}};
+    m_cull_pipeline = std::make_shared<ComputePipeline>(m_device, create_info);
+}
+
+void ClusteredLights::CreateClusterBuffers(FrameResources &frame) noexcept {
+    u64 count_size = static_cast<u64>(GetClusterCount()) * sizeof(u32);
+    u64 index_size = count_size * MAX_LIGHTS_PER_CLUSTER;
+    // cleared by a transfer when the cull pass is not available
+    vk_createBuffer(m_device, count_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame.count_buffer, frame.count_memory);
+    vk_createBuffer(m_device, index_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                    frame.index_buffer, frame.index_memory);
+    // host visible so the statistics can be read without a copy
+    vk_createBuffer(m_device, sizeof(CullStats), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, frame.stats_buffer,
+                    frame.stats_memory);
+
+    frame.count_descriptor = std::make_shared<DescriptorBase>();
+    frame.count_descriptor->bufferDescriptrInfo = {frame.count_buffer, 0, count_size};
+    frame.index_descriptor = std::make_shared<DescriptorBase>();
+    frame.index_descriptor->bufferDescriptrInfo = {frame.index_buffer, 0, index_size};
+}
+
+void ClusteredLights::ReserveLights(FrameResources &frame, u32 light_count) noexcept {
+    if (frame.light_buffer && light_count <= frame.light_capacity) {
+        return;
+    }
+    // the slot's last frame has retired, nothing reads the old buffer any more
+    Destroy(frame);
+    frame.light_capacity = std::max({light_count, frame.light_capacity * 2, MIN_LIGHT_CAPACITY});
+    u64 light_size = static_cast<u64>(frame.light_capacity) * sizeof(LightParams);
+    vk_createBuffer(m_device, light_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, frame.light_buffer,
+                    frame.light_memory);
+    frame.light_descriptor = std::make_shared<DescriptorBase>();
+    frame.light_descriptor->bufferDescriptrInfo = {frame.light_buffer, 0, light_size};
+    WriteDescriptors(frame);
+}
+
+void ClusteredLights::WriteDescriptors(FrameResources &frame) noexcept {
+    std::array<VkDescriptorBufferInfo, 4> buffer_infos{{
+        frame.light_descriptor->bufferDescriptrInfo,
+        frame.count_descriptor->bufferDescriptrInfo,
+        frame.index_descriptor->bufferDescriptrInfo,
+        {frame.stats_buffer, 0, sizeof(CullStats)},
+    }};
+    std::array<VkWriteDescriptorSet, 4> writes{};
+    for (u32 i = 0; i < writes.size(); i++) {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = frame.set;
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[i].pBufferInfo = &buffer_infos[i];
+    }
+    vkUpdateDescriptorSets(m_device->Get(), static_cast<u32>(writes.size()), writes.data(), 0, nullptr);
+}
+
+void ClusteredLights::Destroy(FrameResources &frame) noexcept {
+    if (frame.light_buffer) {
+        vk_destroyBuffer(m_device, frame.light_buffer, frame.light_memory);
+    }
+}
+
+std::shared_ptr<DescriptorBase> ClusteredLights::GetLightBuffer(u32 frame) const noexcept {
+    return m_frames[frame].light_descriptor;
+}
+
+std::shared_ptr<DescriptorBase> ClusteredLights::GetClusterLightCounts(u32 frame) const noexcept {
+    return m_frames[frame].count_descriptor;
+}
+
+std::shared_ptr<DescriptorBase> ClusteredLights::GetClusterLightIndices(u32 frame) const noexcept {
+    return m_frames[frame].index_descriptor;
+}
+
+void ClusteredLights::ReadStats(FrameResources &frame) noexcept {
+    // BeginFrame waited for the slot's fence, the statistics of its cull are final
+    if (!frame.culled) {
+        return;
+    }
+    CullStats stats;
+    memcpy(&stats, frame.stats_memory.mapped, sizeof(CullStats));
+    m_stats.assigned += stats.assigned;
+    m_stats.occupied += stats.occupied;
+    m_stats.max_count = std::max(m_stats.max_count, stats.max_count);
+    m_stats.overflowed += stats.overflowed;
+    m_stats.readbacks++;
+    frame.culled = false;
+}
+
+void ClusteredLights::Update(u32 frame, const std::vector<LightParams> &lights, const Math::mat4 &view,
+                             const Math::mat4 &projection, Math::vec2 near_far) noexcept {
+    auto begin = std::chrono::steady_clock::now();
+    FrameResources &resources = m_frames[frame];
+    ReadStats(resources);
+    ReserveLights(resources, static_cast<u32>(lights.size()));
+
+    // directional lights first, they are shaded everywhere and skipped by the cull pass
+    LightParams *mapped = static_cast<LightParams *>(resources.light_memory.mapped);
+    u32 direct_light_count = 0;
+    for (const LightParams &light : lights) {
+        if (light.position_type.w == static_cast<f32>(LightType::DIRECT_LIGHT)) {
+            mapped[direct_light_count++] = light;
+        }
+    }
+    u32 next = direct_light_count;
+    for (const LightParams &light : lights) {
+        if (light.position_type.w != static_cast<f32>(LightType::DIRECT_LIGHT)) {
+            mapped[next++] = light;
+        }
+    }
+    m_light_count = static_cast<u32>(lights.size());
+    m_view = view;
+    m_ndc_to_view = Math::vec2(1.0f / projection[0][0], 1.0f / projection[1][1]);
+
+    // without the cull pass all lights go through the light pass's loop over the directional lights
+    m_cluster_ubdata.direct_light_count = m_cull_pipeline ? direct_light_count : m_light_count;
+    m_cluster_ubdata.near_plane = near_far.x;
+    m_cluster_ubdata.far_plane = near_far.y;
+    m_cluster_ubdata.slice_scale = static_cast<f32>(DEPTH_SLICES) / std::log(near_far.y / near_far.x);
+    m_cluster_ub->update(&m_cluster_ubdata, sizeof(ClusterUbData));
+
+    m_stats.upload_us += std::chrono::duration<f64, std::micro>(std::chrono::steady_clock::now() - begin).count();
+    m_stats.lights += m_light_count;
+    m_stats.clustered += m_light_count - direct_light_count;
+    if (++m_stats.frames == STATS_INTERVAL) {
+        // lights per occupied cluster is what a shaded pixel loops over, it should not grow with the light count
+        // while the lights spread out. the readbacks lag MAX_FRAMES_IN_FLIGHT frames behind
+        u32 readbacks = std::max(m_stats.readbacks, 1u);
+        LOG_INFO("clustered lights: {} lights ({} clustered) in {} clusters, {:.1f} occupied clusters, {:.1f} lights "
+                 "per occupied cluster, at most {}, {} overflowed, {:.1f} us uploading",
+                 m_stats.lights / m_stats.frames, m_stats.clustered / m_stats.frames, GetClusterCount(),
+                 static_cast<f64>(m_stats.occupied) / readbacks,
+                 m_stats.occupied ? static_cast<f64>(m_stats.assigned) / m_stats.occupied : 0.0, m_stats.max_count,
+                 m_stats.overflowed, m_stats.upload_us / m_stats.frames);
+        m_stats = Stats{};
+    }
+}
+
+void ClusteredLights::Cull(u32 frame) noexcept {
+    FrameResources &resources = m_frames[frame];
+    VkCommandBuffer command_buffer = m_command_buffer->Get(frame);
+
+    if (!m_cull_pipeline) {
+        // empty clusters, the light pass shades every light as a directional one
+        vkCmdFillBuffer(command_buffer, resources.count_buffer, 0, VK_WHOLE_SIZE, 0);
+        BarrierDesc clear_barrier;
+        clear_barrier.src_stage = PIPELINE_STAGE_TRANSFER_BIT;
+        clear_barrier.dst_stage = PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        clear_barrier.buffer_memory_barriers.push_back(
+            {ACCESS_TRANSFER_WRITE_BIT, ACCESS_SHADER_READ_BIT, resources.count_buffer, 0,
+             static_cast<u32>(resources.count_descriptor->bufferDescriptrInfo.range)});
+        InsertBarrier(frame, m_command_buffer, clear_barrier);
+        return;
+    }
+
+    vkCmdFillBuffer(command_buffer, resources.stats_buffer, 0, sizeof(CullStats), 0);
+    BarrierDesc clear_barrier;
+    clear_barrier.src_stage = PIPELINE_STAGE_TRANSFER_BIT;
+    clear_barrier.dst_stage = PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    clear_barrier.buffer_memory_barriers.push_back(
+        {ACCESS_TRANSFER_WRITE_BIT, static_cast<MemoryAccessFlags>(ACCESS_SHADER_READ_BIT | ACCESS_SHADER_WRITE_BIT),
+         resources.stats_buffer, 0, static_cast<u32>(sizeof(CullStats))});
+    InsertBarrier(frame, m_command_buffer, clear_barrier);
+
+    // the dispatch also runs without clustered lights, it clears the counts
+    LightCullParams params{};
+    params.view = m_view;
+    params.ndc_to_view = Math::vec4(m_ndc_to_view, m_cluster_ubdata.near_plane, m_cluster_ubdata.far_plane);
+    params.tile_ndc = Math::vec4(2.0f * TILE_SIZE / m_width, 2.0f * TILE_SIZE / m_height, 0.0f, 0.0f);
+    params.grid[0] = m_cluster_ubdata.grid_x;
+    params.grid[1] = m_cluster_ubdata.grid_y;
+    params.grid[2] = m_cluster_ubdata.grid_z;
+    params.first_light = m_cluster_ubdata.direct_light_count;
+    params.light_count = m_light_count;
+
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cull_pipeline->Get());
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cull_pipeline->GetLayout(), 0, 1,
+                            &resources.set, 0, nullptr);
+    vkCmdPushConstants(command_buffer, m_cull_pipeline->GetLayout(), ToVkShaderStageFlags(SHADER_STAGE_COMPUTE_SHADER),
+                       0, sizeof(LightCullParams), &params);
+    vkCmdDispatch(command_buffer, (GetClusterCount() + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+    // the light pass reads the clusters behind the render graph's barrier, only the statistics go to the host here
+    BarrierDesc stats_barrier;
+    stats_barrier.src_stage = PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    stats_barrier.dst_stage = PIPELINE_STAGE_HOST_BIT;
+    stats_barrier.buffer_memory_barriers.push_back({ACCESS_SHADER_WRITE_BIT, ACCESS_HOST_READ_BIT,
+                                                    resources.stats_buffer, 0, static_cast<u32>(sizeof(CullStats))});
+    InsertBarrier(frame, m_command_buffer, stats_barrier);
+
+    resources.culled = true;
+}
+
+} // namespace Horizon
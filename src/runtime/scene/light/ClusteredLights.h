@@ -0,0 +1,118 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include <runtime/core/math/Math.h>
+#include <runtime/function/rhi/RenderContext.h>
+#include <runtime/function/rhi/vulkan/CommandBuffer.h>
+#include <runtime/function/rhi/vulkan/Device.h>
+#include <runtime/function/rhi/vulkan/Pipeline.h>
+#include <runtime/function/rhi/vulkan/UniformBuffer.h>
+#include <runtime/scene/light/Light.h>
+
+namespace Horizon {
+
+// cluster grid as the light pass sees it, matches ClusterUb in shading.frag
+struct ClusterUbData {
+    u32 grid_x = 0, grid_y = 0, grid_z = 0;
+    u32 direct_light_count = 0;
+    f32 near_plane = 0.0f, far_plane = 0.0f;
+    f32 tile_size = 0.0f;   // pixels
+    f32 slice_scale = 0.0f; // depth slices per log unit of view depth
+};
+
+// lights live in a storage buffer that grows with the scene. a compute pass bins point and spot lights by their
+// range into clusters of screen tiles and logarithmic view depth slices, the light pass only shades the lights of
+// its pixel's cluster. directional lights are stored first and shaded everywhere. without a compiled cull shader the
+// clusters stay empty and every light is shaded everywhere.
+class ClusteredLights {
+  public:
+    ClusteredLights(std::shared_ptr<Device> device, std::shared_ptr<CommandBuffer> command_buffer, u32 width,
+                    u32 height) noexcept;
+    ~ClusteredLights() noexcept;
+    ClusteredLights(const ClusteredLights &) = delete;
+    ClusteredLights &operator=(const ClusteredLights &) = delete;
+
+    // uploads the frame's lights and cluster parameters, call after BeginFrame
+    void Update(u32 frame, const std::vector<LightParams> &lights, const Math::mat4 &view,
+                const Math::mat4 &projection, Math::vec2 near_far) noexcept;
+    // bins the frame's lights into the clusters, record outside of a render pass
+    void Cull(u32 frame) noexcept;
+
+    std::shared_ptr<UniformBuffer> GetClusterUb() const noexcept { return m_cluster_ub; }
+    // storage buffers of the frame slot, bound by the light pass
+    std::shared_ptr<DescriptorBase> GetLightBuffer(u32 frame) const noexcept;
+    std::shared_ptr<DescriptorBase> GetClusterLightCounts(u32 frame) const noexcept;
+    std::shared_ptr<DescriptorBase> GetClusterLightIndices(u32 frame) const noexcept;
+
+  private:
+    // written by light_cull.comp
+    struct CullStats {
+        u32 assigned;
+        u32 max_count;
+        u32 occupied;
+        u32 overflowed;
+    };
+
+    struct FrameResources {
+        VkBuffer light_buffer = VK_NULL_HANDLE;
+        MemoryAllocation light_memory;
+        VkBuffer count_buffer = VK_NULL_HANDLE;
+        MemoryAllocation count_memory;
+        VkBuffer index_buffer = VK_NULL_HANDLE;
+        MemoryAllocation index_memory;
+        VkBuffer stats_buffer = VK_NULL_HANDLE;
+        MemoryAllocation stats_memory;
+        std::shared_ptr<DescriptorBase> light_descriptor, count_descriptor, index_descriptor;
+        VkDescriptorSet set = VK_NULL_HANDLE;
+        u32 light_capacity = 0;
+        // the slot's last cull, its statistics are read back once the slot's fence has signaled
+        bool culled = false;
+    };
+
+    void CreateLayout() noexcept;
+    void CreatePool() noexcept;
+    void CreatePipeline() noexcept;
+    void CreateClusterBuffers(FrameResources &frame) noexcept;
+    void ReserveLights(FrameResources &frame, u32 light_count) noexcept;
+    void WriteDescriptors(FrameResources &frame) noexcept;
+    void Destroy(FrameResources &frame) noexcept;
+    void ReadStats(FrameResources &frame) noexcept;
+    u32 GetClusterCount() const noexcept;
+
+  private:
+    std::shared_ptr<Device> m_device = nullptr;
+    std::shared_ptr<CommandBuffer> m_command_buffer = nullptr;
+
+    VkDescriptorSetLayout m_layout = VK_NULL_HANDLE;
+    VkDescriptorPool m_pool = VK_NULL_HANDLE;
+    // null when light_cull.comp is not compiled
+    std::shared_ptr<Pipeline> m_cull_pipeline = nullptr;
+
+    std::array<FrameResources, MAX_FRAMES_IN_FLIGHT> m_frames;
+    std::shared_ptr<UniformBuffer> m_cluster_ub = nullptr;
+    ClusterUbData m_cluster_ubdata;
+    Math::mat4 m_view{1.0f};
+    Math::vec2 m_ndc_to_view{1.0f};
+    u32 m_width, m_height;
+    u32 m_light_count = 0;
+
+    // averaged and logged periodically
+    struct Stats {
+        u64 lights = 0;
+        u64 clustered = 0;
+        u64 assigned = 0;
+        u64 occupied = 0;
+        u32 max_count = 0;
+        u64 overflowed = 0;
+        f64 upload_us = 0.0;
+        u32 frames = 0;
+        u32 readbacks = 0;
+    } m_stats;
+};
+
+} // namespace Horizon
@@ -37,5 +37,7 @@ class Material {
         //Math::vec2 metallicRoughnessFactor = Math::vec2(0.0f);
     } m_material_ubdata;
     std::shared_ptr<UniformBuffer> m_material_ub;
+    // index into the scene's MaterialTable when drawing bindless
+    u32 m_material_index = 0;
 };
 } // namespace Horizon
\ No newline at end of file
@@ -0,0 +1,187 @@
+#include "MaterialTable.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include <runtime/core/log/Log.h>
+#include <runtime/function/rhi/vulkan/VulkanBuffer.h>
+
+namespace Horizon {
+
+namespace {
+
+constexpr u32 MAX_BINDLESS_TEXTURES = 1024;
+// one set per frame in flight plus the one being built
+constexpr u32 MAX_GENERATIONS = MAX_FRAMES_IN_FLIGHT + 1;
+
+} // namespace
+
+MaterialTable::MaterialTable(std::shared_ptr<Device> device) noexcept : m_device(device) {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(m_device->getPhysicalDevice(), &properties);
+    m_max_textures = std::min({MAX_BINDLESS_TEXTURES, properties.limits.maxPerStageDescriptorSamplers,
+                               properties.limits.maxPerStageDescriptorSampledImages,
+                               properties.limits.maxDescriptorSetSampledImages});
+    CreateLayout();
+    CreatePool();
+}
+
+MaterialTable::~MaterialTable() noexcept {
+    Destroy(m_current);
+    for (auto &generation : m_retired) {
+        Destroy(generation);
+    }
+    // sets are freed with the pool
+    vkDestroyDescriptorPool(m_device->Get(), m_pool, nullptr);
+    vkDestroyDescriptorSetLayout(m_device->Get(), m_layout, nullptr);
+}
+
+void MaterialTable::CreateLayout() noexcept {
+    std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+    // material data
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[0].descriptorCount = 1;
+    bindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    // textures
+    bindings[1].binding = 1;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[1].descriptorCount = m_max_textures;
+    bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    // only the registered textures are written
+    std::array<VkDescriptorBindingFlags, 2> binding_flags{0, VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT};
+    VkDescriptorSetLayoutBindingFlagsCreateInfo binding_flags_create_info{};
+    binding_flags_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    binding_flags_create_info.bindingCount = static_cast<u32>(binding_flags.size());
+    binding_flags_create_info.pBindingFlags = binding_flags.data();
+
+    VkDescriptorSetLayoutCreateInfo layout_create_info{};
+    layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layout_create_info.pNext = &binding_flags_create_info;
+    layout_create_info.bindingCount = static_cast<u32>(bindings.size());
+    layout_create_info.pBindings = bindings.data();
+    CHECK_VK_RESULT(vkCreateDescriptorSetLayout(m_device->Get(), &layout_create_info, nullptr, &m_layout));
+}
+
+void MaterialTable::CreatePool() noexcept {
+    std::array<VkDescriptorPoolSize, 2> pool_sizes{{
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, MAX_GENERATIONS},
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_max_textures * MAX_GENERATIONS},
+    }};
+
+    VkDescriptorPoolCreateInfo pool_create_info{};
+    pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_create_info.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+    pool_create_info.maxSets = MAX_GENERATIONS;
+    pool_create_info.poolSizeCount = static_cast<u32>(pool_sizes.size());
+    pool_create_info.pPoolSizes = pool_sizes.data();
+    CHECK_VK_RESULT(vkCreateDescriptorPool(m_device->Get(), &pool_create_info, nullptr, &m_pool));
+}
+
+u32 MaterialTable::AddTexture(const std::shared_ptr<Texture> &texture) noexcept {
+    auto it = m_texture_indices.find(texture.get());
+    if (it != m_texture_indices.end()) {
+        return it->second;
+    }
+    if (m_textures.size() >= m_max_textures) {
+        LOG_ERROR("bindless texture array is full, {} textures at most", m_max_textures);
+        return 0;
+    }
+    u32 index = static_cast<u32>(m_textures.size());
+    m_textures.push_back(texture);
+    m_texture_indices.emplace(texture.get(), index);
+    return index;
+}
+
+void MaterialTable::AddMaterial(Material &material) noexcept {
+    MaterialData data;
+    data.base_color_texture = AddTexture(material.base_color_texture);
+    data.normal_texture = AddTexture(material.normal_texture);
+    data.metallic_roughness_texture = AddTexture(material.metallic_rougness_texture);
+    data.flags = (material.m_material_ubdata.has_base_color ? static_cast<u32>(MATERIAL_HAS_BASE_COLOR) : 0u) |
+                 (material.m_material_ubdata.has_normal ? static_cast<u32>(MATERIAL_HAS_NORMAL) : 0u) |
+                 (material.m_material_ubdata.has_metallic_rougness ? static_cast<u32>(MATERIAL_HAS_METALLIC_ROUGHNESS)
+                                                                   : 0u);
+
+    material.m_material_index = static_cast<u32>(m_materials.size());
+    m_materials.push_back(data);
+    m_dirty = true;
+}
+
+void MaterialTable::Update() noexcept {
+    m_frame++;
+    // BeginFrame waited for the frame MAX_FRAMES_IN_FLIGHT back, nothing older can still read a retired generation
+    for (auto it = m_retired.begin(); it != m_retired.end();) {
+        if (m_frame - it->retired_frame >= MAX_FRAMES_IN_FLIGHT) {
+            Destroy(*it);
+            it = m_retired.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    if (!m_dirty || m_materials.empty()) {
+        return;
+    }
+    if (m_retired.size() + 1 >= MAX_GENERATIONS) {
+        // every other set is still in flight, try again next frame
+        return;
+    }
+    m_dirty = false;
+
+    Generation generation;
+    u64 size = sizeof(MaterialData) * m_materials.size();
+    vk_createBuffer(m_device, size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, generation.buffer,
+                    generation.memory);
+    memcpy(generation.memory.mapped, m_materials.data(), size);
+
+    VkDescriptorSetAllocateInfo alloc_info{};
+    alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    alloc_info.descriptorPool = m_pool;
+    alloc_info.descriptorSetCount = 1;
+    alloc_info.pSetLayouts = &m_layout;
+    CHECK_VK_RESULT(vkAllocateDescriptorSets(m_device->Get(), &alloc_info, &generation.set));
+
+    VkDescriptorBufferInfo buffer_info{generation.buffer, 0, size};
+    std::vector<VkDescriptorImageInfo> image_infos(m_textures.size());
+    for (u32 i = 0; i < m_textures.size(); i++) {
+        image_infos[i] = m_textures[i]->imageDescriptorInfo;
+    }
+
+    std::array<VkWriteDescriptorSet, 2> writes{};
+    writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[0].dstSet = generation.set;
+    writes[0].dstBinding = 0;
+    writes[0].descriptorCount = 1;
+    writes[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writes[0].pBufferInfo = &buffer_info;
+    writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[1].dstSet = generation.set;
+    writes[1].dstBinding = 1;
+    writes[1].descriptorCount = static_cast<u32>(image_infos.size());
+    writes[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    writes[1].pImageInfo = image_infos.data();
+    vkUpdateDescriptorSets(m_device->Get(), static_cast<u32>(writes.size()), writes.data(), 0, nullptr);
+
+    if (m_current.set) {
+        m_current.retired_frame = m_frame;
+        m_retired.push_back(m_current);
+    }
+    m_current = generation;
+    LOG_INFO("material table: {} materials, {} textures", m_materials.size(), m_textures.size());
+}
+
+void MaterialTable::Destroy(Generation &generation) noexcept {
+    if (generation.set) {
+        vkFreeDescriptorSets(m_device->Get(), m_pool, 1, &generation.set);
+        generation.set = VK_NULL_HANDLE;
+    }
+    if (generation.buffer) {
+        vk_destroyBuffer(m_device, generation.buffer, generation.memory);
+    }
+}
+
+} // namespace Horizon
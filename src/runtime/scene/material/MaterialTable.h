@@ -0,0 +1,78 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include <runtime/function/rhi/vulkan/Device.h>
+#include <runtime/function/rhi/vulkan/Texture.h>
+#include <runtime/scene/material/Material.h>
+
+namespace Horizon {
+
+enum MaterialFlags : u32 {
+    MATERIAL_HAS_BASE_COLOR = 1 << 0,
+    MATERIAL_HAS_NORMAL = 1 << 1,
+    MATERIAL_HAS_METALLIC_ROUGHNESS = 1 << 2,
+};
+
+// gpu side of a material, texture indices point into the bindless texture array. matches geometry_bindless.frag
+struct MaterialData {
+    u32 base_color_texture = 0;
+    u32 normal_texture = 0;
+    u32 metallic_roughness_texture = 0;
+    u32 flags = 0;
+};
+
+// every material of the scene in one storage buffer and every texture in one partially bound sampler array, bound
+// once as set 1 of the geometry pass. draws select their material with an index in the push constant.
+class MaterialTable {
+  public:
+    explicit MaterialTable(std::shared_ptr<Device> device) noexcept;
+    ~MaterialTable() noexcept;
+    MaterialTable(const MaterialTable &) = delete;
+    MaterialTable &operator=(const MaterialTable &) = delete;
+
+    // registers the material and its textures, sets material.m_material_index
+    void AddMaterial(Material &material) noexcept;
+    // uploads pending materials into a new buffer and descriptor set, call once per frame after BeginFrame
+    void Update() noexcept;
+
+    VkDescriptorSetLayout GetLayout() const noexcept { return m_layout; }
+    VkDescriptorSet GetDescriptorSet() const noexcept { return m_current.set; }
+    u32 GetMaterialCount() const noexcept { return static_cast<u32>(m_materials.size()); }
+    u32 GetTextureCount() const noexcept { return static_cast<u32>(m_textures.size()); }
+
+  private:
+    u32 AddTexture(const std::shared_ptr<Texture> &texture) noexcept;
+    void CreateLayout() noexcept;
+    void CreatePool() noexcept;
+
+    // the buffer and set a frame binds, replaced ones live until no frame in flight can use them
+    struct Generation {
+        VkDescriptorSet set = VK_NULL_HANDLE;
+        VkBuffer buffer = VK_NULL_HANDLE;
+        MemoryAllocation memory;
+        u64 retired_frame = 0;
+    };
+    void Destroy(Generation &generation) noexcept;
+
+  private:
+    std::shared_ptr<Device> m_device = nullptr;
+    u32 m_max_textures = 0;
+    VkDescriptorSetLayout m_layout = VK_NULL_HANDLE;
+    VkDescriptorPool m_pool = VK_NULL_HANDLE;
+
+    std::vector<MaterialData> m_materials;
+    std::vector<std::shared_ptr<Texture>> m_textures;
+    std::unordered_map<const Texture *, u32> m_texture_indices;
+    bool m_dirty = false;
+
+    Generation m_current;
+    std::vector<Generation> m_retired;
+    u64 m_frame = 0;
+};
+
+} // namespace Horizon
@@ -0,0 +1,260 @@
+#include "CookedMesh.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+#include <json.hpp>
+
+#include <runtime/core/log/Log.h>
+
+namespace Horizon {
+
+namespace {
+
+constexpr u64 FNV_OFFSET_BASIS = 0xcbf29ce484222325ull;
+constexpr u64 FNV_PRIME = 0x100000001b3ull;
+constexpr u64 SECTION_ALIGNMENT = 16;
+
+const char *COOKED_MESH_EXTENSION = ".cooked";
+
+u64 Fnv1a(u64 hash, const void *data, u64 size) noexcept {
+    const u8 *bytes = static_cast<const u8 *>(data);
+    for (u64 i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+u64 AlignUp(u64 value, u64 alignment) noexcept { return (value + alignment - 1) & ~(alignment - 1); }
+
+// gltf uris are percent encoded
+std::string DecodeUri(const std::string &uri) noexcept {
+    std::string result;
+    for (size_t i = 0; i < uri.size(); i++) {
+        if (uri[i] == '%' && i + 2 < uri.size() && std::isxdigit(static_cast<u8>(uri[i + 1])) &&
+            std::isxdigit(static_cast<u8>(uri[i + 2]))) {
+            result += static_cast<char>(std::stoi(uri.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        } else {
+            result += uri[i];
+        }
+    }
+    return result;
+}
+
+// external files of the buffers and images, embedded data uris are part of the gltf content. a glb or a gltf that
+// doesn't parse references nothing
+std::vector<std::string> ReferencedFiles(const std::vector<char> &content) noexcept {
+    std::vector<std::string> files;
+    nlohmann::json json = nlohmann::json::parse(content.begin(), content.end(), nullptr, false);
+    if (!json.is_object()) {
+        return files;
+    }
+    for (const char *key : {"buffers", "images"}) {
+        auto list = json.find(key);
+        if (list == json.end() || !list->is_array()) {
+            continue;
+        }
+        for (const auto &item : *list) {
+            auto uri = item.find("uri");
+            if (uri != item.end() && uri->is_string() && uri->get<std::string>().rfind("data:", 0) != 0) {
+                files.push_back(DecodeUri(uri->get<std::string>()));
+            }
+        }
+    }
+    std::sort(files.begin(), files.end());
+    files.erase(std::unique(files.begin(), files.end()), files.end());
+    return files;
+}
+
+} // namespace
+
+u32 CookedMeshData::AddString(const std::string &str) noexcept {
+    u32 offset = static_cast<u32>(strings.size());
+    strings.append(str);
+    return offset;
+}
+
+u64 CookedMesh::HashSource(const std::string &path) noexcept {
+    namespace fs = std::filesystem;
+    u64 hash = FNV_OFFSET_BASIS;
+
+    // the gltf itself is small, hash its content
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return 0;
+    }
+    std::vector<char> content{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    hash = Fnv1a(hash, content.data(), content.size());
+
+    // buffers and images can be large, hash the name, size and write time of the ones the gltf references instead.
+    // a missing file hashes as size and time 0, so adding it later invalidates the cache
+    std::error_code ec;
+    fs::path directory = fs::path(path).parent_path();
+    for (const auto &name : ReferencedFiles(content)) {
+        fs::path file_path = directory / fs::u8path(name);
+        u64 size = static_cast<u64>(fs::file_size(file_path, ec));
+        if (ec) {
+            size = 0;
+        }
+        i64 time = static_cast<i64>(fs::last_write_time(file_path, ec).time_since_epoch().count());
+        if (ec) {
+            time = 0;
+        }
+        hash = Fnv1a(hash, name.data(), name.size());
+        hash = Fnv1a(hash, &size, sizeof(size));
+        hash = Fnv1a(hash, &time, sizeof(time));
+    }
+    return hash;
+}
+
+std::string CookedMesh::GetCachePath(const std::string &path) noexcept { return path + COOKED_MESH_EXTENSION; }
+
+bool CookedMesh::Write(const std::string &path, u64 source_hash, const CookedMeshData &data) noexcept {
+    const void *section_data[COOKED_MESH_SECTION_COUNT] = {
+        data.vertices,          data.indices,          data.nodes.data(),  data.primitives.data(),
+        data.materials.data(), data.textures.data(), data.strings.data()};
+    const u64 section_size[COOKED_MESH_SECTION_COUNT] = {data.vertices_count * sizeof(Vertex),
+                                                         data.indices_count * sizeof(Index),
+                                                         data.nodes.size() * sizeof(CookedNode),
+                                                         data.primitives.size() * sizeof(CookedPrimitive),
+                                                         data.materials.size() * sizeof(CookedMaterial),
+                                                         data.textures.size() * sizeof(CookedTexture),
+                                                         data.strings.size()};
+
+    CookedMeshHeader header{};
+    header.magic = COOKED_MESH_MAGIC;
+    header.version = COOKED_MESH_VERSION;
+    header.vertex_layout_version = Vertex::LAYOUT_VERSION;
+    header.vertex_stride = sizeof(Vertex);
+    header.source_hash = source_hash;
+    u64 offset = AlignUp(sizeof(CookedMeshHeader), SECTION_ALIGNMENT);
+    for (u32 i = 0; i < COOKED_MESH_SECTION_COUNT; i++) {
+        header.sections[i].offset = offset;
+        header.sections[i].size = section_size[i];
+        offset = AlignUp(offset + section_size[i], SECTION_ALIGNMENT);
+    }
+
+    // write to a temporary file first so a crash never leaves a truncated cache behind
+    std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            LOG_WARN("failed to open {}", tmp_path);
+            return false;
+        }
+        const char zeros[SECTION_ALIGNMENT]{};
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        u64 written = sizeof(header);
+        for (u32 i = 0; i < COOKED_MESH_SECTION_COUNT; i++) {
+            file.write(zeros, header.sections[i].offset - written);
+            if (section_size[i] > 0) {
+                file.write(static_cast<const char *>(section_data[i]), section_size[i]);
+            }
+            written = header.sections[i].offset + section_size[i];
+        }
+        if (!file.good()) {
+            LOG_WARN("failed to write {}", tmp_path);
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp_path, path, ec);
+    if (ec) {
+        LOG_WARN("failed to move {} to {}: {}", tmp_path, path, ec.message());
+        std::filesystem::remove(tmp_path, ec);
+        return false;
+    }
+    return true;
+}
+
+bool CookedMesh::Open(const std::string &path, u64 source_hash) noexcept {
+    Close();
+    if (!m_file.Open(path)) {
+        return false;
+    }
+    if (m_file.Size() < sizeof(CookedMeshHeader)) {
+        LOG_WARN("{} is truncated", path);
+        Close();
+        return false;
+    }
+    const CookedMeshHeader *header = reinterpret_cast<const CookedMeshHeader *>(m_file.Data());
+    if (header->magic != COOKED_MESH_MAGIC || header->version != COOKED_MESH_VERSION ||
+        header->vertex_layout_version != Vertex::LAYOUT_VERSION || header->vertex_stride != sizeof(Vertex)) {
+        LOG_INFO("{} was cooked by an incompatible version", path);
+        Close();
+        return false;
+    }
+    if (header->source_hash != source_hash) {
+        LOG_INFO("{} is out of date", path);
+        Close();
+        return false;
+    }
+    for (u32 i = 0; i < COOKED_MESH_SECTION_COUNT; i++) {
+        const auto &section = header->sections[i];
+        if (section.offset % SECTION_ALIGNMENT != 0 || section.offset > m_file.Size() ||
+            section.size > m_file.Size() - section.offset) {
+            LOG_WARN("{} is corrupted", path);
+            Close();
+            return false;
+        }
+    }
+    m_header = header;
+    return true;
+}
+
+void CookedMesh::Close() noexcept {
+    m_header = nullptr;
+    m_file.Close();
+}
+
+const Vertex *CookedMesh::GetVertices() const noexcept { return GetSection<Vertex>(COOKED_MESH_SECTION_VERTICES); }
+
+u64 CookedMesh::GetVerticesCount() const noexcept { return GetSectionCount<Vertex>(COOKED_MESH_SECTION_VERTICES); }
+
+const Index *CookedMesh::GetIndices() const noexcept { return GetSection<Index>(COOKED_MESH_SECTION_INDICES); }
+
+u64 CookedMesh::GetIndicesCount() const noexcept { return GetSectionCount<Index>(COOKED_MESH_SECTION_INDICES); }
+
+const CookedNode *CookedMesh::GetNodes() const noexcept { return GetSection<CookedNode>(COOKED_MESH_SECTION_NODES); }
+
+u64 CookedMesh::GetNodesCount() const noexcept { return GetSectionCount<CookedNode>(COOKED_MESH_SECTION_NODES); }
+
+const CookedPrimitive *CookedMesh::GetPrimitives() const noexcept {
+    return GetSection<CookedPrimitive>(COOKED_MESH_SECTION_PRIMITIVES);
+}
+
+u64 CookedMesh::GetPrimitivesCount() const noexcept {
+    return GetSectionCount<CookedPrimitive>(COOKED_MESH_SECTION_PRIMITIVES);
+}
+
+const CookedMaterial *CookedMesh::GetMaterials() const noexcept {
+    return GetSection<CookedMaterial>(COOKED_MESH_SECTION_MATERIALS);
+}
+
+u64 CookedMesh::GetMaterialsCount() const noexcept {
+    return GetSectionCount<CookedMaterial>(COOKED_MESH_SECTION_MATERIALS);
+}
+
+const CookedTexture *CookedMesh::GetTextures() const noexcept {
+    return GetSection<CookedTexture>(COOKED_MESH_SECTION_TEXTURES);
+}
+
+u64 CookedMesh::GetTexturesCount() const noexcept {
+    return GetSectionCount<CookedTexture>(COOKED_MESH_SECTION_TEXTURES);
+}
+
+std::string CookedMesh::GetString(u32 offset, u32 length) const noexcept {
+    const auto &section = m_header->sections[COOKED_MESH_SECTION_STRINGS];
+    if (static_cast<u64>(offset) + length > section.size) {
+        return {};
+    }
+    return std::string(reinterpret_cast<const char *>(m_file.Data() + section.offset + offset), length);
+}
+
+} // namespace Horizon
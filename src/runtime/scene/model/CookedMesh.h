@@ -0,0 +1,133 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <runtime/core/io/MappedFile.h>
+#include <runtime/core/math/Math.h>
+#include <runtime/function/rhi/vulkan/IndexBuffer.h>
+#include <runtime/function/rhi/vulkan/Vertex.h>
+
+namespace Horizon {
+
+// binary blob written next to the source model on first load, every section is 16 byte aligned:
+// header | vertices | indices | nodes | primitives | materials | textures | strings
+
+static constexpr u32 COOKED_MESH_MAGIC = 0x4d435a48; // "HZCM"
+static constexpr u32 COOKED_MESH_VERSION = 2;
+
+enum CookedMeshSection : u32 {
+    COOKED_MESH_SECTION_VERTICES = 0,
+    COOKED_MESH_SECTION_INDICES,
+    COOKED_MESH_SECTION_NODES,
+    COOKED_MESH_SECTION_PRIMITIVES,
+    COOKED_MESH_SECTION_MATERIALS,
+    COOKED_MESH_SECTION_TEXTURES,
+    COOKED_MESH_SECTION_STRINGS,
+    COOKED_MESH_SECTION_COUNT
+};
+
+struct CookedMeshHeader {
+    u32 magic;
+    u32 version;
+    u32 vertex_layout_version;
+    u32 vertex_stride;
+    u64 source_hash;
+    struct {
+        u64 offset;
+        u64 size;
+    } sections[COOKED_MESH_SECTION_COUNT];
+};
+
+// nodes are stored in pre order, a parent always precedes its children
+struct CookedNode {
+    i32 parent;
+    u32 index;
+    u32 has_mesh;
+    u32 first_primitive;
+    u32 primitive_count;
+    u32 name_offset;
+    u32 name_length;
+    u32 padding;
+    f32 translation[3];
+    f32 scale[3];
+    f32 rotation[4];
+    f32 matrix[16];
+};
+
+struct CookedPrimitive {
+    u32 first_index;
+    u32 index_count;
+    u32 vertex_count;
+    u32 material;
+    // local space aabb of the positions
+    f32 bounds_min[3];
+    f32 bounds_max[3];
+};
+
+// texture indices, -1 means the material falls back to the empty texture
+struct CookedMaterial {
+    i32 base_color_texture;
+    i32 normal_texture;
+    i32 metallic_roughness_texture;
+    i32 padding;
+};
+
+// image path relative to the source model
+struct CookedTexture {
+    u32 path_offset;
+    u32 path_length;
+};
+
+struct CookedMeshData {
+    const Vertex *vertices = nullptr;
+    u64 vertices_count = 0;
+    const Index *indices = nullptr;
+    u64 indices_count = 0;
+    std::vector<CookedNode> nodes;
+    std::vector<CookedPrimitive> primitives;
+    std::vector<CookedMaterial> materials;
+    std::vector<CookedTexture> textures;
+    std::string strings;
+
+    u32 AddString(const std::string &str) noexcept;
+};
+
+class CookedMesh {
+  public:
+    // hash of the source model and the buffers and images it references, used to invalidate the cache
+    static u64 HashSource(const std::string &path) noexcept;
+    static std::string GetCachePath(const std::string &path) noexcept;
+    static bool Write(const std::string &path, u64 source_hash, const CookedMeshData &data) noexcept;
+
+    bool Open(const std::string &path, u64 source_hash) noexcept;
+    void Close() noexcept;
+
+    const Vertex *GetVertices() const noexcept;
+    u64 GetVerticesCount() const noexcept;
+    const Index *GetIndices() const noexcept;
+    u64 GetIndicesCount() const noexcept;
+    const CookedNode *GetNodes() const noexcept;
+    u64 GetNodesCount() const noexcept;
+    const CookedPrimitive *GetPrimitives() const noexcept;
+    u64 GetPrimitivesCount() const noexcept;
+    const CookedMaterial *GetMaterials() const noexcept;
+    u64 GetMaterialsCount() const noexcept;
+    const CookedTexture *GetTextures() const noexcept;
+    u64 GetTexturesCount() const noexcept;
+    std::string GetString(u32 offset, u32 length) const noexcept;
+
+  private:
+    template <typename T> const T *GetSection(CookedMeshSection section) const noexcept {
+        return reinterpret_cast<const T *>(m_file.Data() + m_header->sections[section].offset);
+    }
+    template <typename T> u64 GetSectionCount(CookedMeshSection section) const noexcept {
+        return m_header->sections[section].size / sizeof(T);
+    }
+
+  private:
+    MappedFile m_file;
+    const CookedMeshHeader *m_header = nullptr;
+};
+
+} // namespace Horizon
@@ -0,0 +1,255 @@
+#include "MeshKernels.h"
+
+#include <cstring>
+
+#if defined(__AVX2__)
+#define HORIZON_MESH_KERNELS_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HORIZON_MESH_KERNELS_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace Horizon::MeshKernels {
+
+namespace {
+
+template <typename T> void WidenIndicesScalarT(u32 *dst, const T *src, u64 count, u32 base_vertex) noexcept {
+    for (u64 i = 0; i < count; i++) {
+        dst[i] = src[i] + base_vertex;
+    }
+}
+
+#if defined(HORIZON_MESH_KERNELS_AVX2) || defined(HORIZON_MESH_KERNELS_SSE2)
+
+// normalize 4 normals in soa form with the same operation order as glm::normalize:
+// v * (1 / sqrt((x * x + y * y) + z * z))
+inline void Normalize4(__m128 &x, __m128 &y, __m128 &z) noexcept {
+    __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+    __m128 inv = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(dot));
+    x = _mm_mul_ps(x, inv);
+    y = _mm_mul_ps(y, inv);
+    z = _mm_mul_ps(z, inv);
+}
+
+inline void GatherVertices4(Vertex *dst, const f32 *positions, u64 position_stride, const f32 *normals,
+                            u64 normal_stride, const f32 *uvs, u64 uv_stride) noexcept {
+    alignas(16) f32 nx[4], ny[4], nz[4];
+    if (normals) {
+        const f32 *n0 = normals, *n1 = n0 + normal_stride, *n2 = n1 + normal_stride, *n3 = n2 + normal_stride;
+        __m128 x = _mm_set_ps(n3[0], n2[0], n1[0], n0[0]);
+        __m128 y = _mm_set_ps(n3[1], n2[1], n1[1], n0[1]);
+        __m128 z = _mm_set_ps(n3[2], n2[2], n1[2], n0[2]);
+        Normalize4(x, y, z);
+        _mm_store_ps(nx, x);
+        _mm_store_ps(ny, y);
+        _mm_store_ps(nz, z);
+    } else {
+        __m128 x = _mm_setzero_ps(), y = _mm_setzero_ps(), z = _mm_setzero_ps();
+        Normalize4(x, y, z);
+        _mm_store_ps(nx, x);
+        _mm_store_ps(ny, y);
+        _mm_store_ps(nz, z);
+    }
+    for (u32 i = 0; i < 4; i++) {
+        Vertex &vert = dst[i];
+        memcpy(&vert.pos, positions + i * position_stride, sizeof(Math::vec3));
+        vert.normal = Math::vec3(nx[i], ny[i], nz[i]);
+        if (uvs) {
+            memcpy(&vert.uv0, uvs + i * uv_stride, sizeof(Math::vec2));
+        } else {
+            vert.uv0 = Math::vec2(0.0f);
+        }
+    }
+}
+
+#endif
+
+#if defined(HORIZON_MESH_KERNELS_AVX2)
+
+inline void GatherVertices8(Vertex *dst, const f32 *positions, u64 position_stride, const f32 *normals,
+                            u64 normal_stride, const f32 *uvs, u64 uv_stride) noexcept {
+    alignas(32) f32 nx[8], ny[8], nz[8];
+    if (normals) {
+        const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        __m256i index = _mm256_mullo_epi32(lane, _mm256_set1_epi32(static_cast<i32>(normal_stride)));
+        __m256 x = _mm256_i32gather_ps(normals, index, 4);
+        __m256 y = _mm256_i32gather_ps(normals + 1, index, 4);
+        __m256 z = _mm256_i32gather_ps(normals + 2, index, 4);
+        __m256 dot = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z));
+        __m256 inv = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(dot));
+        _mm256_store_ps(nx, _mm256_mul_ps(x, inv));
+        _mm256_store_ps(ny, _mm256_mul_ps(y, inv));
+        _mm256_store_ps(nz, _mm256_mul_ps(z, inv));
+    } else {
+        GatherVertices4(dst, positions, position_stride, normals, normal_stride, uvs, uv_stride);
+        GatherVertices4(dst + 4, positions + 4 * position_stride, position_stride, normals, normal_stride,
+                        uvs ? uvs + 4 * uv_stride : nullptr, uv_stride);
+        return;
+    }
+    for (u32 i = 0; i < 8; i++) {
+        Vertex &vert = dst[i];
+        memcpy(&vert.pos, positions + i * position_stride, sizeof(Math::vec3));
+        vert.normal = Math::vec3(nx[i], ny[i], nz[i]);
+        if (uvs) {
+            memcpy(&vert.uv0, uvs + i * uv_stride, sizeof(Math::vec2));
+        } else {
+            vert.uv0 = Math::vec2(0.0f);
+        }
+    }
+}
+
+#endif
+
+} // namespace
+
+const char *GetInstructionSet() noexcept {
+#if defined(HORIZON_MESH_KERNELS_AVX2)
+    return "avx2";
+#elif defined(HORIZON_MESH_KERNELS_SSE2)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+void GatherVerticesScalar(Vertex *dst, u64 count, const f32 *positions, u64 position_stride, const f32 *normals,
+                          u64 normal_stride, const f32 *uvs, u64 uv_stride) noexcept {
+    for (u64 v = 0; v < count; v++) {
+        Vertex &vert = dst[v];
+        vert.pos = Math::make_vec3(&positions[v * position_stride]);
+        vert.normal =
+            Math::normalize(Math::vec3(normals ? Math::make_vec3(&normals[v * normal_stride]) : Math::vec3(0.0f)));
+        vert.uv0 = uvs ? Math::make_vec2(&uvs[v * uv_stride]) : Math::vec2(0.0f);
+    }
+}
+
+void WidenIndicesScalar(u32 *dst, const void *src, u64 count, u32 component_size, u32 base_vertex) noexcept {
+    switch (component_size) {
+    case 4:
+        WidenIndicesScalarT(dst, static_cast<const u32 *>(src), count, base_vertex);
+        break;
+    case 2:
+        WidenIndicesScalarT(dst, static_cast<const u16 *>(src), count, base_vertex);
+        break;
+    case 1:
+        WidenIndicesScalarT(dst, static_cast<const u8 *>(src), count, base_vertex);
+        break;
+    default:
+        break;
+    }
+}
+
+void GatherVertices(Vertex *dst, u64 count, const f32 *positions, u64 position_stride, const f32 *normals,
+                    u64 normal_stride, const f32 *uvs, u64 uv_stride) noexcept {
+    u64 v = 0;
+#if defined(HORIZON_MESH_KERNELS_AVX2)
+    for (; v + 8 <= count; v += 8) {
+        GatherVertices8(dst + v, positions + v * position_stride, position_stride,
+                        normals ? normals + v * normal_stride : nullptr, normal_stride, uvs ? uvs + v * uv_stride : nullptr,
+                        uv_stride);
+    }
+#endif
+#if defined(HORIZON_MESH_KERNELS_AVX2) || defined(HORIZON_MESH_KERNELS_SSE2)
+    for (; v + 4 <= count; v += 4) {
+        GatherVertices4(dst + v, positions + v * position_stride, position_stride,
+                        normals ? normals + v * normal_stride : nullptr, normal_stride, uvs ? uvs + v * uv_stride : nullptr,
+                        uv_stride);
+    }
+#endif
+    GatherVerticesScalar(dst + v, count - v, positions + v * position_stride, position_stride,
+                         normals ? normals + v * normal_stride : nullptr, normal_stride,
+                         uvs ? uvs + v * uv_stride : nullptr, uv_stride);
+}
+
+void WidenIndices(u32 *dst, const void *src, u64 count, u32 component_size, u32 base_vertex) noexcept {
+    u64 i = 0;
+#if defined(HORIZON_MESH_KERNELS_AVX2)
+    const __m256i base = _mm256_set1_epi32(static_cast<i32>(base_vertex));
+    switch (component_size) {
+    case 4: {
+        const u32 *in = static_cast<const u32 *>(src);
+        for (; i + 8 <= count; i += 8) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_add_epi32(v, base));
+        }
+        break;
+    }
+    case 2: {
+        const u16 *in = static_cast<const u16 *>(src);
+        for (; i + 8 <= count; i += 8) {
+            __m256i v = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_add_epi32(v, base));
+        }
+        break;
+    }
+    case 1: {
+        const u8 *in = static_cast<const u8 *>(src);
+        for (; i + 8 <= count; i += 8) {
+            __m256i v = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(in + i)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_add_epi32(v, base));
+        }
+        break;
+    }
+    default:
+        return;
+    }
+#elif defined(HORIZON_MESH_KERNELS_SSE2)
+    const __m128i base = _mm_set1_epi32(static_cast<i32>(base_vertex));
+    const __m128i zero = _mm_setzero_si128();
+    switch (component_size) {
+    case 4: {
+        const u32 *in = static_cast<const u32 *>(src);
+        for (; i + 4 <= count; i += 4) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_add_epi32(v, base));
+        }
+        break;
+    }
+    case 2: {
+        const u16 *in = static_cast<const u16 *>(src);
+        for (; i + 8 <= count; i += 8) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_add_epi32(_mm_unpacklo_epi16(v, zero), base));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i + 4),
+                             _mm_add_epi32(_mm_unpackhi_epi16(v, zero), base));
+        }
+        break;
+    }
+    case 1: {
+        const u8 *in = static_cast<const u8 *>(src);
+        for (; i + 16 <= count; i += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+            __m128i lo = _mm_unpacklo_epi8(v, zero);
+            __m128i hi = _mm_unpackhi_epi8(v, zero);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_add_epi32(_mm_unpacklo_epi16(lo, zero), base));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i + 4),
+                             _mm_add_epi32(_mm_unpackhi_epi16(lo, zero), base));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i + 8),
+                             _mm_add_epi32(_mm_unpacklo_epi16(hi, zero), base));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i + 12),
+                             _mm_add_epi32(_mm_unpackhi_epi16(hi, zero), base));
+        }
+        break;
+    }
+    default:
+        return;
+    }
+#endif
+    // tail
+    switch (component_size) {
+    case 4:
+        WidenIndicesScalarT(dst + i, static_cast<const u32 *>(src) + i, count - i, base_vertex);
+        break;
+    case 2:
+        WidenIndicesScalarT(dst + i, static_cast<const u16 *>(src) + i, count - i, base_vertex);
+        break;
+    case 1:
+        WidenIndicesScalarT(dst + i, static_cast<const u8 *>(src) + i, count - i, base_vertex);
+        break;
+    default:
+        break;
+    }
+}
+
+} // namespace Horizon::MeshKernels
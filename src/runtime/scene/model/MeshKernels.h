@@ -0,0 +1,25 @@
+#pragma once
+
+#include <runtime/core/math/Math.h>
+#include <runtime/function/rhi/vulkan/Vertex.h>
+
+namespace Horizon::MeshKernels {
+
+// instruction set the kernels were compiled for, "avx2", "sse2" or "scalar"
+const char *GetInstructionSet() noexcept;
+
+// gather strided glTF accessor data into vertices, strides are in floats.
+// normals are normalized on the way, missing normal/uv streams (nullptr) are zero filled.
+// output is bit identical to the scalar glm path on every instruction set.
+void GatherVertices(Vertex *dst, u64 count, const f32 *positions, u64 position_stride, const f32 *normals,
+                    u64 normal_stride, const f32 *uvs, u64 uv_stride) noexcept;
+
+// widen 8/16/32 bit indices to u32 and rebase them by base_vertex
+void WidenIndices(u32 *dst, const void *src, u64 count, u32 component_size, u32 base_vertex) noexcept;
+
+// scalar reference versions, kept for validation and benchmarking
+void GatherVerticesScalar(Vertex *dst, u64 count, const f32 *positions, u64 position_stride, const f32 *normals,
+                          u64 normal_stride, const f32 *uvs, u64 uv_stride) noexcept;
+void WidenIndicesScalar(u32 *dst, const void *src, u64 count, u32 component_size, u32 base_vertex) noexcept;
+
+} // namespace Horizon::MeshKernels
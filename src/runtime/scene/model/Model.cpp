@@ -1,13 +1,31 @@
 #include "Model.h"
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <filesystem>
+
 #include <runtime/core/log/Log.h>
 #include <runtime/core/path/Path.h>
+#include <runtime/core/profile/Profiler.h>
+#include <runtime/core/thread/ThreadPool.h>
 #include <runtime/function/rhi/vulkan/VulkanBuffer.h>
+#include <runtime/scene/model/MeshKernels.h>
 
 namespace Horizon {
 Model::Model(const std::string &path, std::shared_ptr<Device> device, std::shared_ptr<CommandBuffer> command_buffer,
              std::shared_ptr<DescriptorSet> m_scene_descriptor_set) noexcept
     : m_device(device), m_command_buffer(command_buffer), m_scene_descriptor_set(m_scene_descriptor_set) {
+    PROFILE_SCOPE("Model::Model");
+
+    auto begin = std::chrono::steady_clock::now();
+    u64 source_hash = CookedMesh::HashSource(path);
+
+    if (LoadCookedMesh(path, source_hash)) {
+        f64 elapsed = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        LOG_INFO("{} loaded from cooked mesh in {} ms", path, elapsed);
+        return;
+    }
 
     tinygltf::TinyGLTF gltf_context;
     std::string error, warning;
@@ -19,14 +37,34 @@ Model::Model(const std::string &path, std::shared_ptr<Device> device, std::share
         LoadTextures(gltf_model);
         LoadMaterials(gltf_model);
         const tinygltf::Scene &scene = gltf_model.scenes[gltf_model.defaultScene > -1 ? gltf_model.defaultScene : 0];
+
+        // first pass builds the node tree and reserves a vertex and index range for every primitive
+        PrimitiveLayout layout;
         for (size_t i = 0; i < scene.nodes.size(); i++) {
             const tinygltf::Node node = gltf_model.nodes[scene.nodes[i]];
             f32 scale = 1.0;
-            LoadNode(nullptr, node, scene.nodes[i], gltf_model, m_indices, m_vertices, scale);
+            LoadNode(nullptr, node, scene.nodes[i], gltf_model, layout, scale);
         }
+        for (auto &node : m_nodes) {
+            AddNodeTransform(node, -1);
+        }
+
+        // second pass decodes the primitives into their ranges in parallel
+        m_vertices.resize(layout.vertex_count);
+        m_indices.resize(layout.index_count);
+        ThreadPool::GetInstance().ParallelFor(layout.jobs.size(), 1, [&](u64 begin, u64 end) {
+            for (u64 i = begin; i < end; i++) {
+                DecodePrimitive(gltf_model, layout.jobs[i], m_vertices.data(), m_indices.data());
+            }
+        });
 
         m_vertex_buffer = std::make_shared<VertexBuffer>(m_device, m_command_buffer, m_vertices);
         m_index_buffer = std::make_shared<IndexBuffer>(m_device, m_command_buffer, m_indices);
+
+        f64 elapsed = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        LOG_INFO("{} loaded from gltf in {} ms", path, elapsed);
+
+        CookMesh(path, source_hash, gltf_model);
     } else {
         LOG_ERROR("{} {}", error, warning);
     }
@@ -34,18 +72,47 @@ Model::Model(const std::string &path, std::shared_ptr<Device> device, std::share
 
 Model::~Model() noexcept {}
 
-void Model::Draw(std::shared_ptr<Pipeline> pipeline, VkCommandBuffer command_buffer) noexcept {
+u32 Model::Draw(std::shared_ptr<Pipeline> pipeline, VkCommandBuffer command_buffer, VkDescriptorSet material_table,
+                u32 first_instance, u32 instance_count) noexcept {
+    u32 last_instance = static_cast<u32>(std::min<u64>(static_cast<u64>(first_instance) + instance_count,
+                                                       m_instances.size()));
     const VkDeviceSize offsets[1] = {0};
     VkBuffer vertexBuffer = m_vertex_buffer->Get();
 
     vkCmdBindVertexBuffers(command_buffer, 0, 1, &vertexBuffer, offsets);
     vkCmdBindIndexBuffer(command_buffer, m_index_buffer->Get(), 0, VK_INDEX_TYPE_UINT32);
-    for (auto &node : m_nodes) {
-        DrawNode(node, pipeline, command_buffer);
+
+    u32 draw_count = 0;
+    if (material_table) {
+        // one bind for the whole model, primitives only push their material index
+        std::array<VkDescriptorSet, 2> descriptors{m_scene_descriptor_set->Get(), material_table};
+        std::vector<u32> dynamic_offsets;
+        m_scene_descriptor_set->GetDynamicOffsets(dynamic_offsets);
+        vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->GetLayout(), 0,
+                                descriptors.size(), descriptors.data(), dynamic_offsets.size(),
+                                dynamic_offsets.data());
+        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->Get());
+        for (u32 i = first_instance; i < last_instance; i++) {
+            for (auto &node : m_nodes) {
+                DrawNodeBindless(node, pipeline->GetLayout(), command_buffer, m_instances[i], draw_count);
+            }
+        }
+        return draw_count;
     }
+
+    for (u32 i = first_instance; i < last_instance; i++) {
+        for (auto &node : m_nodes) {
+            DrawNode(node, pipeline, command_buffer, m_instances[i], draw_count);
+        }
+    }
+    return draw_count;
 }
 
 void Model::LoadTextures(tinygltf::Model &gltfModel) noexcept {
+    PROFILE_SCOPE("Model::LoadTextures");
+    auto begin = std::chrono::steady_clock::now();
+    UploadStats stats = m_command_buffer->GetUploadManager()->GetStats();
+
     //auto getVkFilterMode = [](int32_t filterMode)
     //{
     //	switch (filterMode) {
@@ -109,6 +176,21 @@ void Model::LoadTextures(tinygltf::Model &gltfModel) noexcept {
         m_textures.emplace_back(std::make_shared<Texture>(m_device, m_command_buffer, gltfModel.images[tex.source]));
     }
 
+    CreateEmptyTexture();
+    FlushTextureUploads(stats, begin);
+}
+
+void Model::FlushTextureUploads(const UploadStats &stats, std::chrono::steady_clock::time_point begin) noexcept {
+    std::shared_ptr<UploadManager> upload_manager = m_command_buffer->GetUploadManager();
+    upload_manager->Flush();
+    const UploadStats &current = upload_manager->GetStats();
+    f64 elapsed = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    LOG_INFO("queued {} textures ({} MB) in {} ms, {} submits, {} staging stalls", current.images - stats.images,
+             (current.bytes - stats.bytes) / (1024.0 * 1024.0), elapsed, current.submits - stats.submits,
+             current.stalls - stats.stalls);
+}
+
+void Model::CreateEmptyTexture() noexcept {
     if (!m_empty_texture) {
         m_empty_texture = std::make_shared<Texture>(m_device, m_command_buffer);
         m_empty_texture->loadFromFile(Path::GetTexturePath("black.jpg"),
@@ -118,16 +200,13 @@ void Model::LoadTextures(tinygltf::Model &gltfModel) noexcept {
 }
 
 void Model::LoadMaterials(tinygltf::Model &gltfModel) noexcept {
+    PROFILE_SCOPE("Model::LoadMaterials");
     for (tinygltf::Material &mat : gltfModel.materials) {
-        std::shared_ptr<Material> material = std::make_shared<Material>();
+        CookedMaterial textures{-1, -1, -1, 0};
         // bc
         if (mat.values.find("baseColorTexture") != mat.values.end()) {
-            material->base_color_texture = m_textures[mat.values["baseColorTexture"].TextureIndex()];
+            textures.base_color_texture = mat.values["baseColorTexture"].TextureIndex();
             //material->texCoordSets.baseColor = mat.values["base_color_texture"].TextureTexCoord();
-            material->m_material_ubdata.has_base_color = true;
-        } else {
-            LOG_WARN("no base color texture found, use an empty texture instead");
-            material->base_color_texture = m_empty_texture;
         }
 
         //if (mat.values.find("baseColorFactor") != mat.values.end()) {
@@ -138,22 +217,14 @@ void Model::LoadMaterials(tinygltf::Model &gltfModel) noexcept {
 
         // normal
         if (mat.additionalValues.find("normalTexture") != mat.additionalValues.end()) {
-            material->normal_texture = m_textures[mat.additionalValues["normalTexture"].TextureIndex()];
+            textures.normal_texture = mat.additionalValues["normalTexture"].TextureIndex();
             //material->texCoordSets.normal = mat.additionalValues["normal_texture"].TextureTexCoord();
-            material->m_material_ubdata.has_normal = true;
-        } else {
-            LOG_WARN("no normal texture found, use an empty texture instead");
-            material->normal_texture = m_empty_texture;
         }
 
         // metallic roughtness
         if (mat.values.find("metallicRoughnessTexture") != mat.values.end()) {
-            material->metallic_rougness_texture = m_textures[mat.values["metallicRoughnessTexture"].TextureIndex()];
+            textures.metallic_roughness_texture = mat.values["metallicRoughnessTexture"].TextureIndex();
             //material->texCoordSets.metallicRoughness = mat.values["metallic_rougness_texture"].TextureTexCoord();
-            material->m_material_ubdata.has_metallic_rougness = true;
-        } else {
-            LOG_WARN("no metallicRoughness texture found, use an empty texture instead");
-            material->metallic_rougness_texture = m_empty_texture;
         }
         /*
 			if (mat.values.find("roughnessFactor") != mat.values.end()) {
@@ -180,30 +251,58 @@ void Model::LoadMaterials(tinygltf::Model &gltfModel) noexcept {
         //	material.emissiveFactor = Math::vec4(0.0f);
         //}
 
-        material->m_material_ub = std::make_shared<UniformBuffer>(m_device);
-
-        std::shared_ptr<DescriptorSetInfo> setInfo = std::make_shared<DescriptorSetInfo>();
-        // material parameters
-        setInfo->AddBinding(DescriptorType::DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-                            SHADER_STAGE_VERTEX_SHADER | SHADER_STAGE_PIXEL_SHADER);
-        // albedo/normal/metallicroughness
-        setInfo->AddBinding(DescriptorType::DESCRIPTOR_TYPE_TEXTURE,
-                            SHADER_STAGE_VERTEX_SHADER | SHADER_STAGE_PIXEL_SHADER);
-        setInfo->AddBinding(DescriptorType::DESCRIPTOR_TYPE_TEXTURE,
-                            SHADER_STAGE_VERTEX_SHADER | SHADER_STAGE_PIXEL_SHADER);
-        setInfo->AddBinding(DescriptorType::DESCRIPTOR_TYPE_TEXTURE,
-                            SHADER_STAGE_VERTEX_SHADER | SHADER_STAGE_PIXEL_SHADER);
-        material->m_material_descriptor_set = std::make_shared<DescriptorSet>(m_device, setInfo);
-
-        m_materials.push_back(material);
+        m_materials.push_back(CreateMaterial(textures));
     }
     // Push a default material at the end of the list for meshes with no material assigned
     //m_materials.push_back(Material());
 }
 
+std::shared_ptr<Material> Model::CreateMaterial(const CookedMaterial &textures) noexcept {
+    std::shared_ptr<Material> material = std::make_shared<Material>();
+    // bc
+    if (textures.base_color_texture > -1) {
+        material->base_color_texture = m_textures[textures.base_color_texture];
+        material->m_material_ubdata.has_base_color = true;
+    } else {
+        LOG_WARN("no base color texture found, use an empty texture instead");
+        material->base_color_texture = m_empty_texture;
+    }
+
+    // normal
+    if (textures.normal_texture > -1) {
+        material->normal_texture = m_textures[textures.normal_texture];
+        material->m_material_ubdata.has_normal = true;
+    } else {
+        LOG_WARN("no normal texture found, use an empty texture instead");
+        material->normal_texture = m_empty_texture;
+    }
+
+    // metallic roughtness
+    if (textures.metallic_roughness_texture > -1) {
+        material->metallic_rougness_texture = m_textures[textures.metallic_roughness_texture];
+        material->m_material_ubdata.has_metallic_rougness = true;
+    } else {
+        LOG_WARN("no metallicRoughness texture found, use an empty texture instead");
+        material->metallic_rougness_texture = m_empty_texture;
+    }
+
+    material->m_material_ub = std::make_shared<UniformBuffer>(m_device);
+
+    std::shared_ptr<DescriptorSetInfo> setInfo = std::make_shared<DescriptorSetInfo>();
+    // material parameters
+    setInfo->AddBinding(DescriptorType::DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                        SHADER_STAGE_VERTEX_SHADER | SHADER_STAGE_PIXEL_SHADER);
+    // albedo/normal/metallicroughness
+    setInfo->AddBinding(DescriptorType::DESCRIPTOR_TYPE_TEXTURE, SHADER_STAGE_VERTEX_SHADER | SHADER_STAGE_PIXEL_SHADER);
+    setInfo->AddBinding(DescriptorType::DESCRIPTOR_TYPE_TEXTURE, SHADER_STAGE_VERTEX_SHADER | SHADER_STAGE_PIXEL_SHADER);
+    setInfo->AddBinding(DescriptorType::DESCRIPTOR_TYPE_TEXTURE, SHADER_STAGE_VERTEX_SHADER | SHADER_STAGE_PIXEL_SHADER);
+    material->m_material_descriptor_set = std::make_shared<DescriptorSet>(m_device, setInfo);
+
+    return material;
+}
+
 void Model::LoadNode(std::shared_ptr<Node> m_parent, const tinygltf::Node &node, uint32_t nodeIndex,
-                     const tinygltf::Model &model, std::vector<u32> &indices, std::vector<Vertex> &vertices,
-                     f32 globalscale) noexcept {
+                     const tinygltf::Model &model, PrimitiveLayout &layout, f32 globalscale) noexcept {
     std::shared_ptr<Node> newNode = std::make_shared<Node>();
     newNode->index = nodeIndex;
     newNode->m_parent = m_parent;
@@ -231,125 +330,52 @@ void Model::LoadNode(std::shared_ptr<Node> m_parent, const tinygltf::Node &node,
     // Node with m_children
     if (node.children.size() > 0) {
         for (size_t i = 0; i < node.children.size(); i++) {
-            LoadNode(newNode, model.nodes[node.children[i]], node.children[i], model, indices, vertices, globalscale);
+            LoadNode(newNode, model.nodes[node.children[i]], node.children[i], model, layout, globalscale);
         }
     }
 
     // Node contains mesh data
     if (node.mesh > -1) {
-        const tinygltf::Mesh mesh = model.meshes[node.mesh];
-        std::shared_ptr<Mesh> newMesh = std::make_shared<Mesh>(m_device, newNode->matrix);
+        const tinygltf::Mesh &mesh = model.meshes[node.mesh];
+        std::shared_ptr<Mesh> newMesh = std::make_shared<Mesh>(m_device);
         for (size_t j = 0; j < mesh.primitives.size(); j++) {
             const tinygltf::Primitive &primitive = mesh.primitives[j];
-            uint32_t indexStart = static_cast<uint32_t>(indices.size());
-            uint32_t vertexStart = static_cast<uint32_t>(vertices.size());
+            uint32_t indexStart = layout.index_count;
+            uint32_t vertexStart = layout.vertex_count;
             uint32_t indexCount = 0;
             uint32_t vertexCount = 0;
-            Math::vec3 posMin{};
-            Math::vec3 posMax{};
-            bool hasSkin = false;
             bool hasIndices = primitive.indices > -1;
-            // Vertices
-            {
-                const f32 *bufferPos = nullptr;
-                const f32 *bufferNormals = nullptr;
-                const f32 *bufferTexCoordSet0 = nullptr;
-                const f32 *bufferTexCoordSet1 = nullptr;
-                const void *bufferJoints = nullptr;
-                const f32 *bufferWeights = nullptr;
-
-                int posByteStride;
-                int normByteStride;
-                int uv0ByteStride;
-                int uv1ByteStride;
-                int jointByteStride;
-                int weightByteStride;
-
-                int jointComponentType;
-
-                // Position attribute is required
-                assert(primitive.attributes.find("POSITION") != primitive.attributes.end());
-
-                const tinygltf::Accessor &posAccessor = model.accessors[primitive.attributes.find("POSITION")->second];
-                const tinygltf::BufferView &posView = model.bufferViews[posAccessor.bufferView];
-                bufferPos = reinterpret_cast<const f32 *>(
-                    &(model.buffers[posView.buffer].data[posAccessor.byteOffset + posView.byteOffset]));
-                posMin = Math::vec3(posAccessor.minValues[0], posAccessor.minValues[1], posAccessor.minValues[2]);
-                posMax = Math::vec3(posAccessor.maxValues[0], posAccessor.maxValues[1], posAccessor.maxValues[2]);
-                vertexCount = static_cast<uint32_t>(posAccessor.count);
-                posByteStride = posAccessor.ByteStride(posView) ? (posAccessor.ByteStride(posView) / sizeof(f32))
-                                                                : sizeof(Math::vec3) * 8;
-
-                if (primitive.attributes.find("NORMAL") != primitive.attributes.end()) {
-                    const tinygltf::Accessor &normAccessor =
-                        model.accessors[primitive.attributes.find("NORMAL")->second];
-                    const tinygltf::BufferView &normView = model.bufferViews[normAccessor.bufferView];
-                    bufferNormals = reinterpret_cast<const f32 *>(
-                        &(model.buffers[normView.buffer].data[normAccessor.byteOffset + normView.byteOffset]));
-                    normByteStride = normAccessor.ByteStride(normView)
-                                         ? (normAccessor.ByteStride(normView) / sizeof(f32))
-                                         : sizeof(Math::vec3) * 8;
-                }
 
-                if (primitive.attributes.find("TEXCOORD_0") != primitive.attributes.end()) {
-                    const tinygltf::Accessor &uvAccessor =
-                        model.accessors[primitive.attributes.find("TEXCOORD_0")->second];
-                    const tinygltf::BufferView &uvView = model.bufferViews[uvAccessor.bufferView];
-                    bufferTexCoordSet0 = reinterpret_cast<const f32 *>(
-                        &(model.buffers[uvView.buffer].data[uvAccessor.byteOffset + uvView.byteOffset]));
-                    uv0ByteStride = uvAccessor.ByteStride(uvView) ? (uvAccessor.ByteStride(uvView) / sizeof(f32))
-                                                                  : sizeof(Math::vec3) * 8;
-                }
-                for (size_t v = 0; v < posAccessor.count; v++) {
-                    Vertex vert;
-                    vert.pos = Math::make_vec3(&bufferPos[v * posByteStride]);
-                    vert.normal = Math::normalize(Math::vec3(
-                        bufferNormals ? Math::make_vec3(&bufferNormals[v * normByteStride]) : Math::vec3(0.0f)));
-                    vert.uv0 =
-                        bufferTexCoordSet0 ? Math::make_vec2(&bufferTexCoordSet0[v * uv0ByteStride]) : Math::vec3(0.0f);
-                    //vert.uv1 = bufferTexCoordSet1 ? Math::make_vec2(&bufferTexCoordSet1[v * uv1ByteStride]) : Math::vec3(0.0f);
-                    vertices.push_back(vert);
-                }
-            }
-            // Indices
-            if (hasIndices) {
-                const tinygltf::Accessor &accessor = model.accessors[primitive.indices > -1 ? primitive.indices : 0];
-                const tinygltf::BufferView &bufferView = model.bufferViews[accessor.bufferView];
-                const tinygltf::Buffer &buffer = model.buffers[bufferView.buffer];
-
-                indexCount = static_cast<uint32_t>(accessor.count);
-                const void *dataPtr = &(buffer.data[accessor.byteOffset + bufferView.byteOffset]);
+            // Position attribute is required
+            assert(primitive.attributes.find("POSITION") != primitive.attributes.end());
+            vertexCount = static_cast<uint32_t>(model.accessors[primitive.attributes.find("POSITION")->second].count);
+            layout.vertex_count += vertexCount;
+            layout.jobs.push_back({&primitive, vertexStart, indexStart});
 
+            if (hasIndices) {
+                const tinygltf::Accessor &accessor = model.accessors[primitive.indices];
                 switch (accessor.componentType) {
-                case TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT: {
-                    const uint32_t *buf = static_cast<const uint32_t *>(dataPtr);
-                    for (size_t index = 0; index < accessor.count; index++) {
-                        indices.push_back(buf[index] + vertexStart);
-                    }
-                    break;
-                }
-                case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT: {
-                    const uint16_t *buf = static_cast<const uint16_t *>(dataPtr);
-                    for (size_t index = 0; index < accessor.count; index++) {
-                        indices.push_back(buf[index] + vertexStart);
-                    }
-                    break;
-                }
-                case TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE: {
-                    const uint8_t *buf = static_cast<const uint8_t *>(dataPtr);
-                    for (size_t index = 0; index < accessor.count; index++) {
-                        indices.push_back(buf[index] + vertexStart);
-                    }
+                case TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT:
+                case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT:
+                case TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE:
                     break;
-                }
                 default:
-                    //std::cerr << "Index component type " << accessor.componentType << " not supported!" << std::endl;
+                    LOG_ERROR("index component type {} not supported", accessor.componentType);
                     return;
                 }
+                indexCount = static_cast<uint32_t>(accessor.count);
+                layout.index_count += indexCount;
             }
-            newMesh->primitives.emplace_back(std::make_shared<MeshPrimitive>(
+            auto newPrimitive = std::make_shared<MeshPrimitive>(
                 indexStart, indexCount, vertexCount,
-                primitive.material > -1 ? m_materials[primitive.material] : m_materials[0]));
+                primitive.material > -1 ? m_materials[primitive.material] : m_materials[0]);
+            // gltf requires min and max on positions, primitives without them are never culled
+            const tinygltf::Accessor &posAccessor = model.accessors[primitive.attributes.find("POSITION")->second];
+            if (posAccessor.minValues.size() == 3 && posAccessor.maxValues.size() == 3) {
+                newPrimitive->boundsMin = Math::make_vec3(posAccessor.minValues.data());
+                newPrimitive->boundsMax = Math::make_vec3(posAccessor.maxValues.data());
+            }
+            newMesh->primitives.emplace_back(newPrimitive);
         }
         newNode->mesh = newMesh;
     }
@@ -361,48 +387,318 @@ void Model::LoadNode(std::shared_ptr<Node> m_parent, const tinygltf::Node &node,
     m_linear_nodes.push_back(newNode);
 }
 
-void Model::DrawNode(std::shared_ptr<Node> node, std::shared_ptr<Pipeline> pipeline,
-                     VkCommandBuffer command_buffer) noexcept {
+void Model::DecodePrimitive(const tinygltf::Model &model, const PrimitiveDecodeJob &job, Vertex *vertices,
+                            u32 *indices) noexcept {
+    const tinygltf::Primitive &primitive = *job.primitive;
+    uint32_t vertexStart = job.vertex_start;
+    // Vertices
+    {
+        const f32 *bufferPos = nullptr;
+        const f32 *bufferNormals = nullptr;
+        const f32 *bufferTexCoordSet0 = nullptr;
+
+        int posByteStride = 0;
+        int normByteStride = 0;
+        int uv0ByteStride = 0;
+
+        const tinygltf::Accessor &posAccessor = model.accessors[primitive.attributes.find("POSITION")->second];
+        const tinygltf::BufferView &posView = model.bufferViews[posAccessor.bufferView];
+        bufferPos = reinterpret_cast<const f32 *>(
+            &(model.buffers[posView.buffer].data[posAccessor.byteOffset + posView.byteOffset]));
+        posByteStride = posAccessor.ByteStride(posView) ? (posAccessor.ByteStride(posView) / sizeof(f32))
+                                                        : sizeof(Math::vec3) * 8;
+
+        if (primitive.attributes.find("NORMAL") != primitive.attributes.end()) {
+            const tinygltf::Accessor &normAccessor = model.accessors[primitive.attributes.find("NORMAL")->second];
+            const tinygltf::BufferView &normView = model.bufferViews[normAccessor.bufferView];
+            bufferNormals = reinterpret_cast<const f32 *>(
+                &(model.buffers[normView.buffer].data[normAccessor.byteOffset + normView.byteOffset]));
+            normByteStride = normAccessor.ByteStride(normView) ? (normAccessor.ByteStride(normView) / sizeof(f32))
+                                                               : sizeof(Math::vec3) * 8;
+        }
+
+        if (primitive.attributes.find("TEXCOORD_0") != primitive.attributes.end()) {
+            const tinygltf::Accessor &uvAccessor = model.accessors[primitive.attributes.find("TEXCOORD_0")->second];
+            const tinygltf::BufferView &uvView = model.bufferViews[uvAccessor.bufferView];
+            bufferTexCoordSet0 = reinterpret_cast<const f32 *>(
+                &(model.buffers[uvView.buffer].data[uvAccessor.byteOffset + uvView.byteOffset]));
+            uv0ByteStride = uvAccessor.ByteStride(uvView) ? (uvAccessor.ByteStride(uvView) / sizeof(f32))
+                                                          : sizeof(Math::vec3) * 8;
+        }
+        MeshKernels::GatherVertices(vertices + vertexStart, posAccessor.count, bufferPos, posByteStride,
+                                    bufferNormals, normByteStride, bufferTexCoordSet0, uv0ByteStride);
+    }
+    // Indices
+    if (primitive.indices > -1) {
+        const tinygltf::Accessor &accessor = model.accessors[primitive.indices];
+        const tinygltf::BufferView &bufferView = model.bufferViews[accessor.bufferView];
+        const tinygltf::Buffer &buffer = model.buffers[bufferView.buffer];
+
+        const void *dataPtr = &(buffer.data[accessor.byteOffset + bufferView.byteOffset]);
+        MeshKernels::WidenIndices(indices + job.index_start, dataPtr, accessor.count,
+                                  tinygltf::GetComponentSizeInBytes(accessor.componentType), vertexStart);
+    }
+}
+
+bool Model::LoadCookedMesh(const std::string &path, u64 source_hash) noexcept {
+    CookedMesh cooked;
+    if (!cooked.Open(CookedMesh::GetCachePath(path), source_hash)) {
+        return false;
+    }
+
+    const CookedTexture *textures = cooked.GetTextures();
+    const CookedMaterial *materials = cooked.GetMaterials();
+    const CookedPrimitive *primitives = cooked.GetPrimitives();
+    const CookedNode *nodes = cooked.GetNodes();
+    u64 textures_count = cooked.GetTexturesCount();
+    u64 materials_count = cooked.GetMaterialsCount();
+    u64 primitives_count = cooked.GetPrimitivesCount();
+    u64 nodes_count = cooked.GetNodesCount();
+    u64 indices_count = cooked.GetIndicesCount();
+
+    // validate every cross reference before touching gpu resources
+    auto valid_texture = [&](i32 texture) { return texture < static_cast<i64>(textures_count); };
+    for (u64 i = 0; i < materials_count; i++) {
+        if (!valid_texture(materials[i].base_color_texture) || !valid_texture(materials[i].normal_texture) ||
+            !valid_texture(materials[i].metallic_roughness_texture)) {
+            LOG_WARN("invalid texture reference in cooked mesh of {}", path);
+            return false;
+        }
+    }
+    for (u64 i = 0; i < primitives_count; i++) {
+        if (primitives[i].material >= materials_count ||
+            static_cast<u64>(primitives[i].first_index) + primitives[i].index_count > indices_count) {
+            LOG_WARN("invalid primitive in cooked mesh of {}", path);
+            return false;
+        }
+    }
+    for (u64 i = 0; i < nodes_count; i++) {
+        if (nodes[i].parent >= static_cast<i64>(i) ||
+            static_cast<u64>(nodes[i].first_primitive) + nodes[i].primitive_count > primitives_count) {
+            LOG_WARN("invalid node in cooked mesh of {}", path);
+            return false;
+        }
+    }
+
+    auto textures_begin = std::chrono::steady_clock::now();
+    UploadStats stats = m_command_buffer->GetUploadManager()->GetStats();
+    std::filesystem::path directory = std::filesystem::path(path).parent_path();
+    for (u64 i = 0; i < textures_count; i++) {
+        std::string image = cooked.GetString(textures[i].path_offset, textures[i].path_length);
+        std::shared_ptr<Texture> texture = std::make_shared<Texture>(m_device, m_command_buffer);
+        texture->loadFromFile((directory / image).string(),
+                              VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                              VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        m_textures.push_back(texture);
+    }
+    CreateEmptyTexture();
+    FlushTextureUploads(stats, textures_begin);
+
+    for (u64 i = 0; i < materials_count; i++) {
+        m_materials.push_back(CreateMaterial(materials[i]));
+    }
+
+    std::vector<std::shared_ptr<Node>> loaded_nodes(nodes_count);
+    for (u64 i = 0; i < nodes_count; i++) {
+        const CookedNode &cooked_node = nodes[i];
+        std::shared_ptr<Node> newNode = std::make_shared<Node>();
+        newNode->index = cooked_node.index;
+        newNode->m_parent = cooked_node.parent > -1 ? loaded_nodes[cooked_node.parent] : nullptr;
+        newNode->name = cooked.GetString(cooked_node.name_offset, cooked_node.name_length);
+        newNode->translation = Math::make_vec3(cooked_node.translation);
+        newNode->scale = Math::make_vec3(cooked_node.scale);
+        newNode->rotation = Math::make_quat(cooked_node.rotation);
+        newNode->matrix = Math::make_mat4x4(cooked_node.matrix);
+
+        if (cooked_node.has_mesh) {
+            std::shared_ptr<Mesh> newMesh = std::make_shared<Mesh>(m_device);
+            for (u32 j = 0; j < cooked_node.primitive_count; j++) {
+                const CookedPrimitive &primitive = primitives[cooked_node.first_primitive + j];
+                auto newPrimitive = std::make_shared<MeshPrimitive>(primitive.first_index, primitive.index_count,
+                                                                    primitive.vertex_count,
+                                                                    m_materials[primitive.material]);
+                newPrimitive->boundsMin = Math::make_vec3(primitive.bounds_min);
+                newPrimitive->boundsMax = Math::make_vec3(primitive.bounds_max);
+                newMesh->primitives.emplace_back(newPrimitive);
+            }
+            newNode->mesh = newMesh;
+        }
+
+        if (newNode->m_parent) {
+            newNode->m_parent->m_children.push_back(newNode);
+        } else {
+            m_nodes.push_back(newNode);
+        }
+        m_linear_nodes.push_back(newNode);
+        loaded_nodes[i] = newNode;
+    }
+    for (auto &node : m_nodes) {
+        AddNodeTransform(node, -1);
+    }
+
+    // upload straight from the mapping, the cpu side copies are only kept on the gltf path
+    m_vertex_buffer =
+        std::make_shared<VertexBuffer>(m_device, m_command_buffer, cooked.GetVertices(), cooked.GetVerticesCount());
+    m_index_buffer = std::make_shared<IndexBuffer>(m_device, m_command_buffer, cooked.GetIndices(), indices_count);
+    return true;
+}
+
+void Model::CookMesh(const std::string &path, u64 source_hash, const tinygltf::Model &gltfModel) noexcept {
+    CookedMeshData data;
+    data.vertices = m_vertices.data();
+    data.vertices_count = m_vertices.size();
+    data.indices = m_indices.data();
+    data.indices_count = m_indices.size();
+
+    for (const tinygltf::Texture &tex : gltfModel.textures) {
+        const std::string &uri = gltfModel.images[tex.source].uri;
+        // embedded images would have to be baked into the blob, keep parsing the gltf for those
+        if (uri.empty() || uri.rfind("data:", 0) == 0) {
+            LOG_WARN("{} has embedded images, skip cooking", path);
+            return;
+        }
+        u32 offset = data.AddString(uri);
+        data.textures.push_back({offset, static_cast<u32>(uri.size())});
+    }
+
+    for (const auto &material : m_materials) {
+        auto texture_index = [&](const std::shared_ptr<Texture> &texture) {
+            auto it = std::find(m_textures.begin(), m_textures.end(), texture);
+            return it != m_textures.end() ? static_cast<i32>(it - m_textures.begin()) : -1;
+        };
+        data.materials.push_back({texture_index(material->base_color_texture),
+                                  texture_index(material->normal_texture),
+                                  texture_index(material->metallic_rougness_texture), 0});
+    }
+
+    for (const auto &node : m_nodes) {
+        CookNode(node, -1, data);
+    }
+
+    std::string cooked_path = CookedMesh::GetCachePath(path);
+    if (CookedMesh::Write(cooked_path, source_hash, data)) {
+        LOG_INFO("cooked {}", cooked_path);
+    }
+}
+
+void Model::CookNode(const std::shared_ptr<Node> &node, i32 parent, CookedMeshData &data) noexcept {
+    CookedNode cooked_node{};
+    cooked_node.parent = parent;
+    cooked_node.index = node->index;
+    cooked_node.name_offset = data.AddString(node->name);
+    cooked_node.name_length = static_cast<u32>(node->name.size());
+    memcpy(cooked_node.translation, &node->translation, sizeof(cooked_node.translation));
+    memcpy(cooked_node.scale, &node->scale, sizeof(cooked_node.scale));
+    memcpy(cooked_node.rotation, &node->rotation, sizeof(cooked_node.rotation));
+    memcpy(cooked_node.matrix, &node->matrix, sizeof(cooked_node.matrix));
+
+    if (node->mesh) {
+        cooked_node.has_mesh = 1;
+        cooked_node.first_primitive = static_cast<u32>(data.primitives.size());
+        cooked_node.primitive_count = static_cast<u32>(node->mesh->primitives.size());
+        for (const auto &primitive : node->mesh->primitives) {
+            auto material = std::find(m_materials.begin(), m_materials.end(), primitive->material);
+            CookedPrimitive cooked_primitive{};
+            cooked_primitive.first_index = primitive->firstIndex;
+            cooked_primitive.index_count = primitive->indexCount;
+            cooked_primitive.vertex_count = primitive->vertexCount;
+            cooked_primitive.material = static_cast<u32>(material - m_materials.begin());
+            memcpy(cooked_primitive.bounds_min, &primitive->boundsMin, sizeof(cooked_primitive.bounds_min));
+            memcpy(cooked_primitive.bounds_max, &primitive->boundsMax, sizeof(cooked_primitive.bounds_max));
+            data.primitives.push_back(cooked_primitive);
+        }
+    }
+
+    i32 index = static_cast<i32>(data.nodes.size());
+    data.nodes.push_back(cooked_node);
+    for (const auto &child : node->m_children) {
+        CookNode(child, index, data);
+    }
+}
+
+void Model::DrawNode(std::shared_ptr<Node> node, std::shared_ptr<Pipeline> pipeline, VkCommandBuffer command_buffer,
+                     const Math::mat4 &instance, u32 &draw_count) noexcept {
     if (node->mesh) {
+        Mesh::MeshPushConstant push_constant{};
+        push_constant.modelMatrix = instance * m_transforms.GetWorld(node->transform);
         for (auto &primitive : node->mesh->primitives) {
             std::vector<VkDescriptorSet> descriptors{m_scene_descriptor_set->Get(),
                                                      primitive->material->m_material_descriptor_set->Get()};
+            std::vector<u32> dynamic_offsets;
+            m_scene_descriptor_set->GetDynamicOffsets(dynamic_offsets);
+            primitive->material->m_material_descriptor_set->GetDynamicOffsets(dynamic_offsets);
 
             vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->GetLayout(), 0,
-                                    descriptors.size(), descriptors.data(), 0, 0);
+                                    descriptors.size(), descriptors.data(), dynamic_offsets.size(),
+                                    dynamic_offsets.data());
             vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->Get());
             if (pipeline->hasPushConstants()) {
                 vkCmdPushConstants(command_buffer, pipeline->GetLayout(), SHADER_STAGE_VERTEX_SHADER, 0,
-                                   sizeof(node->mesh->m_mesh_push_constant), &node->mesh->m_mesh_push_constant);
+                                   sizeof(push_constant), &push_constant);
             }
             vkCmdDrawIndexed(command_buffer, primitive->indexCount, 1, primitive->firstIndex, 0, 0);
+            draw_count++;
         }
     }
     for (auto &child : node->m_children) {
-        DrawNode(child, pipeline, command_buffer);
+        DrawNode(child, pipeline, command_buffer, instance, draw_count);
     }
 }
 
-void Model::UpdateDescriptors() noexcept {
-    for (auto &material : m_materials) {
-        material->UpdateDescriptorSet();
+void Model::DrawNodeBindless(const std::shared_ptr<Node> &node, VkPipelineLayout layout,
+                             VkCommandBuffer command_buffer, const Math::mat4 &instance, u32 &draw_count) noexcept {
+    if (node->mesh) {
+        // model matrix once per node, the material index behind it once per primitive
+        Math::mat4 model_matrix = instance * m_transforms.GetWorld(node->transform);
+        vkCmdPushConstants(command_buffer, layout, SHADER_STAGE_VERTEX_SHADER, 0, sizeof(Math::mat4), &model_matrix);
+        for (auto &primitive : node->mesh->primitives) {
+            vkCmdPushConstants(command_buffer, layout, SHADER_STAGE_VERTEX_SHADER, sizeof(Math::mat4), sizeof(u32),
+                               &primitive->material->m_material_index);
+            vkCmdDrawIndexed(command_buffer, primitive->indexCount, 1, primitive->firstIndex, 0, 0);
+            draw_count++;
+        }
+    }
+    for (auto &child : node->m_children) {
+        DrawNodeBindless(child, layout, command_buffer, instance, draw_count);
     }
 }
 
-void Model::UpdateModelMatrix() noexcept {
-    for (auto &node : m_nodes) {
-        UpdateNodeModelMatrix(node);
+void Model::GatherInstances(IndirectDrawList &draw_list) noexcept {
+    draw_list.AddBatch(m_vertex_buffer->Get(), m_index_buffer->Get());
+    for (auto &instance : m_instances) {
+        for (auto &node : m_linear_nodes) {
+            if (!node->mesh) {
+                continue;
+            }
+            Math::mat4 model_matrix = instance * m_transforms.GetWorld(node->transform);
+            for (auto &primitive : node->mesh->primitives) {
+                draw_list.AddInstance(model_matrix, primitive->boundsMin, primitive->boundsMax,
+                                      primitive->firstIndex, primitive->indexCount,
+                                      primitive->material->m_material_index);
+            }
+        }
     }
 }
 
-void Model::UpdateNodeModelMatrix(std::shared_ptr<Node> node) noexcept {
+void Model::RegisterMaterials(MaterialTable &material_table) noexcept {
+    for (auto &material : m_materials) {
+        material_table.AddMaterial(*material);
+    }
+}
 
-    // update model matrix for each node
-    if (node->mesh) {
-        node->update(m_model_matrix);
+void Model::UpdateDescriptors() noexcept {
+    for (auto &material : m_materials) {
+        material->UpdateDescriptorSet();
     }
-    for (auto &child : node->m_children) {
-        UpdateNodeModelMatrix(child);
+}
+
+void Model::UpdateModelMatrix() noexcept { m_transforms.Update(); }
+
+void Model::AddNodeTransform(const std::shared_ptr<Node> &node, i32 parent) noexcept {
+    // pre order walk of the node tree, m_linear_nodes is ordered differently by the gltf and cooked paths
+    node->transform = m_transforms.AddNode(parent, node->translation, node->rotation, node->scale, node->matrix);
+    for (const auto &child : node->m_children) {
+        AddNodeTransform(child, static_cast<i32>(node->transform));
     }
 }
 
@@ -432,7 +728,12 @@ std::shared_ptr<DescriptorSet> Model::GetMaterialDescriptorSet() noexcept {
     return nullptr;
 }
 
-void Model::SetModelMatrix(const Math::mat4 &modelMatrix) noexcept { m_model_matrix = modelMatrix; }
+void Model::SetModelMatrix(const Math::mat4 &modelMatrix) noexcept {
+    m_model_matrix = modelMatrix;
+    m_transforms.SetRoot(modelMatrix);
+}
+
+void Model::SetInstances(const std::vector<Math::mat4> &instances) noexcept { m_instances = instances; }
 
 std::shared_ptr<DescriptorSet> Model::GetNodeMaterialDescriptorSet(std::shared_ptr<Node> node) noexcept {
     if (node->mesh) {
@@ -446,8 +747,7 @@ std::shared_ptr<DescriptorSet> Model::GetNodeMaterialDescriptorSet(std::shared_p
     return nullptr;
 }
 
-Mesh::Mesh(std::shared_ptr<Device> device, Math::mat4 model) noexcept : m_device(device) {
-    m_mesh_push_constant.modelMatrix = model;
+Mesh::Mesh(std::shared_ptr<Device> device) noexcept : m_device(device) {
     //meshUb = std::make_shared<UniformBuffer>(m_device);
     //std::shared_ptr<DescriptorSetInfo> setInfo = std::make_shared<DescriptorSetInfo>();
     //setInfo->AddBinding(DESCRIPTOR_TYPE_UNIFORM_BUFFER, SHADER_STAGE_VERTEX_SHADER);
@@ -464,29 +764,4 @@ Node::Node() noexcept {}
 
 Node::~Node() noexcept {}
 
-Math::mat4 Node::localMatrix() noexcept {
-    return Math::translate(Math::mat4(1.0f), translation) * Math::mat4_cast(rotation) *
-           Math::scale(Math::mat4(1.0f), scale) * matrix;
-}
-
-Math::mat4 Node::getMatrix() noexcept {
-    // local matrix
-    Math::mat4 m = localMatrix();
-    std::shared_ptr<Node> p = m_parent;
-    while (p) {
-        m = p->localMatrix() * m;
-        p = p->m_parent;
-    }
-    return m;
-}
-
-void Node::update(const Math::mat4 &modelMat) noexcept {
-    mesh->m_mesh_push_constant.modelMatrix = modelMat * getMatrix();
-    //mesh->meshUbStruct.model = modelMat * getMatrix();
-    //mesh->meshUb->update(&mesh->meshUbStruct, sizeof(mesh->meshUbStruct));
-
-    for (auto &child : m_children) {
-        child->update(modelMat);
-    }
-}
 } // namespace Horizon
\ No newline at end of file
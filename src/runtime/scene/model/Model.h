@@ -1,5 +1,7 @@
 #pragma once
 
+#include <chrono>
+#include <limits>
 #include <vector>
 
 #include <vulkan/vulkan.hpp>
@@ -15,6 +17,10 @@
 #include <runtime/function/rhi/vulkan/UniformBuffer.h>
 #include <runtime/function/rhi/vulkan/VertexBuffer.h>
 #include <runtime/scene/material/Material.h>
+#include <runtime/scene/material/MaterialTable.h>
+#include <runtime/scene/model/CookedMesh.h>
+#include <runtime/scene/model/TransformHierarchy.h>
+#include <runtime/scene/scene/IndirectDrawList.h>
 
 namespace Horizon {
 
@@ -29,11 +35,27 @@ class MeshPrimitive {
     uint32_t indexCount;
     uint32_t vertexCount;
     bool hasIndices;
+    // local space aabb, culled against the frustum in gpu driven mode
+    Math::vec3 boundsMin{std::numeric_limits<f32>::lowest()};
+    Math::vec3 boundsMax{std::numeric_limits<f32>::max()};
+};
+
+// a primitive whose vertex and index ranges are reserved but not yet decoded
+struct PrimitiveDecodeJob {
+    const tinygltf::Primitive *primitive;
+    u32 vertex_start;
+    u32 index_start;
+};
+
+struct PrimitiveLayout {
+    u32 vertex_count = 0;
+    u32 index_count = 0;
+    std::vector<PrimitiveDecodeJob> jobs;
 };
 
 class Mesh {
   public:
-    Mesh(std::shared_ptr<Device> device, Math::mat4 model) noexcept;
+    Mesh(std::shared_ptr<Device> device) noexcept;
     ~Mesh() noexcept = default;
 
     std::shared_ptr<Device> m_device;
@@ -44,7 +66,7 @@ class Mesh {
     struct MeshPushConstant {
         Math::mat4 modelMatrix;
         Math::mat4 padding;
-    } m_mesh_push_constant;
+    };
 
     //std::shared_ptr<UniformBuffer> meshUb = nullptr;
     //std::shared_ptr<DescriptorSet> meshDescriptorSet = nullptr;
@@ -64,9 +86,8 @@ class Node {
     Math::vec3 translation{};
     Math::vec3 scale{1.0f};
     Math::quat rotation{};
-    Math::mat4 localMatrix() noexcept;
-    Math::mat4 getMatrix() noexcept;
-    void update(const Math::mat4 &modelMat) noexcept;
+    // index into the model's transform hierarchy
+    u32 transform = 0;
 };
 
 class Model {
@@ -74,22 +95,43 @@ class Model {
     Model(const std::string &path, std::shared_ptr<Device> device, std::shared_ptr<CommandBuffer> command_buffer,
           std::shared_ptr<DescriptorSet> m_scene_descriptor_set) noexcept;
     ~Model() noexcept;
-    void Draw(std::shared_ptr<Pipeline> pipeline, VkCommandBuffer command_buffer) noexcept;
+    // binds per primitive material sets, or the material table once if one is given. draws instance_count instances
+    // starting at first_instance and returns the draw count
+    u32 Draw(std::shared_ptr<Pipeline> pipeline, VkCommandBuffer command_buffer,
+             VkDescriptorSet material_table = VK_NULL_HANDLE, u32 first_instance = 0,
+             u32 instance_count = ~0u) noexcept;
     void LoadTextures(tinygltf::Model &gltfModel) noexcept;
     void LoadMaterials(tinygltf::Model &gltfModel) noexcept;
     void LoadNode(std::shared_ptr<Node> m_parent, const tinygltf::Node &node, uint32_t nodeIndex,
-                  const tinygltf::Model &model, std::vector<u32> &indexBuffer, std::vector<Vertex> &vertexBuffer,
-                  f32 globalscale) noexcept;
-    void DrawNode(std::shared_ptr<Node> node, std::shared_ptr<Pipeline> pipeline,
-                  VkCommandBuffer command_buffer) noexcept;
+                  const tinygltf::Model &model, PrimitiveLayout &layout, f32 globalscale) noexcept;
+    static void DecodePrimitive(const tinygltf::Model &model, const PrimitiveDecodeJob &job, Vertex *vertices,
+                                u32 *indices) noexcept;
+    void DrawNode(std::shared_ptr<Node> node, std::shared_ptr<Pipeline> pipeline, VkCommandBuffer command_buffer,
+                  const Math::mat4 &instance, u32 &draw_count) noexcept;
+    void DrawNodeBindless(const std::shared_ptr<Node> &node, VkPipelineLayout layout, VkCommandBuffer command_buffer,
+                          const Math::mat4 &instance, u32 &draw_count) noexcept;
+    // appends a batch with one draw instance per primitive and model instance, materials must be registered
+    void GatherInstances(IndirectDrawList &draw_list) noexcept;
+    void RegisterMaterials(MaterialTable &material_table) noexcept;
     void UpdateDescriptors() noexcept;
+    // resolves the world matrices of the nodes whose transform changed since the last call
     void UpdateModelMatrix() noexcept;
     //std::shared_ptr<DescriptorSet> getMeshDescriptorSet();
     std::shared_ptr<DescriptorSet> GetMaterialDescriptorSet() noexcept;
     void SetModelMatrix(const Math::mat4 &modelMatrix) noexcept;
+    // world space transforms applied on top of the model matrix, the model is drawn once per instance
+    void SetInstances(const std::vector<Math::mat4> &instances) noexcept;
+    u32 GetInstanceCount() const noexcept { return static_cast<u32>(m_instances.size()); }
+    TransformHierarchy &GetTransforms() noexcept { return m_transforms; }
 
   private:
-    void UpdateNodeModelMatrix(std::shared_ptr<Node> node) noexcept;
+    bool LoadCookedMesh(const std::string &path, u64 source_hash) noexcept;
+    void CookMesh(const std::string &path, u64 source_hash, const tinygltf::Model &gltfModel) noexcept;
+    void CookNode(const std::shared_ptr<Node> &node, i32 parent, CookedMeshData &data) noexcept;
+    void CreateEmptyTexture() noexcept;
+    void FlushTextureUploads(const UploadStats &stats, std::chrono::steady_clock::time_point begin) noexcept;
+    std::shared_ptr<Material> CreateMaterial(const CookedMaterial &textures) noexcept;
+    void AddNodeTransform(const std::shared_ptr<Node> &node, i32 parent) noexcept;
     //void updateNodeDescriptorSet(std::shared_ptr<Node> node);
     //std::shared_ptr<DescriptorSet> getNodeMeshDescriptorSet(std::shared_ptr<Node> node);
     std::shared_ptr<DescriptorSet> GetNodeMaterialDescriptorSet(std::shared_ptr<Node> node) noexcept;
@@ -101,6 +143,8 @@ class Model {
     std::shared_ptr<DescriptorSet> m_scene_descriptor_set;
 
     Math::mat4 m_model_matrix = Math::mat4(1.0);
+    std::vector<Math::mat4> m_instances{Math::mat4(1.0)};
+    TransformHierarchy m_transforms;
 
     std::shared_ptr<VertexBuffer> m_vertex_buffer = nullptr;
     std::shared_ptr<IndexBuffer> m_index_buffer = nullptr;
@@ -0,0 +1,94 @@
+#include "TransformHierarchy.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace Horizon {
+
+u32 TransformHierarchy::AddNode(i32 parent, const Math::vec3 &translation, const Math::quat &rotation,
+                                const Math::vec3 &scale, const Math::mat4 &matrix) noexcept {
+    u32 node = static_cast<u32>(m_parents.size());
+    m_parents.push_back(parent);
+    m_subtree_ends.push_back(node + 1);
+    m_translations.push_back(translation);
+    m_rotations.push_back(rotation);
+    m_scales.push_back(scale);
+    m_matrices.push_back(matrix);
+    m_locals.emplace_back(1.0f);
+    m_worlds.emplace_back(1.0f);
+    m_dirty.push_back(DIRTY_LOCAL);
+
+    // pre order, the new node closes the subtree of every ancestor after it
+    for (i32 ancestor = parent; ancestor > -1; ancestor = m_parents[ancestor]) {
+        m_subtree_ends[ancestor] = node + 1;
+    }
+    m_first_dirty = std::min(m_first_dirty, node);
+    return node;
+}
+
+void TransformHierarchy::Clear() noexcept {
+    m_parents.clear();
+    m_subtree_ends.clear();
+    m_translations.clear();
+    m_rotations.clear();
+    m_scales.clear();
+    m_matrices.clear();
+    m_locals.clear();
+    m_worlds.clear();
+    m_dirty.clear();
+    m_root = Math::mat4(1.0f);
+    m_first_dirty = 0;
+}
+
+void TransformHierarchy::SetLocal(u32 node, const Math::vec3 &translation, const Math::quat &rotation,
+                                  const Math::vec3 &scale) noexcept {
+    m_translations[node] = translation;
+    m_rotations[node] = rotation;
+    m_scales[node] = scale;
+    MarkDirty(node, DIRTY_LOCAL);
+}
+
+void TransformHierarchy::SetRoot(const Math::mat4 &root) noexcept {
+    if (root == m_root) {
+        return;
+    }
+    m_root = root;
+    // roots are the nodes without a parent, their subtrees cover everything
+    for (u32 node = 0; node < m_parents.size(); node = m_subtree_ends[node]) {
+        MarkDirty(node, DIRTY_WORLD);
+    }
+}
+
+void TransformHierarchy::MarkDirty(u32 node, u8 flags) noexcept {
+    m_dirty[node] |= flags;
+    m_first_dirty = std::min(m_first_dirty, node);
+}
+
+u32 TransformHierarchy::Update() noexcept {
+    u32 node_count = static_cast<u32>(m_parents.size());
+    u32 updated = 0;
+    u32 node = m_first_dirty;
+    while (node < node_count) {
+        if (!m_dirty[node]) {
+            node++;
+            continue;
+        }
+        // the whole subtree follows a dirty node, its parent is either clean or already updated
+        u32 subtree_end = m_subtree_ends[node];
+        for (u32 i = node; i < subtree_end; i++) {
+            if (m_dirty[i] & DIRTY_LOCAL) {
+                m_locals[i] = Math::translate(Math::mat4(1.0f), m_translations[i]) * Math::mat4_cast(m_rotations[i]) *
+                              Math::scale(Math::mat4(1.0f), m_scales[i]) * m_matrices[i];
+            }
+            i32 parent = m_parents[i];
+            m_worlds[i] = (parent > -1 ? m_worlds[parent] : m_root) * m_locals[i];
+            m_dirty[i] = 0;
+        }
+        updated += subtree_end - node;
+        node = subtree_end;
+    }
+    m_first_dirty = std::numeric_limits<u32>::max();
+    return updated;
+}
+
+} // namespace Horizon
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+
+#include <runtime/core/math/Math.h>
+
+namespace Horizon {
+
+// node transforms of a model as structure of arrays. nodes are stored in pre order, so a parent always precedes its
+// children and every subtree is one contiguous range. world matrices are resolved in a single forward pass that only
+// visits the subtrees below a changed node.
+class TransformHierarchy {
+  public:
+    TransformHierarchy() noexcept = default;
+    ~TransformHierarchy() noexcept = default;
+
+    // appends a node in pre order, parent must be -1 or an already added node whose subtree is still open
+    u32 AddNode(i32 parent, const Math::vec3 &translation, const Math::quat &rotation, const Math::vec3 &scale,
+                const Math::mat4 &matrix = Math::mat4(1.0f)) noexcept;
+    // drops every node and resets the root to identity
+    void Clear() noexcept;
+
+    void SetLocal(u32 node, const Math::vec3 &translation, const Math::quat &rotation,
+                  const Math::vec3 &scale) noexcept;
+    // transform of the whole hierarchy, the model matrix
+    void SetRoot(const Math::mat4 &root) noexcept;
+
+    // recomputes the world matrices below every changed node, returns the number of nodes updated
+    u32 Update() noexcept;
+
+    const Math::mat4 &GetWorld(u32 node) const noexcept { return m_worlds[node]; }
+    i32 GetParent(u32 node) const noexcept { return m_parents[node]; }
+    u32 GetNodeCount() const noexcept { return static_cast<u32>(m_parents.size()); }
+
+  private:
+    enum DirtyFlags : u8 {
+        DIRTY_LOCAL = 1 << 0,
+        DIRTY_WORLD = 1 << 1,
+    };
+    void MarkDirty(u32 node, u8 flags) noexcept;
+
+  private:
+    Math::mat4 m_root = Math::mat4(1.0f);
+    std::vector<i32> m_parents;
+    // one past the last node of the subtree
+    std::vector<u32> m_subtree_ends;
+    std::vector<Math::vec3> m_translations;
+    std::vector<Math::quat> m_rotations;
+    std::vector<Math::vec3> m_scales;
+    // gltf node matrix, applied after trs
+    std::vector<Math::mat4> m_matrices;
+    std::vector<Math::mat4> m_locals;
+    std::vector<Math::mat4> m_worlds;
+    std::vector<u8> m_dirty;
+    // nothing before this node is dirty
+    u32 m_first_dirty = 0;
+};
+
+} // namespace Horizon
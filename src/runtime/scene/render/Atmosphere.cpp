@@ -1,14 +1,34 @@
 #include "Atmosphere.h"
 
+#include <algorithm>
+#include <cstring>
+
+#include <runtime/core/log/Log.h>
 #include <runtime/core/path/Path.h>
 #include <runtime/function/rhi/RenderContext.h>
+#include <runtime/function/rhi/vulkan/ResourceBarrier.h>
+#include <runtime/function/rhi/vulkan/VulkanBuffer.h>
 #include <runtime/function/rhi/vulkan/VulkanEnums.h>
 
 namespace Horizon {
+
+namespace {
+
+// texels of the 3d passes one chunk covers, 8 x 1 workgroups of 4x4x4 across the full width. 32 chunks per pass
+constexpr u32 PRECOMPUTE_CHUNK_HEIGHT = 32;
+constexpr u32 PRECOMPUTE_CHUNK_DEPTH = 4;
+constexpr u32 SCATTERING_LOCAL_SIZE = 4;
+
+constexpr f64 CHUNK_COST_SMOOTHING = 0.25;
+
+} // namespace
+
 Atmosphere::Atmosphere(std::shared_ptr<PipelineManager> _pipeline_manager, std::shared_ptr<Device> _device,
-                       std::shared_ptr<CommandBuffer> command_buffer, RenderContext &_render_context) noexcept {
+                       std::shared_ptr<CommandBuffer> command_buffer, RenderContext &_render_context) noexcept
+    : m_device(_device), m_command_buffer(command_buffer), m_parameters(GetDefaultAtmosphereParameters()) {
 
     CreateResources(_device, command_buffer);
+    CreateTimestampQueries();
 
     // transmittance lut
 
@@ -46,6 +66,7 @@ Atmosphere::Atmosphere(std::shared_ptr<PipelineManager> _pipeline_manager, std::
     single_scattering_lut_create_info.group_count_x = 256 / 4;
     single_scattering_lut_create_info.group_count_y = 128 / 4;
     single_scattering_lut_create_info.group_count_z = 32 / 4;
+    single_scattering_lut_create_info.push_constants = scattering_order_push_constants;
 
     m_single_scattering_lut_pass = _pipeline_manager->CreateComputePipeline(single_scattering_lut_create_info);
 
@@ -83,6 +104,7 @@ Atmosphere::Atmosphere(std::shared_ptr<PipelineManager> _pipeline_manager, std::
     multi_scattering_lut_create_info.cs =
         std::make_shared<Shader>(_device->Get(), Path::GetShaderPath("atmosphere/multi_scattering_lut.comp.spv"));
     multi_scattering_lut_create_info.descriptor_layouts = multi_scattering_lut_descriptor_set_layouts;
+    multi_scattering_lut_create_info.push_constants = scattering_order_push_constants;
     multi_scattering_lut_create_info.group_count_x = 256 / 4;
     multi_scattering_lut_create_info.group_count_y = 128 / 4;
     multi_scattering_lut_create_info.group_count_z = 32 / 4;
@@ -113,57 +135,81 @@ Atmosphere::Atmosphere(std::shared_ptr<PipelineManager> _pipeline_manager, std::
 
     std::vector<AttachmentCreateInfo> sky_attachments_create_info{{TextureFormat::TEXTURE_FORMAT_RGBA16_UNORM,
                                                                    COLOR_ATTACHMENT, TextureType::TEXTURE_TYPE_2D,
-                                                                   _render_context.width, _render_context.height, 1}};
+                                                                   _render_context.width, _render_context.height, 1,
+                                                                   "sky"}};
 
     m_sky_pass = _pipeline_manager->CreateGraphicsPipeline(sky_pipeline_create_info, sky_attachments_create_info,
                                                            _render_context);
 
     m_sky_ub = std::make_shared<UniformBuffer>(_device);
     m_sky_ubdata.resolution = Math::vec2(_render_context.width, _render_context.height);
+
+    m_lut_key = HashAtmospherePrecompute(m_parameters, m_multi_scattering_order,
+                                         {Path::GetShaderPath("atmosphere/transmittance_lut.comp.spv"),
+                                          Path::GetShaderPath("atmosphere/direct_irradiance_lut.comp.spv"),
+                                          Path::GetShaderPath("atmosphere/single_scattering_lut.comp.spv"),
+                                          Path::GetShaderPath("atmosphere/scattering_density.comp.spv"),
+                                          Path::GetShaderPath("atmosphere/indirect_irradiance_lut.comp.spv"),
+                                          Path::GetShaderPath("atmosphere/multi_scattering_lut.comp.spv")});
 }
 
-Atmosphere::~Atmosphere() noexcept {}
+Atmosphere::~Atmosphere() noexcept {
+    if (m_timestamp_query_pool) {
+        vkDestroyQueryPool(m_device->Get(), m_timestamp_query_pool, nullptr);
+    }
+}
 
 void Atmosphere::SetCameraParams(Math::mat4 inv_view_projection, Math::vec3 camera_pos) noexcept {
     m_sky_ubdata.inv_view_projection_matrix = inv_view_projection;
     m_sky_ubdata.camera_pos = camera_pos;
+    m_sky_ubdata.atmosphere = PackAtmosphereParameters(m_lut_sets[m_front].parameters);
     m_sky_ub->update(&m_sky_ubdata, sizeof(ScatteringUb));
 }
 
 void Atmosphere::UpdateDescriptorSets() noexcept {
-    if (!precomputed) {
+    if (!m_precompute_pending &&
+        (!precomputed ||
+         std::memcmp(&m_parameters, &m_lut_sets[m_front].parameters, sizeof(AtmosphereParameters)) != 0)) {
+        StartPrecompute();
+    }
+
+    if (m_precompute_pending) {
+        // uniform buffers live in the per frame ring, so every frame that dispatches binds a fresh copy
+        AtmosphereUbData precompute_ubdata = PackAtmosphereParameters(m_lut_sets[m_target].parameters);
+        m_precompute_ub->update(&precompute_ubdata, sizeof(AtmosphereUbData));
+        const LutSet &target = m_lut_sets[m_target];
+
         // tramsmittance lut
-        m_transmittance_lut_descriptor_set_update_desc.BindResource(0, transmittance_lut);
+        m_transmittance_lut_descriptor_set_update_desc.BindResource(0, target.transmittance);
+        m_transmittance_lut_descriptor_set_update_desc.BindResource(1, m_precompute_ub);
         m_transmittance_lut_descriptor_set->UpdateDescriptorSet(m_transmittance_lut_descriptor_set_update_desc);
 
         // direct irradiance lut
-        m_direct_irradiance_lut_descriptor_set_update_desc.BindResource(0, transmittance_lut);
+        m_direct_irradiance_lut_descriptor_set_update_desc.BindResource(0, target.transmittance);
         m_direct_irradiance_lut_descriptor_set_update_desc.BindResource(1, direct_irradiance_lut);
-        m_direct_irradiance_lut_descriptor_set_update_desc.BindResource(2, _irradiance_tex);
+        m_direct_irradiance_lut_descriptor_set_update_desc.BindResource(2, target.irradiance);
+        m_direct_irradiance_lut_descriptor_set_update_desc.BindResource(3, m_precompute_ub);
         m_direct_irradiance_lut_descriptor_set->UpdateDescriptorSet(m_direct_irradiance_lut_descriptor_set_update_desc);
 
         // single scattering lut
 
-        //m_single_scattering_lut_ubdata.luminance_from_radiance = Math::mat3(1.0);
-        //m_single_scattering_lut_ubdata.layer = 0;
-        //m_single_scattering_lut_ub->update(&m_single_scattering_lut_ubdata,sizeof(m_single_scattering_lut_ubdata));
-
-        m_single_scattering_lut_descriptor_set_update_desc.BindResource(0, transmittance_lut);
-        //m_single_scattering_lut_descriptor_set_update_desc.BindResource(1, m_single_scattering_lut_ub);
+        m_single_scattering_lut_descriptor_set_update_desc.BindResource(0, target.transmittance);
         m_single_scattering_lut_descriptor_set_update_desc.BindResource(1, single_rayleigh_scattering_lut);
         m_single_scattering_lut_descriptor_set_update_desc.BindResource(2, single_mie_scattering_lut);
-        m_single_scattering_lut_descriptor_set_update_desc.BindResource(3, _scattering_tex);
+        m_single_scattering_lut_descriptor_set_update_desc.BindResource(3, target.scattering);
+        m_single_scattering_lut_descriptor_set_update_desc.BindResource(4, m_precompute_ub);
 
         m_single_scattering_lut_descriptor_set->UpdateDescriptorSet(m_single_scattering_lut_descriptor_set_update_desc);
 
         // SCATTERING DENSITY LUT
 
-        m_scattering_density_lut_descriptor_set_update_desc.BindResource(0, transmittance_lut);
+        m_scattering_density_lut_descriptor_set_update_desc.BindResource(0, target.transmittance);
         m_scattering_density_lut_descriptor_set_update_desc.BindResource(1, single_rayleigh_scattering_lut);
         m_scattering_density_lut_descriptor_set_update_desc.BindResource(2, single_mie_scattering_lut);
         m_scattering_density_lut_descriptor_set_update_desc.BindResource(3, multi_scattering_lut);
         m_scattering_density_lut_descriptor_set_update_desc.BindResource(4, direct_irradiance_lut);
         m_scattering_density_lut_descriptor_set_update_desc.BindResource(5, scattering_density_lut);
+        m_scattering_density_lut_descriptor_set_update_desc.BindResource(6, m_precompute_ub);
 
         m_scattering_density_lut_descriptor_set->UpdateDescriptorSet(
             m_scattering_density_lut_descriptor_set_update_desc);
@@ -174,25 +220,27 @@ void Atmosphere::UpdateDescriptorSets() noexcept {
         m_indirect_irradiance_lut_descriptor_set_update_desc.BindResource(1, single_mie_scattering_lut);
         m_indirect_irradiance_lut_descriptor_set_update_desc.BindResource(2, multi_scattering_lut);
         m_indirect_irradiance_lut_descriptor_set_update_desc.BindResource(3, direct_irradiance_lut);
-        m_indirect_irradiance_lut_descriptor_set_update_desc.BindResource(4, _irradiance_tex);
+        m_indirect_irradiance_lut_descriptor_set_update_desc.BindResource(4, target.irradiance);
+        m_indirect_irradiance_lut_descriptor_set_update_desc.BindResource(5, m_precompute_ub);
 
         m_indirect_irradiance_lut_descriptor_set->UpdateDescriptorSet(
             m_indirect_irradiance_lut_descriptor_set_update_desc);
 
         // multi-scattering
 
-        m_multi_scattering_lut_descriptor_set_update_desc.BindResource(0, transmittance_lut);
+        m_multi_scattering_lut_descriptor_set_update_desc.BindResource(0, target.transmittance);
         m_multi_scattering_lut_descriptor_set_update_desc.BindResource(1, scattering_density_lut);
         m_multi_scattering_lut_descriptor_set_update_desc.BindResource(2, single_rayleigh_scattering_lut);
-        m_multi_scattering_lut_descriptor_set_update_desc.BindResource(3, _scattering_tex);
+        m_multi_scattering_lut_descriptor_set_update_desc.BindResource(3, target.scattering);
+        m_multi_scattering_lut_descriptor_set_update_desc.BindResource(4, m_precompute_ub);
 
         m_multi_scattering_lut_descriptor_set->UpdateDescriptorSet(m_multi_scattering_lut_descriptor_set_update_desc);
     }
     // render sky
 
     m_sky_descriptor_set_update_desc.BindResource(0, m_sky_ub);
-    m_sky_descriptor_set_update_desc.BindResource(1, transmittance_lut);
-    m_sky_descriptor_set_update_desc.BindResource(2, _scattering_tex);
+    m_sky_descriptor_set_update_desc.BindResource(1, m_lut_sets[m_front].transmittance);
+    m_sky_descriptor_set_update_desc.BindResource(2, m_lut_sets[m_front].scattering);
     m_sky_descriptor_set->UpdateDescriptorSet(m_sky_descriptor_set_update_desc);
 }
 
@@ -205,6 +253,290 @@ std::shared_ptr<AttachmentDescriptor> Atmosphere::GetFrameBufferAttachment(u32 _
     return std::static_pointer_cast<GraphicsPipeline>(m_sky_pass)->GetFrameBufferAttachment(_index);
 }
 
+bool Atmosphere::LoadPrecomputedLuts(const std::string &path) noexcept {
+    AtmosphereLuts luts;
+    if (!luts.Read(path, m_lut_key)) {
+        return false;
+    }
+
+    // the copies land on the graphics queue before the first frame, the luts stay in general layout like after the
+    // precompute
+    std::shared_ptr<UploadManager> upload_manager = m_command_buffer->GetUploadManager();
+    const AtmosphereTexture *sources[3] = {&luts.transmittance, &luts.irradiance, &luts.scattering};
+    const LutSet &front = m_lut_sets[m_front];
+    std::shared_ptr<Texture> targets[3] = {front.transmittance, front.irradiance, front.scattering};
+    for (u32 i = 0; i < 3; i++) {
+        upload_manager->UploadImage(targets[i]->GetImage(), sources[i]->texels.data(), sources[i]->GetSize(),
+                                    sources[i]->width, sources[i]->height, VK_IMAGE_LAYOUT_GENERAL,
+                                    sources[i]->depth);
+    }
+    m_lut_sets[m_front].parameters = m_parameters;
+    precomputed = true;
+    return true;
+}
+
+bool Atmosphere::SavePrecomputedLuts(const std::string &path) noexcept {
+    AtmosphereLuts luts;
+    luts.Allocate();
+    AtmosphereTexture *targets[3] = {&luts.transmittance, &luts.irradiance, &luts.scattering};
+    const LutSet &front = m_lut_sets[m_front];
+    std::shared_ptr<Texture> sources[3] = {front.transmittance, front.irradiance, front.scattering};
+
+    u64 size = 0;
+    for (const AtmosphereTexture *target : targets) {
+        size += target->GetSize();
+    }
+    VkBuffer readback_buffer = VK_NULL_HANDLE;
+    MemoryAllocation readback_memory;
+    vk_createBuffer(m_device, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, readback_buffer,
+                    readback_memory);
+    if (!readback_memory.mapped) {
+        LOG_WARN("failed to map the atmosphere lut readback buffer");
+        vk_destroyBuffer(m_device, readback_buffer, readback_memory);
+        return false;
+    }
+
+    // submitted after the precompute on the same queue, the barrier orders the copies after its writes
+    VkCommandBuffer cmdbuf = m_command_buffer->beginSingleTimeCommands();
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(cmdbuf, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier,
+                         0, nullptr, 0, nullptr);
+
+    u64 offset = 0;
+    for (u32 i = 0; i < 3; i++) {
+        VkBufferImageCopy region{};
+        region.bufferOffset = offset;
+        region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+        region.imageExtent = {targets[i]->width, targets[i]->height, targets[i]->depth};
+        vkCmdCopyImageToBuffer(cmdbuf, sources[i]->GetImage(), VK_IMAGE_LAYOUT_GENERAL, readback_buffer, 1, &region);
+        offset += targets[i]->GetSize();
+    }
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(cmdbuf, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0,
+                         nullptr, 0, nullptr);
+    // waits for the queue to drain
+    m_command_buffer->endSingleTimeCommands(cmdbuf);
+
+    const u8 *data = static_cast<const u8 *>(readback_memory.mapped);
+    for (AtmosphereTexture *target : targets) {
+        memcpy(target->texels.data(), data, target->GetSize());
+        data += target->GetSize();
+    }
+    vk_destroyBuffer(m_device, readback_buffer, readback_memory);
+
+    return luts.Write(path, m_lut_key);
+}
+
+void Atmosphere::StartPrecompute() noexcept {
+    // the first precompute has no complete luts to keep showing, so it writes the ones the sky samples
+    m_target = precomputed ? 1 - m_front : m_front;
+    m_lut_sets[m_target].parameters = m_parameters;
+
+    // same order as one whole precompute, the 3d passes split into bands of workgroups
+    m_chunks.clear();
+    auto add_slabs = [this](PrecomputePass pass, u32 order) {
+        for (u32 z = 0; z < SCATTERING_TEXTURE_DEPTH; z += PRECOMPUTE_CHUNK_DEPTH) {
+            for (u32 y = 0; y < SCATTERING_TEXTURE_HEIGHT; y += PRECOMPUTE_CHUNK_HEIGHT) {
+                m_chunks.push_back({pass, order, y, z});
+            }
+        }
+    };
+    m_chunks.push_back({PrecomputePass::TRANSMITTANCE, 0, 0, 0});
+    m_chunks.push_back({PrecomputePass::DIRECT_IRRADIANCE, 0, 0, 0});
+    add_slabs(PrecomputePass::SINGLE_SCATTERING, 0);
+    for (u32 j = 0; j < m_multi_scattering_order; j++) {
+        add_slabs(PrecomputePass::SCATTERING_DENSITY, j);
+        m_chunks.push_back({PrecomputePass::INDIRECT_IRRADIANCE, j, 0, 0});
+        add_slabs(PrecomputePass::MULTI_SCATTERING, j);
+    }
+
+    m_next_chunk = 0;
+    m_precompute_frames = 0;
+    m_precompute_pending = true;
+}
+
+void Atmosphere::RecordPrecompute(u32 frame) noexcept {
+    ReadPrecomputeTimestamps(frame);
+    if (!m_precompute_pending) {
+        return;
+    }
+    bool bounded = precomputed;
+    VkCommandBuffer cmdbuf = m_command_buffer->Get(frame);
+
+    // earlier frames may still sample the target set or write the intermediates, the chunks of the last frame must
+    // be visible. later submissions on the queue are covered as well
+    {
+        BarrierDesc desc;
+        desc.memory_barriers.push_back(
+            {MemoryAccessFlags::ACCESS_SHADER_WRITE_BIT,
+             static_cast<MemoryAccessFlags>(MemoryAccessFlags::ACCESS_SHADER_READ_BIT |
+                                            MemoryAccessFlags::ACCESS_SHADER_WRITE_BIT)});
+        desc.src_stage = PipelineStageFlags::PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+                         PipelineStageFlags::PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        desc.dst_stage = PipelineStageFlags::PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        InsertBarrier(frame, m_command_buffer, desc);
+    }
+    if (m_timestamp_query_pool) {
+        vkCmdResetQueryPool(cmdbuf, m_timestamp_query_pool, frame * 2, 2);
+        vkCmdWriteTimestamp(cmdbuf, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_timestamp_query_pool, frame * 2);
+    }
+
+    std::vector<PrecomputePass> &frame_chunks = m_frame_chunks[frame];
+    frame_chunks.clear();
+    f64 predicted_ms = 0.0;
+    while (m_next_chunk < m_chunks.size()) {
+        const PrecomputeChunk &chunk = m_chunks[m_next_chunk];
+        // an unmeasured pass takes the whole budget so it runs alone and gets measured
+        f64 cost_ms = m_chunk_cost_ms[static_cast<u32>(chunk.pass)];
+        if (cost_ms <= 0.0) {
+            cost_ms = m_precompute_budget_ms;
+        }
+        if (bounded && !frame_chunks.empty() && predicted_ms + cost_ms > m_precompute_budget_ms) {
+            break;
+        }
+
+        // bands of the same pass write disjoint texels, the next pass reads what the previous one wrote
+        if (!frame_chunks.empty()) {
+            const PrecomputeChunk &previous = m_chunks[m_next_chunk - 1];
+            if (previous.pass != chunk.pass || previous.order != chunk.order) {
+                BarrierDesc desc;
+                desc.memory_barriers.push_back(
+                    {MemoryAccessFlags::ACCESS_SHADER_WRITE_BIT,
+                     static_cast<MemoryAccessFlags>(MemoryAccessFlags::ACCESS_SHADER_READ_BIT |
+                                                    MemoryAccessFlags::ACCESS_SHADER_WRITE_BIT)});
+                desc.src_stage = PipelineStageFlags::PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+                desc.dst_stage = PipelineStageFlags::PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+                InsertBarrier(frame, m_command_buffer, desc);
+            }
+        }
+
+        RecordChunk(frame, chunk);
+        frame_chunks.push_back(chunk.pass);
+        predicted_ms += cost_ms;
+        m_next_chunk++;
+    }
+
+    if (m_timestamp_query_pool) {
+        vkCmdWriteTimestamp(cmdbuf, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_timestamp_query_pool, frame * 2 + 1);
+    }
+    m_precompute_frames++;
+
+    if (m_next_chunk < m_chunks.size()) {
+        return;
+    }
+
+    // the sky samples the new set from the next frame on, this frame still binds the previous one. the render graph
+    // declares the sets separately, so make the writes visible to the sky of later frames here
+    {
+        BarrierDesc desc;
+        desc.memory_barriers.push_back(
+            {MemoryAccessFlags::ACCESS_SHADER_WRITE_BIT, MemoryAccessFlags::ACCESS_SHADER_READ_BIT});
+        desc.src_stage = PipelineStageFlags::PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        desc.dst_stage = PipelineStageFlags::PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        InsertBarrier(frame, m_command_buffer, desc);
+    }
+    if (bounded) {
+        LOG_INFO("atmosphere luts recomputed in {} chunks over {} frames", m_chunks.size(), m_precompute_frames);
+    }
+    m_front = m_target;
+    m_precompute_pending = false;
+    precomputed = true;
+}
+
+void Atmosphere::RecordChunk(u32 frame, const PrecomputeChunk &chunk) noexcept {
+    m_precompute_push_constants.offset_y = static_cast<i32>(chunk.offset_y);
+    m_precompute_push_constants.offset_z = static_cast<i32>(chunk.offset_z);
+    // the band a chunk of the 3d passes dispatches
+    u32 group_count_x = SCATTERING_TEXTURE_WIDTH / SCATTERING_LOCAL_SIZE;
+    u32 group_count_y = PRECOMPUTE_CHUNK_HEIGHT / SCATTERING_LOCAL_SIZE;
+    u32 group_count_z = PRECOMPUTE_CHUNK_DEPTH / SCATTERING_LOCAL_SIZE;
+
+    switch (chunk.pass) {
+    case PrecomputePass::TRANSMITTANCE:
+        m_command_buffer->Dispatch(frame, m_transmittance_lut_pass, {m_transmittance_lut_descriptor_set});
+        break;
+    case PrecomputePass::DIRECT_IRRADIANCE:
+        m_command_buffer->Dispatch(frame, m_direct_irradiance_lut_pass, {m_direct_irradiance_lut_descriptor_set});
+        break;
+    case PrecomputePass::SINGLE_SCATTERING:
+        m_precompute_push_constants.scattering_order = 1;
+        m_command_buffer->Dispatch(frame, m_single_scattering_lut_pass, {m_single_scattering_lut_descriptor_set},
+                                   group_count_x, group_count_y, group_count_z);
+        break;
+    case PrecomputePass::SCATTERING_DENSITY:
+        m_precompute_push_constants.scattering_order = layers[chunk.order + 1];
+        m_command_buffer->Dispatch(frame, m_scattering_density_lut, {m_scattering_density_lut_descriptor_set},
+                                   group_count_x, group_count_y, group_count_z);
+        break;
+    case PrecomputePass::INDIRECT_IRRADIANCE:
+        m_precompute_push_constants.scattering_order = layers[chunk.order];
+        m_command_buffer->Dispatch(frame, m_indirect_irradiance_lut, {m_indirect_irradiance_lut_descriptor_set});
+        break;
+    case PrecomputePass::MULTI_SCATTERING:
+        m_precompute_push_constants.scattering_order = layers[chunk.order + 1];
+        m_command_buffer->Dispatch(frame, m_multi_scattering_lut, {m_multi_scattering_lut_descriptor_set},
+                                   group_count_x, group_count_y, group_count_z);
+        break;
+    default:
+        break;
+    }
+}
+
+void Atmosphere::ReadPrecomputeTimestamps(u32 frame) noexcept {
+    std::vector<PrecomputePass> &frame_chunks = m_frame_chunks[frame];
+    if (!m_timestamp_query_pool || frame_chunks.empty()) {
+        return;
+    }
+    // the frame's fence has signaled, results are available without waiting
+    u64 timestamps[2]{};
+    VkResult result = vkGetQueryPoolResults(m_device->Get(), m_timestamp_query_pool, frame * 2, 2, sizeof(timestamps),
+                                            timestamps, sizeof(u64), VK_QUERY_RESULT_64_BIT);
+    if (result == VK_SUCCESS) {
+        u64 mask = m_command_buffer->GetTimestampMask();
+        u64 ticks = ((timestamps[1] & mask) - (timestamps[0] & mask)) & mask;
+        f64 measured_ms = static_cast<f64>(ticks) * m_command_buffer->GetTimestampPeriod() * 1e-6;
+
+        // a frame with an unmeasured pass holds only that chunk, otherwise the measured time is shared out in
+        // proportion to the estimates
+        f64 predicted_ms = 0.0;
+        for (PrecomputePass pass : frame_chunks) {
+            predicted_ms += m_chunk_cost_ms[static_cast<u32>(pass)];
+        }
+        if (predicted_ms <= 0.0 && frame_chunks.size() == 1) {
+            m_chunk_cost_ms[static_cast<u32>(frame_chunks[0])] = measured_ms;
+        } else if (predicted_ms > 0.0) {
+            f64 scale = measured_ms / predicted_ms;
+            for (u32 pass = 0; pass < m_chunk_cost_ms.size(); pass++) {
+                PrecomputePass kind = static_cast<PrecomputePass>(pass);
+                bool recorded = std::find(frame_chunks.begin(), frame_chunks.end(), kind) != frame_chunks.end();
+                if (recorded && m_chunk_cost_ms[pass] > 0.0) {
+                    m_chunk_cost_ms[pass] += (m_chunk_cost_ms[pass] * scale - m_chunk_cost_ms[pass]) *
+                                             CHUNK_COST_SMOOTHING;
+                }
+            }
+        }
+    }
+    frame_chunks.clear();
+}
+
+void Atmosphere::CreateTimestampQueries() noexcept {
+    if (m_command_buffer->GetTimestampMask() == 0) {
+        LOG_WARN("no timestamp support, the atmosphere recompute runs one chunk per frame");
+        return;
+    }
+    VkQueryPoolCreateInfo query_pool_create_info{};
+    query_pool_create_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    query_pool_create_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    query_pool_create_info.queryCount = MAX_FRAMES_IN_FLIGHT * 2;
+    CHECK_VK_RESULT(vkCreateQueryPool(m_device->Get(), &query_pool_create_info, nullptr, &m_timestamp_query_pool));
+}
+
 void Atmosphere::CreateResources(std::shared_ptr<Device> _device,
                                  std::shared_ptr<CommandBuffer> command_buffer) noexcept {
 
@@ -214,6 +546,9 @@ void Atmosphere::CreateResources(std::shared_ptr<Device> _device,
         std::make_shared<DescriptorSetInfo>();
     trasmittance_lut_descriptor_set_create_info->AddBinding(DescriptorType::DESCRIPTOR_TYPE_RW_TEXTURE,
                                                             SHADER_STAGE_COMPUTE_SHADER);
+    // atmosphere parameters
+    trasmittance_lut_descriptor_set_create_info->AddBinding(DescriptorType::DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                                                            SHADER_STAGE_COMPUTE_SHADER);
 
     m_transmittance_lut_descriptor_set =
         std::make_shared<DescriptorSet>(_device, trasmittance_lut_descriptor_set_create_info);
@@ -231,6 +566,9 @@ void Atmosphere::CreateResources(std::shared_ptr<Device> _device,
                                                                  SHADER_STAGE_COMPUTE_SHADER); // delta_irradiance
     direct_irradiance_lut_descriptor_set_create_info->AddBinding(DescriptorType::DESCRIPTOR_TYPE_RW_TEXTURE,
                                                                  SHADER_STAGE_COMPUTE_SHADER); // irradiance
+    // atmosphere parameters
+    direct_irradiance_lut_descriptor_set_create_info->AddBinding(DescriptorType::DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                                                                 SHADER_STAGE_COMPUTE_SHADER);
 
     m_direct_irradiance_lut_descriptor_set =
         std::make_shared<DescriptorSet>(_device, direct_irradiance_lut_descriptor_set_create_info);
@@ -253,6 +591,9 @@ void Atmosphere::CreateResources(std::shared_ptr<Device> _device,
                                                                  SHADER_STAGE_COMPUTE_SHADER);
     single_scattering_lut_descriptor_set_create_info->AddBinding(DescriptorType::DESCRIPTOR_TYPE_RW_TEXTURE,
                                                                  SHADER_STAGE_COMPUTE_SHADER);
+    // atmosphere parameters
+    single_scattering_lut_descriptor_set_create_info->AddBinding(DescriptorType::DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                                                                 SHADER_STAGE_COMPUTE_SHADER);
 
     m_single_scattering_lut_descriptor_set =
         std::make_shared<DescriptorSet>(_device, single_scattering_lut_descriptor_set_create_info);
@@ -277,6 +618,9 @@ void Atmosphere::CreateResources(std::shared_ptr<Device> _device,
                                                                   SHADER_STAGE_COMPUTE_SHADER);
     scattering_density_lut_descriptor_set_create_info->AddBinding(DescriptorType::DESCRIPTOR_TYPE_RW_TEXTURE,
                                                                   SHADER_STAGE_COMPUTE_SHADER);
+    // atmosphere parameters
+    scattering_density_lut_descriptor_set_create_info->AddBinding(DescriptorType::DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                                                                  SHADER_STAGE_COMPUTE_SHADER);
 
     m_scattering_density_lut_descriptor_set =
         std::make_shared<DescriptorSet>(_device, scattering_density_lut_descriptor_set_create_info);
@@ -299,6 +643,9 @@ void Atmosphere::CreateResources(std::shared_ptr<Device> _device,
                                                                    SHADER_STAGE_COMPUTE_SHADER);
     indirect_irradiance_lut_descriptor_set_create_info->AddBinding(DescriptorType::DESCRIPTOR_TYPE_RW_TEXTURE,
                                                                    SHADER_STAGE_COMPUTE_SHADER);
+    // atmosphere parameters
+    indirect_irradiance_lut_descriptor_set_create_info->AddBinding(DescriptorType::DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                                                                   SHADER_STAGE_COMPUTE_SHADER);
 
     m_indirect_irradiance_lut_descriptor_set =
         std::make_shared<DescriptorSet>(_device, indirect_irradiance_lut_descriptor_set_create_info);
@@ -319,6 +666,9 @@ void Atmosphere::CreateResources(std::shared_ptr<Device> _device,
                                                                SHADER_STAGE_COMPUTE_SHADER);
     multi_scatteing_lut_descriptor_set_create_info->AddBinding(DescriptorType::DESCRIPTOR_TYPE_RW_TEXTURE,
                                                                SHADER_STAGE_COMPUTE_SHADER);
+    // atmosphere parameters
+    multi_scatteing_lut_descriptor_set_create_info->AddBinding(DescriptorType::DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                                                               SHADER_STAGE_COMPUTE_SHADER);
 
     m_multi_scattering_lut_descriptor_set =
         std::make_shared<DescriptorSet>(_device, multi_scatteing_lut_descriptor_set_create_info);
@@ -361,18 +711,24 @@ void Atmosphere::CreateResources(std::shared_ptr<Device> _device,
 
     // textures and uniform buffers
 
-    transmittance_lut = std::make_shared<Texture>(_device, command_buffer,
-                                                  TextureCreateInfo{TextureType::TEXTURE_TYPE_2D,
-                                                                    TextureFormat::TEXTURE_FORMAT_RGBA32_SFLOAT,
-                                                                    TextureUsage::TEXTURE_USAGE_RW, 256, 64, 1});
+    for (LutSet &lut_set : m_lut_sets) {
+        lut_set.transmittance = std::make_shared<Texture>(
+            _device, command_buffer,
+            TextureCreateInfo{TextureType::TEXTURE_TYPE_2D, TextureFormat::TEXTURE_FORMAT_RGBA32_SFLOAT,
+                              TextureUsage::TEXTURE_USAGE_RW, 256, 64, 1});
+        lut_set.irradiance = std::make_shared<Texture>(
+            _device, command_buffer,
+            TextureCreateInfo{TextureType::TEXTURE_TYPE_2D, TextureFormat::TEXTURE_FORMAT_RGBA32_SFLOAT,
+                              TextureUsage::TEXTURE_USAGE_RW, 64, 16, 1});
+        lut_set.scattering = std::make_shared<Texture>(
+            _device, command_buffer,
+            TextureCreateInfo{TextureType::TEXTURE_TYPE_3D, TextureFormat::TEXTURE_FORMAT_RGBA32_SFLOAT,
+                              TextureUsage::TEXTURE_USAGE_RW, 256, 128, 32});
+    }
     direct_irradiance_lut = std::make_shared<Texture>(_device, command_buffer,
                                                       TextureCreateInfo{TextureType::TEXTURE_TYPE_2D,
                                                                         TextureFormat::TEXTURE_FORMAT_RGBA32_SFLOAT,
                                                                         TextureUsage::TEXTURE_USAGE_RW, 64, 16, 1});
-    _irradiance_tex = std::make_shared<Texture>(_device, command_buffer,
-                                                TextureCreateInfo{TextureType::TEXTURE_TYPE_2D,
-                                                                  TextureFormat::TEXTURE_FORMAT_RGBA32_SFLOAT,
-                                                                  TextureUsage::TEXTURE_USAGE_RW, 64, 16, 1});
     single_rayleigh_scattering_lut = std::make_shared<Texture>(
         _device, command_buffer,
         TextureCreateInfo{TextureType::TEXTURE_TYPE_3D, TextureFormat::TEXTURE_FORMAT_RGBA32_SFLOAT,
@@ -381,10 +737,6 @@ void Atmosphere::CreateResources(std::shared_ptr<Device> _device,
         _device, command_buffer,
         TextureCreateInfo{TextureType::TEXTURE_TYPE_3D, TextureFormat::TEXTURE_FORMAT_RGBA32_SFLOAT,
                           TextureUsage::TEXTURE_USAGE_RW, 256, 128, 32});
-    _scattering_tex = std::make_shared<Texture>(_device, command_buffer,
-                                                TextureCreateInfo{TextureType::TEXTURE_TYPE_3D,
-                                                                  TextureFormat::TEXTURE_FORMAT_RGBA32_SFLOAT,
-                                                                  TextureUsage::TEXTURE_USAGE_RW, 256, 128, 32});
     scattering_density_lut = std::make_shared<Texture>(_device, command_buffer,
                                                        TextureCreateInfo{TextureType::TEXTURE_TYPE_3D,
                                                                          TextureFormat::TEXTURE_FORMAT_RGBA32_SFLOAT,
@@ -394,9 +746,11 @@ void Atmosphere::CreateResources(std::shared_ptr<Device> _device,
     //scatter_transfer_t = std::make_shared<Texture>(_device, command_buffer, TextureCreateInfo{ TextureType::TEXTURE_TYPE_3D,TextureFormat::TEXTURE_FORMAT_RGBA32_SFLOAT,TextureUsage::TEXTURE_USAGE_RW, 32, 32, 32 });
     //out_transmittance = std::make_shared<Texture>(_device, command_buffer, TextureCreateInfo{ TextureType::TEXTURE_TYPE_3D,TextureFormat::TEXTURE_FORMAT_RGBA32_SFLOAT,TextureUsage::TEXTURE_USAGE_RW, 32, 32, 32 });
 
+    m_precompute_ub = std::make_shared<UniformBuffer>(_device);
+
     scattering_order_push_constants = std::make_shared<PushConstants>();
     scattering_order_push_constants->ranges = {
-        {SHADER_STAGE_COMPUTE_SHADER, 0, 2 * sizeof(Math::mat4)}}; // Push constants have a minimum size of 128 bytes
+        {SHADER_STAGE_COMPUTE_SHADER, 0, sizeof(PrecomputePushConstants), &m_precompute_push_constants}};
 }
 
 } // namespace Horizon
\ No newline at end of file
@@ -1,13 +1,20 @@
 #pragma once
 
+#include <array>
 #include <memory>
+#include <vector>
+
 #include <runtime/function/rhi/vulkan/CommandBuffer.h>
 #include <runtime/function/rhi/vulkan/Descriptors.h>
 #include <runtime/function/rhi/vulkan/Pipeline.h>
 #include <runtime/function/rhi/vulkan/Texture.h>
 #include <runtime/function/rhi/vulkan/UniformBuffer.h>
+#include <runtime/scene/render/AtmosphereLuts.h>
 
 namespace Horizon {
+// precomputes the transmittance, irradiance and scattering luts and draws the sky from them. new parameters are
+// recomputed in chunks over several frames into a second set of luts, the sky keeps sampling the last complete set
+// until the new one is done. chunks are scheduled against a gpu time budget, measured with timestamps.
 class Atmosphere {
   public:
     Atmosphere(std::shared_ptr<PipelineManager> _pipeline_manager, std::shared_ptr<Device> _device,
@@ -18,8 +25,66 @@ class Atmosphere {
     void BindResource(u32 binding, std::shared_ptr<DescriptorBase> buffer) noexcept;
     std::shared_ptr<AttachmentDescriptor> GetFrameBufferAttachment(u32 _index) const noexcept;
 
+    // uploads luts a previous run saved and marks the atmosphere precomputed, fails if the file is missing or was
+    // computed from other parameters or shaders
+    bool LoadPrecomputedLuts(const std::string &path) noexcept;
+    // reads the luts back and saves them, call after the frame recording the precompute is submitted
+    bool SavePrecomputedLuts(const std::string &path) noexcept;
+
+    // the recompute starts with the next frame, changes while one runs are picked up once it finishes
+    void SetParameters(const AtmosphereParameters &atmosphere) noexcept { m_parameters = atmosphere; }
+    const AtmosphereParameters &GetParameters() const noexcept { return m_parameters; }
+    // gpu time per frame a recompute may take, one chunk runs per frame even if it is over budget. the very first
+    // precompute ignores the budget because there is nothing to show before it
+    void SetPrecomputeBudget(f64 ms) noexcept { m_precompute_budget_ms = ms; }
+    f64 GetPrecomputeBudget() const noexcept { return m_precompute_budget_ms; }
+    bool IsRecomputing() const noexcept { return m_precompute_pending; }
+    // lut set the sky samples this frame and the one a pending recompute writes, the same set for the first precompute
+    u32 GetFrontLutSet() const noexcept { return m_front; }
+    u32 GetTargetLutSet() const noexcept { return m_target; }
+
+    // records the chunks of the pending precompute that fit into the budget. the caller orders the lut writes before
+    // the sky pass samples them
+    void RecordPrecompute(u32 frame) noexcept;
+
   private:
+    enum class PrecomputePass : u8 {
+        TRANSMITTANCE,
+        DIRECT_IRRADIANCE,
+        SINGLE_SCATTERING,
+        SCATTERING_DENSITY,
+        INDIRECT_IRRADIANCE,
+        MULTI_SCATTERING,
+        COUNT
+    };
+
+    // a band of workgroups of one pass, 2d passes are a single chunk
+    struct PrecomputeChunk {
+        PrecomputePass pass;
+        u32 order; // index into layers for the multiple scattering passes
+        u32 offset_y, offset_z;
+    };
+
+    // the luts the sky samples, written by the precompute
+    struct LutSet {
+        std::shared_ptr<Texture> transmittance;
+        std::shared_ptr<Texture> irradiance;
+        std::shared_ptr<Texture> scattering;
+        AtmosphereParameters parameters;
+    };
+
+    struct PrecomputePushConstants {
+        i32 scattering_order;
+        i32 offset_y;
+        i32 offset_z;
+    };
+
     void CreateResources(std::shared_ptr<Device> device, std::shared_ptr<CommandBuffer> command_buffer) noexcept;
+    void CreateTimestampQueries() noexcept;
+    void StartPrecompute() noexcept;
+    void RecordChunk(u32 frame, const PrecomputeChunk &chunk) noexcept;
+    // calibrates the chunk costs with the gpu time of the chunks the frame slot recorded last time
+    void ReadPrecomputeTimestamps(u32 frame) noexcept;
 
   public:
     std::shared_ptr<Pipeline> m_sky_pass, m_transmittance_lut_pass, m_direct_irradiance_lut_pass,
@@ -31,6 +96,7 @@ class Atmosphere {
         m_multi_scattering_lut_descriptor_set, m_camera_volume_descriptor_set;
     u32 m_multi_scattering_order = 3;
 
+    // scattering order and chunk offset of the precompute passes
     std::shared_ptr<PushConstants> scattering_order_push_constants;
 
     std::array<i32, 4> layers = {1, 2, 3, 4};
@@ -55,12 +121,10 @@ class Atmosphere {
     DescriptorSetUpdateDesc m_camera_volume_descriptor_set_update_desc;
 
   public:
-    std::shared_ptr<Texture> transmittance_lut;
+    // intermediates of the precompute, shared by both lut sets
     std::shared_ptr<Texture> direct_irradiance_lut;
-    std::shared_ptr<Texture> _irradiance_tex;
     std::shared_ptr<Texture> single_rayleigh_scattering_lut;
     std::shared_ptr<Texture> single_mie_scattering_lut;
-    std::shared_ptr<Texture> _scattering_tex;
     //std::shared_ptr<Texture> single_scattering_lut_tex4;
     std::shared_ptr<Texture> scattering_density_lut;
     std::shared_ptr<Texture> multi_scattering_lut;
@@ -69,6 +133,33 @@ class Atmosphere {
     std::shared_ptr<Texture> out_transmittance;
 
   private:
+    std::shared_ptr<Device> m_device = nullptr;
+    std::shared_ptr<CommandBuffer> m_command_buffer = nullptr;
+    // identifies the precomputed luts in the cache file
+    u64 m_lut_key = 0;
+
+    // the sky samples the front set, a precompute writes the target set. the first precompute has no complete set to
+    // keep showing and writes the front set directly
+    std::array<LutSet, 2> m_lut_sets;
+    u32 m_front = 0;
+    u32 m_target = 0;
+    // parameters the next precompute uses
+    AtmosphereParameters m_parameters;
+
+    std::vector<PrecomputeChunk> m_chunks;
+    u32 m_next_chunk = 0;
+    bool m_precompute_pending = false;
+    u32 m_precompute_frames = 0;
+    std::shared_ptr<UniformBuffer> m_precompute_ub;
+    PrecomputePushConstants m_precompute_push_constants{};
+
+    f64 m_precompute_budget_ms = 1.0;
+    // measured gpu time of one chunk of each pass, 0 until measured
+    std::array<f64, static_cast<u32>(PrecomputePass::COUNT)> m_chunk_cost_ms{};
+    // two timestamps around the chunks of each frame in flight, null without timestamp support
+    VkQueryPool m_timestamp_query_pool = VK_NULL_HANDLE;
+    std::array<std::vector<PrecomputePass>, MAX_FRAMES_IN_FLIGHT> m_frame_chunks;
+
     std::shared_ptr<UniformBuffer> m_single_scattering_lut_ub;
     struct SingleScatteringLUTUb {
         Math::mat3 luminance_from_radiance;
@@ -84,8 +175,10 @@ class Atmosphere {
         Math::vec2 pad0;
         Math::vec3 camera_pos;
         f32 pad1;
+        AtmosphereUbData atmosphere;
     } m_sky_ubdata;
 
+    // the front set holds complete luts
     bool precomputed = false;
 };
 
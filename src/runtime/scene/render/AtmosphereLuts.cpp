@@ -0,0 +1,190 @@
+#include "AtmosphereLuts.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+
+#include <runtime/core/log/Log.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HORIZON_ATMOSPHERE_LUTS_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace Horizon {
+
+namespace {
+
+constexpr u32 ATMOSPHERE_LUTS_MAGIC = 0x4d544148; // "HATM"
+constexpr u32 ATMOSPHERE_LUTS_VERSION = 1;
+
+struct AtmosphereLutsHeader {
+    u32 magic;
+    u32 version;
+    u64 key;
+    // width, height, depth of transmittance, irradiance, scattering
+    u32 extents[3][3];
+    u32 padding;
+};
+
+// texel pair and weight of a linear filter along one axis, clamp to edge
+struct LinearTaps {
+    u32 i0, i1;
+    f32 t;
+};
+
+inline LinearTaps GetLinearTaps(f32 coord, u32 size) noexcept {
+    f32 x = coord * static_cast<f32>(size) - 0.5f;
+    f32 x0 = std::floor(x);
+    i32 i = static_cast<i32>(x0);
+    i32 last = static_cast<i32>(size) - 1;
+    return {static_cast<u32>(std::clamp(i, 0, last)), static_cast<u32>(std::clamp(i + 1, 0, last)), x - x0};
+}
+
+// all four channels of a texel at once, the channels are the wavelengths the kernels integrate
+#if defined(HORIZON_ATMOSPHERE_LUTS_SSE2)
+
+using Texel = __m128;
+
+inline Texel Load(const Math::vec4 &v) noexcept { return _mm_loadu_ps(&v.x); }
+
+inline Texel Lerp(Texel a, Texel b, f32 t) noexcept {
+    return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), _mm_set1_ps(t)));
+}
+
+inline Math::vec4 Store(Texel v) noexcept {
+    Math::vec4 result;
+    _mm_storeu_ps(&result.x, v);
+    return result;
+}
+
+#else
+
+using Texel = Math::vec4;
+
+inline Texel Load(const Math::vec4 &v) noexcept { return v; }
+
+inline Texel Lerp(const Texel &a, const Texel &b, f32 t) noexcept { return a + (b - a) * t; }
+
+inline Math::vec4 Store(const Texel &v) noexcept { return v; }
+
+#endif
+
+} // namespace
+
+void AtmosphereTexture::Resize(u32 _width, u32 _height, u32 _depth) noexcept {
+    width = _width;
+    height = _height;
+    depth = _depth;
+    texels.assign(static_cast<u64>(width) * height * depth, Math::vec4(0.0f));
+}
+
+Math::vec4 AtmosphereTexture::Sample(const Math::vec2 &uv) const noexcept {
+    LinearTaps x = GetLinearTaps(uv.x, width);
+    LinearTaps y = GetLinearTaps(uv.y, height);
+    const Math::vec4 *row0 = texels.data() + static_cast<u64>(y.i0) * width;
+    const Math::vec4 *row1 = texels.data() + static_cast<u64>(y.i1) * width;
+    return Store(Lerp(Lerp(Load(row0[x.i0]), Load(row0[x.i1]), x.t), Lerp(Load(row1[x.i0]), Load(row1[x.i1]), x.t),
+                      y.t));
+}
+
+Math::vec4 AtmosphereTexture::Sample(const Math::vec3 &uvw) const noexcept {
+    LinearTaps x = GetLinearTaps(uvw.x, width);
+    LinearTaps y = GetLinearTaps(uvw.y, height);
+    LinearTaps z = GetLinearTaps(uvw.z, depth);
+    u64 slice = static_cast<u64>(width) * height;
+    const Math::vec4 *row00 = texels.data() + z.i0 * slice + static_cast<u64>(y.i0) * width;
+    const Math::vec4 *row01 = texels.data() + z.i0 * slice + static_cast<u64>(y.i1) * width;
+    const Math::vec4 *row10 = texels.data() + z.i1 * slice + static_cast<u64>(y.i0) * width;
+    const Math::vec4 *row11 = texels.data() + z.i1 * slice + static_cast<u64>(y.i1) * width;
+    Texel slice0 = Lerp(Lerp(Load(row00[x.i0]), Load(row00[x.i1]), x.t),
+                        Lerp(Load(row01[x.i0]), Load(row01[x.i1]), x.t), y.t);
+    Texel slice1 = Lerp(Lerp(Load(row10[x.i0]), Load(row10[x.i1]), x.t),
+                        Lerp(Load(row11[x.i0]), Load(row11[x.i1]), x.t), y.t);
+    return Store(Lerp(slice0, slice1, z.t));
+}
+
+void AtmosphereLuts::Allocate() noexcept {
+    transmittance.Resize(TRANSMITTANCE_TEXTURE_WIDTH, TRANSMITTANCE_TEXTURE_HEIGHT);
+    irradiance.Resize(IRRADIANCE_TEXTURE_WIDTH, IRRADIANCE_TEXTURE_HEIGHT);
+    scattering.Resize(SCATTERING_TEXTURE_WIDTH, SCATTERING_TEXTURE_HEIGHT, SCATTERING_TEXTURE_DEPTH);
+}
+
+bool AtmosphereLuts::Write(const std::string &path, u64 key) const noexcept {
+    const AtmosphereTexture *luts[3] = {&transmittance, &irradiance, &scattering};
+
+    AtmosphereLutsHeader header{};
+    header.magic = ATMOSPHERE_LUTS_MAGIC;
+    header.version = ATMOSPHERE_LUTS_VERSION;
+    header.key = key;
+    for (u32 i = 0; i < 3; i++) {
+        header.extents[i][0] = luts[i]->width;
+        header.extents[i][1] = luts[i]->height;
+        header.extents[i][2] = luts[i]->depth;
+    }
+
+    // write to a temporary file first so a crash never leaves a truncated file behind
+    std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            LOG_WARN("failed to open {}", tmp_path);
+            return false;
+        }
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        for (const AtmosphereTexture *lut : luts) {
+            file.write(reinterpret_cast<const char *>(lut->texels.data()), lut->GetSize());
+        }
+        if (!file.good()) {
+            LOG_WARN("failed to write {}", tmp_path);
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp_path, path, ec);
+    if (ec) {
+        LOG_WARN("failed to move {} to {}: {}", tmp_path, path, ec.message());
+        std::filesystem::remove(tmp_path, ec);
+        return false;
+    }
+    return true;
+}
+
+bool AtmosphereLuts::Read(const std::string &path, u64 key) noexcept {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    AtmosphereLutsHeader header{};
+    file.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (!file.good() || header.magic != ATMOSPHERE_LUTS_MAGIC || header.version != ATMOSPHERE_LUTS_VERSION) {
+        LOG_WARN("{} is not an atmosphere lut file of version {}", path, ATMOSPHERE_LUTS_VERSION);
+        return false;
+    }
+    if (key != 0 && header.key != key) {
+        LOG_INFO("{} was computed from different parameters", path);
+        return false;
+    }
+
+    Allocate();
+    AtmosphereTexture *luts[3] = {&transmittance, &irradiance, &scattering};
+    for (u32 i = 0; i < 3; i++) {
+        if (header.extents[i][0] != luts[i]->width || header.extents[i][1] != luts[i]->height ||
+            header.extents[i][2] != luts[i]->depth) {
+            LOG_WARN("{} has different lut sizes", path);
+            return false;
+        }
+    }
+    for (AtmosphereTexture *lut : luts) {
+        file.read(reinterpret_cast<char *>(lut->texels.data()), lut->GetSize());
+    }
+    if (!file.good()) {
+        LOG_WARN("{} is truncated", path);
+        return false;
+    }
+    return true;
+}
+
+} // namespace Horizon
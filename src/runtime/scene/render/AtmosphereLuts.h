@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <runtime/core/math/Math.h>
+#include <runtime/scene/render/AtmosphereParameters.h>
+
+namespace Horizon {
+
+// rgba32f texels on the cpu, x fastest then y then z. this is the layout of a tightly packed image copy
+struct AtmosphereTexture {
+    u32 width = 0;
+    u32 height = 0;
+    u32 depth = 0;
+    std::vector<Math::vec4> texels;
+
+    void Resize(u32 _width, u32 _height, u32 _depth = 1) noexcept;
+    u64 GetTexelCount() const noexcept { return texels.size(); }
+    u64 GetSize() const noexcept { return texels.size() * sizeof(Math::vec4); }
+
+    Math::vec4 &At(u32 x, u32 y, u32 z = 0) noexcept { return texels[(static_cast<u64>(z) * height + y) * width + x]; }
+
+    // linear filtering with clamp to edge addressing, like the sampler of the lut textures
+    Math::vec4 Sample(const Math::vec2 &uv) const noexcept;
+    Math::vec4 Sample(const Math::vec3 &uvw) const noexcept;
+};
+
+// the luts the sky pass samples once the precompute is done
+struct AtmosphereLuts {
+    AtmosphereTexture transmittance;
+    // indirect ground irradiance, the direct part is not included
+    AtmosphereTexture irradiance;
+    // rayleigh and multiple scattering in rgb, single mie scattering red in alpha
+    AtmosphereTexture scattering;
+
+    // sizes every lut to the dimensions in AtmosphereParameters.h
+    void Allocate() noexcept;
+
+    // header | transmittance | irradiance | scattering, key identifies what the luts were computed from
+    bool Write(const std::string &path, u64 key) const noexcept;
+    // fails on a missing file, a version or size mismatch, or a different key. key 0 accepts any key
+    bool Read(const std::string &path, u64 key) noexcept;
+};
+
+} // namespace Horizon
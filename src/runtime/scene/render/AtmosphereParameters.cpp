@@ -0,0 +1,97 @@
+#include "AtmosphereParameters.h"
+
+#include <cmath>
+#include <fstream>
+#include <iterator>
+
+namespace Horizon {
+
+namespace {
+
+constexpr u64 FNV_OFFSET_BASIS = 0xcbf29ce484222325ull;
+constexpr u64 FNV_PRIME = 0x100000001b3ull;
+
+u64 Fnv1a(u64 hash, const void *data, u64 size) noexcept {
+    const u8 *bytes = static_cast<const u8 *>(data);
+    for (u64 i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+} // namespace
+
+AtmosphereParameters GetDefaultAtmosphereParameters() noexcept {
+    AtmosphereParameters atmosphere{};
+    atmosphere.bottom_radius = 6360.0f;
+    atmosphere.top_radius = 6460.0f;
+    atmosphere.solar_irradiance = Math::vec3(1.0f);
+    atmosphere.sun_angular_radius = 0.004675f;
+    f32 rayleigh_scale_height = 8.0f;
+    f32 mie_scale_height = 1.2f;
+    atmosphere.rayleigh_density.layers[0] = DensityProfileLayer{0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+    atmosphere.rayleigh_density.layers[1] = DensityProfileLayer{0.0f, 1.0f, -1.0f / rayleigh_scale_height, 0.0f, 0.0f};
+    atmosphere.rayleigh_scattering = Math::vec3(0.005802f, 0.013558f, 0.033100f);
+    atmosphere.mie_density.layers[0] = DensityProfileLayer{0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+    atmosphere.mie_density.layers[1] = DensityProfileLayer{0.0f, 1.0f, -1.0f / mie_scale_height, 0.0f, 0.0f};
+    atmosphere.mie_scattering = Math::vec3(0.003996f);
+    atmosphere.mie_extinction = Math::vec3(0.004440f);
+    atmosphere.mie_g = 0.8f;
+    atmosphere.absorption_density.layers[0] = DensityProfileLayer{25.0f, 0.0f, 0.0f, 1.0f / 15.0f, -2.0f / 3.0f};
+    atmosphere.absorption_density.layers[1] = DensityProfileLayer{0.0f, 0.0f, 0.0f, -1.0f / 15.0f, 8.0f / 3.0f};
+    atmosphere.absorption_extinction = Math::vec3(0.000650f, 0.001881f, 0.000085f);
+    atmosphere.ground_albedo = Math::vec3(0.0f);
+    const f32 max_sun_zenith_angle = 120.0f / 180.0f * 3.14159265359f;
+    atmosphere.mu_s_min = std::cos(max_sun_zenith_angle);
+    return atmosphere;
+}
+
+AtmosphereUbData PackAtmosphereParameters(const AtmosphereParameters &atmosphere) noexcept {
+    AtmosphereUbData data{};
+    data.radii = Math::vec4(atmosphere.bottom_radius, atmosphere.top_radius, atmosphere.mie_g,
+                            atmosphere.sun_angular_radius);
+    data.solar_irradiance = Math::vec4(atmosphere.solar_irradiance, atmosphere.mu_s_min);
+    data.rayleigh_scattering = Math::vec4(atmosphere.rayleigh_scattering, 0.0f);
+    data.mie_scattering = Math::vec4(atmosphere.mie_scattering, 0.0f);
+    data.mie_extinction = Math::vec4(atmosphere.mie_extinction, 0.0f);
+    data.absorption_extinction = Math::vec4(atmosphere.absorption_extinction, 0.0f);
+    data.ground_albedo = Math::vec4(atmosphere.ground_albedo, 0.0f);
+
+    const DensityProfileLayer *layers[6] = {
+        &atmosphere.rayleigh_density.layers[0],   &atmosphere.rayleigh_density.layers[1],
+        &atmosphere.mie_density.layers[0],        &atmosphere.mie_density.layers[1],
+        &atmosphere.absorption_density.layers[0], &atmosphere.absorption_density.layers[1]};
+    for (u32 i = 0; i < 6; i++) {
+        data.density_layers[i] =
+            Math::vec4(layers[i]->width, layers[i]->exp_term, layers[i]->exp_scale, layers[i]->linear_term);
+        data.density_constant_terms[i / 4][i % 4] = layers[i]->constant_term;
+    }
+    return data;
+}
+
+u64 HashAtmosphereParameters(const AtmosphereParameters &atmosphere) noexcept {
+    // every member is a float, the struct has no padding
+    u64 hash = Fnv1a(FNV_OFFSET_BASIS, &atmosphere, sizeof(AtmosphereParameters));
+    const u32 dimensions[] = {TRANSMITTANCE_TEXTURE_WIDTH,  TRANSMITTANCE_TEXTURE_HEIGHT, SCATTERING_TEXTURE_R_SIZE,
+                              SCATTERING_TEXTURE_MU_SIZE,   SCATTERING_TEXTURE_MU_S_SIZE, SCATTERING_TEXTURE_NU_SIZE,
+                              IRRADIANCE_TEXTURE_WIDTH,     IRRADIANCE_TEXTURE_HEIGHT};
+    return Fnv1a(hash, dimensions, sizeof(dimensions));
+}
+
+u64 HashAtmospherePrecompute(const AtmosphereParameters &atmosphere, u32 multi_scattering_order,
+                             const std::vector<std::string> &spirv_paths) noexcept {
+    u64 hash = HashAtmosphereParameters(atmosphere);
+    hash = Fnv1a(hash, &multi_scattering_order, sizeof(multi_scattering_order));
+    for (const std::string &path : spirv_paths) {
+        // a missing shader hashes like an empty one, the pipeline creation reports it
+        std::ifstream file(path, std::ios::binary);
+        std::vector<char> code((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        u64 size = code.size();
+        hash = Fnv1a(hash, &size, sizeof(size));
+        hash = Fnv1a(hash, code.data(), size);
+    }
+    return hash;
+}
+
+} // namespace Horizon
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <runtime/core/math/Math.h>
+
+namespace Horizon {
+
+// lut dimensions, must match definations.glsl
+static constexpr u32 TRANSMITTANCE_TEXTURE_WIDTH = 256;
+static constexpr u32 TRANSMITTANCE_TEXTURE_HEIGHT = 64;
+static constexpr u32 SCATTERING_TEXTURE_R_SIZE = 32;
+static constexpr u32 SCATTERING_TEXTURE_MU_SIZE = 128;
+static constexpr u32 SCATTERING_TEXTURE_MU_S_SIZE = 32;
+static constexpr u32 SCATTERING_TEXTURE_NU_SIZE = 8;
+static constexpr u32 SCATTERING_TEXTURE_WIDTH = SCATTERING_TEXTURE_NU_SIZE * SCATTERING_TEXTURE_MU_S_SIZE;
+static constexpr u32 SCATTERING_TEXTURE_HEIGHT = SCATTERING_TEXTURE_MU_SIZE;
+static constexpr u32 SCATTERING_TEXTURE_DEPTH = SCATTERING_TEXTURE_R_SIZE;
+static constexpr u32 IRRADIANCE_TEXTURE_WIDTH = 64;
+static constexpr u32 IRRADIANCE_TEXTURE_HEIGHT = 16;
+
+struct DensityProfileLayer {
+    f32 width;
+    f32 exp_term;
+    f32 exp_scale;
+    f32 linear_term;
+    f32 constant_term;
+};
+
+struct DensityProfile {
+    DensityProfileLayer layers[2];
+};
+
+// lengths in km, same fields as AtmosphereParameters in definations.glsl
+struct AtmosphereParameters {
+    f32 bottom_radius;
+    f32 top_radius;
+    f32 mie_g;
+    f32 sun_angular_radius;
+    Math::vec3 solar_irradiance;
+    Math::vec3 rayleigh_scattering, mie_scattering, mie_extinction, absorption_extinction;
+    DensityProfile rayleigh_density, mie_density, absorption_density;
+    f32 mu_s_min;
+    Math::vec3 ground_albedo;
+};
+
+// std140 packing of the parameters for uniform buffers, AtmosphereUbData in definations.glsl
+struct AtmosphereUbData {
+    Math::vec4 radii; // bottom_radius, top_radius, mie_g, sun_angular_radius
+    Math::vec4 solar_irradiance; // w is mu_s_min
+    Math::vec4 rayleigh_scattering;
+    Math::vec4 mie_scattering;
+    Math::vec4 mie_extinction;
+    Math::vec4 absorption_extinction;
+    Math::vec4 ground_albedo;
+    // width, exp_term, exp_scale, linear_term of the rayleigh, mie and absorption layers
+    Math::vec4 density_layers[6];
+    // constant_term of the same six layers
+    Math::vec4 density_constant_terms[2];
+};
+
+// the earth like atmosphere the renderer starts with
+AtmosphereParameters GetDefaultAtmosphereParameters() noexcept;
+
+AtmosphereUbData PackAtmosphereParameters(const AtmosphereParameters &atmosphere) noexcept;
+
+// hash of the parameters and the lut dimensions
+u64 HashAtmosphereParameters(const AtmosphereParameters &atmosphere) noexcept;
+
+// key of luts precomputed on the gpu, also covers the scattering orders and the spirv of the precompute shaders
+u64 HashAtmospherePrecompute(const AtmosphereParameters &atmosphere, u32 multi_scattering_order,
+                             const std::vector<std::string> &spirv_paths) noexcept;
+
+} // namespace Horizon
@@ -0,0 +1,569 @@
+#include "AtmosphereReference.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include <runtime/core/thread/ThreadPool.h>
+
+namespace Horizon {
+
+namespace {
+
+// straight ports of functions.glsl, same names, same float math
+
+constexpr f32 PI = 3.14159265359f;
+
+f32 ClampCosine(f32 mu) noexcept { return std::clamp(mu, -1.0f, 1.0f); }
+
+f32 ClampDistance(f32 d) noexcept { return std::max(d, 0.0f); }
+
+f32 ClampRadius(const AtmosphereParameters &atmosphere, f32 r) noexcept {
+    return std::clamp(r, atmosphere.bottom_radius, atmosphere.top_radius);
+}
+
+f32 SafeSqrt(f32 a) noexcept { return std::sqrt(std::max(a, 0.0f)); }
+
+f32 DistanceToTopAtmosphereBoundary(const AtmosphereParameters &atmosphere, f32 r, f32 mu) noexcept {
+    f32 discriminant = r * r * (mu * mu - 1.0f) + atmosphere.top_radius * atmosphere.top_radius;
+    return ClampDistance(-r * mu + SafeSqrt(discriminant));
+}
+
+f32 DistanceToBottomAtmosphereBoundary(const AtmosphereParameters &atmosphere, f32 r, f32 mu) noexcept {
+    f32 discriminant = r * r * (mu * mu - 1.0f) + atmosphere.bottom_radius * atmosphere.bottom_radius;
+    return ClampDistance(-r * mu - SafeSqrt(discriminant));
+}
+
+bool RayIntersectsGround(const AtmosphereParameters &atmosphere, f32 r, f32 mu) noexcept {
+    return mu < 0.0f && r * r * (mu * mu - 1.0f) + atmosphere.bottom_radius * atmosphere.bottom_radius >= 0.0f;
+}
+
+f32 GetLayerDensity(const DensityProfileLayer &layer, f32 altitude) noexcept {
+    f32 density =
+        layer.exp_term * std::exp(layer.exp_scale * altitude) + layer.linear_term * altitude + layer.constant_term;
+    return std::clamp(density, 0.0f, 1.0f);
+}
+
+f32 GetProfileDensity(const DensityProfile &profile, f32 altitude) noexcept {
+    return altitude < profile.layers[0].width ? GetLayerDensity(profile.layers[0], altitude)
+                                              : GetLayerDensity(profile.layers[1], altitude);
+}
+
+f32 ComputeOpticalLengthToTopAtmosphereBoundary(const AtmosphereParameters &atmosphere, const DensityProfile &profile,
+                                                f32 r, f32 mu) noexcept {
+    const i32 SAMPLE_COUNT = 500;
+    f32 dx = DistanceToTopAtmosphereBoundary(atmosphere, r, mu) / static_cast<f32>(SAMPLE_COUNT);
+    f32 result = 0.0f;
+    for (i32 i = 0; i <= SAMPLE_COUNT; ++i) {
+        f32 d_i = static_cast<f32>(i) * dx;
+        f32 r_i = std::sqrt(d_i * d_i + 2.0f * r * mu * d_i + r * r);
+        f32 y_i = GetProfileDensity(profile, r_i - atmosphere.bottom_radius);
+        f32 weight_i = i == 0 || i == SAMPLE_COUNT ? 0.5f : 1.0f;
+        result += y_i * weight_i * dx;
+    }
+    return result;
+}
+
+Math::vec3 ComputeTransmittanceToTopAtmosphereBoundary(const AtmosphereParameters &atmosphere, f32 r,
+                                                       f32 mu) noexcept {
+    return Math::exp(
+        -(atmosphere.rayleigh_scattering *
+              ComputeOpticalLengthToTopAtmosphereBoundary(atmosphere, atmosphere.rayleigh_density, r, mu) +
+          atmosphere.mie_extinction *
+              ComputeOpticalLengthToTopAtmosphereBoundary(atmosphere, atmosphere.mie_density, r, mu) +
+          atmosphere.absorption_extinction *
+              ComputeOpticalLengthToTopAtmosphereBoundary(atmosphere, atmosphere.absorption_density, r, mu)));
+}
+
+f32 GetTextureCoordFromUnitRange(f32 x, f32 texture_size) noexcept {
+    return 0.5f / texture_size + x * (1.0f - 1.0f / texture_size);
+}
+
+f32 GetUnitRangeFromTextureCoord(f32 u, f32 texture_size) noexcept {
+    return (u - 0.5f / texture_size) / (1.0f - 1.0f / texture_size);
+}
+
+Math::vec2 GetTransmittanceTextureUvFromRMu(const AtmosphereParameters &atmosphere, f32 r, f32 mu) noexcept {
+    f32 H = std::sqrt(atmosphere.top_radius * atmosphere.top_radius -
+                      atmosphere.bottom_radius * atmosphere.bottom_radius);
+    f32 rho = SafeSqrt(r * r - atmosphere.bottom_radius * atmosphere.bottom_radius);
+    f32 d = DistanceToTopAtmosphereBoundary(atmosphere, r, mu);
+    f32 d_min = atmosphere.top_radius - r;
+    f32 d_max = rho + H;
+    f32 x_mu = (d - d_min) / (d_max - d_min);
+    f32 x_r = rho / H;
+    return Math::vec2(GetTextureCoordFromUnitRange(x_mu, TRANSMITTANCE_TEXTURE_WIDTH),
+                      GetTextureCoordFromUnitRange(x_r, TRANSMITTANCE_TEXTURE_HEIGHT));
+}
+
+void GetRMuFromTransmittanceTextureUv(const AtmosphereParameters &atmosphere, const Math::vec2 &uv, f32 &r,
+                                      f32 &mu) noexcept {
+    f32 x_mu = GetUnitRangeFromTextureCoord(uv.x, TRANSMITTANCE_TEXTURE_WIDTH);
+    f32 x_r = GetUnitRangeFromTextureCoord(uv.y, TRANSMITTANCE_TEXTURE_HEIGHT);
+    f32 H = std::sqrt(atmosphere.top_radius * atmosphere.top_radius -
+                      atmosphere.bottom_radius * atmosphere.bottom_radius);
+    f32 rho = H * x_r;
+    r = std::sqrt(rho * rho + atmosphere.bottom_radius * atmosphere.bottom_radius);
+    f32 d_min = atmosphere.top_radius - r;
+    f32 d_max = rho + H;
+    f32 d = d_min + x_mu * (d_max - d_min);
+    mu = d == 0.0f ? 1.0f : (H * H - rho * rho - d * d) / (2.0f * r * d);
+    mu = ClampCosine(mu);
+}
+
+Math::vec3 GetTransmittanceToTopAtmosphereBoundary(const AtmosphereParameters &atmosphere,
+                                                   const AtmosphereTexture &transmittance_texture, f32 r,
+                                                   f32 mu) noexcept {
+    return Math::vec3(transmittance_texture.Sample(GetTransmittanceTextureUvFromRMu(atmosphere, r, mu)));
+}
+
+Math::vec3 GetTransmittance(const AtmosphereParameters &atmosphere, const AtmosphereTexture &transmittance_texture,
+                            f32 r, f32 mu, f32 d, bool ray_r_mu_intersects_ground) noexcept {
+    f32 r_d = ClampRadius(atmosphere, std::sqrt(d * d + 2.0f * r * mu * d + r * r));
+    f32 mu_d = ClampCosine((r * mu + d) / r_d);
+    if (ray_r_mu_intersects_ground) {
+        return Math::min(GetTransmittanceToTopAtmosphereBoundary(atmosphere, transmittance_texture, r_d, -mu_d) /
+                             GetTransmittanceToTopAtmosphereBoundary(atmosphere, transmittance_texture, r, -mu),
+                         Math::vec3(1.0f));
+    } else {
+        return Math::min(GetTransmittanceToTopAtmosphereBoundary(atmosphere, transmittance_texture, r, mu) /
+                             GetTransmittanceToTopAtmosphereBoundary(atmosphere, transmittance_texture, r_d, mu_d),
+                         Math::vec3(1.0f));
+    }
+}
+
+Math::vec3 GetTransmittanceToSun(const AtmosphereParameters &atmosphere, const AtmosphereTexture &transmittance_texture,
+                                 f32 r, f32 mu_s) noexcept {
+    f32 sin_theta_h = atmosphere.bottom_radius / r;
+    f32 cos_theta_h = -std::sqrt(std::max(1.0f - sin_theta_h * sin_theta_h, 0.0f));
+    return GetTransmittanceToTopAtmosphereBoundary(atmosphere, transmittance_texture, r, mu_s) *
+           Math::smoothstep(-sin_theta_h * atmosphere.sun_angular_radius, sin_theta_h * atmosphere.sun_angular_radius,
+                            mu_s - cos_theta_h);
+}
+
+void ComputeSingleScatteringIntegrand(const AtmosphereParameters &atmosphere,
+                                      const AtmosphereTexture &transmittance_texture, f32 r, f32 mu, f32 mu_s, f32 nu,
+                                      f32 d, bool ray_r_mu_intersects_ground, Math::vec3 &rayleigh,
+                                      Math::vec3 &mie) noexcept {
+    f32 r_d = ClampRadius(atmosphere, std::sqrt(d * d + 2.0f * r * mu * d + r * r));
+    f32 mu_s_d = ClampCosine((r * mu_s + d * nu) / r_d);
+    Math::vec3 transmittance =
+        GetTransmittance(atmosphere, transmittance_texture, r, mu, d, ray_r_mu_intersects_ground) *
+        GetTransmittanceToSun(atmosphere, transmittance_texture, r_d, mu_s_d);
+    rayleigh = transmittance * GetProfileDensity(atmosphere.rayleigh_density, r_d - atmosphere.bottom_radius);
+    mie = transmittance * GetProfileDensity(atmosphere.mie_density, r_d - atmosphere.bottom_radius);
+}
+
+f32 DistanceToNearestAtmosphereBoundary(const AtmosphereParameters &atmosphere, f32 r, f32 mu,
+                                        bool ray_r_mu_intersects_ground) noexcept {
+    if (ray_r_mu_intersects_ground) {
+        return DistanceToBottomAtmosphereBoundary(atmosphere, r, mu);
+    } else {
+        return DistanceToTopAtmosphereBoundary(atmosphere, r, mu);
+    }
+}
+
+void ComputeSingleScattering(const AtmosphereParameters &atmosphere, const AtmosphereTexture &transmittance_texture,
+                             f32 r, f32 mu, f32 mu_s, f32 nu, bool ray_r_mu_intersects_ground, Math::vec3 &rayleigh,
+                             Math::vec3 &mie) noexcept {
+    const i32 SAMPLE_COUNT = 50;
+    f32 dx = DistanceToNearestAtmosphereBoundary(atmosphere, r, mu, ray_r_mu_intersects_ground) /
+             static_cast<f32>(SAMPLE_COUNT);
+    Math::vec3 rayleigh_sum(0.0f);
+    Math::vec3 mie_sum(0.0f);
+    for (i32 i = 0; i <= SAMPLE_COUNT; ++i) {
+        f32 d_i = static_cast<f32>(i) * dx;
+        Math::vec3 rayleigh_i;
+        Math::vec3 mie_i;
+        ComputeSingleScatteringIntegrand(atmosphere, transmittance_texture, r, mu, mu_s, nu, d_i,
+                                         ray_r_mu_intersects_ground, rayleigh_i, mie_i);
+        f32 weight_i = (i == 0 || i == SAMPLE_COUNT) ? 0.5f : 1.0f;
+        rayleigh_sum += rayleigh_i * weight_i;
+        mie_sum += mie_i * weight_i;
+    }
+    rayleigh = rayleigh_sum * dx * atmosphere.solar_irradiance * atmosphere.rayleigh_scattering;
+    mie = mie_sum * dx * atmosphere.solar_irradiance * atmosphere.mie_scattering;
+}
+
+f32 RayleighPhaseFunction(f32 nu) noexcept {
+    f32 k = 3.0f / (16.0f * PI);
+    return k * (1.0f + nu * nu);
+}
+
+f32 MiePhaseFunction(f32 g, f32 nu) noexcept {
+    f32 k = 3.0f / (8.0f * PI) * (1.0f - g * g) / (2.0f + g * g);
+    return k * (1.0f + nu * nu) / std::pow(1.0f + g * g - 2.0f * g * nu, 1.5f);
+}
+
+Math::vec4 GetScatteringTextureUvwzFromRMuMuSNu(const AtmosphereParameters &atmosphere, f32 r, f32 mu, f32 mu_s,
+                                                f32 nu, bool ray_r_mu_intersects_ground) noexcept {
+    f32 H = std::sqrt(atmosphere.top_radius * atmosphere.top_radius -
+                      atmosphere.bottom_radius * atmosphere.bottom_radius);
+    f32 rho = SafeSqrt(r * r - atmosphere.bottom_radius * atmosphere.bottom_radius);
+    f32 u_r = GetTextureCoordFromUnitRange(rho / H, SCATTERING_TEXTURE_R_SIZE);
+    f32 r_mu = r * mu;
+    f32 discriminant = r_mu * r_mu - r * r + atmosphere.bottom_radius * atmosphere.bottom_radius;
+    f32 u_mu;
+    if (ray_r_mu_intersects_ground) {
+        f32 d = -r_mu - SafeSqrt(discriminant);
+        f32 d_min = r - atmosphere.bottom_radius;
+        f32 d_max = rho;
+        u_mu = 0.5f - 0.5f * GetTextureCoordFromUnitRange(d_max == d_min ? 0.0f : (d - d_min) / (d_max - d_min),
+                                                          SCATTERING_TEXTURE_MU_SIZE * 0.5f);
+    } else {
+        f32 d = -r_mu + SafeSqrt(discriminant + H * H);
+        f32 d_min = atmosphere.top_radius - r;
+        f32 d_max = rho + H;
+        u_mu = 0.5f + 0.5f * GetTextureCoordFromUnitRange((d - d_min) / (d_max - d_min),
+                                                          SCATTERING_TEXTURE_MU_SIZE * 0.5f);
+    }
+    f32 d = DistanceToTopAtmosphereBoundary(atmosphere, atmosphere.bottom_radius, mu_s);
+    f32 d_min = atmosphere.top_radius - atmosphere.bottom_radius;
+    f32 d_max = H;
+    f32 a = (d - d_min) / (d_max - d_min);
+    f32 D = DistanceToTopAtmosphereBoundary(atmosphere, atmosphere.bottom_radius, atmosphere.mu_s_min);
+    f32 A = (D - d_min) / (d_max - d_min);
+    f32 u_mu_s = GetTextureCoordFromUnitRange(std::max(1.0f - a / A, 0.0f) / (1.0f + a), SCATTERING_TEXTURE_MU_S_SIZE);
+    f32 u_nu = (nu + 1.0f) / 2.0f;
+    return Math::vec4(u_nu, u_mu_s, u_mu, u_r);
+}
+
+void GetRMuMuSNuFromScatteringTextureUvwz(const AtmosphereParameters &atmosphere, const Math::vec4 &uvwz, f32 &r,
+                                          f32 &mu, f32 &mu_s, f32 &nu, bool &ray_r_mu_intersects_ground) noexcept {
+    f32 H = std::sqrt(atmosphere.top_radius * atmosphere.top_radius -
+                      atmosphere.bottom_radius * atmosphere.bottom_radius);
+    f32 rho = H * GetUnitRangeFromTextureCoord(uvwz.w, SCATTERING_TEXTURE_R_SIZE);
+    r = std::sqrt(rho * rho + atmosphere.bottom_radius * atmosphere.bottom_radius);
+    if (uvwz.z < 0.5f) {
+        f32 d_min = r - atmosphere.bottom_radius;
+        f32 d_max = rho;
+        f32 d = d_min + (d_max - d_min) *
+                            GetUnitRangeFromTextureCoord(1.0f - 2.0f * uvwz.z, SCATTERING_TEXTURE_MU_SIZE / 2);
+        mu = d == 0.0f ? -1.0f : ClampCosine(-(rho * rho + d * d) / (2.0f * r * d));
+        ray_r_mu_intersects_ground = true;
+    } else {
+        f32 d_min = atmosphere.top_radius - r;
+        f32 d_max = rho + H;
+        f32 d = d_min + (d_max - d_min) *
+                            GetUnitRangeFromTextureCoord(2.0f * uvwz.z - 1.0f, SCATTERING_TEXTURE_MU_SIZE / 2);
+        mu = d == 0.0f ? 1.0f : ClampCosine((H * H - rho * rho - d * d) / (2.0f * r * d));
+        ray_r_mu_intersects_ground = false;
+    }
+    f32 x_mu_s = GetUnitRangeFromTextureCoord(uvwz.y, SCATTERING_TEXTURE_MU_S_SIZE);
+    f32 d_min = atmosphere.top_radius - atmosphere.bottom_radius;
+    f32 d_max = H;
+    f32 D = DistanceToTopAtmosphereBoundary(atmosphere, atmosphere.bottom_radius, atmosphere.mu_s_min);
+    f32 A = (D - d_min) / (d_max - d_min);
+    f32 a = (A - x_mu_s * A) / (1.0f + x_mu_s * A);
+    f32 d = d_min + std::min(a, A) * (d_max - d_min);
+    mu_s = d == 0.0f ? 1.0f : ClampCosine((H * H - d * d) / (2.0f * atmosphere.bottom_radius * d));
+    nu = ClampCosine(uvwz.x * 2.0f - 1.0f);
+}
+
+void GetRMuMuSNuFromScatteringTextureFragCoord(const AtmosphereParameters &atmosphere, const Math::vec3 &frag_coord,
+                                               f32 &r, f32 &mu, f32 &mu_s, f32 &nu,
+                                               bool &ray_r_mu_intersects_ground) noexcept {
+    const Math::vec4 SCATTERING_TEXTURE_SIZE(SCATTERING_TEXTURE_NU_SIZE - 1, SCATTERING_TEXTURE_MU_S_SIZE,
+                                             SCATTERING_TEXTURE_MU_SIZE, SCATTERING_TEXTURE_R_SIZE);
+    f32 frag_coord_nu = std::floor(frag_coord.x / static_cast<f32>(SCATTERING_TEXTURE_MU_S_SIZE));
+    // glsl mod, x - y * floor(x / y)
+    f32 frag_coord_mu_s = frag_coord.x - static_cast<f32>(SCATTERING_TEXTURE_MU_S_SIZE) * frag_coord_nu;
+    Math::vec4 uvwz = Math::vec4(frag_coord_nu, frag_coord_mu_s, frag_coord.y, frag_coord.z) / SCATTERING_TEXTURE_SIZE;
+    GetRMuMuSNuFromScatteringTextureUvwz(atmosphere, uvwz, r, mu, mu_s, nu, ray_r_mu_intersects_ground);
+    nu = std::clamp(nu, mu * mu_s - std::sqrt((1.0f - mu * mu) * (1.0f - mu_s * mu_s)),
+                    mu * mu_s + std::sqrt((1.0f - mu * mu) * (1.0f - mu_s * mu_s)));
+}
+
+// the 4d scattering function is stored as nu slices side by side in x, lerp between the two nearest slices
+Math::vec4 GetScatteringTexel(const AtmosphereParameters &atmosphere, const AtmosphereTexture &scattering_texture,
+                              f32 r, f32 mu, f32 mu_s, f32 nu, bool ray_r_mu_intersects_ground) noexcept {
+    Math::vec4 uvwz = GetScatteringTextureUvwzFromRMuMuSNu(atmosphere, r, mu, mu_s, nu, ray_r_mu_intersects_ground);
+    f32 tex_coord_x = uvwz.x * static_cast<f32>(SCATTERING_TEXTURE_NU_SIZE - 1);
+    f32 tex_x = std::floor(tex_coord_x);
+    f32 lerp = tex_coord_x - tex_x;
+    Math::vec3 uvw0((tex_x + uvwz.y) / static_cast<f32>(SCATTERING_TEXTURE_NU_SIZE), uvwz.z, uvwz.w);
+    Math::vec3 uvw1((tex_x + 1.0f + uvwz.y) / static_cast<f32>(SCATTERING_TEXTURE_NU_SIZE), uvwz.z, uvwz.w);
+    return scattering_texture.Sample(uvw0) * (1.0f - lerp) + scattering_texture.Sample(uvw1) * lerp;
+}
+
+Math::vec3 GetScattering(const AtmosphereParameters &atmosphere, const AtmosphereTexture &scattering_texture, f32 r,
+                         f32 mu, f32 mu_s, f32 nu, bool ray_r_mu_intersects_ground) noexcept {
+    return Math::vec3(
+        GetScatteringTexel(atmosphere, scattering_texture, r, mu, mu_s, nu, ray_r_mu_intersects_ground));
+}
+
+Math::vec3 GetScattering(const AtmosphereParameters &atmosphere,
+                         const AtmosphereTexture &single_rayleigh_scattering_texture,
+                         const AtmosphereTexture &single_mie_scattering_texture,
+                         const AtmosphereTexture &multiple_scattering_texture, f32 r, f32 mu, f32 mu_s, f32 nu,
+                         bool ray_r_mu_intersects_ground, i32 scattering_order) noexcept {
+    if (scattering_order == 1) {
+        Math::vec3 rayleigh = GetScattering(atmosphere, single_rayleigh_scattering_texture, r, mu, mu_s, nu,
+                                            ray_r_mu_intersects_ground);
+        Math::vec3 mie =
+            GetScattering(atmosphere, single_mie_scattering_texture, r, mu, mu_s, nu, ray_r_mu_intersects_ground);
+        return rayleigh * RayleighPhaseFunction(nu) + mie * MiePhaseFunction(atmosphere.mie_g, nu);
+    } else {
+        return GetScattering(atmosphere, multiple_scattering_texture, r, mu, mu_s, nu, ray_r_mu_intersects_ground);
+    }
+}
+
+Math::vec2 GetIrradianceTextureUvFromRMuS(const AtmosphereParameters &atmosphere, f32 r, f32 mu_s) noexcept {
+    f32 x_r = (r - atmosphere.bottom_radius) / (atmosphere.top_radius - atmosphere.bottom_radius);
+    f32 x_mu_s = mu_s * 0.5f + 0.5f;
+    return Math::vec2(GetTextureCoordFromUnitRange(x_mu_s, IRRADIANCE_TEXTURE_WIDTH),
+                      GetTextureCoordFromUnitRange(x_r, IRRADIANCE_TEXTURE_HEIGHT));
+}
+
+void GetRMuSFromIrradianceTextureUv(const AtmosphereParameters &atmosphere, const Math::vec2 &uv, f32 &r,
+                                    f32 &mu_s) noexcept {
+    f32 x_mu_s = GetUnitRangeFromTextureCoord(uv.x, IRRADIANCE_TEXTURE_WIDTH);
+    f32 x_r = GetUnitRangeFromTextureCoord(uv.y, IRRADIANCE_TEXTURE_HEIGHT);
+    r = atmosphere.bottom_radius + x_r * (atmosphere.top_radius - atmosphere.bottom_radius);
+    mu_s = ClampCosine(2.0f * x_mu_s - 1.0f);
+}
+
+Math::vec3 GetIrradiance(const AtmosphereParameters &atmosphere, const AtmosphereTexture &irradiance_texture, f32 r,
+                         f32 mu_s) noexcept {
+    return Math::vec3(irradiance_texture.Sample(GetIrradianceTextureUvFromRMuS(atmosphere, r, mu_s)));
+}
+
+Math::vec3 ComputeScatteringDensity(const AtmosphereParameters &atmosphere,
+                                    const AtmosphereTexture &transmittance_texture,
+                                    const AtmosphereTexture &single_rayleigh_scattering_texture,
+                                    const AtmosphereTexture &single_mie_scattering_texture,
+                                    const AtmosphereTexture &multiple_scattering_texture,
+                                    const AtmosphereTexture &irradiance_texture, f32 r, f32 mu, f32 mu_s, f32 nu,
+                                    i32 scattering_order) noexcept {
+    Math::vec3 zenith_direction(0.0f, 0.0f, 1.0f);
+    Math::vec3 omega(std::sqrt(1.0f - mu * mu), 0.0f, mu);
+    f32 sun_dir_x = omega.x == 0.0f ? 0.0f : (nu - mu * mu_s) / omega.x;
+    f32 sun_dir_y = std::sqrt(std::max(1.0f - sun_dir_x * sun_dir_x - mu_s * mu_s, 0.0f));
+    Math::vec3 omega_s(sun_dir_x, sun_dir_y, mu_s);
+
+    const i32 SAMPLE_COUNT = 16;
+    const f32 dphi = PI / static_cast<f32>(SAMPLE_COUNT);
+    const f32 dtheta = PI / static_cast<f32>(SAMPLE_COUNT);
+    Math::vec3 rayleigh_mie(0.0f);
+
+    // constant over the sphere of directions, hoisted out of the loops
+    f32 rayleigh_density = GetProfileDensity(atmosphere.rayleigh_density, r - atmosphere.bottom_radius);
+    f32 mie_density = GetProfileDensity(atmosphere.mie_density, r - atmosphere.bottom_radius);
+
+    for (i32 l = 0; l < SAMPLE_COUNT; ++l) {
+        f32 theta = (static_cast<f32>(l) + 0.5f) * dtheta;
+        f32 cos_theta = std::cos(theta);
+        f32 sin_theta = std::sin(theta);
+        bool ray_r_theta_intersects_ground = RayIntersectsGround(atmosphere, r, cos_theta);
+
+        f32 distance_to_ground = 0.0f;
+        Math::vec3 transmittance_to_ground(0.0f);
+        Math::vec3 ground_albedo(0.0f);
+        if (ray_r_theta_intersects_ground) {
+            distance_to_ground = DistanceToBottomAtmosphereBoundary(atmosphere, r, cos_theta);
+            transmittance_to_ground =
+                GetTransmittance(atmosphere, transmittance_texture, r, cos_theta, distance_to_ground, true);
+            ground_albedo = atmosphere.ground_albedo;
+        }
+
+        for (i32 m = 0; m < 2 * SAMPLE_COUNT; ++m) {
+            f32 phi = (static_cast<f32>(m) + 0.5f) * dphi;
+            Math::vec3 omega_i(std::cos(phi) * sin_theta, std::sin(phi) * sin_theta, cos_theta);
+            f32 domega_i = dtheta * dphi * sin_theta;
+
+            f32 nu1 = Math::dot(omega_s, omega_i);
+            Math::vec3 incident_radiance =
+                GetScattering(atmosphere, single_rayleigh_scattering_texture, single_mie_scattering_texture,
+                              multiple_scattering_texture, r, omega_i.z, mu_s, nu1, ray_r_theta_intersects_ground,
+                              scattering_order - 1);
+
+            Math::vec3 ground_normal = Math::normalize(zenith_direction * r + omega_i * distance_to_ground);
+            Math::vec3 ground_irradiance = GetIrradiance(atmosphere, irradiance_texture, atmosphere.bottom_radius,
+                                                         Math::dot(ground_normal, omega_s));
+            incident_radiance += transmittance_to_ground * ground_albedo * (1.0f / PI) * ground_irradiance;
+
+            f32 nu2 = Math::dot(omega, omega_i);
+            rayleigh_mie += incident_radiance *
+                            (atmosphere.rayleigh_scattering * rayleigh_density * RayleighPhaseFunction(nu2) +
+                             atmosphere.mie_scattering * mie_density * MiePhaseFunction(atmosphere.mie_g, nu2)) *
+                            domega_i;
+        }
+    }
+    return rayleigh_mie;
+}
+
+Math::vec3 ComputeMultipleScattering(const AtmosphereParameters &atmosphere,
+                                     const AtmosphereTexture &transmittance_texture,
+                                     const AtmosphereTexture &scattering_density_texture, f32 r, f32 mu, f32 mu_s,
+                                     f32 nu, bool ray_r_mu_intersects_ground) noexcept {
+    const i32 SAMPLE_COUNT = 50;
+    f32 dx = DistanceToNearestAtmosphereBoundary(atmosphere, r, mu, ray_r_mu_intersects_ground) /
+             static_cast<f32>(SAMPLE_COUNT);
+    Math::vec3 rayleigh_mie_sum(0.0f);
+    for (i32 i = 0; i <= SAMPLE_COUNT; ++i) {
+        f32 d_i = static_cast<f32>(i) * dx;
+        f32 r_i = ClampRadius(atmosphere, std::sqrt(d_i * d_i + 2.0f * r * mu * d_i + r * r));
+        f32 mu_i = ClampCosine((r * mu + d_i) / r_i);
+        f32 mu_s_i = ClampCosine((r * mu_s + d_i * nu) / r_i);
+        Math::vec3 rayleigh_mie_i =
+            GetScattering(atmosphere, scattering_density_texture, r_i, mu_i, mu_s_i, nu, ray_r_mu_intersects_ground) *
+            GetTransmittance(atmosphere, transmittance_texture, r, mu, d_i, ray_r_mu_intersects_ground) * dx;
+        f32 weight_i = (i == 0 || i == SAMPLE_COUNT) ? 0.5f : 1.0f;
+        rayleigh_mie_sum += rayleigh_mie_i * weight_i;
+    }
+    return rayleigh_mie_sum;
+}
+
+Math::vec3 ComputeDirectIrradiance(const AtmosphereParameters &atmosphere,
+                                   const AtmosphereTexture &transmittance_texture, f32 r, f32 mu_s) noexcept {
+    f32 alpha_s = atmosphere.sun_angular_radius;
+    f32 average_cosine_factor =
+        mu_s < -alpha_s ? 0.0f
+                        : (mu_s > alpha_s ? mu_s : (mu_s + alpha_s) * (mu_s + alpha_s) / (4.0f * alpha_s));
+    return atmosphere.solar_irradiance *
+           GetTransmittanceToTopAtmosphereBoundary(atmosphere, transmittance_texture, r, mu_s) *
+           average_cosine_factor;
+}
+
+Math::vec3 ComputeIndirectIrradiance(const AtmosphereParameters &atmosphere,
+                                     const AtmosphereTexture &single_rayleigh_scattering_texture,
+                                     const AtmosphereTexture &single_mie_scattering_texture,
+                                     const AtmosphereTexture &multiple_scattering_texture, f32 r, f32 mu_s,
+                                     i32 scattering_order) noexcept {
+    const i32 SAMPLE_COUNT = 32;
+    const f32 dphi = PI / static_cast<f32>(SAMPLE_COUNT);
+    const f32 dtheta = PI / static_cast<f32>(SAMPLE_COUNT);
+    Math::vec3 result(0.0f);
+    Math::vec3 omega_s(std::sqrt(1.0f - mu_s * mu_s), 0.0f, mu_s);
+    for (i32 j = 0; j < SAMPLE_COUNT / 2; ++j) {
+        f32 theta = (static_cast<f32>(j) + 0.5f) * dtheta;
+        for (i32 i = 0; i < 2 * SAMPLE_COUNT; ++i) {
+            f32 phi = (static_cast<f32>(i) + 0.5f) * dphi;
+            Math::vec3 omega(std::cos(phi) * std::sin(theta), std::sin(phi) * std::sin(theta), std::cos(theta));
+            f32 domega = dtheta * dphi * std::sin(theta);
+            f32 nu = Math::dot(omega, omega_s);
+            result += GetScattering(atmosphere, single_rayleigh_scattering_texture, single_mie_scattering_texture,
+                                    multiple_scattering_texture, r, omega.z, mu_s, nu, false, scattering_order) *
+                      omega.z * domega;
+        }
+    }
+    return result;
+}
+
+} // namespace
+
+AtmosphereReference::AtmosphereReference(const AtmosphereParameters &atmosphere, u32 multi_scattering_order) noexcept
+    : m_atmosphere(atmosphere), m_multi_scattering_order(multi_scattering_order) {}
+
+template <typename F>
+void AtmosphereReference::RunPass(const std::string &name, AtmosphereTexture &target, F &&texel) noexcept {
+    auto begin = std::chrono::steady_clock::now();
+    u32 width = target.width, height = target.height;
+    // one row per item, the cost per texel varies a lot between rows that hit the ground and rows that do not
+    ThreadPool::GetInstance().ParallelFor(static_cast<u64>(height) * target.depth, 1, [&](u64 row_begin, u64 row_end) {
+        for (u64 row = row_begin; row < row_end; row++) {
+            u32 y = static_cast<u32>(row % height), z = static_cast<u32>(row / height);
+            for (u32 x = 0; x < width; x++) {
+                texel(x, y, z);
+            }
+        }
+    });
+    f64 elapsed = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    m_timings.push_back({name, elapsed});
+}
+
+void AtmosphereReference::Precompute(AtmosphereLuts &luts) noexcept {
+    const AtmosphereParameters &atmosphere = m_atmosphere;
+    m_timings.clear();
+    luts.Allocate();
+    m_delta_irradiance.Resize(IRRADIANCE_TEXTURE_WIDTH, IRRADIANCE_TEXTURE_HEIGHT);
+    m_delta_rayleigh.Resize(SCATTERING_TEXTURE_WIDTH, SCATTERING_TEXTURE_HEIGHT, SCATTERING_TEXTURE_DEPTH);
+    m_delta_mie.Resize(SCATTERING_TEXTURE_WIDTH, SCATTERING_TEXTURE_HEIGHT, SCATTERING_TEXTURE_DEPTH);
+    m_scattering_density.Resize(SCATTERING_TEXTURE_WIDTH, SCATTERING_TEXTURE_HEIGHT, SCATTERING_TEXTURE_DEPTH);
+
+    AtmosphereTexture &transmittance = luts.transmittance;
+    AtmosphereTexture &irradiance = luts.irradiance;
+    AtmosphereTexture &scattering = luts.scattering;
+    AtmosphereTexture &delta_multiple_scattering = m_delta_rayleigh;
+
+    // transmittance_lut.comp
+    RunPass("transmittance", transmittance, [&](u32 x, u32 y, u32) {
+        Math::vec2 frag_coord(x + 0.5f, y + 0.5f);
+        f32 r, mu;
+        GetRMuFromTransmittanceTextureUv(
+            atmosphere, frag_coord / Math::vec2(TRANSMITTANCE_TEXTURE_WIDTH, TRANSMITTANCE_TEXTURE_HEIGHT), r, mu);
+        transmittance.At(x, y) = Math::vec4(ComputeTransmittanceToTopAtmosphereBoundary(atmosphere, r, mu), 1.0f);
+    });
+
+    // direct_irradiance_lut.comp, the irradiance lut starts out empty
+    RunPass("direct irradiance", m_delta_irradiance, [&](u32 x, u32 y, u32) {
+        Math::vec2 frag_coord(x + 0.5f, y + 0.5f);
+        f32 r, mu_s;
+        GetRMuSFromIrradianceTextureUv(
+            atmosphere, frag_coord / Math::vec2(IRRADIANCE_TEXTURE_WIDTH, IRRADIANCE_TEXTURE_HEIGHT), r, mu_s);
+        m_delta_irradiance.At(x, y) =
+            Math::vec4(ComputeDirectIrradiance(atmosphere, transmittance, r, mu_s), 0.0f);
+        irradiance.At(x, y) = Math::vec4(0.0f);
+    });
+
+    // single_scattering_lut.comp
+    RunPass("single scattering", scattering, [&](u32 x, u32 y, u32 z) {
+        Math::vec3 frag_coord(x + 0.5f, y + 0.5f, z + 0.5f);
+        f32 r, mu, mu_s, nu;
+        bool ray_r_mu_intersects_ground;
+        GetRMuMuSNuFromScatteringTextureFragCoord(atmosphere, frag_coord, r, mu, mu_s, nu,
+                                                  ray_r_mu_intersects_ground);
+        Math::vec3 rayleigh, mie;
+        ComputeSingleScattering(atmosphere, transmittance, r, mu, mu_s, nu, ray_r_mu_intersects_ground, rayleigh,
+                                mie);
+        m_delta_rayleigh.At(x, y, z) = Math::vec4(rayleigh, 0.0f);
+        m_delta_mie.At(x, y, z) = Math::vec4(mie, 0.0f);
+        scattering.At(x, y, z) = Math::vec4(rayleigh, mie.r);
+    });
+
+    for (u32 j = 0; j < m_multi_scattering_order; j++) {
+        i32 scattering_order = static_cast<i32>(j) + 2;
+        std::string order = std::to_string(scattering_order);
+
+        // scattering_density.comp
+        RunPass("scattering density " + order, m_scattering_density, [&](u32 x, u32 y, u32 z) {
+            Math::vec3 frag_coord(x + 0.5f, y + 0.5f, z + 0.5f);
+            f32 r, mu, mu_s, nu;
+            bool ray_r_mu_intersects_ground;
+            GetRMuMuSNuFromScatteringTextureFragCoord(atmosphere, frag_coord, r, mu, mu_s, nu,
+                                                      ray_r_mu_intersects_ground);
+            Math::vec3 density =
+                ComputeScatteringDensity(atmosphere, transmittance, m_delta_rayleigh, m_delta_mie,
+                                         delta_multiple_scattering, m_delta_irradiance, r, mu, mu_s, nu,
+                                         scattering_order);
+            m_scattering_density.At(x, y, z) = Math::vec4(density, 0.0f);
+        });
+
+        // indirect_irradiance_lut.comp, one order behind the density
+        RunPass("indirect irradiance " + order, irradiance, [&](u32 x, u32 y, u32) {
+            Math::vec2 frag_coord(x + 0.5f, y + 0.5f);
+            f32 r, mu_s;
+            GetRMuSFromIrradianceTextureUv(
+                atmosphere, frag_coord / Math::vec2(IRRADIANCE_TEXTURE_WIDTH, IRRADIANCE_TEXTURE_HEIGHT), r, mu_s);
+            Math::vec3 result = ComputeIndirectIrradiance(atmosphere, m_delta_rayleigh, m_delta_mie,
+                                                          delta_multiple_scattering, r, mu_s, scattering_order - 1);
+            m_delta_irradiance.At(x, y) = Math::vec4(result, 0.0f);
+            irradiance.At(x, y) += Math::vec4(result, 0.0f);
+        });
+
+        // multi_scattering_lut.comp, the delta multiple scattering it writes replaces the single rayleigh scattering
+        RunPass("multiple scattering " + order, scattering, [&](u32 x, u32 y, u32 z) {
+            Math::vec3 frag_coord(x + 0.5f, y + 0.5f, z + 0.5f);
+            f32 r, mu, mu_s, nu;
+            bool ray_r_mu_intersects_ground;
+            GetRMuMuSNuFromScatteringTextureFragCoord(atmosphere, frag_coord, r, mu, mu_s, nu,
+                                                      ray_r_mu_intersects_ground);
+            Math::vec3 ms = ComputeMultipleScattering(atmosphere, transmittance, m_scattering_density, r, mu, mu_s,
+                                                      nu, ray_r_mu_intersects_ground);
+            delta_multiple_scattering.At(x, y, z) = Math::vec4(ms, 0.0f);
+            scattering.At(x, y, z) += Math::vec4(ms / RayleighPhaseFunction(nu), 0.0f);
+        });
+    }
+}
+
+} // namespace Horizon
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <runtime/scene/render/AtmosphereLuts.h>
+#include <runtime/scene/render/AtmosphereParameters.h>
+
+namespace Horizon {
+
+// cpu port of the atmosphere precompute shaders, for validating and baking the luts without a gpu. runs the same
+// passes in the same order as Renderer::DrawFrame, including the delta multiple scattering texture aliasing the delta
+// rayleigh one, and leaves the luts the sky pass samples. texels are spread over the thread pool, lut lookups filter
+// all four channels at once.
+class AtmosphereReference {
+  public:
+    struct PassTiming {
+        std::string name;
+        f64 ms;
+    };
+
+    AtmosphereReference(const AtmosphereParameters &atmosphere, u32 multi_scattering_order = 3) noexcept;
+    ~AtmosphereReference() noexcept = default;
+
+    void Precompute(AtmosphereLuts &luts) noexcept;
+
+    // wall time of every pass of the last Precompute, in dispatch order
+    const std::vector<PassTiming> &GetTimings() const noexcept { return m_timings; }
+
+  private:
+    template <typename F> void RunPass(const std::string &name, AtmosphereTexture &target, F &&texel) noexcept;
+
+  private:
+    AtmosphereParameters m_atmosphere;
+    u32 m_multi_scattering_order;
+
+    AtmosphereTexture m_delta_irradiance;
+    // also the delta multiple scattering texture from the second order on
+    AtmosphereTexture m_delta_rayleigh;
+    AtmosphereTexture m_delta_mie;
+    AtmosphereTexture m_scattering_density;
+
+    std::vector<PassTiming> m_timings;
+};
+
+} // namespace Horizon
@@ -9,8 +9,14 @@ Geometry::Geometry(const std::shared_ptr<Scene> &_scene, const std::shared_ptr<P
 
     GraphicsPipelineCreateInfo geometryPipelineCreateInfo;
     geometryPipelineCreateInfo.name = "geometry";
-    geometryPipelineCreateInfo.vs = std::make_shared<Shader>(_device->Get(), Path::GetShaderPath("geometry.vert.spv"));
-    geometryPipelineCreateInfo.ps = std::make_shared<Shader>(_device->Get(), Path::GetShaderPath("geometry.frag.spv"));
+    // the bindless shaders read materials from the scene's material table, the indirect vertex shader also reads
+    // its transform and material from the culled instance
+    std::string shader_name = _scene->IsBindless() ? "geometry_bindless" : "geometry";
+    std::string vs_name = _scene->IsGpuDriven() ? "geometry_indirect" : shader_name;
+    geometryPipelineCreateInfo.vs =
+        std::make_shared<Shader>(_device->Get(), Path::GetShaderPath(vs_name + ".vert.spv"));
+    geometryPipelineCreateInfo.ps =
+        std::make_shared<Shader>(_device->Get(), Path::GetShaderPath(shader_name + ".frag.spv"));
     geometryPipelineCreateInfo.descriptor_layouts = _scene->GetGeometryPassDescriptorLayouts();
 
     std::shared_ptr<PushConstants> geometryPipelinePushConstants = std::make_shared<PushConstants>();
@@ -18,20 +24,20 @@ Geometry::Geometry(const std::shared_ptr<Scene> &_scene, const std::shared_ptr<P
     geometryPipelinePushConstants->ranges = {
         {SHADER_STAGE_VERTEX_SHADER, 0, 2 * sizeof(Math::mat4)}}; // Push constants have a minimum size of 128 bytes
     geometryPipelineCreateInfo.push_constants = geometryPipelinePushConstants;
-    // position + depth
-    // normal
-    // albedo
+    // packed g-buffer, see gbuffer.glsl. world position is reconstructed from depth in the light pass
+    // octahedral normal + roughness
+    // albedo + metallic
     // depth
 
     std::vector<AttachmentCreateInfo> geometryAttachmentsCreateInfo{
-        AttachmentCreateInfo{TextureFormat::TEXTURE_FORMAT_RGBA32_SFLOAT, COLOR_ATTACHMENT,
-                             TextureType::TEXTURE_TYPE_2D, _render_context.width, _render_context.height, 1},
-        AttachmentCreateInfo{TextureFormat::TEXTURE_FORMAT_RGBA32_SFLOAT, COLOR_ATTACHMENT,
-                             TextureType::TEXTURE_TYPE_2D, _render_context.width, _render_context.height, 1},
-        AttachmentCreateInfo{TextureFormat::TEXTURE_FORMAT_RGBA32_SFLOAT, COLOR_ATTACHMENT,
-                             TextureType::TEXTURE_TYPE_2D, _render_context.width, _render_context.height, 1},
+        AttachmentCreateInfo{TextureFormat::TEXTURE_FORMAT_RGB10A2_UNORM, COLOR_ATTACHMENT,
+                             TextureType::TEXTURE_TYPE_2D, _render_context.width, _render_context.height, 1,
+                             "gbuffer0"},
+        AttachmentCreateInfo{TextureFormat::TEXTURE_FORMAT_RGBA8_UNORM, COLOR_ATTACHMENT,
+                             TextureType::TEXTURE_TYPE_2D, _render_context.width, _render_context.height, 1,
+                             "gbuffer1"},
         AttachmentCreateInfo{TextureFormat::TEXTURE_FORMAT_D32_SFLOAT, DEPTH_STENCIL_ATTACHMENT,
-                             TextureType::TEXTURE_TYPE_2D, _render_context.width, _render_context.height, 1}};
+                             TextureType::TEXTURE_TYPE_2D, _render_context.width, _render_context.height, 1, "depth"}};
 
     m_pipeline = _pipeline_manager->CreateGraphicsPipeline(geometryPipelineCreateInfo, geometryAttachmentsCreateInfo,
                                                            _render_context);
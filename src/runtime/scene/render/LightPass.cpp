@@ -16,7 +16,7 @@ LightPass::LightPass(std::shared_ptr<Scene> _scene, std::shared_ptr<PipelineMana
 
     std::vector<AttachmentCreateInfo> LightPassAttachmentsCreateInfo{
         AttachmentCreateInfo{TextureFormat::TEXTURE_FORMAT_RGBA16_SFLOAT, COLOR_ATTACHMENT,
-                             TextureType::TEXTURE_TYPE_2D, _render_context.width, _render_context.height, 1}};
+                             TextureType::TEXTURE_TYPE_2D, _render_context.width, _render_context.height, 1, "lit"}};
 
     m_pipeline = _pipeline_manager->CreateGraphicsPipeline(LightPassPipelineCreateInfo, LightPassAttachmentsCreateInfo,
                                                            _render_context);
@@ -26,12 +26,17 @@ LightPass::~LightPass() noexcept {}
 
 void LightPass::CreateResources() noexcept {
     std::shared_ptr<DescriptorSetInfo> descriptor_set_create_info = std::make_shared<DescriptorSetInfo>();
+    // cluster grid, lights, camera
     descriptor_set_create_info->AddBinding(DescriptorType::DESCRIPTOR_TYPE_UNIFORM_BUFFER, SHADER_STAGE_PIXEL_SHADER);
+    descriptor_set_create_info->AddBinding(DescriptorType::DESCRIPTOR_TYPE_RW_BUFFER, SHADER_STAGE_PIXEL_SHADER);
     descriptor_set_create_info->AddBinding(DescriptorType::DESCRIPTOR_TYPE_UNIFORM_BUFFER, SHADER_STAGE_PIXEL_SHADER);
-    descriptor_set_create_info->AddBinding(DescriptorType::DESCRIPTOR_TYPE_UNIFORM_BUFFER, SHADER_STAGE_PIXEL_SHADER);
+    // gbuffer
     descriptor_set_create_info->AddBinding(DescriptorType::DESCRIPTOR_TYPE_TEXTURE, SHADER_STAGE_PIXEL_SHADER);
     descriptor_set_create_info->AddBinding(DescriptorType::DESCRIPTOR_TYPE_TEXTURE, SHADER_STAGE_PIXEL_SHADER);
     descriptor_set_create_info->AddBinding(DescriptorType::DESCRIPTOR_TYPE_TEXTURE, SHADER_STAGE_PIXEL_SHADER);
+    // light counts and indices of the clusters
+    descriptor_set_create_info->AddBinding(DescriptorType::DESCRIPTOR_TYPE_RW_BUFFER, SHADER_STAGE_PIXEL_SHADER);
+    descriptor_set_create_info->AddBinding(DescriptorType::DESCRIPTOR_TYPE_RW_BUFFER, SHADER_STAGE_PIXEL_SHADER);
 
     m_descriptorset = std::make_shared<DescriptorSet>(m_device, descriptor_set_create_info);
 
@@ -34,7 +34,7 @@ PostProcess::PostProcess(std::shared_ptr<PipelineManager> _pipeline_manager, std
 
     std::vector<AttachmentCreateInfo> pp_attachment_create_info{
         {TextureFormat::TEXTURE_FORMAT_RGBA16_UNORM, COLOR_ATTACHMENT, TextureType::TEXTURE_TYPE_2D,
-         _render_context.width, _render_context.height},
+         _render_context.width, _render_context.height, 1, "post_process"},
     };
     m_pipeline =
         _pipeline_manager->CreateGraphicsPipeline(pp_ipeline_create_info, pp_attachment_create_info, _render_context);
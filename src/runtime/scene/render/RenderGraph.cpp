@@ -0,0 +1,360 @@
+#include "RenderGraph.h"
+
+#include <algorithm>
+#include <sstream>
+
+#include <runtime/core/log/Log.h>
+#include <runtime/function/rhi/vulkan/ResourceBarrier.h>
+
+namespace Horizon {
+
+namespace {
+
+struct AccessInfo {
+    u32 stage;
+    u32 access;
+    bool write;
+    const char *name;
+};
+
+AccessInfo GetAccessInfo(RenderGraphAccess access) noexcept {
+    switch (access) {
+    case RenderGraphAccess::COLOR_ATTACHMENT:
+        return {PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, ACCESS_COLOR_ATTACHMENT_WRITE_BIT, true, "color"};
+    case RenderGraphAccess::DEPTH_ATTACHMENT:
+        return {PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, true, "depth"};
+    case RenderGraphAccess::FRAGMENT_READ:
+        return {PIPELINE_STAGE_FRAGMENT_SHADER_BIT, ACCESS_SHADER_READ_BIT, false, "fragment"};
+    case RenderGraphAccess::COMPUTE_READ:
+        return {PIPELINE_STAGE_COMPUTE_SHADER_BIT, ACCESS_SHADER_READ_BIT, false, "compute"};
+    case RenderGraphAccess::COMPUTE_WRITE:
+        return {PIPELINE_STAGE_COMPUTE_SHADER_BIT, ACCESS_SHADER_WRITE_BIT, true, "compute"};
+    default:
+        return {0, 0, false, "unknown"};
+    }
+}
+
+std::string StageNames(u32 stages) noexcept {
+    static const std::pair<u32, const char *> names[] = {
+        {PIPELINE_STAGE_COMPUTE_SHADER_BIT, "compute"},
+        {PIPELINE_STAGE_FRAGMENT_SHADER_BIT, "fragment"},
+        {PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT, "early_fragment_tests"},
+        {PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, "late_fragment_tests"},
+        {PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, "color_output"},
+    };
+    std::string result;
+    for (auto &[stage, name] : names) {
+        if (stages & stage) {
+            result += result.empty() ? name : std::string("|") + name;
+        }
+    }
+    return result;
+}
+
+} // namespace
+
+RenderGraph::Pass &RenderGraph::Pass::Read(const std::string &resource, RenderGraphAccess access) noexcept {
+    reads.push_back({graph->GetResource(resource), access});
+    return *this;
+}
+
+RenderGraph::Pass &RenderGraph::Pass::Write(const std::string &resource, RenderGraphAccess access) noexcept {
+    writes.push_back({graph->GetResource(resource), access});
+    return *this;
+}
+
+RenderGraph::Pass &RenderGraph::Pass::SetSideEffect() noexcept {
+    side_effect = true;
+    return *this;
+}
+
+RenderGraph::Pass &RenderGraph::Pass::SetSecondaryCommandBuffers() noexcept {
+    secondary_command_buffers = true;
+    return *this;
+}
+
+RenderGraph::RenderGraph(std::shared_ptr<CommandBuffer> command_buffer) noexcept : m_command_buffer(command_buffer) {}
+
+void RenderGraph::Reset() noexcept {
+    m_passes.clear();
+    m_live.clear();
+    m_schedule.clear();
+    m_barriers.clear();
+    m_barrier_count = 0;
+    m_hash = 0;
+}
+
+RenderGraph::Pass &RenderGraph::AddPass(const std::string &name, RenderGraphPassType type,
+                                        ExecuteFunc execute) noexcept {
+    Pass &pass = m_passes.emplace_back();
+    pass.graph = this;
+    pass.name = name;
+    pass.type = type;
+    pass.execute = std::move(execute);
+    return pass;
+}
+
+u32 RenderGraph::GetResource(const std::string &name) noexcept {
+    auto it = m_resources.find(name);
+    if (it != m_resources.end()) {
+        return it->second;
+    }
+    u32 resource = static_cast<u32>(m_resource_names.size());
+    m_resource_names.push_back(name);
+    m_resources.emplace(name, resource);
+    m_aliases.push_back(resource);
+    return resource;
+}
+
+void RenderGraph::SetAlias(const std::string &resource, const std::string &alias) noexcept {
+    u32 target = GetResource(alias);
+    m_aliases[GetResource(resource)] = target;
+}
+
+bool RenderGraph::GetLifetime(const std::string &resource, u32 &first_use, u32 &last_use) const noexcept {
+    auto it = m_resources.find(resource);
+    if (it == m_resources.end()) {
+        return false;
+    }
+    bool used = false;
+    for (u32 s = 0; s < m_schedule.size(); s++) {
+        const Pass &pass = m_passes[m_schedule[s]];
+        auto touches = [&it](const ResourceAccess &access) { return access.resource == it->second; };
+        if (std::any_of(pass.reads.begin(), pass.reads.end(), touches) ||
+            std::any_of(pass.writes.begin(), pass.writes.end(), touches)) {
+            first_use = used ? first_use : s;
+            last_use = s;
+            used = true;
+        }
+    }
+    return used;
+}
+
+void RenderGraph::Compile() noexcept {
+    CullPasses();
+    SchedulePasses();
+    ComputeBarriers();
+    ComputeHash();
+}
+
+void RenderGraph::CullPasses() noexcept {
+    // walking backwards, a pass is live if it has side effects or writes something a live pass reads later
+    m_live.assign(m_passes.size(), false);
+    std::vector<bool> needed(m_resource_names.size(), false);
+    for (u32 p = static_cast<u32>(m_passes.size()); p-- > 0;) {
+        const Pass &pass = m_passes[p];
+        bool live = pass.side_effect;
+        for (const ResourceAccess &write : pass.writes) {
+            live = live || needed[write.resource];
+        }
+        if (!live) {
+            continue;
+        }
+        m_live[p] = true;
+        for (const ResourceAccess &read : pass.reads) {
+            needed[read.resource] = true;
+        }
+    }
+}
+
+void RenderGraph::SchedulePasses() noexcept {
+    // declaration order defines which write a read sees, the edges keep those pairs and write after read in order
+    u32 pass_count = static_cast<u32>(m_passes.size());
+    std::vector<std::vector<u32>> successors(pass_count);
+    std::vector<u32> in_degree(pass_count, 0);
+    auto add_edge = [&](u32 from, u32 to) {
+        if (from != to && std::find(successors[from].begin(), successors[from].end(), to) == successors[from].end()) {
+            successors[from].push_back(to);
+            in_degree[to]++;
+        }
+    };
+
+    std::vector<i32> last_writer(m_resource_names.size(), -1);
+    std::vector<std::vector<u32>> readers(m_resource_names.size());
+    for (u32 p = 0; p < pass_count; p++) {
+        if (!m_live[p]) {
+            continue;
+        }
+        for (const ResourceAccess &read : m_passes[p].reads) {
+            if (last_writer[read.resource] >= 0) {
+                add_edge(static_cast<u32>(last_writer[read.resource]), p);
+            }
+            readers[read.resource].push_back(p);
+        }
+        for (const ResourceAccess &write : m_passes[p].writes) {
+            if (last_writer[write.resource] >= 0) {
+                add_edge(static_cast<u32>(last_writer[write.resource]), p);
+            }
+            for (u32 reader : readers[write.resource]) {
+                add_edge(reader, p);
+            }
+            readers[write.resource].clear();
+            last_writer[write.resource] = static_cast<i32>(p);
+        }
+    }
+
+    // among the passes that are ready, compute goes first so its results are produced long before the graphics
+    // passes that consume them, otherwise declaration order
+    std::vector<u32> ready;
+    for (u32 p = 0; p < pass_count; p++) {
+        if (m_live[p] && in_degree[p] == 0) {
+            ready.push_back(p);
+        }
+    }
+    m_schedule.clear();
+    while (!ready.empty()) {
+        auto next = std::min_element(ready.begin(), ready.end(), [this](u32 a, u32 b) {
+            bool a_compute = m_passes[a].type == RenderGraphPassType::COMPUTE;
+            bool b_compute = m_passes[b].type == RenderGraphPassType::COMPUTE;
+            return a_compute != b_compute ? a_compute : a < b;
+        });
+        u32 p = *next;
+        ready.erase(next);
+        m_schedule.push_back(p);
+        for (u32 successor : successors[p]) {
+            if (--in_degree[successor] == 0) {
+                ready.push_back(successor);
+            }
+        }
+    }
+}
+
+void RenderGraph::ComputeBarriers() noexcept {
+    // every hazard in front of a pass goes into one barrier, stages and access masks merged. aliased resources
+    // share one state, so reusing memory waits for the previous owner like a write after write or read
+    std::vector<ResourceState> states(m_resource_names.size());
+    m_barriers.assign(m_schedule.size(), Barrier{});
+    m_barrier_count = 0;
+    for (u32 s = 0; s < m_schedule.size(); s++) {
+        const Pass &pass = m_passes[m_schedule[s]];
+        Barrier &barrier = m_barriers[s];
+
+        for (const ResourceAccess &read : pass.reads) {
+            AccessInfo info = GetAccessInfo(read.access);
+            ResourceState &state = states[m_aliases[read.resource]];
+            // read after write, unless the write is already visible to this stage
+            if (state.write_stage && (state.visible_stages & info.stage) != info.stage) {
+                barrier.src_stage |= state.write_stage;
+                barrier.src_access |= state.write_access;
+                barrier.dst_stage |= info.stage;
+                barrier.dst_access |= info.access;
+            }
+        }
+        for (const ResourceAccess &write : pass.writes) {
+            AccessInfo info = GetAccessInfo(write.access);
+            const ResourceState &state = states[m_aliases[write.resource]];
+            // write after write needs the memory dependency, write after read only the execution dependency
+            if (state.write_stage) {
+                barrier.src_stage |= state.write_stage;
+                barrier.src_access |= state.write_access;
+                barrier.dst_stage |= info.stage;
+                barrier.dst_access |= info.access;
+            }
+            if (state.read_stages) {
+                barrier.src_stage |= state.read_stages;
+                barrier.dst_stage |= info.stage;
+            }
+        }
+
+        for (const ResourceAccess &read : pass.reads) {
+            AccessInfo info = GetAccessInfo(read.access);
+            ResourceState &state = states[m_aliases[read.resource]];
+            state.read_stages |= info.stage;
+            state.visible_stages |= info.stage;
+        }
+        for (const ResourceAccess &write : pass.writes) {
+            AccessInfo info = GetAccessInfo(write.access);
+            ResourceState &state = states[m_aliases[write.resource]];
+            state.write_stage = info.stage;
+            state.write_access = info.access;
+            state.read_stages = 0;
+            // the render pass's external dependency makes color writes visible to later fragment shaders
+            state.visible_stages =
+                write.access == RenderGraphAccess::COLOR_ATTACHMENT ? PIPELINE_STAGE_FRAGMENT_SHADER_BIT : 0;
+        }
+
+        if (barrier.src_stage) {
+            m_barrier_count++;
+        }
+    }
+}
+
+void RenderGraph::ComputeHash() noexcept {
+    // fnv-1a over what Dump prints, resource indices never change meaning once registered
+    u64 hash = 14695981039346656037ull;
+    auto add = [&hash](u64 word) { hash = (hash ^ word) * 1099511628211ull; };
+    add(m_passes.size());
+    for (u32 s = 0; s < m_schedule.size(); s++) {
+        const Pass &pass = m_passes[m_schedule[s]];
+        add(m_schedule[s]);
+        add(std::hash<std::string>{}(pass.name));
+        add(static_cast<u64>(pass.type));
+        for (const auto *list : {&pass.reads, &pass.writes}) {
+            add(list->size());
+            for (const ResourceAccess &access : *list) {
+                add((static_cast<u64>(access.resource) << 32) | static_cast<u64>(access.access));
+            }
+        }
+        const Barrier &barrier = m_barriers[s];
+        add((static_cast<u64>(barrier.src_stage) << 32) | barrier.dst_stage);
+    }
+    m_hash = hash;
+}
+
+void RenderGraph::Execute(u32 frame) noexcept {
+    std::shared_ptr<GpuProfiler> profiler = m_command_buffer->GetGpuProfiler();
+    for (u32 s = 0; s < m_schedule.size(); s++) {
+        const Barrier &barrier = m_barriers[s];
+        if (barrier.src_stage) {
+            BarrierDesc desc;
+            desc.src_stage = barrier.src_stage;
+            desc.dst_stage = barrier.dst_stage;
+            desc.memory_barriers.push_back({static_cast<MemoryAccessFlags>(barrier.src_access),
+                                            static_cast<MemoryAccessFlags>(barrier.dst_access)});
+            InsertBarrier(frame, m_command_buffer, desc);
+        }
+        // every pass is a profiler scope, its render passes and dispatches begin and end inside it
+        const Pass &pass = m_passes[m_schedule[s]];
+        if (profiler) {
+            profiler->BeginScope(frame, m_command_buffer->Get(frame), pass.name, pass.secondary_command_buffers);
+        }
+        pass.execute(frame);
+        if (profiler) {
+            profiler->EndScope(frame, m_command_buffer->Get(frame));
+        }
+    }
+}
+
+std::string RenderGraph::Dump() const noexcept {
+    std::ostringstream out;
+    out << "render graph: " << m_schedule.size() << " passes, " << m_passes.size() - m_schedule.size()
+        << " culled, " << m_barrier_count << " barriers per frame\n";
+    auto accesses = [this](const std::vector<ResourceAccess> &list) {
+        std::string result;
+        for (const ResourceAccess &access : list) {
+            result += (result.empty() ? "" : ", ") + m_resource_names[access.resource] + " (" +
+                      GetAccessInfo(access.access).name + ")";
+        }
+        return result.empty() ? std::string("-") : result;
+    };
+    for (u32 s = 0; s < m_schedule.size(); s++) {
+        const Pass &pass = m_passes[m_schedule[s]];
+        const Barrier &barrier = m_barriers[s];
+        if (barrier.src_stage) {
+            out << "      barrier " << StageNames(barrier.src_stage) << " -> " << StageNames(barrier.dst_stage)
+                << "\n";
+        }
+        out << "  " << s << ". " << pass.name << " ["
+            << (pass.type == RenderGraphPassType::COMPUTE ? "compute" : "graphics") << "]"
+            << " reads " << accesses(pass.reads) << "; writes " << accesses(pass.writes) << "\n";
+    }
+    for (u32 p = 0; p < m_passes.size(); p++) {
+        if (!m_live[p]) {
+            out << "  culled " << m_passes[p].name << "\n";
+        }
+    }
+    return out.str();
+}
+
+} // namespace Horizon
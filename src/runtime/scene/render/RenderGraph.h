@@ -0,0 +1,123 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <runtime/core/math/Math.h>
+#include <runtime/function/rhi/vulkan/CommandBuffer.h>
+
+namespace Horizon {
+
+enum class RenderGraphPassType { GRAPHICS, COMPUTE };
+
+// how a pass touches a resource, each maps to the pipeline stages and access flags it synchronizes on
+enum class RenderGraphAccess {
+    COLOR_ATTACHMENT, // written by the pass's render pass
+    DEPTH_ATTACHMENT, // written by the pass's render pass
+    FRAGMENT_READ,    // sampled in a fragment shader
+    COMPUTE_READ,
+    COMPUTE_WRITE,
+};
+
+// per frame graph of passes and the resources they read and write. passes are declared every frame, Compile culls
+// the ones nothing live consumes, orders the rest and works out one batched memory barrier in front of each pass
+// that has a hazard on a resource. layout transitions stay with the render passes, their external subpass
+// dependencies already make color attachment writes visible to fragment shaders, so those need no barrier.
+class RenderGraph {
+  public:
+    using ExecuteFunc = std::function<void(u32 frame)>;
+
+    struct ResourceAccess {
+        u32 resource;
+        RenderGraphAccess access;
+    };
+
+    struct Pass {
+        Pass &Read(const std::string &resource, RenderGraphAccess access) noexcept;
+        Pass &Write(const std::string &resource, RenderGraphAccess access) noexcept;
+        // kept even when nothing reads its outputs, e.g. present or work with state across frames
+        Pass &SetSideEffect() noexcept;
+        // executes secondary command buffers, keeps the profiler's statistics query off without inheritedQueries
+        Pass &SetSecondaryCommandBuffers() noexcept;
+
+        RenderGraph *graph = nullptr;
+        std::string name;
+        RenderGraphPassType type;
+        ExecuteFunc execute;
+        std::vector<ResourceAccess> reads, writes;
+        bool side_effect = false;
+        bool secondary_command_buffers = false;
+    };
+
+    RenderGraph(std::shared_ptr<CommandBuffer> command_buffer) noexcept;
+    ~RenderGraph() noexcept = default;
+    RenderGraph(const RenderGraph &) = delete;
+    RenderGraph(RenderGraph &&) = delete;
+    RenderGraph &operator=(const RenderGraph &) = delete;
+    RenderGraph &operator=(RenderGraph &&) = delete;
+
+    // drops the passes of the previous frame, resource names stay registered
+    void Reset() noexcept;
+
+    // the returned pass is only valid until the next AddPass
+    Pass &AddPass(const std::string &name, RenderGraphPassType type, ExecuteFunc execute) noexcept;
+
+    void Compile() noexcept;
+
+    // resources with the same alias share memory and synchronize as one, the alias itself is never accessed
+    void SetAlias(const std::string &resource, const std::string &alias) noexcept;
+
+    // first and last scheduled pass touching the resource, false if no live pass does
+    bool GetLifetime(const std::string &resource, u32 &first_use, u32 &last_use) const noexcept;
+
+    // records the scheduled passes and their barriers into the frame's command buffer
+    void Execute(u32 frame) noexcept;
+
+    // the compiled schedule, culled passes and barriers in text form
+    std::string Dump() const noexcept;
+
+    // vkCmdPipelineBarrier calls the compiled graph issues per frame
+    u32 GetBarrierCount() const noexcept { return m_barrier_count; }
+
+    // hash of the compiled schedule, the accesses of the scheduled passes and their barriers. cheap to compare every
+    // frame, equal hashes mean an equal Dump
+    u64 GetHash() const noexcept { return m_hash; }
+
+  private:
+    struct Barrier {
+        u32 src_stage = 0, dst_stage = 0;
+        u32 src_access = 0, dst_access = 0;
+    };
+
+    // synchronization state of a resource while the schedule is walked
+    struct ResourceState {
+        u32 write_stage = 0, write_access = 0;
+        // stages that read since the last write, and stages the last write is already visible to
+        u32 read_stages = 0, visible_stages = 0;
+    };
+
+    u32 GetResource(const std::string &name) noexcept;
+    void CullPasses() noexcept;
+    void SchedulePasses() noexcept;
+    void ComputeBarriers() noexcept;
+    void ComputeHash() noexcept;
+
+  private:
+    std::shared_ptr<CommandBuffer> m_command_buffer;
+    std::vector<Pass> m_passes;
+    std::vector<std::string> m_resource_names;
+    std::unordered_map<std::string, u32> m_resources;
+    std::vector<u32> m_aliases; // resource whose synchronization state each resource uses, itself by default
+
+    // compiled
+    std::vector<bool> m_live;
+    std::vector<u32> m_schedule;
+    std::vector<Barrier> m_barriers; // per scheduled pass
+    u32 m_barrier_count = 0;
+    u64 m_hash = 0;
+};
+
+} // namespace Horizon
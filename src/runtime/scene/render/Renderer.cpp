@@ -1,22 +1,36 @@
 #include "Renderer.h"
 
+#include <chrono>
 #include <config.hpp>
 #include <filesystem>
 #include <iostream>
 
+#include <runtime/core/log/Log.h>
 #include <runtime/core/math/Math.h>
 #include <runtime/core/path/Path.h>
-#include <runtime/function/rhi/vulkan/ResourceBarrier.h>
+#include <runtime/core/profile/Profiler.h>
+#include <runtime/function/rhi/vulkan/VulkanBuffer.h>
 #include <runtime/function/rhi/vulkan/VulkanEnums.h>
+#include <stb_image_write.h>
 
 namespace Horizon {
 
+namespace {
+
+// render graph resource of one of the atmosphere's two lut sets
+std::string LutSetResource(u32 set) noexcept { return "atmosphere_luts" + std::to_string(set); }
+
+} // namespace
+
 class Window;
 
-Renderer::Renderer(u32 width, u32 height, std::shared_ptr<Window> window) noexcept : m_window(window) {
+Renderer::Renderer(u32 width, u32 height, std::shared_ptr<Window> window, bool default_scene) noexcept
+    : m_window(window) {
 
-    m_instance = std::make_shared<Instance>();
-    m_surface = std::make_shared<Surface>(m_instance, m_window);
+    m_instance = std::make_shared<Instance>(IsHeadless());
+    if (!IsHeadless()) {
+        m_surface = std::make_shared<Surface>(m_instance, m_window);
+    }
     m_device = std::make_shared<Device>(m_instance, m_surface);
 
     m_render_context.width = width;
@@ -26,9 +40,26 @@ Renderer::Renderer(u32 width, u32 height, std::shared_ptr<Window> window) noexce
     m_command_buffer = std::make_shared<CommandBuffer>(m_render_context, m_device);
     m_scene = std::make_shared<Scene>(m_render_context, m_device, m_command_buffer);
     m_fullscreen_triangle = std::make_shared<FullscreenTriangle>(m_device, m_command_buffer);
-    m_pipeline_manager = std::make_shared<PipelineManager>(m_device);
-    PrepareAssests();
+    // the driver's pipeline cache survives runs, it is rejected when the gpu or driver changes
+    m_render_target_pool = std::make_shared<RenderTargetPool>(m_device);
+    m_pipeline_manager =
+        std::make_shared<PipelineManager>(m_device, Path::GetCachePath("pipelines.cache"), m_render_target_pool);
+    m_render_graph = std::make_shared<RenderGraph>(m_command_buffer);
+    if (default_scene) {
+        PrepareAssests();
+    }
+    // the pipelines compile on the thread pool while the rest of startup runs, the first frame waits for them
     CreatePipelines();
+    BuildRenderTargets();
+    m_device->GetMemoryAllocator()->LogStats();
+
+    // the luts only depend on the parameters and the precompute shaders, the cache is keyed on both
+    m_atmosphere_lut_cache_path = Path::GetCachePath("atmosphere.luts");
+    auto begin = std::chrono::steady_clock::now();
+    if (m_atmosphere_pass->LoadPrecomputedLuts(m_atmosphere_lut_cache_path)) {
+        f64 elapsed = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        LOG_INFO("atmosphere luts loaded from {} in {} ms", m_atmosphere_lut_cache_path, elapsed);
+    }
 }
 
 Renderer::~Renderer() noexcept {}
@@ -36,16 +67,29 @@ Renderer::~Renderer() noexcept {}
 void Renderer::Init() noexcept {}
 
 void Renderer::Update() noexcept {
+    PROFILE_SCOPE("Renderer::Update");
+    if (m_first_frame_begin == std::chrono::steady_clock::time_point{}) {
+        m_first_frame_begin = std::chrono::steady_clock::now();
+        m_pipeline_manager->WaitForPipelines();
+        m_pipeline_manager->LogStats();
+        m_pipeline_manager->SavePipelineCache();
+    }
+    m_command_buffer->BeginFrame(m_swap_chain);
     m_scene->Prepare();
 
-    m_light_pass->BindResource(0, m_scene->m_light_count_ub);
-    m_light_pass->BindResource(1, m_scene->m_light_ub);
+    u32 frame = m_command_buffer->GetCurrentFrame();
+    auto clustered_lights = m_scene->GetClusteredLights();
+    m_light_pass->BindResource(0, clustered_lights->GetClusterUb());
+    m_light_pass->BindResource(1, clustered_lights->GetLightBuffer(frame));
     m_light_pass->BindResource(2, m_scene->m_camera_ub);
 
     m_light_pass->BindResource(3, m_geometry_pass->GetFrameBufferAttachment(0));
     m_light_pass->BindResource(4, m_geometry_pass->GetFrameBufferAttachment(1));
     m_light_pass->BindResource(5, m_geometry_pass->GetFrameBufferAttachment(2));
 
+    m_light_pass->BindResource(6, clustered_lights->GetClusterLightCounts(frame));
+    m_light_pass->BindResource(7, clustered_lights->GetClusterLightIndices(frame));
+
     m_light_pass->UpdateDescriptorSets();
 
     m_atmosphere_pass->SetCameraParams(m_scene->GetMainCamera()->GetInvViewProjectionMatrix(),
@@ -53,197 +97,226 @@ void Renderer::Update() noexcept {
 
     m_atmosphere_pass->BindResource(0, m_scene->getCameraUbo());
     m_atmosphere_pass->BindResource(3, m_light_pass->GetFrameBufferAttachment(0));
-    m_atmosphere_pass->BindResource(4, m_geometry_pass->GetFrameBufferAttachment(3));
+    m_atmosphere_pass->BindResource(4, m_geometry_pass->GetFrameBufferAttachment(2));
     m_atmosphere_pass->UpdateDescriptorSets();
 
     m_post_process_pass->BindResource(0, m_atmosphere_pass->GetFrameBufferAttachment(0));
     m_post_process_pass->UpdateDescriptorSets();
 
-    m_present_descriptorSet->AllocateDescriptorSet();
     DescriptorSetUpdateDesc desc;
     desc.BindResource(0, m_post_process_pass->GetFrameBufferAttachment(0));
     m_present_descriptorSet->UpdateDescriptorSet(desc);
 }
 
 void Renderer::Render() noexcept {
+    bool precompute = !m_atmosphere_pass->precomputed;
 
     DrawFrame();
     m_command_buffer->submit(m_swap_chain);
+    PROFILE_FRAME();
+
+    if (!m_first_frame_done) {
+        // one time wait so the first frame is timed until the gpu finished it, precompute included
+        Wait();
+        f64 elapsed =
+            std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - m_first_frame_begin).count();
+        LOG_INFO("first frame took {} ms, atmosphere luts {}", elapsed, precompute ? "precomputed" : "from cache");
+        m_first_frame_done = true;
+    }
+
+    if (precompute) {
+        auto begin = std::chrono::steady_clock::now();
+        if (m_atmosphere_pass->SavePrecomputedLuts(m_atmosphere_lut_cache_path)) {
+            f64 elapsed = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - begin).count();
+            LOG_INFO("atmosphere luts saved to {} in {} ms", m_atmosphere_lut_cache_path, elapsed);
+        }
+    }
 }
 
-void Renderer::Wait() noexcept { vkDeviceWaitIdle(m_device->Get()); }
+void Renderer::Wait() noexcept { m_command_buffer->WaitIdle(); }
+
+std::vector<FrameTiming> Renderer::CollectFrameTimings() noexcept { return m_command_buffer->CollectFrameTimings(); }
+
+bool Renderer::SaveImage(const std::string &path) noexcept {
+    if (!IsHeadless()) {
+        LOG_WARN("presented images can't be read back, {} is not written", path);
+        return false;
+    }
+    Wait();
+
+    // rgba16 unorm, the present format
+    u32 width = m_render_context.width;
+    u32 height = m_render_context.height;
+    VkBuffer readback_buffer = VK_NULL_HANDLE;
+    MemoryAllocation readback_memory;
+    vk_createBuffer(m_device, static_cast<u64>(width) * height * 4 * sizeof(u16), VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, readback_buffer,
+                    readback_memory);
+    if (!readback_memory.mapped) {
+        LOG_WARN("failed to map the image readback buffer");
+        vk_destroyBuffer(m_device, readback_buffer, readback_memory);
+        return false;
+    }
+
+    // the present pass leaves the image in the transfer source layout, the next frame's pass discards it
+    VkImage image = m_swap_chain->getImage(m_command_buffer->GetImageIndex());
+    VkCommandBuffer cmdbuf = m_command_buffer->beginSingleTimeCommands();
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    vkCmdPipelineBarrier(cmdbuf, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0,
+                         nullptr, 0, nullptr, 1, &barrier);
+
+    VkBufferImageCopy region{};
+    region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.imageExtent = {width, height, 1};
+    vkCmdCopyImageToBuffer(cmdbuf, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readback_buffer, 1, &region);
+
+    VkMemoryBarrier host_barrier{};
+    host_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    host_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    host_barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(cmdbuf, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &host_barrier, 0,
+                         nullptr, 0, nullptr);
+    // waits for the queue to drain
+    m_command_buffer->endSingleTimeCommands(cmdbuf);
+
+    const u16 *texels = static_cast<const u16 *>(readback_memory.mapped);
+    std::vector<u8> pixels(static_cast<u64>(width) * height * 4);
+    for (u64 i = 0; i < pixels.size(); i++) {
+        pixels[i] = static_cast<u8>(texels[i] >> 8);
+    }
+    vk_destroyBuffer(m_device, readback_buffer, readback_memory);
+
+    if (!stbi_write_png(path.c_str(), static_cast<i32>(width), static_cast<i32>(height), 4, pixels.data(),
+                        static_cast<i32>(width * 4))) {
+        LOG_WARN("failed to write {}", path);
+        return false;
+    }
+    LOG_INFO("frame image written to {}", path);
+    return true;
+}
 
 std::shared_ptr<Camera> Renderer::GetMainCamera() const noexcept { return m_scene->GetMainCamera(); }
 
-void Renderer::DrawFrame() noexcept {
-    for (u32 i = 0; i < m_render_context.swap_chain_image_count; i++) {
-        m_command_buffer->beginCommandRecording(i);
-
-        // geometry pass
-        m_scene->Draw(i, m_command_buffer, m_geometry_pass->GetPipeline());
-
-        m_fullscreen_triangle->Draw(i, m_command_buffer, m_light_pass->GetPipeline(), {m_light_pass->m_descriptorset});
-
-        // scattering pass
-
-        if (!m_atmosphere_pass->precomputed) {
-            m_command_buffer->Dispatch(i, m_atmosphere_pass->m_transmittance_lut_pass,
-                                       {m_atmosphere_pass->m_transmittance_lut_descriptor_set});
-
-            // barrier
-            {
-                BarrierDesc desc1;
-                ImageMemoryBarrierDesc transmittance_lut_barrier;
-                transmittance_lut_barrier.src_access_mask = MemoryAccessFlags::ACCESS_SHADER_WRITE_BIT;
-                transmittance_lut_barrier.dst_access_mask = MemoryAccessFlags::ACCESS_SHADER_READ_BIT;
-                transmittance_lut_barrier.src_usage = TextureUsage::TEXTURE_USAGE_RW;
-                transmittance_lut_barrier.dst_usage = TextureUsage::TEXTURE_USAGE_RW;
-                transmittance_lut_barrier.dst_access_mask = MemoryAccessFlags::ACCESS_SHADER_READ_BIT;
-                transmittance_lut_barrier.texture = m_atmosphere_pass->transmittance_lut;
-                desc1.image_memory_barriers.push_back(transmittance_lut_barrier);
-                desc1.src_stage = PipelineStageFlags::PIPELINE_STAGE_COMPUTE_SHADER_BIT;
-                desc1.dst_stage = PipelineStageFlags::PIPELINE_STAGE_COMPUTE_SHADER_BIT;
-                InsertBarrier(i, m_command_buffer, desc1);
-            }
-
-            m_command_buffer->Dispatch(i, m_atmosphere_pass->m_direct_irradiance_lut_pass,
-                                       {m_atmosphere_pass->m_direct_irradiance_lut_descriptor_set});
-
-            m_command_buffer->Dispatch(i, m_atmosphere_pass->m_single_scattering_lut_pass,
-                                       {m_atmosphere_pass->m_single_scattering_lut_descriptor_set});
-
-            // barrier
-            {
-                BarrierDesc desc2;
-
-                ImageMemoryBarrierDesc delta_r_barrier;
-                delta_r_barrier.src_access_mask = MemoryAccessFlags::ACCESS_SHADER_WRITE_BIT;
-                delta_r_barrier.dst_access_mask = MemoryAccessFlags::ACCESS_SHADER_READ_BIT;
-                delta_r_barrier.texture = m_atmosphere_pass->single_rayleigh_scattering_lut;
-                delta_r_barrier.src_usage = TextureUsage::TEXTURE_USAGE_RW;
-                delta_r_barrier.dst_usage = TextureUsage::TEXTURE_USAGE_RW;
-
-                ImageMemoryBarrierDesc delta_mie_barrier;
-                delta_mie_barrier.src_access_mask = MemoryAccessFlags::ACCESS_SHADER_WRITE_BIT;
-                delta_mie_barrier.dst_access_mask = MemoryAccessFlags::ACCESS_SHADER_READ_BIT;
-                delta_mie_barrier.texture = m_atmosphere_pass->single_mie_scattering_lut;
-                delta_mie_barrier.src_usage = TextureUsage::TEXTURE_USAGE_RW;
-                delta_mie_barrier.dst_usage = TextureUsage::TEXTURE_USAGE_RW;
-
-                ImageMemoryBarrierDesc irradiance_barrier;
-                irradiance_barrier.src_access_mask = MemoryAccessFlags::ACCESS_SHADER_WRITE_BIT;
-                irradiance_barrier.dst_access_mask = MemoryAccessFlags::ACCESS_SHADER_READ_BIT;
-                irradiance_barrier.texture = m_atmosphere_pass->direct_irradiance_lut;
-                irradiance_barrier.src_usage = TextureUsage::TEXTURE_USAGE_RW;
-                irradiance_barrier.dst_usage = TextureUsage::TEXTURE_USAGE_RW;
-
-                ImageMemoryBarrierDesc multi_scattering_barrier;
-                multi_scattering_barrier.src_access_mask = MemoryAccessFlags::ACCESS_SHADER_WRITE_BIT;
-                multi_scattering_barrier.dst_access_mask = MemoryAccessFlags::ACCESS_SHADER_READ_BIT;
-                multi_scattering_barrier.texture = m_atmosphere_pass->multi_scattering_lut;
-                multi_scattering_barrier.src_usage = TextureUsage::TEXTURE_USAGE_RW;
-                multi_scattering_barrier.dst_usage = TextureUsage::TEXTURE_USAGE_RW;
-
-                desc2.image_memory_barriers.push_back(delta_r_barrier);
-                desc2.image_memory_barriers.push_back(delta_mie_barrier);
-                desc2.image_memory_barriers.push_back(irradiance_barrier);
-                desc2.image_memory_barriers.push_back(multi_scattering_barrier);
-
-                desc2.src_stage = PipelineStageFlags::PIPELINE_STAGE_COMPUTE_SHADER_BIT;
-                desc2.dst_stage = PipelineStageFlags::PIPELINE_STAGE_COMPUTE_SHADER_BIT;
-
-                InsertBarrier(i, m_command_buffer, desc2);
-            }
-
-            for (u32 j = 0; j < m_atmosphere_pass->m_multi_scattering_order; j++) {
-                m_atmosphere_pass->scattering_order_push_constants->ranges[0].value = &m_atmosphere_pass->layers[j + 1];
-                m_command_buffer->Dispatch(i, m_atmosphere_pass->m_scattering_density_lut,
-                                           {m_atmosphere_pass->m_scattering_density_lut_descriptor_set});
-                // barrier
-                {
-                    BarrierDesc desc;
-                    desc.src_stage = PipelineStageFlags::PIPELINE_STAGE_COMPUTE_SHADER_BIT;
-                    desc.dst_stage = PipelineStageFlags::PIPELINE_STAGE_COMPUTE_SHADER_BIT;
-                    InsertBarrier(i, m_command_buffer, desc);
-                }
-                m_atmosphere_pass->scattering_order_push_constants->ranges[0].value = &m_atmosphere_pass->layers[j];
-                m_command_buffer->Dispatch(i, m_atmosphere_pass->m_indirect_irradiance_lut,
-                                           {m_atmosphere_pass->m_indirect_irradiance_lut_descriptor_set});
-                // barrier
-                {
-                    BarrierDesc desc2;
-
-                    ImageMemoryBarrierDesc density_barrier;
-                    density_barrier.src_access_mask = MemoryAccessFlags::ACCESS_SHADER_WRITE_BIT;
-                    density_barrier.dst_access_mask = MemoryAccessFlags::ACCESS_SHADER_READ_BIT;
-                    density_barrier.texture = m_atmosphere_pass->scattering_density_lut;
-                    density_barrier.src_usage = TextureUsage::TEXTURE_USAGE_RW;
-                    density_barrier.dst_usage = TextureUsage::TEXTURE_USAGE_RW;
-
-                    ImageMemoryBarrierDesc multi_scattering_barrier;
-                    multi_scattering_barrier.src_access_mask = MemoryAccessFlags::ACCESS_SHADER_WRITE_BIT;
-                    multi_scattering_barrier.dst_access_mask = MemoryAccessFlags::ACCESS_SHADER_WRITE_BIT;
-                    multi_scattering_barrier.texture = m_atmosphere_pass->single_rayleigh_scattering_lut;
-                    multi_scattering_barrier.src_usage = TextureUsage::TEXTURE_USAGE_RW;
-                    multi_scattering_barrier.dst_usage = TextureUsage::TEXTURE_USAGE_RW;
-
-                    desc2.image_memory_barriers.push_back(density_barrier);
-                    desc2.image_memory_barriers.push_back(multi_scattering_barrier);
-
-                    desc2.src_stage = PipelineStageFlags::PIPELINE_STAGE_COMPUTE_SHADER_BIT;
-                    desc2.dst_stage = PipelineStageFlags::PIPELINE_STAGE_COMPUTE_SHADER_BIT |
-                                      PipelineStageFlags::PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-
-                    InsertBarrier(i, m_command_buffer, desc2);
-                }
-                m_atmosphere_pass->scattering_order_push_constants->ranges[0].value = &m_atmosphere_pass->layers[j + 1];
-                m_command_buffer->Dispatch(i, m_atmosphere_pass->m_multi_scattering_lut,
-                                           {m_atmosphere_pass->m_multi_scattering_lut_descriptor_set});
-                // barrier
-                {
-                    BarrierDesc desc2;
-
-                    ImageMemoryBarrierDesc _scattering_barrier;
-                    _scattering_barrier.src_access_mask = MemoryAccessFlags::ACCESS_SHADER_WRITE_BIT;
-                    _scattering_barrier.dst_access_mask = MemoryAccessFlags::ACCESS_SHADER_WRITE_BIT;
-                    _scattering_barrier.texture = m_atmosphere_pass->_scattering_tex;
-                    _scattering_barrier.src_usage = TextureUsage::TEXTURE_USAGE_RW;
-                    _scattering_barrier.dst_usage = TextureUsage::TEXTURE_USAGE_RW;
-
-                    ImageMemoryBarrierDesc multi_scattering_barrier;
-                    multi_scattering_barrier.src_access_mask = MemoryAccessFlags::ACCESS_SHADER_WRITE_BIT;
-                    multi_scattering_barrier.dst_access_mask = MemoryAccessFlags::ACCESS_SHADER_READ_BIT;
-                    multi_scattering_barrier.texture = m_atmosphere_pass->single_rayleigh_scattering_lut;
-                    multi_scattering_barrier.src_usage = TextureUsage::TEXTURE_USAGE_RW;
-                    multi_scattering_barrier.dst_usage = TextureUsage::TEXTURE_USAGE_RW;
-
-                    desc2.image_memory_barriers.push_back(_scattering_barrier);
-                    desc2.image_memory_barriers.push_back(multi_scattering_barrier);
-
-                    desc2.src_stage = PipelineStageFlags::PIPELINE_STAGE_COMPUTE_SHADER_BIT;
-                    desc2.dst_stage = PipelineStageFlags::PIPELINE_STAGE_COMPUTE_SHADER_BIT |
-                                      PipelineStageFlags::PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-
-                    InsertBarrier(i, m_command_buffer, desc2);
-                }
-            }
-            m_atmosphere_pass->precomputed = true;
-        }
+std::shared_ptr<Scene> Renderer::GetScene() const noexcept { return m_scene; }
+
+std::shared_ptr<Atmosphere> Renderer::GetAtmosphere() const noexcept { return m_atmosphere_pass; }
+
+std::shared_ptr<GpuProfiler> Renderer::GetGpuProfiler() const noexcept { return m_command_buffer->GetGpuProfiler(); }
 
-        //TODO: barrier
+void Renderer::DrawFrame() noexcept {
+    PROFILE_SCOPE("Renderer::DrawFrame");
+    // only the current frame slot is recorded, the other slot may still be executing on the gpu
+    u32 i = m_command_buffer->GetCurrentFrame();
+    m_command_buffer->beginCommandRecording(i);
+
+    BuildRenderGraph();
+    m_render_graph->Compile();
+    // the schedule only changes with the passes and resources declared, log it when it does
+    if (m_render_graph->GetHash() != m_render_graph_hash) {
+        LOG_INFO("{}", m_render_graph->Dump());
+        m_render_graph_hash = m_render_graph->GetHash();
+    }
+    m_render_graph->Execute(i);
 
-        m_fullscreen_triangle->Draw(i, m_command_buffer, m_atmosphere_pass->m_sky_pass,
-                                    {m_atmosphere_pass->m_sky_descriptor_set});
+    m_command_buffer->endCommandRecording(i);
+}
 
-        // post process pass
-        m_fullscreen_triangle->Draw(i, m_command_buffer, m_post_process_pass->GetPipeline(),
-                                    {m_post_process_pass->GetDescriptorSet()});
-        // final present pass
-        m_fullscreen_triangle->Draw(i, m_command_buffer, m_pipeline_manager->Get("present"), {m_present_descriptorSet},
-                                    true);
+void Renderer::BuildRenderTargets() noexcept {
+    // the render targets live between the first and last pass of the compiled graph that touches them
+    BuildRenderGraph();
+    m_render_graph->Compile();
+    for (auto &name : m_render_target_pool->GetTargetNames()) {
+        u32 first_use, last_use;
+        if (m_render_graph->GetLifetime(name, first_use, last_use)) {
+            m_render_target_pool->SetLifetime(name, first_use, last_use);
+        }
+    }
+    m_render_target_pool->Build();
+    for (auto &name : m_render_target_pool->GetTargetNames()) {
+        m_render_graph->SetAlias(name,
+                                 "render_target_memory" + std::to_string(m_render_target_pool->GetMemorySlot(name)));
+    }
+    m_render_target_pool->LogStats();
+}
 
-        m_command_buffer->endCommandRecording(i);
+void Renderer::BuildRenderGraph() noexcept {
+    m_render_graph->Reset();
+
+    // keeps its timestamps and job state across frames, so it runs even when nothing samples the luts this frame
+    RenderGraph::Pass &precompute = m_render_graph->AddPass(
+        "atmosphere_precompute", RenderGraphPassType::COMPUTE,
+        [this](u32 i) { m_atmosphere_pass->RecordPrecompute(i); });
+    precompute.SetSideEffect();
+    // the sky samples the front lut set while a recompute fills the other one, the first precompute writes the front
+    // set and the sky waits for it
+    if (m_atmosphere_pass->IsRecomputing()) {
+        precompute.Write(LutSetResource(m_atmosphere_pass->GetTargetLutSet()), RenderGraphAccess::COMPUTE_WRITE);
     }
+
+    // culling runs inside the geometry pass, its buffer barriers stay with it
+    m_render_graph
+        ->AddPass("geometry", RenderGraphPassType::GRAPHICS,
+                  [this](u32 i) { m_scene->Draw(i, m_command_buffer, m_geometry_pass->GetPipeline()); })
+        .Write("gbuffer0", RenderGraphAccess::COLOR_ATTACHMENT)
+        .Write("gbuffer1", RenderGraphAccess::COLOR_ATTACHMENT)
+        .Write("depth", RenderGraphAccess::DEPTH_ATTACHMENT)
+        .SetSecondaryCommandBuffers();
+
+    m_render_graph
+        ->AddPass("light_cull", RenderGraphPassType::COMPUTE,
+                  [this](u32 i) { m_scene->GetClusteredLights()->Cull(i); })
+        .Write("light_clusters", RenderGraphAccess::COMPUTE_WRITE);
+
+    m_render_graph
+        ->AddPass("light", RenderGraphPassType::GRAPHICS,
+                  [this](u32 i) {
+                      m_fullscreen_triangle->Draw(i, m_command_buffer, m_light_pass->GetPipeline(),
+                                                  {m_light_pass->m_descriptorset});
+                  })
+        .Read("gbuffer0", RenderGraphAccess::FRAGMENT_READ)
+        .Read("gbuffer1", RenderGraphAccess::FRAGMENT_READ)
+        .Read("depth", RenderGraphAccess::FRAGMENT_READ)
+        .Read("light_clusters", RenderGraphAccess::FRAGMENT_READ)
+        .Write("lit", RenderGraphAccess::COLOR_ATTACHMENT);
+
+    m_render_graph
+        ->AddPass("sky", RenderGraphPassType::GRAPHICS,
+                  [this](u32 i) {
+                      m_fullscreen_triangle->Draw(i, m_command_buffer, m_atmosphere_pass->m_sky_pass,
+                                                  {m_atmosphere_pass->m_sky_descriptor_set});
+                  })
+        .Read(LutSetResource(m_atmosphere_pass->GetFrontLutSet()), RenderGraphAccess::FRAGMENT_READ)
+        .Read("lit", RenderGraphAccess::FRAGMENT_READ)
+        .Read("depth", RenderGraphAccess::FRAGMENT_READ)
+        .Write("sky", RenderGraphAccess::COLOR_ATTACHMENT);
+
+    m_render_graph
+        ->AddPass("post_process", RenderGraphPassType::GRAPHICS,
+                  [this](u32 i) {
+                      m_fullscreen_triangle->Draw(i, m_command_buffer, m_post_process_pass->GetPipeline(),
+                                                  {m_post_process_pass->GetDescriptorSet()});
+                  })
+        .Read("sky", RenderGraphAccess::FRAGMENT_READ)
+        .Write("post_process", RenderGraphAccess::COLOR_ATTACHMENT);
+
+    m_render_graph
+        ->AddPass("present", RenderGraphPassType::GRAPHICS,
+                  [this](u32 i) {
+                      m_fullscreen_triangle->Draw(i, m_command_buffer, m_pipeline_manager->Get("present"),
+                                                  {m_present_descriptorSet}, true);
+                  })
+        .Read("post_process", RenderGraphAccess::FRAGMENT_READ)
+        .Write("swap_chain", RenderGraphAccess::COLOR_ATTACHMENT)
+        .SetSideEffect();
 }
 
 void Renderer::PrepareAssests() noexcept {
@@ -298,9 +371,12 @@ void Renderer::CreatePresentPipeline() noexcept {
     presentPipelineCreateInfo.vs = presentVs;
     presentPipelineCreateInfo.ps = presentPs;
     presentPipelineCreateInfo.descriptor_layouts = presentDescriptorSetLayout;
+    // headless images have no sampled usage, they end in the layout SaveImage copies from. the present layout needs
+    // the swap chain extension
+    u32 present_usage = IsHeadless() ? COLOR_ATTACHMENT | TRANSFER_SRC : COLOR_ATTACHMENT | PRESENT_SRC;
     std::vector<AttachmentCreateInfo> presentAttachmentsCreateInfo{
-        {TextureFormat::TEXTURE_FORMAT_RGBA16_UNORM, COLOR_ATTACHMENT | PRESENT_SRC, TextureType::TEXTURE_TYPE_2D,
-         m_render_context.width, m_render_context.height}};
+        {TextureFormat::TEXTURE_FORMAT_RGBA16_UNORM, present_usage, TextureType::TEXTURE_TYPE_2D,
+         m_render_context.width, m_render_context.height, 1, ""}};
     m_pipeline_manager->createPresentPipeline(presentPipelineCreateInfo, presentAttachmentsCreateInfo, m_render_context,
                                               m_swap_chain);
 }
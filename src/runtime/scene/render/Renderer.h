@@ -1,5 +1,8 @@
 #pragma once
 
+#include <chrono>
+#include <string>
+
 #include <vulkan/vulkan.hpp>
 
 #include <runtime/function/rhi/RenderContext.h>
@@ -9,6 +12,7 @@
 #include <runtime/function/rhi/vulkan/Framebuffer.h>
 #include <runtime/function/rhi/vulkan/Instance.h>
 #include <runtime/function/rhi/vulkan/Pipeline.h>
+#include <runtime/function/rhi/vulkan/RenderTargetPool.h>
 #include <runtime/function/rhi/vulkan/Surface.h>
 #include <runtime/function/rhi/vulkan/SwapChain.h>
 #include <runtime/function/rhi/vulkan/UniformBuffer.h>
@@ -17,12 +21,15 @@
 #include <runtime/scene/render/Geometry.h>
 #include <runtime/scene/render/LightPass.h>
 #include <runtime/scene/render/PostProcess.h>
+#include <runtime/scene/render/RenderGraph.h>
 #include <runtime/scene/scene/Scene.h>
 
 namespace Horizon {
 class Renderer {
   public:
-    Renderer(u32 width, u32 height, std::shared_ptr<Window> window) noexcept;
+    // without a window the renderer is headless, the same passes render into offscreen images and nothing is
+    // presented. default_scene loads the flight helmet and the sun, tools that build their own scene turn it off
+    Renderer(u32 width, u32 height, std::shared_ptr<Window> window, bool default_scene = true) noexcept;
     ~Renderer() noexcept;
 
     Renderer(const Renderer &) = default;
@@ -35,13 +42,35 @@ class Renderer {
 
     void Render() noexcept;
 
+    // waits for the gpu, the timings and gpu profiles of every submitted frame are available afterwards
     void Wait() noexcept;
 
+    bool IsHeadless() const noexcept { return !m_window; }
+
+    // cpu and gpu timings of the frames retired since the last call, oldest first
+    std::vector<FrameTiming> CollectFrameTimings() noexcept;
+
+    // waits for the gpu and writes the last frame as an 8 bit png, headless only
+    bool SaveImage(const std::string &path) noexcept;
+
     std::shared_ptr<Camera> GetMainCamera() const noexcept;
 
+    std::shared_ptr<Scene> GetScene() const noexcept;
+
+    std::shared_ptr<Atmosphere> GetAtmosphere() const noexcept;
+
+    // per render graph pass gpu timings, nullptr without timestamp support
+    std::shared_ptr<GpuProfiler> GetGpuProfiler() const noexcept;
+
   private:
     void DrawFrame() noexcept;
 
+    // declares this frame's passes and the resources they read and write
+    void BuildRenderGraph() noexcept;
+
+    // gives the pooled render targets memory, aliased by their lifetimes in the render graph
+    void BuildRenderTargets() noexcept;
+
     void PrepareAssests() noexcept;
 
     // create pipeline layouts for each pass
@@ -55,6 +84,7 @@ class Renderer {
     std::shared_ptr<Device> m_device = nullptr;
     std::shared_ptr<Surface> m_surface = nullptr;
     std::shared_ptr<SwapChain> m_swap_chain = nullptr;
+    std::shared_ptr<RenderTargetPool> m_render_target_pool = nullptr;
     std::shared_ptr<PipelineManager> m_pipeline_manager = nullptr;
     std::shared_ptr<CommandBuffer> m_command_buffer = nullptr;
     std::shared_ptr<Scene> m_scene = nullptr;
@@ -73,5 +103,13 @@ class Renderer {
     std::shared_ptr<PostProcess> m_post_process_pass;
     std::shared_ptr<Geometry> m_geometry_pass;
     std::shared_ptr<LightPass> m_light_pass;
+
+    std::shared_ptr<RenderGraph> m_render_graph;
+    // hash of the last logged graph, the graph is logged whenever it changes
+    u64 m_render_graph_hash = 0;
+
+    std::string m_atmosphere_lut_cache_path;
+    std::chrono::steady_clock::time_point m_first_frame_begin{};
+    bool m_first_frame_done = false;
 };
 } // namespace Horizon
\ No newline at end of file
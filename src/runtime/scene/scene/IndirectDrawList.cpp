@@ -0,0 +1,316 @@
+#include "IndirectDrawList.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+#include <runtime/core/log/Log.h>
+#include <runtime/core/path/Path.h>
+#include <runtime/function/rhi/vulkan/ResourceBarrier.h>
+#include <runtime/function/rhi/vulkan/ShaderModule.h>
+#include <runtime/function/rhi/vulkan/VulkanBuffer.h>
+
+namespace Horizon {
+
+namespace {
+
+constexpr u32 CULL_GROUP_SIZE = 64; // local_size_x of cull.comp
+constexpr u32 MIN_INSTANCE_CAPACITY = 256;
+constexpr u32 MIN_BATCH_CAPACITY = 16;
+
+// push constant of cull.comp
+struct CullParams {
+    Math::vec4 frustum_planes[6];
+    u32 instance_count;
+    u32 compact;
+};
+
+} // namespace
+
+IndirectDrawList::IndirectDrawList(std::shared_ptr<Device> device,
+                                   std::shared_ptr<CommandBuffer> command_buffer) noexcept
+    : m_device(device), m_command_buffer(command_buffer),
+      m_draw_indexed_indirect_count(device->GetDrawIndexedIndirectCount()) {
+    CreateLayout();
+    CreatePool();
+    CreatePipeline();
+    if (!m_draw_indexed_indirect_count) {
+        LOG_WARN("VK_KHR_draw_indirect_count is not supported, culled draws are issued with zero instances");
+    }
+}
+
+IndirectDrawList::~IndirectDrawList() noexcept {
+    for (auto &frame : m_frames) {
+        Destroy(frame);
+    }
+    // sets are freed with the pool
+    vkDestroyDescriptorPool(m_device->Get(), m_pool, nullptr);
+    vkDestroyDescriptorSetLayout(m_device->Get(), m_layout, nullptr);
+}
+
+bool IndirectDrawList::IsSupported(const std::shared_ptr<Device> &device) noexcept {
+    if (!device->IsMultiDrawIndirectSupported()) {
+        LOG_WARN("multi draw indirect is not supported, geometry is drawn from the cpu");
+        return false;
+    }
+    if (!std::filesystem::exists(Path::GetShaderPath("cull.comp.spv")) ||
+        !std::filesystem::exists(Path::GetShaderPath("geometry_indirect.vert.spv"))) {
+        LOG_WARN("gpu driven shaders are not compiled, geometry is drawn from the cpu");
+        return false;
+    }
+    return true;
+}
+
+void IndirectDrawList::CreateLayout() noexcept {
+    std::array<VkDescriptorSetLayoutBinding, 3> bindings{};
+    // instances, also read by the vertex shader through gl_InstanceIndex
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[0].descriptorCount = 1;
+    bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT;
+    // draw commands
+    bindings[1].binding = 1;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[1].descriptorCount = 1;
+    bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    // draw counts
+    bindings[2].binding = 2;
+    bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[2].descriptorCount = 1;
+    bindings[2].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layout_create_info{};
+    layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layout_create_info.bindingCount = static_cast<u32>(bindings.size());
+    layout_create_info.pBindings = bindings.data();
+    CHECK_VK_RESULT(vkCreateDescriptorSetLayout(m_device->Get(), &layout_create_info, nullptr, &m_layout));
+}
+
+void IndirectDrawList::CreatePool() noexcept {
+    VkDescriptorPoolSize pool_size{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3 * MAX_FRAMES_IN_FLIGHT};
+
+    VkDescriptorPoolCreateInfo pool_create_info{};
+    pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_create_info.maxSets = MAX_FRAMES_IN_FLIGHT;
+    pool_create_info.poolSizeCount = 1;
+    pool_create_info.pPoolSizes = &pool_size;
+    CHECK_VK_RESULT(vkCreateDescriptorPool(m_device->Get(), &pool_create_info, nullptr, &m_pool));
+
+    std::array<VkDescriptorSetLayout, MAX_FRAMES_IN_FLIGHT> layouts;
+    layouts.fill(m_layout);
+    std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT> sets{};
+    VkDescriptorSetAllocateInfo alloc_info{};
+    alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    alloc_info.descriptorPool = m_pool;
+    alloc_info.descriptorSetCount = MAX_FRAMES_IN_FLIGHT;
+    alloc_info.pSetLayouts = layouts.data();
+    CHECK_VK_RESULT(vkAllocateDescriptorSets(m_device->Get(), &alloc_info, sets.data()));
+    for (u32 i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        m_frames[i].set = sets[i];
+    }
+}
+
+void IndirectDrawList::CreatePipeline() noexcept {
+    ComputePipelineCreateInfo create_info;
+    create_info.name = "cull";
+    create_info.cs = std::make_shared<Shader>(m_device->Get(), Path::GetShaderPath("cull.comp.spv"));
+    create_info.descriptor_layouts = std::make_shared<DescriptorSetLayouts>();
+    create_info.descriptor_layouts->layouts = {m_layout};
+    create_info.push_constants = std::make_shared<PushConstants>();
+    create_info.push_constants->ranges = {{SHADER_STAGE_COMPUTE_SHADER, 0, sizeof(CullParams)}};
+    m_cull_pipeline = std::make_shared<ComputePipeline>(m_device, create_info);
+}
+
+void IndirectDrawList::Begin(u32 frame) noexcept {
+    m_frame = frame;
+    m_instances.clear();
+    m_batches.clear();
+
+    // BeginFrame waited for the slot's fence, the counts it produced are final
+    FrameResources &resources = m_frames[frame];
+    if (resources.culled) {
+        const u32 *counts = static_cast<const u32 *>(resources.count_memory.mapped);
+        m_visible_count = 0;
+        for (u32 i = 0; i < resources.batch_count; i++) {
+            m_visible_count += counts[i];
+        }
+        resources.culled = false;
+    }
+}
+
+void IndirectDrawList::AddBatch(VkBuffer vertex_buffer, VkBuffer index_buffer) noexcept {
+    Batch batch;
+    batch.vertex_buffer = vertex_buffer;
+    batch.index_buffer = index_buffer;
+    batch.first_instance = static_cast<u32>(m_instances.size());
+    m_batches.push_back(batch);
+}
+
+void IndirectDrawList::AddInstance(const Math::mat4 &model, const Math::vec3 &bounds_min,
+                                   const Math::vec3 &bounds_max, u32 first_index, u32 index_count,
+                                   u32 material_index) noexcept {
+    Batch &batch = m_batches.back();
+    DrawInstance instance{};
+    instance.model = model;
+    instance.bounds_center = Math::vec4((bounds_min + bounds_max) * 0.5f, 0.0f);
+    instance.bounds_extent = Math::vec4((bounds_max - bounds_min) * 0.5f, 0.0f);
+    instance.first_index = first_index;
+    instance.index_count = index_count;
+    instance.material_index = material_index;
+    instance.batch = static_cast<u32>(m_batches.size() - 1);
+    instance.batch_first = batch.first_instance;
+    m_instances.push_back(instance);
+    batch.instance_count++;
+}
+
+void IndirectDrawList::End() noexcept {
+    FrameResources &resources = m_frames[m_frame];
+    Reserve(resources, static_cast<u32>(m_instances.size()), static_cast<u32>(m_batches.size()));
+    if (!m_instances.empty()) {
+        memcpy(resources.instance_memory.mapped, m_instances.data(), m_instances.size() * sizeof(DrawInstance));
+    }
+}
+
+void IndirectDrawList::Reserve(FrameResources &frame, u32 instance_count, u32 batch_count) noexcept {
+    if (instance_count <= frame.instance_capacity && batch_count <= frame.batch_capacity) {
+        return;
+    }
+    // the slot's last frame has retired, nothing reads the old buffers any more
+    Destroy(frame);
+    frame.instance_capacity = std::max({instance_count, frame.instance_capacity * 2, MIN_INSTANCE_CAPACITY});
+    frame.batch_capacity = std::max({batch_count, frame.batch_capacity * 2, MIN_BATCH_CAPACITY});
+
+    u64 instance_size = static_cast<u64>(frame.instance_capacity) * sizeof(DrawInstance);
+    u64 command_size = static_cast<u64>(frame.instance_capacity) * sizeof(VkDrawIndexedIndirectCommand);
+    u64 count_size = static_cast<u64>(frame.batch_capacity) * sizeof(u32);
+    vk_createBuffer(m_device, instance_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, frame.instance_buffer,
+                    frame.instance_memory);
+    vk_createBuffer(m_device, command_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame.command_buffer, frame.command_memory);
+    // host visible so the visible count can be reported without a copy
+    vk_createBuffer(m_device, count_size,
+                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                        VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, frame.count_buffer,
+                    frame.count_memory);
+
+    std::array<VkDescriptorBufferInfo, 3> buffer_infos{{
+        {frame.instance_buffer, 0, instance_size},
+        {frame.command_buffer, 0, command_size},
+        {frame.count_buffer, 0, count_size},
+    }};
+    std::array<VkWriteDescriptorSet, 3> writes{};
+    for (u32 i = 0; i < writes.size(); i++) {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = frame.set;
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[i].pBufferInfo = &buffer_infos[i];
+    }
+    vkUpdateDescriptorSets(m_device->Get(), static_cast<u32>(writes.size()), writes.data(), 0, nullptr);
+}
+
+void IndirectDrawList::Destroy(FrameResources &frame) noexcept {
+    if (frame.instance_buffer) {
+        vk_destroyBuffer(m_device, frame.instance_buffer, frame.instance_memory);
+    }
+    if (frame.command_buffer) {
+        vk_destroyBuffer(m_device, frame.command_buffer, frame.command_memory);
+    }
+    if (frame.count_buffer) {
+        vk_destroyBuffer(m_device, frame.count_buffer, frame.count_memory);
+    }
+}
+
+void IndirectDrawList::Cull(u32 frame, const Math::mat4 &view_projection) noexcept {
+    FrameResources &resources = m_frames[frame];
+    u32 instance_count = static_cast<u32>(m_instances.size());
+    u32 batch_count = static_cast<u32>(m_batches.size());
+    if (instance_count == 0) {
+        return;
+    }
+    VkCommandBuffer command_buffer = m_command_buffer->Get(frame);
+
+    vkCmdFillBuffer(command_buffer, resources.count_buffer, 0, batch_count * sizeof(u32), 0);
+    BarrierDesc clear_barrier;
+    clear_barrier.src_stage = PIPELINE_STAGE_TRANSFER_BIT;
+    clear_barrier.dst_stage = PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    clear_barrier.buffer_memory_barriers.push_back(
+        {ACCESS_TRANSFER_WRITE_BIT, static_cast<MemoryAccessFlags>(ACCESS_SHADER_READ_BIT | ACCESS_SHADER_WRITE_BIT),
+         resources.count_buffer, 0, static_cast<u32>(batch_count * sizeof(u32))});
+    InsertBarrier(frame, m_command_buffer, clear_barrier);
+
+    // gribb-hartmann planes of the vulkan clip volume, 0 <= z <= w also holds for the reversed depth range
+    CullParams params{};
+    Math::mat4 m = Math::transpose(view_projection);
+    params.frustum_planes[0] = m[3] + m[0];
+    params.frustum_planes[1] = m[3] - m[0];
+    params.frustum_planes[2] = m[3] + m[1];
+    params.frustum_planes[3] = m[3] - m[1];
+    params.frustum_planes[4] = m[2];
+    params.frustum_planes[5] = m[3] - m[2];
+    for (auto &plane : params.frustum_planes) {
+        plane /= Math::length(Math::vec3(plane));
+    }
+    params.instance_count = instance_count;
+    params.compact = m_draw_indexed_indirect_count ? 1 : 0;
+
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cull_pipeline->Get());
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cull_pipeline->GetLayout(), 0, 1,
+                            &resources.set, 0, nullptr);
+    vkCmdPushConstants(command_buffer, m_cull_pipeline->GetLayout(), ToVkShaderStageFlags(SHADER_STAGE_COMPUTE_SHADER),
+                       0, sizeof(CullParams), &params);
+    vkCmdDispatch(command_buffer, (instance_count + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+    // commands and counts feed the indirect draws, counts are also read back by the host
+    BarrierDesc cull_barrier;
+    cull_barrier.src_stage = PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    cull_barrier.dst_stage = PIPELINE_STAGE_DRAW_INDIRECT_BIT | PIPELINE_STAGE_HOST_BIT;
+    cull_barrier.buffer_memory_barriers.push_back(
+        {ACCESS_SHADER_WRITE_BIT, ACCESS_INDIRECT_COMMAND_READ_BIT, resources.command_buffer, 0,
+         static_cast<u32>(instance_count * sizeof(VkDrawIndexedIndirectCommand))});
+    cull_barrier.buffer_memory_barriers.push_back(
+        {ACCESS_SHADER_WRITE_BIT,
+         static_cast<MemoryAccessFlags>(ACCESS_INDIRECT_COMMAND_READ_BIT | ACCESS_HOST_READ_BIT),
+         resources.count_buffer, 0, static_cast<u32>(batch_count * sizeof(u32))});
+    InsertBarrier(frame, m_command_buffer, cull_barrier);
+
+    resources.batch_count = batch_count;
+    resources.culled = true;
+}
+
+u32 IndirectDrawList::Draw(u32 frame, VkCommandBuffer command_buffer, VkPipelineLayout layout,
+                           u32 set_index) noexcept {
+    FrameResources &resources = m_frames[frame];
+    if (m_instances.empty()) {
+        return 0;
+    }
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, set_index, 1, &resources.set, 0,
+                            nullptr);
+
+    const VkDeviceSize offsets[1] = {0};
+    constexpr u32 stride = sizeof(VkDrawIndexedIndirectCommand);
+    u32 draw_count = 0;
+    for (u32 i = 0; i < m_batches.size(); i++) {
+        const Batch &batch = m_batches[i];
+        if (batch.instance_count == 0) {
+            continue;
+        }
+        vkCmdBindVertexBuffers(command_buffer, 0, 1, &batch.vertex_buffer, offsets);
+        vkCmdBindIndexBuffer(command_buffer, batch.index_buffer, 0, VK_INDEX_TYPE_UINT32);
+        VkDeviceSize command_offset = static_cast<VkDeviceSize>(batch.first_instance) * stride;
+        if (m_draw_indexed_indirect_count) {
+            m_draw_indexed_indirect_count(command_buffer, resources.command_buffer, command_offset,
+                                          resources.count_buffer, i * sizeof(u32), batch.instance_count, stride);
+        } else {
+            vkCmdDrawIndexedIndirect(command_buffer, resources.command_buffer, command_offset, batch.instance_count,
+                                     stride);
+        }
+        draw_count++;
+    }
+    return draw_count;
+}
+
+} // namespace Horizon
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include <runtime/core/math/Math.h>
+#include <runtime/function/rhi/RenderContext.h>
+#include <runtime/function/rhi/vulkan/CommandBuffer.h>
+#include <runtime/function/rhi/vulkan/Device.h>
+#include <runtime/function/rhi/vulkan/Pipeline.h>
+
+namespace Horizon {
+
+// one primitive of one model instance. matches cull.comp and geometry_indirect.vert
+struct DrawInstance {
+    Math::mat4 model;
+    Math::vec4 bounds_center; // local space aabb
+    Math::vec4 bounds_extent;
+    u32 first_index;
+    u32 index_count;
+    u32 material_index;
+    u32 batch;       // count slot of the instance's batch
+    u32 batch_first; // first draw command of the batch
+    u32 padding[3];
+};
+static_assert(sizeof(DrawInstance) == 128, "DrawInstance must match the std430 layout of the shaders");
+
+// gpu driven geometry: the cpu only gathers the instances of every primitive, a compute pass frustum culls them and
+// writes one VkDrawIndexedIndirectCommand per visible instance. instances are batched by the vertex and index buffer
+// they draw from, each batch is a single indirect draw whose count comes from the cull pass if the device has
+// VK_KHR_draw_indirect_count, otherwise culled commands are left in place with zero instances.
+class IndirectDrawList {
+  public:
+    IndirectDrawList(std::shared_ptr<Device> device, std::shared_ptr<CommandBuffer> command_buffer) noexcept;
+    ~IndirectDrawList() noexcept;
+    IndirectDrawList(const IndirectDrawList &) = delete;
+    IndirectDrawList &operator=(const IndirectDrawList &) = delete;
+
+    // the device features and the compiled shaders are available
+    static bool IsSupported(const std::shared_ptr<Device> &device) noexcept;
+
+    // starts the instances of the frame slot, call after BeginFrame
+    void Begin(u32 frame) noexcept;
+    // following instances draw from these buffers
+    void AddBatch(VkBuffer vertex_buffer, VkBuffer index_buffer) noexcept;
+    void AddInstance(const Math::mat4 &model, const Math::vec3 &bounds_min, const Math::vec3 &bounds_max,
+                     u32 first_index, u32 index_count, u32 material_index) noexcept;
+    // uploads the gathered instances
+    void End() noexcept;
+
+    // culls the frame's instances into its draw commands, record outside of a render pass
+    void Cull(u32 frame, const Math::mat4 &view_projection) noexcept;
+    // binds the instance set at set_index and issues one indirect draw per batch, returns the draw call count
+    u32 Draw(u32 frame, VkCommandBuffer command_buffer, VkPipelineLayout layout, u32 set_index) noexcept;
+
+    VkDescriptorSetLayout GetLayout() const noexcept { return m_layout; }
+    u32 GetInstanceCount() const noexcept { return static_cast<u32>(m_instances.size()); }
+    // instances that passed culling the last time the current frame slot was drawn
+    u32 GetVisibleCount() const noexcept { return m_visible_count; }
+    bool IsCompacted() const noexcept { return m_draw_indexed_indirect_count != nullptr; }
+
+  private:
+    struct Batch {
+        VkBuffer vertex_buffer = VK_NULL_HANDLE;
+        VkBuffer index_buffer = VK_NULL_HANDLE;
+        u32 first_instance = 0;
+        u32 instance_count = 0;
+    };
+
+    // instances, draw commands and per batch counts of one frame in flight
+    struct FrameResources {
+        VkBuffer instance_buffer = VK_NULL_HANDLE;
+        MemoryAllocation instance_memory;
+        VkBuffer command_buffer = VK_NULL_HANDLE;
+        MemoryAllocation command_memory;
+        VkBuffer count_buffer = VK_NULL_HANDLE;
+        MemoryAllocation count_memory;
+        VkDescriptorSet set = VK_NULL_HANDLE;
+        u32 instance_capacity = 0;
+        u32 batch_capacity = 0;
+        // what the slot culled last time, read back once its fence has signaled
+        u32 batch_count = 0;
+        bool culled = false;
+    };
+
+    void CreateLayout() noexcept;
+    void CreatePool() noexcept;
+    void CreatePipeline() noexcept;
+    void Reserve(FrameResources &frame, u32 instance_count, u32 batch_count) noexcept;
+    void Destroy(FrameResources &frame) noexcept;
+
+  private:
+    std::shared_ptr<Device> m_device = nullptr;
+    std::shared_ptr<CommandBuffer> m_command_buffer = nullptr;
+    PFN_vkCmdDrawIndexedIndirectCount m_draw_indexed_indirect_count = nullptr;
+
+    VkDescriptorSetLayout m_layout = VK_NULL_HANDLE;
+    VkDescriptorPool m_pool = VK_NULL_HANDLE;
+    std::shared_ptr<Pipeline> m_cull_pipeline = nullptr;
+
+    std::array<FrameResources, MAX_FRAMES_IN_FLIGHT> m_frames;
+    u32 m_frame = 0;
+    std::vector<DrawInstance> m_instances;
+    std::vector<Batch> m_batches;
+    u32 m_visible_count = 0;
+};
+
+} // namespace Horizon
@@ -1,10 +1,26 @@
 #include "Scene.h"
 
+#include <array>
+#include <chrono>
+#include <filesystem>
+
 #include <runtime/core/log/Log.h>
+#include <runtime/core/path/Path.h>
+#include <runtime/core/profile/Profiler.h>
+#include <runtime/core/thread/ThreadPool.h>
 #include <runtime/function/rhi/vulkan/UniformBuffer.h>
 
 namespace Horizon {
 
+namespace {
+
+// frames averaged into one geometry pass report
+constexpr u32 DRAW_STATS_INTERVAL = 240;
+// fewer instances per thread cost more in secondary command buffers than they save in recording
+constexpr u32 MIN_INSTANCES_PER_RECORDING_THREAD = 8;
+
+} // namespace
+
 Scene::Scene(RenderContext &render_context, const std::shared_ptr<Device> &device,
              const std::shared_ptr<CommandBuffer> &command_buffer) noexcept
     : m_render_context(render_context), m_device(device), m_command_buffer(command_buffer) {
@@ -31,67 +47,72 @@ Scene::Scene(RenderContext &render_context, const std::shared_ptr<Device> &devic
 
     // create uniform buffer
     m_scene_ub = std::make_shared<UniformBuffer>(device);
-    m_light_count_ub = std::make_shared<UniformBuffer>(device);
-    m_light_ub = std::make_shared<UniformBuffer>(device);
     m_camera_ub = std::make_shared<UniformBuffer>(device);
+    m_clustered_lights =
+        std::make_shared<ClusteredLights>(device, command_buffer, m_render_context.width, m_render_context.height);
+
+#ifdef HORIZON_ENABLE_BINDLESS
+    if (!m_device->IsBindlessSupported()) {
+        LOG_WARN("descriptor indexing is not supported, materials are bound per draw");
+    } else if (!std::filesystem::exists(Path::GetShaderPath("geometry_bindless.frag.spv"))) {
+        LOG_WARN("bindless geometry shaders are not compiled, materials are bound per draw");
+    } else {
+        m_material_table = std::make_shared<MaterialTable>(m_device);
+    }
+#endif
+#ifdef HORIZON_ENABLE_GPU_DRIVEN
+    if (!m_material_table) {
+        LOG_WARN("gpu driven drawing needs the bindless material table, geometry is drawn from the cpu");
+    } else if (IndirectDrawList::IsSupported(m_device)) {
+        m_indirect_draw_list = std::make_shared<IndirectDrawList>(m_device, m_command_buffer);
+    }
+#endif
 }
 
 void Scene::LoadModel(const std::string &path, const std::string &name) noexcept {
-    m_models.insert({name, std::make_shared<Model>(path, m_device, m_command_buffer, m_scene_descriptor_set)});
+    PROFILE_SCOPE("Scene::LoadModel");
+    auto model = std::make_shared<Model>(path, m_device, m_command_buffer, m_scene_descriptor_set);
+    if (m_material_table) {
+        model->RegisterMaterials(*m_material_table);
+    }
+    m_models.insert({name, model});
 }
 
 std::shared_ptr<Model> Scene::GetModel(const std::string &name) const noexcept { return m_models.at(name); }
 
 void Scene::AddDirectLight(Math::vec3 color, f32 intensity, Math::vec3 direction) noexcept {
-    if (m_light_count_ubdata.lightCount >= MAX_LIGHT_COUNT) {
-        LOG_WARN("light count cannot more than {}", MAX_LIGHT_COUNT);
-        return;
-    }
-
     f32 luminous_intensity = intensity;
 
-    m_lights_ubdata.lights[m_light_count_ubdata.lightCount].color_intensity = {color, luminous_intensity};
-    m_lights_ubdata.lights[m_light_count_ubdata.lightCount].direction = {direction.x, direction.y, direction.z, 0.0};
-    m_lights_ubdata.lights[m_light_count_ubdata.lightCount].position_type = {0.0, 0.0, 0.0,
-                                                                             static_cast<f32>(LightType::DIRECT_LIGHT)};
-    m_light_count_ubdata.lightCount++;
+    LightParams &light = m_lights.emplace_back();
+    light.color_intensity = {color, luminous_intensity};
+    light.direction = {direction.x, direction.y, direction.z, 0.0};
+    light.position_type = {0.0, 0.0, 0.0, static_cast<f32>(LightType::DIRECT_LIGHT)};
 }
 
 void Scene::AddPointLight(Math::vec3 color, f32 intensity, Math::vec3 position, f32 radius) noexcept {
-    if (m_light_count_ubdata.lightCount >= MAX_LIGHT_COUNT) {
-        LOG_WARN("light count cannot more than {}", MAX_LIGHT_COUNT);
-        return;
-    }
-
     f32 luminous_intensity = intensity / Math::one_over_pi<f32>() / 4.0f;
 
-    m_lights_ubdata.lights[m_light_count_ubdata.lightCount].color_intensity = {color, luminous_intensity};
-    m_lights_ubdata.lights[m_light_count_ubdata.lightCount].position_type = {position,
-                                                                             static_cast<f32>(LightType::POINT_LIGHT)};
-    m_lights_ubdata.lights[m_light_count_ubdata.lightCount].radius_inner_outer = {radius, 0.0, 0.0, 0.0};
-    m_light_count_ubdata.lightCount++;
+    LightParams &light = m_lights.emplace_back();
+    light.color_intensity = {color, luminous_intensity};
+    light.position_type = {position, static_cast<f32>(LightType::POINT_LIGHT)};
+    light.radius_inner_outer = {radius, 0.0, 0.0, 0.0};
 }
 
 void Scene::AddSpotLight(Math::vec3 color, f32 intensity, Math::vec3 direction, Math::vec3 position, f32 radius,
                          f32 innerConeAngle, f32 outerConeAngle) noexcept {
-    if (m_light_count_ubdata.lightCount >= MAX_LIGHT_COUNT) {
-        LOG_WARN("light count cannot more than {}", MAX_LIGHT_COUNT);
-        return;
-    };
     f32 cos_outer = Math::cos(std::clamp(std::abs(outerConeAngle), 0.5f * Math::radians(0.5f), Math::two_pi<f32>()));
     f32 cos_outer2 = Math::sqrt(cos_outer * cos_outer);
     f32 luminous_intensity = intensity / Math::one_over_two_pi<f32>() / (1.0f - cos_outer2);
 
-    m_lights_ubdata.lights[m_light_count_ubdata.lightCount].color_intensity = {color, luminous_intensity};
-    m_lights_ubdata.lights[m_light_count_ubdata.lightCount].direction = {direction, 0.0};
-    m_lights_ubdata.lights[m_light_count_ubdata.lightCount].position_type = {position,
-                                                                             static_cast<f32>(LightType::SPOT_LIGHT)};
-    m_lights_ubdata.lights[m_light_count_ubdata.lightCount].radius_inner_outer = {radius, innerConeAngle,
-                                                                                  outerConeAngle, 0.0};
-    m_light_count_ubdata.lightCount++;
+    LightParams &light = m_lights.emplace_back();
+    light.color_intensity = {color, luminous_intensity};
+    light.direction = {direction, 0.0};
+    light.position_type = {position, static_cast<f32>(LightType::SPOT_LIGHT)};
+    light.radius_inner_outer = {radius, innerConeAngle, outerConeAngle, 0.0};
 }
 
 void Scene::Prepare() noexcept {
+    PROFILE_SCOPE("Scene::Prepare");
     // update scene descriptorset
 
     // update Ub data
@@ -102,12 +123,11 @@ void Scene::Prepare() noexcept {
 
     m_camera_ubdata.camera_pos = m_camera->GetPosition();
     m_camera_ubdata.camera_forward_dir = m_camera->GetForwardDir();
+    m_camera_ubdata.inv_view_projection = m_camera->GetInvViewProjectionMatrix();
     m_camera_ub->update(&m_camera_ubdata, sizeof(CamaeraUb));
 
-    m_light_count_ub->update(&m_light_count_ubdata, sizeof(LightCountUb));
-    m_light_ub->update(&m_lights_ubdata, m_light_count_ubdata.lightCount > 0
-                                             ? sizeof(LightParams) * m_light_count_ubdata.lightCount
-                                             : sizeof(LightParams));
+    m_clustered_lights->Update(m_command_buffer->GetCurrentFrame(), m_lights, m_scene_ubdata.view,
+                               m_scene_ubdata.projection, m_scene_ubdata.nearFar);
 
     DescriptorSetUpdateDesc desc;
     desc.BindResource(0, m_scene_ub);
@@ -120,17 +140,143 @@ void Scene::Prepare() noexcept {
     // update material&mesh descriptorset
     for (auto &model : m_models) {
         model.second->UpdateModelMatrix();
-        model.second->UpdateDescriptors();
+        if (!m_material_table) {
+            model.second->UpdateDescriptors();
+        }
+    }
+    if (m_material_table) {
+        m_material_table->Update();
+    }
+
+    if (m_indirect_draw_list) {
+        auto begin = std::chrono::steady_clock::now();
+        m_indirect_draw_list->Begin(m_command_buffer->GetCurrentFrame());
+        for (auto &model : m_models) {
+            model.second->GatherInstances(*m_indirect_draw_list);
+        }
+        m_indirect_draw_list->End();
+        m_draw_stats.gather_us +=
+            std::chrono::duration<f64, std::micro>(std::chrono::steady_clock::now() - begin).count();
     }
 }
 
 void Scene::Draw(u32 _i, std::shared_ptr<CommandBuffer> _command_buffer, std::shared_ptr<Pipeline> _pipeline) noexcept {
+    if (m_indirect_draw_list) {
+        DrawIndirect(_i, _command_buffer, _pipeline);
+        return;
+    }
 
-    _command_buffer->beginRenderPass(_i, _pipeline);
+    u32 instance_count = 0;
     for (auto &model : m_models) {
-        model.second->Draw(_pipeline, _command_buffer->Get(_i));
+        instance_count += model.second->GetInstanceCount();
     }
+    u32 thread_count = GetRecordingThreadCount(instance_count);
+
+    auto begin = std::chrono::steady_clock::now();
+    VkDescriptorSet material_table = m_material_table ? m_material_table->GetDescriptorSet() : VK_NULL_HANDLE;
+    u32 draws = 0;
+    if (thread_count > 1) {
+        draws = DrawParallel(_i, _command_buffer, _pipeline, material_table, instance_count, thread_count);
+    } else {
+        _command_buffer->beginRenderPass(_i, _pipeline);
+        for (auto &model : m_models) {
+            draws += model.second->Draw(_pipeline, _command_buffer->Get(_i), material_table);
+        }
+        _command_buffer->endRenderPass(_i);
+    }
+    PROFILE_COUNTER("geometry draws", draws);
+    m_draw_stats.draws += draws;
+    m_draw_stats.record_us += std::chrono::duration<f64, std::micro>(std::chrono::steady_clock::now() - begin).count();
+    m_draw_stats.threads += thread_count;
+
+    if (++m_draw_stats.frames == DRAW_STATS_INTERVAL) {
+        LOG_INFO("geometry pass ({}, {:.1f} threads): {} draws, {:.1f} us recording, {:.3f} us per draw",
+                 m_material_table ? "bindless" : "bound",
+                 static_cast<f64>(m_draw_stats.threads) / m_draw_stats.frames, m_draw_stats.draws / m_draw_stats.frames,
+                 m_draw_stats.record_us / m_draw_stats.frames,
+                 m_draw_stats.draws ? m_draw_stats.record_us / m_draw_stats.draws : 0.0);
+        m_draw_stats = DrawStats{};
+    }
+}
+
+u32 Scene::GetRecordingThreadCount(u32 instance_count) const noexcept {
+    u32 slot_count = m_command_buffer->GetRecordingSlotCount();
+    if (m_recording_thread_count) {
+        return std::clamp(std::min(m_recording_thread_count, instance_count), 1u, slot_count);
+    }
+    return std::clamp(instance_count / MIN_INSTANCES_PER_RECORDING_THREAD, 1u, slot_count);
+}
+
+u32 Scene::DrawParallel(u32 _i, std::shared_ptr<CommandBuffer> _command_buffer, std::shared_ptr<Pipeline> _pipeline,
+                        VkDescriptorSet material_table, u32 instance_count, u32 thread_count) noexcept {
+    // begun first so the framebuffer exists before the threads read it for their inheritance info
+    _command_buffer->beginRenderPass(_i, _pipeline, false, true);
+
+    std::vector<VkCommandBuffer> secondaries(thread_count);
+    std::vector<u32> draw_counts(thread_count, 0);
+    // one index per thread, ParallelFor hands every index to a single thread so each recording slot has one owner
+    ThreadPool::GetInstance().ParallelFor(thread_count, 1, [&](u64 begin, u64 end) {
+        for (u64 t = begin; t < end; t++) {
+            PROFILE_SCOPE("Scene::RecordSecondary");
+            u32 first = static_cast<u32>(static_cast<u64>(instance_count) * t / thread_count);
+            u32 last = static_cast<u32>(static_cast<u64>(instance_count) * (t + 1) / thread_count);
+            VkCommandBuffer command_buffer = _command_buffer->BeginSecondary(_i, static_cast<u32>(t), _pipeline);
+            u32 offset = 0;
+            for (auto &model : m_models) {
+                u32 count = model.second->GetInstanceCount();
+                u32 model_first = std::max(first, offset);
+                u32 model_last = std::min(last, offset + count);
+                if (model_first < model_last) {
+                    draw_counts[t] += model.second->Draw(_pipeline, command_buffer, material_table,
+                                                         model_first - offset, model_last - model_first);
+                }
+                offset += count;
+            }
+            _command_buffer->EndSecondary(command_buffer);
+            secondaries[t] = command_buffer;
+        }
+    });
+
+    vkCmdExecuteCommands(_command_buffer->Get(_i), thread_count, secondaries.data());
+    _command_buffer->endRenderPass(_i);
+
+    u32 draw_count = 0;
+    for (u32 count : draw_counts) {
+        draw_count += count;
+    }
+    return draw_count;
+}
+
+void Scene::DrawIndirect(u32 _i, std::shared_ptr<CommandBuffer> _command_buffer,
+                         std::shared_ptr<Pipeline> _pipeline) noexcept {
+    auto begin = std::chrono::steady_clock::now();
+    // culling runs before the render pass, the draws below consume its commands
+    m_indirect_draw_list->Cull(_i, m_scene_ubdata.projection * m_scene_ubdata.view);
+
+    _command_buffer->beginRenderPass(_i, _pipeline);
+    VkCommandBuffer command_buffer = _command_buffer->Get(_i);
+    std::array<VkDescriptorSet, 2> descriptors{m_scene_descriptor_set->Get(), m_material_table->GetDescriptorSet()};
+    std::vector<u32> dynamic_offsets;
+    m_scene_descriptor_set->GetDynamicOffsets(dynamic_offsets);
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipeline->GetLayout(), 0,
+                            descriptors.size(), descriptors.data(), dynamic_offsets.size(), dynamic_offsets.data());
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipeline->Get());
+    m_draw_stats.draws += m_indirect_draw_list->Draw(_i, command_buffer, _pipeline->GetLayout(), 2);
     _command_buffer->endRenderPass(_i);
+    m_draw_stats.record_us += std::chrono::duration<f64, std::micro>(std::chrono::steady_clock::now() - begin).count();
+    m_draw_stats.instances += m_indirect_draw_list->GetInstanceCount();
+    m_draw_stats.visible += m_indirect_draw_list->GetVisibleCount();
+
+    if (++m_draw_stats.frames == DRAW_STATS_INTERVAL) {
+        // visible counts lag MAX_FRAMES_IN_FLIGHT frames behind, they are read back once a frame slot retires
+        LOG_INFO("geometry pass (gpu driven{}): {} instances, {} visible, {} indirect draws, {:.1f} us gathering, "
+                 "{:.1f} us recording",
+                 m_indirect_draw_list->IsCompacted() ? "" : ", uncompacted",
+                 m_draw_stats.instances / m_draw_stats.frames, m_draw_stats.visible / m_draw_stats.frames,
+                 m_draw_stats.draws / m_draw_stats.frames, m_draw_stats.gather_us / m_draw_stats.frames,
+                 m_draw_stats.record_us / m_draw_stats.frames);
+        m_draw_stats = DrawStats{};
+    }
 }
 
 std::shared_ptr<DescriptorSetLayouts> Scene::GetDescriptorLayouts() const noexcept {
@@ -154,6 +300,15 @@ std::shared_ptr<DescriptorSetLayouts> Scene::GetDescriptorLayouts() const noexce
 
 std::shared_ptr<DescriptorSetLayouts> Scene::GetGeometryPassDescriptorLayouts() const noexcept {
     std::shared_ptr<DescriptorSetLayouts> layouts = std::make_shared<DescriptorSetLayouts>();
+    if (m_indirect_draw_list) {
+        layouts->layouts = {{m_scene_descriptor_set->GetLayout(), m_material_table->GetLayout(),
+                             m_indirect_draw_list->GetLayout()}};
+        return layouts;
+    }
+    if (m_material_table) {
+        layouts->layouts = {{m_scene_descriptor_set->GetLayout(), m_material_table->GetLayout()}};
+        return layouts;
+    }
     VkDescriptorSetLayout materialSetLayout = VK_NULL_HANDLE;
     for (auto &model : m_models) {
         if (model.second->GetMaterialDescriptorSet()) {
@@ -200,11 +355,14 @@ void FullscreenTriangle::Draw(u32 _i, std::shared_ptr<CommandBuffer> _command_bu
 
     if (!_descriptor_sets.empty()) {
         std::vector<VkDescriptorSet> descriptor_sets(_descriptor_sets.size());
+        std::vector<u32> dynamic_offsets;
         for (u32 i = 0; i < _descriptor_sets.size(); i++) {
             descriptor_sets[i] = _descriptor_sets[i]->Get();
+            _descriptor_sets[i]->GetDynamicOffsets(dynamic_offsets);
         }
         vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipeline->GetLayout(), 0,
-                                descriptor_sets.size(), descriptor_sets.data(), 0, 0);
+                                descriptor_sets.size(), descriptor_sets.data(), dynamic_offsets.size(),
+                                dynamic_offsets.data());
     }
 
     vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipeline->Get());
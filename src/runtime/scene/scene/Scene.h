@@ -8,13 +8,14 @@
 #include <runtime/function/rhi/vulkan/Descriptors.h>
 #include <runtime/function/rhi/vulkan/Device.h>
 #include <runtime/scene/camera/Camera.h>
+#include <runtime/scene/light/ClusteredLights.h>
 #include <runtime/scene/light/Light.h>
+#include <runtime/scene/material/MaterialTable.h>
 #include <runtime/scene/model/Model.h>
+#include <runtime/scene/scene/IndirectDrawList.h>
 
 namespace Horizon {
 
-#define MAX_LIGHT_COUNT 1024
-
 class Scene {
   public:
     Scene(RenderContext &render_context, const std::shared_ptr<Device> &device,
@@ -37,17 +38,49 @@ class Scene {
     std::shared_ptr<DescriptorSetLayouts> GetSceneDescriptorLayouts() const noexcept;
     std::shared_ptr<Camera> GetMainCamera() const noexcept;
     std::shared_ptr<UniformBuffer> getCameraUbo() const noexcept;
+    // materials are drawn through the bindless material table instead of a descriptor set per material
+    bool IsBindless() const noexcept { return m_material_table != nullptr; }
+    // geometry is culled on the gpu and drawn with indirect draws, implies bindless
+    bool IsGpuDriven() const noexcept { return m_indirect_draw_list != nullptr; }
+    // threads recording the geometry pass into secondary command buffers, 0 picks a count from the number of model
+    // instances. not used when the geometry is gpu driven
+    void SetRecordingThreadCount(u32 thread_count) noexcept { m_recording_thread_count = thread_count; }
+    // lights of the scene, binned into view space clusters before the light pass
+    std::shared_ptr<ClusteredLights> GetClusteredLights() const noexcept { return m_clustered_lights; }
 
-    std::shared_ptr<UniformBuffer> m_light_count_ub;
-    std::shared_ptr<UniformBuffer> m_light_ub;
     std::shared_ptr<UniformBuffer> m_camera_ub;
 
+  private:
+    void DrawIndirect(u32 i, std::shared_ptr<CommandBuffer> command_buffer,
+                      std::shared_ptr<Pipeline> pipeline) noexcept;
+    // records contiguous ranges of the model instances on the thread pool and executes them from the primary
+    u32 DrawParallel(u32 i, std::shared_ptr<CommandBuffer> command_buffer, std::shared_ptr<Pipeline> pipeline,
+                     VkDescriptorSet material_table, u32 instance_count, u32 thread_count) noexcept;
+    u32 GetRecordingThreadCount(u32 instance_count) const noexcept;
+
   private:
     RenderContext &m_render_context;
     std::shared_ptr<Camera> m_camera = nullptr;
     std::shared_ptr<Device> m_device;
     std::shared_ptr<CommandBuffer> m_command_buffer;
     std::shared_ptr<DescriptorSet> m_scene_descriptor_set = nullptr;
+    std::shared_ptr<MaterialTable> m_material_table = nullptr;
+    std::shared_ptr<IndirectDrawList> m_indirect_draw_list = nullptr;
+    std::shared_ptr<ClusteredLights> m_clustered_lights = nullptr;
+    std::vector<LightParams> m_lights;
+    u32 m_recording_thread_count = 0;
+
+    // geometry pass recording cost, averaged and logged periodically
+    struct DrawStats {
+        f64 record_us = 0.0;
+        u64 draws = 0;
+        u64 threads = 0;
+        // gpu driven only
+        f64 gather_us = 0.0;
+        u64 instances = 0;
+        u64 visible = 0;
+        u32 frames = 0;
+    } m_draw_stats;
 
     // uniform buffers
 
@@ -58,22 +91,15 @@ class Scene {
         Math::vec2 nearFar;
     } m_scene_ubdata;
     std::shared_ptr<UniformBuffer> m_scene_ub = nullptr;
-    // 1
-    struct LightCountUb {
-        u32 lightCount = 0;
-    } m_light_count_ubdata;
-
-    // 2
-    struct LightsUb {
-        LightParams lights[MAX_LIGHT_COUNT];
-    } m_lights_ubdata;
 
-    // 3
+    // 1
     struct CamaeraUb {
         Math::vec3 camera_pos;
         f32 pad0;
         Math::vec3 camera_forward_dir;
         f32 pad1;
+        // reconstructs world positions from the depth buffer in the light pass
+        Math::mat4 inv_view_projection;
     } m_camera_ubdata;
 
     // models
@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <runtime/core/log/Log.h>
+#include <runtime/core/thread/ThreadPool.h>
+#include <runtime/scene/render/AtmosphereLuts.h>
+#include <runtime/scene/render/AtmosphereReference.h>
+
+using namespace Horizon;
+
+namespace {
+
+struct LutError {
+    f64 max_abs = 0.0;
+    f64 mean_abs = 0.0;
+    f64 max_rel = 0.0;
+};
+
+// relative error is taken against max(|reference|, 1e-3 * largest reference value) so texels that are close to
+// zero, like the night side of the scattering lut, do not dominate it
+LutError Compare(const AtmosphereTexture &lut, const AtmosphereTexture &reference) noexcept {
+    f64 largest = 0.0;
+    for (const Math::vec4 &texel : reference.texels) {
+        for (u32 c = 0; c < 4; c++) {
+            largest = std::max(largest, static_cast<f64>(std::abs(texel[c])));
+        }
+    }
+    f64 floor = std::max(largest * 1e-3, 1e-12);
+
+    LutError error;
+    for (u64 i = 0; i < lut.texels.size(); i++) {
+        for (u32 c = 0; c < 4; c++) {
+            f64 value = lut.texels[i][c], expected = reference.texels[i][c];
+            f64 diff = std::abs(value - expected);
+            error.max_abs = std::max(error.max_abs, diff);
+            error.mean_abs += diff;
+            error.max_rel = std::max(error.max_rel, diff / std::max(std::abs(expected), floor));
+        }
+    }
+    error.mean_abs /= static_cast<f64>(std::max<u64>(lut.texels.size() * 4, 1));
+    return error;
+}
+
+} // namespace
+
+// bakes the atmosphere luts on the cpu.
+//   --out <file>      where to write the luts, atmosphere.luts by default
+//   --compare <file>  lut file to report the error against, e.g. luts read back from the gpu
+//   --orders <n>      multiple scattering orders after the single scattering, 3 like the renderer
+int main(int argc, char *argv[]) {
+    std::string out_path = "atmosphere.luts";
+    std::string compare_path;
+    u32 orders = 3;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--out") == 0) {
+            out_path = argv[++i];
+        } else if (strcmp(argv[i], "--compare") == 0) {
+            compare_path = argv[++i];
+        } else if (strcmp(argv[i], "--orders") == 0) {
+            orders = static_cast<u32>(std::max(0, atoi(argv[++i])));
+        }
+    }
+
+    AtmosphereParameters atmosphere = GetDefaultAtmosphereParameters();
+    AtmosphereReference reference(atmosphere, orders);
+    AtmosphereLuts luts;
+
+    LOG_INFO("baking atmosphere luts on {} threads, {} multiple scattering orders",
+             ThreadPool::GetInstance().GetWorkerCount() + 1, orders);
+    reference.Precompute(luts);
+
+    // per pass, then per lut the passes write into
+    f64 transmittance_ms = 0.0, irradiance_ms = 0.0, scattering_ms = 0.0, total_ms = 0.0;
+    for (const auto &timing : reference.GetTimings()) {
+        LOG_INFO("{:<24} {:10.1f} ms", timing.name, timing.ms);
+        if (timing.name == "transmittance") {
+            transmittance_ms += timing.ms;
+        } else if (timing.name.find("irradiance") != std::string::npos) {
+            irradiance_ms += timing.ms;
+        } else {
+            scattering_ms += timing.ms;
+        }
+        total_ms += timing.ms;
+    }
+    LOG_INFO("transmittance lut {:.1f} ms, irradiance lut {:.1f} ms, scattering lut {:.1f} ms, total {:.1f} ms",
+             transmittance_ms, irradiance_ms, scattering_ms, total_ms);
+
+    if (!luts.Write(out_path, HashAtmosphereParameters(atmosphere))) {
+        LOG_ERROR("failed to write {}", out_path);
+        return 1;
+    }
+    LOG_INFO("luts written to {}", out_path);
+
+    if (!compare_path.empty()) {
+        AtmosphereLuts expected;
+        if (!expected.Read(compare_path, 0)) {
+            LOG_ERROR("failed to read {}", compare_path);
+            return 1;
+        }
+        const char *names[3] = {"transmittance", "irradiance", "scattering"};
+        const AtmosphereTexture *computed_luts[3] = {&luts.transmittance, &luts.irradiance, &luts.scattering};
+        const AtmosphereTexture *expected_luts[3] = {&expected.transmittance, &expected.irradiance,
+                                                     &expected.scattering};
+        for (u32 i = 0; i < 3; i++) {
+            LutError error = Compare(*computed_luts[i], *expected_luts[i]);
+            LOG_INFO("{:<14} max abs {:.3e}, mean abs {:.3e}, max rel {:.3e}", names[i], error.max_abs,
+                     error.mean_abs, error.max_rel);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,317 @@
+#include "SceneGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <vector>
+
+#include <stb_image_write.h>
+#include <tiny_gltf.h>
+
+#include <runtime/core/log/Log.h>
+#include <runtime/scene/scene/Scene.h>
+
+namespace Horizon {
+
+namespace {
+
+// surface height the default scene stands on
+constexpr f32 GROUND_HEIGHT = 6370.0f;
+constexpr f32 MIN_RADIUS = 0.2f;
+constexpr f32 MAX_RADIUS = 0.5f;
+// a child sits this far above its parent
+constexpr f32 CHILD_OFFSET = 1.2f;
+constexpr f32 CHILD_SCALE = 0.9f;
+constexpr u32 CHECKER_CELLS = 8;
+constexpr i32 FLAT_TEXTURE_SIZE = 4;
+
+// the std distributions differ between standard libraries, the generator itself does not
+f32 Uniform(std::mt19937 &rng, f32 lo, f32 hi) noexcept {
+    return lo + (hi - lo) * static_cast<f32>(rng() >> 8) * (1.0f / 16777216.0f);
+}
+
+template <typename T> size_t Append(std::vector<unsigned char> &data, const std::vector<T> &values) noexcept {
+    size_t offset = data.size();
+    data.resize(offset + values.size() * sizeof(T));
+    memcpy(data.data() + offset, values.data(), values.size() * sizeof(T));
+    return offset;
+}
+
+u32 GetRootCount(const SceneConfig &config) noexcept {
+    return (config.primitive_count + config.hierarchy_depth - 1) / config.hierarchy_depth;
+}
+
+// the roots of a model stand on a ring wide enough to keep their spheres apart
+f32 GetRingRadius(u32 root_count) noexcept {
+    return std::max(1.0f, static_cast<f32>(root_count) * 1.2f * MAX_RADIUS / Math::pi<f32>());
+}
+
+bool WritePng(const std::string &path, i32 size, const std::vector<u8> &pixels) noexcept {
+    if (!stbi_write_png(path.c_str(), size, size, 4, pixels.data(), size * 4)) {
+        LOG_ERROR("failed to write {}", path);
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+SceneGenerator::SceneGenerator(const SceneConfig &config, const std::string &directory) noexcept
+    : m_config(config), m_directory(directory), m_center(0.0f, GROUND_HEIGHT, 0.0f) {
+    m_config.model_count = std::max(m_config.model_count, 1u);
+    m_config.instance_count = std::max(m_config.instance_count, 1u);
+    m_config.primitive_count = std::max(m_config.primitive_count, 1u);
+    m_config.sphere_segments = std::max(m_config.sphere_segments, 4u);
+    m_config.hierarchy_depth = std::max(m_config.hierarchy_depth, 1u);
+    m_config.texture_count = std::max(m_config.texture_count, 1u);
+    m_config.texture_size = std::max(m_config.texture_size, CHECKER_CELLS);
+
+    u32 side = static_cast<u32>(
+        std::ceil(std::sqrt(static_cast<f32>(m_config.model_count) * static_cast<f32>(m_config.instance_count))));
+    m_spacing = 2.0f * (GetRingRadius(GetRootCount(m_config)) + MAX_RADIUS) + 1.0f;
+    m_extent = 0.5f * static_cast<f32>(side) * m_spacing;
+}
+
+std::string SceneGenerator::GetModelPath(u32 index) const noexcept {
+    // only what changes the files is in the name, scenes that differ in counts and lights share their models
+    std::string name = fmt::format("model{}_p{}_s{}_d{}_t{}x{}_seed{}", index, m_config.primitive_count,
+                                   m_config.sphere_segments, m_config.hierarchy_depth, m_config.texture_count,
+                                   m_config.texture_size, m_config.seed);
+    return (std::filesystem::path(m_directory) / name / "model.gltf").string();
+}
+
+bool SceneGenerator::Populate(Scene &scene) noexcept {
+    for (u32 i = 0; i < m_config.model_count; i++) {
+        std::string path = GetModelPath(i);
+        if (!std::filesystem::exists(path) && !WriteModel(i, path)) {
+            return false;
+        }
+        std::string name = fmt::format("benchmark{}", i);
+        scene.LoadModel(path, name);
+        auto model = scene.GetModel(name);
+        model->SetModelMatrix(Math::translate(Math::mat4(1.0f), m_center));
+        model->UpdateModelMatrix();
+    }
+
+    // placement and lights only depend on the seed, the models take turns on the grid so every model is spread
+    // over the whole scene
+    std::seed_seq seed{m_config.seed};
+    std::mt19937 rng(seed);
+    u32 object_count = m_config.model_count * m_config.instance_count;
+    u32 side = static_cast<u32>(std::ceil(std::sqrt(static_cast<f32>(object_count))));
+    std::vector<std::vector<Math::mat4>> instances(m_config.model_count);
+    for (u32 i = 0; i < object_count; i++) {
+        Math::vec3 offset((static_cast<f32>(i % side) - 0.5f * (side - 1)) * m_spacing, 0.0f,
+                          (static_cast<f32>(i / side) - 0.5f * (side - 1)) * m_spacing);
+        f32 yaw = Uniform(rng, 0.0f, Math::two_pi<f32>());
+        Math::mat4 rotation = Math::rotate(Math::mat4(1.0f), yaw, Math::vec3(0.0f, 1.0f, 0.0f));
+        instances[i % m_config.model_count].push_back(Math::translate(Math::mat4(1.0f), offset) * rotation);
+    }
+    for (u32 i = 0; i < m_config.model_count; i++) {
+        scene.GetModel(fmt::format("benchmark{}", i))->SetInstances(instances[i]);
+    }
+
+    // the sun of the renderer's default scene, which the benchmark does not load
+    scene.AddDirectLight(Math::vec3(1.0f), 1.0f, Math::normalize(Math::vec3(0.0f, -1.0f, -1.0f)));
+
+    // sunflower spiral over the grid, about the same number of lights reaches every part of it
+    constexpr f32 golden_angle = 2.39996323f;
+    for (u32 i = 0; i < m_config.light_count; i++) {
+        f32 r = m_extent * std::sqrt((static_cast<f32>(i) + 0.5f) / static_cast<f32>(m_config.light_count));
+        f32 theta = golden_angle * static_cast<f32>(i);
+        Math::vec3 position = m_center + Math::vec3(r * std::cos(theta), Uniform(rng, 1.0f, 4.0f), r * std::sin(theta));
+        Math::vec3 color(Uniform(rng, 0.2f, 1.0f), Uniform(rng, 0.2f, 1.0f), Uniform(rng, 0.2f, 1.0f));
+        scene.AddPointLight(color, 100.0f, position, 1.5f * m_spacing);
+    }
+
+    LOG_INFO("benchmark scene: {} models, {} instances, {} primitives per model, {} lights", m_config.model_count,
+             object_count, m_config.primitive_count, m_config.light_count);
+    return true;
+}
+
+bool SceneGenerator::WriteModel(u32 index, const std::string &path) const noexcept {
+    std::filesystem::path directory = std::filesystem::path(path).parent_path();
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    if (ec) {
+        LOG_ERROR("failed to create {}: {}", directory.string(), ec.message());
+        return false;
+    }
+
+    std::seed_seq seed{m_config.seed, index + 1};
+    std::mt19937 rng(seed);
+    tinygltf::Model model;
+    model.asset.version = "2.0";
+    model.asset.generator = "horizon frame_benchmark";
+
+    // checkers in random colors, then a flat normal and metallic roughness texture shared by all materials
+    u32 size = m_config.texture_size;
+    for (u32 t = 0; t < m_config.texture_count; t++) {
+        u8 color[3], dark[3];
+        for (u32 c = 0; c < 3; c++) {
+            color[c] = static_cast<u8>(Uniform(rng, 64.0f, 255.0f));
+            dark[c] = color[c] / 2;
+        }
+        std::vector<u8> pixels(size * size * 4);
+        u32 cell = size / CHECKER_CELLS;
+        for (u32 y = 0; y < size; y++) {
+            for (u32 x = 0; x < size; x++) {
+                const u8 *texel = ((x / cell + y / cell) % 2) ? dark : color;
+                memcpy(&pixels[(y * size + x) * 4], texel, 3);
+                pixels[(y * size + x) * 4 + 3] = 255;
+            }
+        }
+        std::string uri = fmt::format("base_color{}.png", t);
+        if (!WritePng((directory / uri).string(), static_cast<i32>(size), pixels)) {
+            return false;
+        }
+        tinygltf::Image image;
+        image.uri = uri;
+        model.images.push_back(image);
+    }
+    const u8 flat_normal[4] = {128, 128, 255, 255};
+    const u8 flat_metallic_roughness[4] = {0, 160, 0, 255};
+    for (const u8 *texel : {flat_normal, flat_metallic_roughness}) {
+        std::vector<u8> pixels(FLAT_TEXTURE_SIZE * FLAT_TEXTURE_SIZE * 4);
+        for (size_t i = 0; i < pixels.size(); i += 4) {
+            memcpy(&pixels[i], texel, 4);
+        }
+        std::string uri = texel == flat_normal ? "normal.png" : "metallic_roughness.png";
+        if (!WritePng((directory / uri).string(), FLAT_TEXTURE_SIZE, pixels)) {
+            return false;
+        }
+        tinygltf::Image image;
+        image.uri = uri;
+        model.images.push_back(image);
+    }
+    for (u32 i = 0; i < model.images.size(); i++) {
+        tinygltf::Texture texture;
+        texture.source = static_cast<int>(i);
+        model.textures.push_back(texture);
+    }
+    for (u32 t = 0; t < m_config.texture_count; t++) {
+        tinygltf::Material material;
+        material.name = fmt::format("material{}", t);
+        material.pbrMetallicRoughness.baseColorTexture.index = static_cast<int>(t);
+        material.normalTexture.index = static_cast<int>(m_config.texture_count);
+        material.pbrMetallicRoughness.metallicRoughnessTexture.index = static_cast<int>(m_config.texture_count + 1);
+        model.materials.push_back(material);
+    }
+
+    // uv spheres of random radius, all vertices of an attribute in one buffer view and every primitive an accessor
+    // range of it
+    std::vector<f32> positions, normals, uvs;
+    std::vector<u32> indices;
+    u32 segments = m_config.sphere_segments;
+    u32 rings = segments / 2;
+    u32 vertex_count = (rings + 1) * (segments + 1);
+    u32 index_count = rings * segments * 6;
+    for (u32 p = 0; p < m_config.primitive_count; p++) {
+        f32 radius = Uniform(rng, MIN_RADIUS, MAX_RADIUS);
+        for (u32 ring = 0; ring <= rings; ring++) {
+            f32 phi = Math::pi<f32>() * static_cast<f32>(ring) / static_cast<f32>(rings);
+            for (u32 s = 0; s <= segments; s++) {
+                f32 theta = Math::two_pi<f32>() * static_cast<f32>(s) / static_cast<f32>(segments);
+                Math::vec3 n(std::sin(phi) * std::cos(theta), std::cos(phi), std::sin(phi) * std::sin(theta));
+                positions.insert(positions.end(), {n.x * radius, n.y * radius, n.z * radius});
+                normals.insert(normals.end(), {n.x, n.y, n.z});
+                uvs.insert(uvs.end(), {static_cast<f32>(s) / segments, static_cast<f32>(ring) / rings});
+            }
+        }
+        // counter clockwise seen from outside
+        for (u32 ring = 0; ring < rings; ring++) {
+            for (u32 s = 0; s < segments; s++) {
+                u32 a = ring * (segments + 1) + s, b = a + segments + 1;
+                indices.insert(indices.end(), {a, a + 1, b, a + 1, b + 1, b});
+            }
+        }
+
+        std::vector<double> bounds_min = {-radius, -radius, -radius}, bounds_max = {radius, radius, radius};
+        size_t first_vertex = static_cast<size_t>(p) * vertex_count;
+        int base = static_cast<int>(model.accessors.size());
+        for (u32 view = 0; view < 3; view++) {
+            tinygltf::Accessor accessor;
+            accessor.bufferView = static_cast<int>(view);
+            accessor.byteOffset = first_vertex * (view == 2 ? 2 : 3) * sizeof(f32);
+            accessor.componentType = TINYGLTF_COMPONENT_TYPE_FLOAT;
+            accessor.count = vertex_count;
+            accessor.type = view == 2 ? TINYGLTF_TYPE_VEC2 : TINYGLTF_TYPE_VEC3;
+            if (view == 0) {
+                accessor.minValues = bounds_min;
+                accessor.maxValues = bounds_max;
+            }
+            model.accessors.push_back(accessor);
+        }
+        tinygltf::Accessor index_accessor;
+        index_accessor.bufferView = 3;
+        index_accessor.byteOffset = static_cast<size_t>(p) * index_count * sizeof(u32);
+        index_accessor.componentType = TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT;
+        index_accessor.count = index_count;
+        index_accessor.type = TINYGLTF_TYPE_SCALAR;
+        model.accessors.push_back(index_accessor);
+
+        tinygltf::Primitive primitive;
+        primitive.attributes["POSITION"] = base;
+        primitive.attributes["NORMAL"] = base + 1;
+        primitive.attributes["TEXCOORD_0"] = base + 2;
+        primitive.indices = base + 3;
+        primitive.material = static_cast<int>(p % m_config.texture_count);
+        primitive.mode = TINYGLTF_MODE_TRIANGLES;
+        tinygltf::Mesh mesh;
+        mesh.primitives.push_back(primitive);
+        model.meshes.push_back(mesh);
+    }
+
+    tinygltf::Buffer buffer;
+    buffer.uri = "model.bin";
+    size_t offsets[4] = {Append(buffer.data, positions), Append(buffer.data, normals), Append(buffer.data, uvs),
+                         Append(buffer.data, indices)};
+    size_t lengths[4] = {positions.size() * sizeof(f32), normals.size() * sizeof(f32), uvs.size() * sizeof(f32),
+                         indices.size() * sizeof(u32)};
+    for (u32 view = 0; view < 4; view++) {
+        tinygltf::BufferView buffer_view;
+        buffer_view.buffer = 0;
+        buffer_view.byteOffset = offsets[view];
+        buffer_view.byteLength = lengths[view];
+        buffer_view.target = view == 3 ? TINYGLTF_TARGET_ELEMENT_ARRAY_BUFFER : TINYGLTF_TARGET_ARRAY_BUFFER;
+        model.bufferViews.push_back(buffer_view);
+    }
+    model.buffers.push_back(buffer);
+
+    // chains of hierarchy_depth nodes, each child a little above its parent, turned and scaled so the world
+    // transforms of a chain compound
+    u32 root_count = GetRootCount(m_config);
+    f32 ring_radius = GetRingRadius(root_count);
+    tinygltf::Scene gltf_scene;
+    for (u32 p = 0; p < m_config.primitive_count; p++) {
+        tinygltf::Node node;
+        node.mesh = static_cast<int>(p);
+        u32 chain = p / m_config.hierarchy_depth;
+        if (p % m_config.hierarchy_depth == 0) {
+            f32 angle = Math::two_pi<f32>() * static_cast<f32>(chain) / static_cast<f32>(root_count);
+            node.translation = {ring_radius * std::cos(angle), MAX_RADIUS, ring_radius * std::sin(angle)};
+            gltf_scene.nodes.push_back(static_cast<int>(p));
+        } else {
+            f32 yaw = Uniform(rng, 0.0f, Math::two_pi<f32>());
+            node.translation = {Uniform(rng, -0.2f, 0.2f), CHILD_OFFSET, Uniform(rng, -0.2f, 0.2f)};
+            node.rotation = {0.0, std::sin(0.5f * yaw), 0.0, std::cos(0.5f * yaw)};
+            node.scale = {CHILD_SCALE, CHILD_SCALE, CHILD_SCALE};
+            model.nodes[p - 1].children.push_back(static_cast<int>(p));
+        }
+        model.nodes.push_back(node);
+    }
+    model.scenes.push_back(gltf_scene);
+    model.defaultScene = 0;
+
+    tinygltf::TinyGLTF gltf_context;
+    if (!gltf_context.WriteGltfSceneToFile(&model, path, false, false, true, false)) {
+        LOG_ERROR("failed to write {}", path);
+        return false;
+    }
+    LOG_INFO("generated {}", path);
+    return true;
+}
+
+} // namespace Horizon
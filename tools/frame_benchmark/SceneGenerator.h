@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+
+#include <runtime/core/math/Math.h>
+
+namespace Horizon {
+
+class Scene;
+
+// procedural benchmark scene. everything derives from the config, two runs with the same config load the same
+// geometry and textures and place them the same way
+struct SceneConfig {
+    u32 model_count = 4;
+    u32 instance_count = 16;  // per model
+    u32 primitive_count = 32; // per model, a sphere on its own node each
+    u32 sphere_segments = 16; // around the equator, half as many rings
+    u32 hierarchy_depth = 4;  // nodes from a root to the deepest child
+    u32 texture_count = 4;    // base color textures per model, at least one
+    u32 texture_size = 256;
+    u32 light_count = 64;
+    u32 seed = 1;
+};
+
+class SceneGenerator {
+  public:
+    // models are written below directory and reused by later runs with the same model parameters
+    SceneGenerator(const SceneConfig &config, const std::string &directory) noexcept;
+
+    // writes the models missing on disk, loads them with their instances and adds the lights
+    bool Populate(Scene &scene) noexcept;
+
+    // the config with out of range counts clamped, as generated
+    const SceneConfig &GetConfig() const noexcept { return m_config; }
+
+    // the instances are laid out on a square grid around the center, camera paths scale with its half width
+    Math::vec3 GetCenter() const noexcept { return m_center; }
+    f32 GetExtent() const noexcept { return m_extent; }
+
+  private:
+    std::string GetModelPath(u32 index) const noexcept;
+    bool WriteModel(u32 index, const std::string &path) const noexcept;
+
+  private:
+    SceneConfig m_config;
+    std::string m_directory;
+    Math::vec3 m_center;
+    f32 m_spacing = 0.0f;
+    f32 m_extent = 0.0f;
+};
+
+} // namespace Horizon
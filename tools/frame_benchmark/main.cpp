@@ -0,0 +1,315 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <json.hpp>
+
+#include <runtime/core/log/Log.h>
+#include <runtime/scene/render/Renderer.h>
+
+#include "SceneGenerator.h"
+
+using namespace Horizon;
+
+namespace {
+
+enum Phase : u32 { FRAME, UPDATE, RENDER, WAIT, RECORD, GPU, PHASE_COUNT };
+
+// report keys, frame is the whole loop iteration, update and render the renderer calls in it, wait and record split
+// render on the cpu, gpu is the frame's command buffer
+constexpr const char *PHASE_NAMES[PHASE_COUNT] = {"frame_ms", "update_ms", "render_ms",
+                                                   "wait_ms",  "record_ms", "gpu_ms"};
+constexpr const char *COMPARED_PERCENTILES[] = {"p50", "p95", "p99"};
+
+enum class CameraPath { ORBIT, FLYBY, STATIC };
+
+// t runs from 0 to 1 over the measured frames
+void PlaceCamera(Camera &camera, CameraPath path, f32 t, Math::vec3 center, f32 extent) noexcept {
+    switch (path) {
+    case CameraPath::ORBIT: {
+        // once around the grid, looking down on it from outside
+        f32 angle = Math::two_pi<f32>() * t, radius = extent + 10.0f;
+        camera.SetLookAt(center + Math::vec3(radius * std::sin(angle), 0.4f * radius, radius * std::cos(angle)),
+                         center);
+        break;
+    }
+    case CameraPath::FLYBY: {
+        // low across the grid, most instances are behind or beside the camera
+        Math::vec3 eye = center + Math::vec3((2.0f * t - 1.0f) * extent, 3.0f, 0.25f * extent);
+        camera.SetLookAt(eye, eye + Math::vec3(10.0f, -1.5f, 0.0f));
+        break;
+    }
+    case CameraPath::STATIC:
+        camera.SetLookAt(center + Math::vec3(0.0f, 0.5f * extent + 5.0f, extent + 10.0f), center);
+        break;
+    }
+}
+
+nlohmann::json Summarize(std::vector<f64> values) noexcept {
+    std::sort(values.begin(), values.end());
+    f64 sum = 0.0;
+    for (f64 value : values) {
+        sum += value;
+    }
+    // nearest rank
+    auto percentile = [&values](f64 p) {
+        size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * static_cast<f64>(values.size())));
+        return values[std::max<size_t>(rank, 1) - 1];
+    };
+    return {{"mean", sum / static_cast<f64>(values.size())},
+            {"p50", percentile(50.0)},
+            {"p95", percentile(95.0)},
+            {"p99", percentile(99.0)},
+            {"max", values.back()}};
+}
+
+// adds the comparison to the report and returns the number of regressed percentiles, -1 when the baseline was
+// recorded with another scene or run. a percentile regresses when it grew by more than threshold and min_delta ms
+i32 CompareBaseline(nlohmann::json &report, const std::string &path, f64 threshold, f64 min_delta) noexcept {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        LOG_ERROR("failed to open {}", path);
+        return -1;
+    }
+    nlohmann::json baseline = nlohmann::json::parse(file, nullptr, false);
+    if (baseline.is_discarded() || !baseline.contains("metrics") || !baseline.contains("scene")) {
+        LOG_ERROR("{} is not a benchmark report", path);
+        return -1;
+    }
+    if (baseline["scene"] != report["scene"] || baseline["run"] != report["run"]) {
+        LOG_ERROR("{} was recorded with another scene or run, baseline {} {}", path, baseline["scene"].dump(),
+                  baseline["run"].dump());
+        return -1;
+    }
+
+    i32 regressions = 0;
+    nlohmann::json comparison = nlohmann::json::array();
+    for (const char *phase : PHASE_NAMES) {
+        auto before_metric = baseline["metrics"].find(phase);
+        if (before_metric == baseline["metrics"].end() || !before_metric->is_object()) {
+            continue;
+        }
+        for (const char *percentile : COMPARED_PERCENTILES) {
+            f64 before = before_metric->value(percentile, 0.0);
+            f64 after = report["metrics"][phase][percentile].get<f64>();
+            // gpu times are 0 on devices without timestamps
+            if (before <= 0.0) {
+                continue;
+            }
+            f64 change = (after - before) / before;
+            bool regressed = change > threshold && after - before > min_delta;
+            if (regressed) {
+                LOG_WARN("{} {} regressed: {:.3f} ms -> {:.3f} ms ({:+.1f}%)", phase, percentile, before, after,
+                         change * 100.0);
+                regressions++;
+            } else {
+                LOG_INFO("{} {}: {:.3f} ms -> {:.3f} ms ({:+.1f}%)", phase, percentile, before, after, change * 100.0);
+            }
+            comparison.push_back({{"metric", phase},
+                                  {"percentile", percentile},
+                                  {"baseline", before},
+                                  {"current", after},
+                                  {"change", change},
+                                  {"regressed", regressed}});
+        }
+    }
+    report["baseline"] = {{"path", path}, {"threshold", threshold}, {"min_delta_ms", min_delta},
+                          {"regressions", regressions}, {"comparison", comparison}};
+    return regressions;
+}
+
+} // namespace
+
+// renders a procedural scene without a window along a scripted camera path and reports the frame time percentiles
+// of every phase as json. the scene and the path only depend on the options, so reports of two builds with the same
+// options compare.
+//   --models <n>            distinct models, 4 by default
+//   --instances <n>         instances per model, 16
+//   --primitives <n>        spheres per model, each on its own node, 32
+//   --segments <n>          sphere segments around the equator, 16
+//   --depth <n>             nodes per chain from a root to its deepest child, 4
+//   --textures <n>          base color textures per model, 4
+//   --texture-size <n>      width and height of the base color textures, 256
+//   --lights <n>            point lights over the grid, 64
+//   --seed <n>              seed of models, placement and lights, 1
+//   --scene-dir <dir>       where the generated models are written and reused from, benchmark_scene
+//   --camera <path>         orbit, flyby or static
+//   --frames <n>            measured frames, 600
+//   --warmup <n>            frames rendered before measuring, 60
+//   --width <n>, --height <n>  render resolution, 1280x720
+//   --record-threads <n>    threads recording the geometry pass, 0 lets the scene decide
+//   --output <file>         json report, frame_benchmark.json
+//   --baseline <file>       earlier report to compare the p50, p95 and p99 of every phase against
+//   --threshold <percent>   growth over the baseline that counts as a regression, 10
+//   --min-delta <ms>        growth that is always noise, 0.05
+// exits with 1 when a percentile regressed and 2 when the scene failed to build or the baseline doesn't match
+int main(int argc, char *argv[]) {
+    SceneConfig config;
+    std::string scene_dir = "benchmark_scene";
+    std::string camera_name = "orbit";
+    u32 frames = 600, warmup = 60, width = 1280, height = 720, recording_threads = 0;
+    std::string output_path = "frame_benchmark.json";
+    std::string baseline_path;
+    f64 threshold = 10.0, min_delta = 0.05;
+    for (int i = 1; i + 1 < argc; i++) {
+        auto count = [&]() { return static_cast<u32>(std::max(0, atoi(argv[++i]))); };
+        if (strcmp(argv[i], "--models") == 0) {
+            config.model_count = count();
+        } else if (strcmp(argv[i], "--instances") == 0) {
+            config.instance_count = count();
+        } else if (strcmp(argv[i], "--primitives") == 0) {
+            config.primitive_count = count();
+        } else if (strcmp(argv[i], "--segments") == 0) {
+            config.sphere_segments = count();
+        } else if (strcmp(argv[i], "--depth") == 0) {
+            config.hierarchy_depth = count();
+        } else if (strcmp(argv[i], "--textures") == 0) {
+            config.texture_count = count();
+        } else if (strcmp(argv[i], "--texture-size") == 0) {
+            config.texture_size = count();
+        } else if (strcmp(argv[i], "--lights") == 0) {
+            config.light_count = count();
+        } else if (strcmp(argv[i], "--seed") == 0) {
+            config.seed = count();
+        } else if (strcmp(argv[i], "--scene-dir") == 0) {
+            scene_dir = argv[++i];
+        } else if (strcmp(argv[i], "--camera") == 0) {
+            camera_name = argv[++i];
+        } else if (strcmp(argv[i], "--frames") == 0) {
+            frames = std::max(1u, count());
+        } else if (strcmp(argv[i], "--warmup") == 0) {
+            warmup = count();
+        } else if (strcmp(argv[i], "--width") == 0) {
+            width = std::max(1u, count());
+        } else if (strcmp(argv[i], "--height") == 0) {
+            height = std::max(1u, count());
+        } else if (strcmp(argv[i], "--record-threads") == 0) {
+            recording_threads = count();
+        } else if (strcmp(argv[i], "--output") == 0) {
+            output_path = argv[++i];
+        } else if (strcmp(argv[i], "--baseline") == 0) {
+            baseline_path = argv[++i];
+        } else if (strcmp(argv[i], "--threshold") == 0) {
+            threshold = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--min-delta") == 0) {
+            min_delta = atof(argv[++i]);
+        }
+    }
+
+    CameraPath camera_path;
+    if (camera_name == "orbit") {
+        camera_path = CameraPath::ORBIT;
+    } else if (camera_name == "flyby") {
+        camera_path = CameraPath::FLYBY;
+    } else if (camera_name == "static") {
+        camera_path = CameraPath::STATIC;
+    } else {
+        LOG_ERROR("unknown camera path {}, expected orbit, flyby or static", camera_name);
+        return 2;
+    }
+
+    // only the generated scene is drawn, not the renderer's default helmet
+    auto renderer = std::make_unique<Renderer>(width, height, nullptr, false);
+    renderer->GetScene()->SetRecordingThreadCount(recording_threads);
+    SceneGenerator generator(config, scene_dir);
+    if (!generator.Populate(*renderer->GetScene())) {
+        return 2;
+    }
+
+    u32 total = warmup + frames;
+    std::array<std::vector<f64>, PHASE_COUNT> samples;
+    for (auto &phase : samples) {
+        phase.resize(total, 0.0);
+    }
+    std::vector<bool> retired(total, false);
+    auto retire = [&](const std::vector<FrameTiming> &timings) {
+        for (const FrameTiming &timing : timings) {
+            if (timing.frame < total) {
+                samples[WAIT][timing.frame] = timing.wait_ms;
+                samples[RECORD][timing.frame] = timing.record_ms;
+                samples[GPU][timing.frame] = timing.gpu_ms;
+                retired[timing.frame] = true;
+            }
+        }
+    };
+
+    // the warmup holds the first view, it covers pipeline creation, the atmosphere precompute and the first uploads
+    auto camera = renderer->GetMainCamera();
+    for (u32 i = 0; i < total; i++) {
+        f32 t = i < warmup ? 0.0f : static_cast<f32>(i - warmup) / static_cast<f32>(frames);
+        auto begin = std::chrono::steady_clock::now();
+        PlaceCamera(*camera, camera_path, t, generator.GetCenter(), generator.GetExtent());
+        renderer->Update();
+        auto updated = std::chrono::steady_clock::now();
+        renderer->Render();
+        auto rendered = std::chrono::steady_clock::now();
+        retire(renderer->CollectFrameTimings());
+
+        samples[FRAME][i] = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        samples[UPDATE][i] = std::chrono::duration<f64, std::milli>(updated - begin).count();
+        samples[RENDER][i] = std::chrono::duration<f64, std::milli>(rendered - updated).count();
+    }
+    renderer->Wait();
+    retire(renderer->CollectFrameTimings());
+
+    nlohmann::json report;
+    const SceneConfig &scene = generator.GetConfig();
+    report["scene"] = {{"models", scene.model_count},       {"instances", scene.instance_count},
+                       {"primitives", scene.primitive_count}, {"segments", scene.sphere_segments},
+                       {"depth", scene.hierarchy_depth},      {"textures", scene.texture_count},
+                       {"texture_size", scene.texture_size},  {"lights", scene.light_count},
+                       {"seed", scene.seed}};
+    report["run"] = {{"camera", camera_name}, {"frames", frames},  {"warmup", warmup},
+                     {"width", width},        {"height", height}, {"record_threads", recording_threads}};
+
+    std::array<std::vector<f64>, PHASE_COUNT> measured;
+    for (u32 i = warmup; i < total; i++) {
+        if (!retired[i]) {
+            continue;
+        }
+        for (u32 phase = 0; phase < PHASE_COUNT; phase++) {
+            measured[phase].push_back(samples[phase][i]);
+        }
+    }
+    if (measured[FRAME].empty()) {
+        LOG_ERROR("no measured frame retired");
+        return 2;
+    }
+    report["measured_frames"] = measured[FRAME].size();
+    for (u32 phase = 0; phase < PHASE_COUNT; phase++) {
+        nlohmann::json summary = Summarize(measured[phase]);
+        LOG_INFO("{}: mean {:.3f}, p50 {:.3f}, p95 {:.3f}, p99 {:.3f}, max {:.3f}", PHASE_NAMES[phase],
+                 summary["mean"].get<f64>(), summary["p50"].get<f64>(), summary["p95"].get<f64>(),
+                 summary["p99"].get<f64>(), summary["max"].get<f64>());
+        report["metrics"][PHASE_NAMES[phase]] = summary;
+    }
+
+    i32 regressions = 0;
+    if (!baseline_path.empty()) {
+        regressions = CompareBaseline(report, baseline_path, threshold / 100.0, min_delta);
+    }
+
+    std::ofstream file(output_path, std::ios::trunc);
+    file << report.dump(4) << "\n";
+    if (!file.good()) {
+        LOG_ERROR("failed to write {}", output_path);
+        return 2;
+    }
+    LOG_INFO("report written to {}", output_path);
+
+    if (regressions < 0) {
+        return 2;
+    }
+    if (regressions > 0) {
+        LOG_ERROR("{} percentiles regressed against {}", regressions, baseline_path);
+        return 1;
+    }
+    return 0;
+}
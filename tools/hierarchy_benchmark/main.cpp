@@ -0,0 +1,183 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <runtime/core/log/Log.h>
+#include <runtime/scene/model/TransformHierarchy.h>
+
+using namespace Horizon;
+
+namespace {
+
+struct Trs {
+    Math::vec3 translation;
+    Math::quat rotation;
+    Math::vec3 scale;
+};
+
+// the node update the flat hierarchy replaced: every node walks up to the root for its matrix, and the model
+// re-enters the update of every descendant through UpdateNodeModelMatrix
+struct RecursiveNode {
+    Trs trs;
+    RecursiveNode *parent = nullptr;
+    std::vector<RecursiveNode *> children;
+    Math::mat4 world = Math::mat4(1.0f);
+
+    Math::mat4 LocalMatrix() const noexcept {
+        return Math::translate(Math::mat4(1.0f), trs.translation) * Math::mat4_cast(trs.rotation) *
+               Math::scale(Math::mat4(1.0f), trs.scale);
+    }
+
+    void Update(const Math::mat4 &model) noexcept {
+        Math::mat4 m = LocalMatrix();
+        for (RecursiveNode *p = parent; p; p = p->parent) {
+            m = p->LocalMatrix() * m;
+        }
+        world = model * m;
+        for (RecursiveNode *child : children) {
+            child->Update(model);
+        }
+    }
+};
+
+void UpdateRecursive(RecursiveNode *node, const Math::mat4 &model) noexcept {
+    node->Update(model);
+    for (RecursiveNode *child : node->children) {
+        UpdateRecursive(child, model);
+    }
+}
+
+// parents in pre order, -1 for roots
+std::vector<i32> Chain(u32 depth) noexcept {
+    std::vector<i32> parents(depth);
+    for (u32 i = 0; i < depth; i++) {
+        parents[i] = static_cast<i32>(i) - 1;
+    }
+    return parents;
+}
+
+std::vector<i32> Wide(u32 children) noexcept {
+    std::vector<i32> parents(children + 1, 0);
+    parents[0] = -1;
+    return parents;
+}
+
+void Tree(std::vector<i32> &parents, i32 parent, u32 fanout, u32 depth) noexcept {
+    i32 node = static_cast<i32>(parents.size());
+    parents.push_back(parent);
+    if (depth > 0) {
+        for (u32 c = 0; c < fanout; c++) {
+            Tree(parents, node, fanout, depth - 1);
+        }
+    }
+}
+
+// mean us per call, repeated for at least min_ms
+f64 TimePerCall(f64 min_ms, const std::function<void()> &call) noexcept {
+    u64 calls = 0;
+    auto begin = std::chrono::steady_clock::now();
+    f64 elapsed_ms = 0.0;
+    do {
+        call();
+        calls++;
+        elapsed_ms = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    } while (elapsed_ms < min_ms);
+    return elapsed_ms * 1e3 / static_cast<f64>(calls);
+}
+
+void Run(const std::string &name, const std::vector<i32> &parents, f64 min_ms) noexcept {
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<f32> unit(-1.0f, 1.0f);
+    u32 node_count = static_cast<u32>(parents.size());
+    std::vector<Trs> trs(node_count);
+    for (Trs &t : trs) {
+        t.translation = Math::vec3(unit(rng), unit(rng), unit(rng));
+        t.rotation = Math::angleAxis(unit(rng), Math::normalize(Math::vec3(unit(rng), unit(rng), 1.0f)));
+        t.scale = Math::vec3(1.0f);
+    }
+
+    std::vector<RecursiveNode> nodes(node_count);
+    std::vector<RecursiveNode *> roots;
+    TransformHierarchy hierarchy;
+    for (u32 i = 0; i < node_count; i++) {
+        nodes[i].trs = trs[i];
+        if (parents[i] > -1) {
+            nodes[i].parent = &nodes[parents[i]];
+            nodes[parents[i]].children.push_back(&nodes[i]);
+        } else {
+            roots.push_back(&nodes[i]);
+        }
+        hierarchy.AddNode(parents[i], trs[i].translation, trs[i].rotation, trs[i].scale);
+    }
+
+    // the root alternates between two matrices so every call moves the whole hierarchy
+    Math::mat4 models[2] = {Math::translate(Math::mat4(1.0f), Math::vec3(1.0f, 2.0f, 3.0f)),
+                            Math::translate(Math::mat4(1.0f), Math::vec3(3.0f, 2.0f, 1.0f))};
+    u32 flip = 0;
+    f64 recursive_us = TimePerCall(min_ms, [&]() {
+        flip ^= 1;
+        for (RecursiveNode *root : roots) {
+            UpdateRecursive(root, models[flip]);
+        }
+    });
+    f64 root_us = TimePerCall(min_ms, [&]() {
+        flip ^= 1;
+        hierarchy.SetRoot(models[flip]);
+        hierarchy.Update();
+    });
+
+    // both sides end on the same root, the results only differ by the order the matrices were multiplied in
+    for (RecursiveNode *root : roots) {
+        UpdateRecursive(root, models[flip]);
+    }
+    f32 max_error = 0.0f;
+    for (u32 i = 0; i < node_count; i++) {
+        for (u32 c = 0; c < 4; c++) {
+            for (u32 r = 0; r < 4; r++) {
+                max_error = std::max(max_error, std::abs(hierarchy.GetWorld(i)[c][r] - nodes[i].world[c][r]));
+            }
+        }
+    }
+
+    f64 clean_us = TimePerCall(min_ms, [&]() { hierarchy.Update(); });
+    u32 leaf = node_count - 1;
+    f64 leaf_us = TimePerCall(min_ms, [&]() {
+        trs[leaf].translation.x += 1e-3f;
+        hierarchy.SetLocal(leaf, trs[leaf].translation, trs[leaf].rotation, trs[leaf].scale);
+        hierarchy.Update();
+    });
+
+    LOG_INFO("{:<16} {:>6} nodes  recursive {:10.2f} us  flat: root moved {:8.2f} us, clean {:6.3f} us, one leaf "
+             "{:6.3f} us  max diff {:.2e}",
+             name, node_count, recursive_us, root_us, clean_us, leaf_us, max_error);
+}
+
+} // namespace
+
+// times a full update of deep, wide and bushy node hierarchies, the flat TransformHierarchy against the recursive
+// per node update it replaced.
+//   --min-ms <n>  time each case for at least n ms, 200 by default
+int main(int argc, char *argv[]) {
+    f64 min_ms = 200.0;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--min-ms") == 0) {
+            min_ms = std::max(1.0, atof(argv[++i]));
+        }
+    }
+
+    Run("chain depth 64", Chain(64), min_ms);
+    Run("chain depth 256", Chain(256), min_ms);
+    Run("wide, 1 root", Wide(1000), min_ms);
+    Run("wide, 1 root", Wide(10000), min_ms);
+    std::vector<i32> tree;
+    Tree(tree, -1, 8, 4);
+    Run("8-ary, depth 4", tree, min_ms);
+    return 0;
+}
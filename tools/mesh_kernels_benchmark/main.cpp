@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <runtime/core/log/Log.h>
+#include <runtime/scene/model/MeshKernels.h>
+
+using namespace Horizon;
+
+namespace {
+
+// position, normal and uv interleaved in one buffer view like most gltf exporters write them
+constexpr u64 VERTEX_STRIDE = 8;
+
+// fastest of the runs, the first run also faults the destination pages in
+f64 BestOf(u32 runs, const std::function<void()> &kernel) noexcept {
+    f64 best_ms = 0.0;
+    for (u32 r = 0; r < runs; r++) {
+        auto begin = std::chrono::steady_clock::now();
+        kernel();
+        f64 ms = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        best_ms = r == 0 ? ms : std::min(best_ms, ms);
+    }
+    return best_ms;
+}
+
+// ms of both versions, and whether their outputs are bit identical
+bool Report(const char *name, u64 count, f64 simd_ms, f64 scalar_ms, bool identical) noexcept {
+    LOG_INFO("{:<16} {:>9} elements  {} {:8.3f} ms  scalar {:8.3f} ms  {:5.2f}x  {}", name, count,
+             MeshKernels::GetInstructionSet(), simd_ms, scalar_ms, scalar_ms / simd_ms,
+             identical ? "bit identical" : "MISMATCH");
+    return identical;
+}
+
+} // namespace
+
+// times the mesh decoding kernels against their scalar reference versions and checks their outputs match.
+// build with -DHORIZON_ENABLE_AVX2=ON to time the avx2 kernels.
+//   --vertices <n>  vertices gathered, 1M by default
+//   --indices <n>   indices widened per index size, 3M by default
+//   --runs <n>      runs per kernel, the fastest is reported, 10 by default
+int main(int argc, char *argv[]) {
+    u64 vertex_count = 1 << 20;
+    u64 index_count = 3 << 20;
+    u32 runs = 10;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--vertices") == 0) {
+            vertex_count = static_cast<u64>(std::max(1, atoi(argv[++i])));
+        } else if (strcmp(argv[i], "--indices") == 0) {
+            index_count = static_cast<u64>(std::max(1, atoi(argv[++i])));
+        } else if (strcmp(argv[i], "--runs") == 0) {
+            runs = static_cast<u32>(std::max(1, atoi(argv[++i])));
+        }
+    }
+
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<f32> unit(-1.0f, 1.0f);
+    std::vector<f32> interleaved(vertex_count * VERTEX_STRIDE);
+    for (f32 &value : interleaved) {
+        value = unit(rng);
+    }
+    const f32 *positions = interleaved.data();
+    const f32 *normals = interleaved.data() + 3;
+    const f32 *uvs = interleaved.data() + 6;
+
+    bool identical = true;
+    std::vector<Vertex> simd_vertices(vertex_count), scalar_vertices(vertex_count);
+    f64 simd_ms = BestOf(runs, [&]() {
+        MeshKernels::GatherVertices(simd_vertices.data(), vertex_count, positions, VERTEX_STRIDE, normals,
+                                    VERTEX_STRIDE, uvs, VERTEX_STRIDE);
+    });
+    f64 scalar_ms = BestOf(runs, [&]() {
+        MeshKernels::GatherVerticesScalar(scalar_vertices.data(), vertex_count, positions, VERTEX_STRIDE, normals,
+                                          VERTEX_STRIDE, uvs, VERTEX_STRIDE);
+    });
+    identical &= Report("gather vertices", vertex_count, simd_ms, scalar_ms,
+                        memcmp(simd_vertices.data(), scalar_vertices.data(), vertex_count * sizeof(Vertex)) == 0);
+
+    // indices stay below the vertex count like in a real primitive, the base vertex rebases them
+    constexpr u32 base_vertex = 12345;
+    std::vector<u32> simd_indices(index_count), scalar_indices(index_count);
+    for (u32 component_size : {1u, 2u, 4u}) {
+        u64 max_index = std::min<u64>((1ull << (component_size * 8)) - 1, vertex_count - 1);
+        std::uniform_int_distribution<u64> index(0, max_index);
+        std::vector<u8> source(index_count * component_size);
+        for (u64 i = 0; i < index_count; i++) {
+            u64 value = index(rng);
+            memcpy(source.data() + i * component_size, &value, component_size);
+        }
+        simd_ms = BestOf(runs, [&]() {
+            MeshKernels::WidenIndices(simd_indices.data(), source.data(), index_count, component_size, base_vertex);
+        });
+        scalar_ms = BestOf(runs, [&]() {
+            MeshKernels::WidenIndicesScalar(scalar_indices.data(), source.data(), index_count, component_size,
+                                            base_vertex);
+        });
+        std::string name = "widen u" + std::to_string(component_size * 8);
+        identical &= Report(name.c_str(), index_count, simd_ms, scalar_ms,
+                            memcmp(simd_indices.data(), scalar_indices.data(), index_count * sizeof(u32)) == 0);
+    }
+    return identical ? 0 : 1;
+}